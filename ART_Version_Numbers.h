@@ -26,7 +26,7 @@
 
 #define ART_VERSION_MAJOR       "2"
 #define ART_VERSION_MINOR       "1"
-#define ART_VERSION_PATCH       "2"
+#define ART_VERSION_PATCH       "3"
 #define ART_VERSION_DEVTAG      ""
-#define ART_VERSION_STRING      "2.1.2"
+#define ART_VERSION_STRING      "2.1.3"
 
@@ -40,6 +40,7 @@
 ART_MODULE_INTERFACE(ARM_Action)
 
 #import "ART_Scenegraph.h"
+#import "ArnBSPTree.h"
 
 /**
  * @brief Internal Spectral Representation selection action
@@ -518,6 +519,59 @@ ArNode <ArpAction> * scenegraph_bounding_box_insertion(
         ART_GV  * art_gv
         );
 
+/* ---------------------------------------------------------------------------
+
+    'ArRayCastingAccelerationStructure'
+
+    Selects which spatial data structure the action sequence returned by
+    CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE builds over the leaf
+    nodes of the scene graph. The default is the kd-tree (ArnBSPTree).
+
+    The selection has to be made before the action sequence is first
+    used, since the sequence is created once and then cached.
+
+------------------------------------------------------------------------aw- */
+
+typedef enum ArRayCastingAccelerationStructure
+{
+    arraycastingaccelerationstructure_bsp_tree = 0,
+    arraycastingaccelerationstructure_bvh      = 1
+}
+ArRayCastingAccelerationStructure;
+
+void art_set_raycasting_acceleration_structure(
+        ART_GV                             * art_gv,
+        ArRayCastingAccelerationStructure    newStructure
+        );
+
+ArRayCastingAccelerationStructure art_raycasting_acceleration_structure(
+        const ART_GV  * art_gv
+        );
+
+//   Split search used if the acceleration structure is a BSP tree, see
+//   ArnBSPTree.h. The same caveat as above applies.
+
+void art_set_bsp_tree_split_search(
+        ART_GV                * art_gv,
+        ArBSPTreeSplitSearch    newSplitSearch
+        );
+
+ArBSPTreeSplitSearch art_bsp_tree_split_search(
+        const ART_GV  * art_gv
+        );
+
+//   Optional cache file for the BSP tree (see ArnBSPTree.h), 0 if none is
+//   to be used. Again, the same caveat applies.
+
+void art_set_bsp_tree_cache_file_name(
+        ART_GV      * art_gv,
+        const char  * newCacheFileName
+        );
+
+const char * art_bsp_tree_cache_file_name(
+        const ART_GV  * art_gv
+        );
+
 ArNode <ArpAction> * scenegraph_raycasting_optimisations_create(
         ART_GV  * art_gv
         );
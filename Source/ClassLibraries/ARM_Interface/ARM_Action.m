@@ -36,6 +36,9 @@ typedef struct ARM_Actions_GV
 {
     ArNode <ArpAction>      * scenegraph_bounding_box_insertion;
     ArNode <ArpAction>      * scenegraph_raycasting_optimisations;
+    ArRayCastingAccelerationStructure  raycasting_acceleration_structure;
+    ArBSPTreeSplitSearch               bsp_tree_split_search;
+    ArSymbol                           bsp_tree_cache_file_name;
 }
 ARM_Actions_GV;
 
@@ -43,6 +46,12 @@ ARM_Actions_GV;
     art_gv->ar2m_actions_gv->scenegraph_bounding_box_insertion
 #define CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE_GV \
     art_gv->ar2m_actions_gv->scenegraph_raycasting_optimisations
+#define RAYCASTING_ACCELERATION_STRUCTURE_GV \
+    art_gv->ar2m_actions_gv->raycasting_acceleration_structure
+#define BSP_TREE_SPLIT_SEARCH_GV \
+    art_gv->ar2m_actions_gv->bsp_tree_split_search
+#define BSP_TREE_CACHE_FILE_NAME_GV \
+    art_gv->ar2m_actions_gv->bsp_tree_cache_file_name
 
 typedef struct ARM_ScenegraphActions_GV
 {
@@ -93,6 +102,11 @@ ART_MODULE_INITIALISATION_FUNCTION
 
     SCENEGRAPH_INSERT_BOUNDING_BOXES_GV = 0;
     CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE_GV = 0;
+    RAYCASTING_ACCELERATION_STRUCTURE_GV =
+        arraycastingaccelerationstructure_bsp_tree;
+    BSP_TREE_SPLIT_SEARCH_GV =
+        arbsptreesplitsearch_sorted_events;
+    BSP_TREE_CACHE_FILE_NAME_GV = 0;
 
     ARNODE_SINGLETON_CREATOR(SCENEGRAPH_INSERT_BOUNDING_BOXES);
     ARNODE_SINGLETON_CREATOR(CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE);
@@ -189,10 +203,89 @@ ArNode <ArpAction> * scenegraph_bounding_box_insertion(
 
 #define WITH_NEW_RSA
 
+void art_set_raycasting_acceleration_structure(
+        ART_GV                             * art_gv,
+        ArRayCastingAccelerationStructure    newStructure
+        )
+{
+    if ( CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE_GV )
+        ART_ERRORHANDLING_WARNING(
+            "ray casting acceleration structure changed after the "
+            "standard action sequence was created - change has no effect"
+            );
+
+    RAYCASTING_ACCELERATION_STRUCTURE_GV = newStructure;
+}
+
+ArRayCastingAccelerationStructure art_raycasting_acceleration_structure(
+        const ART_GV  * art_gv
+        )
+{
+    return RAYCASTING_ACCELERATION_STRUCTURE_GV;
+}
+
+void art_set_bsp_tree_split_search(
+        ART_GV                * art_gv,
+        ArBSPTreeSplitSearch    newSplitSearch
+        )
+{
+    if ( CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE_GV )
+        ART_ERRORHANDLING_WARNING(
+            "BSP tree split search changed after the standard "
+            "action sequence was created - change has no effect"
+            );
+
+    BSP_TREE_SPLIT_SEARCH_GV = newSplitSearch;
+}
+
+ArBSPTreeSplitSearch art_bsp_tree_split_search(
+        const ART_GV  * art_gv
+        )
+{
+    return BSP_TREE_SPLIT_SEARCH_GV;
+}
+
+void art_set_bsp_tree_cache_file_name(
+        ART_GV      * art_gv,
+        const char  * newCacheFileName
+        )
+{
+    if ( CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE_GV )
+        ART_ERRORHANDLING_WARNING(
+            "BSP tree cache file set after the standard "
+            "action sequence was created - change has no effect"
+            );
+
+    BSP_TREE_CACHE_FILE_NAME_GV =
+        newCacheFileName ? arsymbol( art_gv, newCacheFileName ) : 0;
+}
+
+const char * art_bsp_tree_cache_file_name(
+        const ART_GV  * art_gv
+        )
+{
+    return BSP_TREE_CACHE_FILE_NAME_GV;
+}
+
 ArNode <ArpAction> * scenegraph_raycasting_optimisations_create(
         ART_GV  * art_gv
         )
 {
+#ifdef WITH_NEW_RSA
+    ArNode <ArpAction>  * createAccelerationStructureAction;
+
+    if (   RAYCASTING_ACCELERATION_STRUCTURE_GV
+        == arraycastingaccelerationstructure_bvh )
+        createAccelerationStructureAction =
+            [ ALLOC_INIT_OBJECT(ArnCreateBVHAction) ];
+    else
+        createAccelerationStructureAction =
+            [ ALLOC_INIT_OBJECT(ArnCreateBSPTreeAction)
+                :   BSP_TREE_SPLIT_SEARCH_GV
+                :   BSP_TREE_CACHE_FILE_NAME_GV
+                ];
+#endif
+
     return
         arnactionsequence_message(
             art_gv,
@@ -215,7 +308,7 @@ ArNode <ArpAction> * scenegraph_raycasting_optimisations_create(
 
             [ ALLOC_INIT_OBJECT(ArnCollectLeafNodeBBoxesAction) ],
 
-            [ ALLOC_INIT_OBJECT(ArnCreateBSPTreeAction) ],
+            createAccelerationStructureAction,
 #endif
             ACTION_SEQUENCE_END
             );
@@ -193,6 +193,17 @@ ART_MODULE_INTERFACE(ARM_PathspaceIntegrator)
  * Uses weighed light sampling. Requires to have a light source collector before
  * the pathtracing action on the action sequence.
  *
+ * @def arpathtracermode_light_tree_light_sampling
+ * @brief Light sampling with a light tree
+ * Like light sampling, but lights are selected via a bounding volume
+ * hierarchy over the light sources, according to their estimated
+ * contribution to each shaded point, instead of in proportion to their
+ * power. Worthwhile for scenes with many light sources.
+ *
+ * @def arpathtracermode_light_tree_mis
+ * @brief Multiple importance sampling with a light tree
+ * Like multiple importance sampling, with light selection via a light tree.
+ *
  */
 
 /**
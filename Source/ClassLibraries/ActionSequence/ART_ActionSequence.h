@@ -32,6 +32,7 @@ ART_LIBRARY_INTERFACE(ART_ActionSequence)
 #import "ArnActionSequence.h"
 #import "ArnNodeAction.h"
 #import "ArnNodeStack.h"
+#import "ArnCachedAction.h"
 #import "ScenegraphActions.h"
 
 // ===========================================================================
@@ -34,6 +34,7 @@ ART_LIBRARY_INITIALISATION_FUNCTION
     ART_PERFORM_MODULE_INITIALISATION( ArnActionSequence )
     ART_PERFORM_MODULE_INITIALISATION( ArnNodeAction )
     ART_PERFORM_MODULE_INITIALISATION( ArnNodeStack )
+    ART_PERFORM_MODULE_INITIALISATION( ArnCachedAction )
     ART_PERFORM_MODULE_INITIALISATION( ScenegraphActions )
 )
 
@@ -0,0 +1,74 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+
+#include "ART_Foundation.h"
+
+ART_MODULE_INTERFACE(ArnCachedAction)
+
+#import "ART_Scenegraph.h"
+
+/* ---------------------------------------------------------------------------
+
+    'ArnCachedAction'
+
+    Wraps an action that takes one node from the stack, and leaves a fixed
+    number of results in its place, e.g. the creation of the ray casting
+    acceleration structure (one result: the optimised world), or the light
+    source collector (two: the light source collection and the world).
+
+    The first time it is performed, the wrapped action is run, and its
+    results are kept. As long as the node it is performed on afterwards is
+    the same, the kept results are put on the stack without running the
+    wrapped action again. Any other node on the stack clears the cache.
+
+    This is only correct for actions that do nothing but compute their
+    results from the node they are given, and it is meant for applications
+    which run the same scene graph several times, such as the render server
+    mode of artist.
+
+------------------------------------------------------------------------aw- */
+
+@interface ArnCachedAction
+        : ArnUnary
+        < ArpConcreteClass, ArpCoding, ArpAction >
+{
+    unsigned int        numberOfResults;
+    ArNode            * cachedInput;
+    ArNodeRefDynArray   cachedResults;
+}
+
+- (id) init
+        : (ArNode <ArpAction> *) newAction
+        : (unsigned int) newNumberOfResults
+        ;
+
+- (void) clearCache
+        ;
+
+@end
+
+// ===========================================================================
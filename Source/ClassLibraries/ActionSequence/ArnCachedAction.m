@@ -0,0 +1,206 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+
+#define ART_MODULE_NAME     ArnCachedAction
+
+#import "ArnCachedAction.h"
+
+ART_MODULE_INITIALISATION_FUNCTION
+(
+    (void) art_gv;
+    [ ArnCachedAction registerWithRuntime ];
+)
+
+ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
+
+
+#define REPORTER    ART_GLOBAL_REPORTER
+
+#define CACHED_ACTION \
+    ((ArNode <ArpAction> *) ARNUNARY_SUBNODE)
+
+@implementation ArnCachedAction
+
+ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnCachedAction)
+ARPACTION_DEFAULT_IMPLEMENTATION(ArnCachedAction)
+
+- (id) init
+        : (ArNode <ArpAction> *) newAction
+        : (unsigned int) newNumberOfResults
+{
+    self =
+        [ super init
+            :   HARD_NODE_REFERENCE(newAction)
+            ];
+
+    if ( self )
+    {
+        numberOfResults = newNumberOfResults;
+        cachedInput = 0;
+        cachedResults = arnoderefdynarray_init( 0 );
+    }
+
+    return self;
+}
+
+- (void) dealloc
+{
+    [ self clearCache ];
+
+    arnoderefdynarray_free_contents( & cachedResults );
+
+    [ super dealloc ];
+}
+
+- (id) copy
+{
+    ArnCachedAction  * copiedInstance = [ super copy ];
+
+    //   Copies start out with an empty cache of their own.
+
+    copiedInstance->numberOfResults = numberOfResults;
+    copiedInstance->cachedInput = 0;
+    copiedInstance->cachedResults = arnoderefdynarray_init( 0 );
+
+    return copiedInstance;
+}
+
+- (id) deepSemanticCopy
+        : (ArnGraphTraversal *) traversal
+{
+    ArnCachedAction  * copiedInstance =
+        [ super deepSemanticCopy
+            :   traversal
+            ];
+
+    copiedInstance->numberOfResults = numberOfResults;
+    copiedInstance->cachedInput = 0;
+    copiedInstance->cachedResults = arnoderefdynarray_init( 0 );
+
+    return copiedInstance;
+}
+
+- (void) clearCache
+{
+    arnoderefdynarray_free_contents( & cachedResults );
+    cachedResults = arnoderefdynarray_init( 0 );
+
+    if ( cachedInput )
+        RELEASE_OBJECT( cachedInput );
+
+    cachedInput = 0;
+}
+
+- (void) performOn
+        : (ArNode <ArpNodeStack> *) nodeStack
+{
+    ArNodeRef  input_Ref = [ nodeStack pop ];
+
+    ArNode  * input = ARNODEREF_POINTER(input_Ref);
+
+    if ( ! input )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "no node to perform cached action on found on node stack"
+            );
+
+    if ( input == cachedInput )
+    {
+        for ( unsigned int i = 0; i < numberOfResults; i++ )
+            [ nodeStack push
+                :   arnoderefdynarray_i( & cachedResults, i )
+                ];
+
+        RELEASE_NODE_REF(input_Ref);
+
+        return;
+    }
+
+    [ self clearCache ];
+
+    //   The input is retained, so that its address cannot be re-used by
+    //   a different node while the results computed from it are kept.
+
+    cachedInput = RETAIN_OBJECT( input );
+
+    [ nodeStack push
+        :   input_Ref
+        ];
+
+    RELEASE_NODE_REF(input_Ref);
+
+    [ CACHED_ACTION performOn
+        :   nodeStack
+        ];
+
+    //   The results are taken off the stack top first, and put back in
+    //   their original order.
+
+    ArNodeRef  * result_Ref = ALLOC_ARRAY( ArNodeRef, numberOfResults );
+
+    for ( unsigned int i = numberOfResults; i > 0; i-- )
+    {
+        result_Ref[i - 1] = [ nodeStack pop ];
+
+        if ( ! ARNODEREF_POINTER(result_Ref[i - 1]) )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "%s left fewer than %u results on the node stack"
+                ,   [ CACHED_ACTION cStringClassName ]
+                ,   numberOfResults
+                );
+    }
+
+    for ( unsigned int i = 0; i < numberOfResults; i++ )
+    {
+        arnoderefdynarray_push( & cachedResults, result_Ref[i] );
+
+        [ nodeStack push
+            :   result_Ref[i]
+            ];
+
+        RELEASE_NODE_REF(result_Ref[i]);
+    }
+
+    FREE_ARRAY( result_Ref );
+}
+
+- (void) code
+        : (ArcObject <ArpCoder> *) coder
+{
+    [ super code: coder ];
+
+    [ coder codeUInt: & numberOfResults ];
+
+    if ( [ coder isReading ] )
+    {
+        cachedInput = 0;
+        cachedResults = arnoderefdynarray_init( 0 );
+    }
+}
+
+@end
+
+// ===========================================================================
@@ -30,6 +30,7 @@ ART_MODULE_INTERFACE(ScenegraphActions)
 
 #import "ART_Scenegraph.h"
 #import "ART_RayCasting.h"
+#import "ArnBSPTree.h"
 
 #import "ArnNodeAction.h"
 
@@ -90,11 +91,27 @@ ART_MODULE_INTERFACE(ScenegraphActions)
         : ArNode
         < ArpCoding, ArpConcreteClass, ArpAction >
 {
+    ArBSPTreeSplitSearch  splitSearch;
+    ArSymbol              cacheFileName;
 }
 
 - (id) init
         ;
 
+- (id) init
+        : (ArBSPTreeSplitSearch) newSplitSearch
+        ;
+
+- (id) init
+        : (ArBSPTreeSplitSearch) newSplitSearch
+        : (const char *) newCacheFileName
+        ;
+
+@end
+
+@interface ArnCreateBVHAction
+        : ArNode
+        < ArpCoding, ArpConcreteClass, ArpAction >
 @end
 
 // ===========================================================================
@@ -486,10 +486,35 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnCreateBSPTreeAction)
 ARPACTION_DEFAULT_IMPLEMENTATION(ArnCreateBSPTreeAction)
 
 - (id) init
+{
+    return
+        [ self init
+            :   arbsptreesplitsearch_sorted_events
+            ];
+}
+
+- (id) init
+        : (ArBSPTreeSplitSearch) newSplitSearch
+{
+    return
+        [ self init
+            :   newSplitSearch
+            :   0
+            ];
+}
+
+- (id) init
+        : (ArBSPTreeSplitSearch) newSplitSearch
+        : (const char *) newCacheFileName
 {
     self = [ super init ];
 
-//  method kept to store BSP creation parameters later in the dev cycle
+    if ( self )
+    {
+        splitSearch = newSplitSearch;
+        cacheFileName =
+            newCacheFileName ? arsymbol( art_gv, newCacheFileName ) : 0;
+    }
     
     return self;
 }
@@ -538,6 +563,14 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnCreateBSPTreeAction)
             :   HARD_NODE_REFERENCE(sceneGeometry)
             :   leafNodeBBoxCollection
             :   operationTree
+            :   splitSearch
+            :   cacheFileName
+            ];
+
+    if ( [ bspTree wasLoadedFromCache ] )
+        [ REPORTER printf
+            :   "BSP tree loaded from cache file \"%s\"\n"
+            ,   cacheFileName
             ];
 
     [ worldNode setScene
@@ -556,6 +589,11 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnCreateBSPTreeAction)
     RELEASE_NODE_REF( node_Ref_Scene );
 }
 
+//   The split search and the cache file name are coded since ART 2.1.3;
+//   action sequences coded by earlier versions lack them, and cannot be
+//   read back. Coded files carry the ART version that wrote them, and
+//   reading one from another version warns about that.
+
 - (void) code
         : (ArcObject <ArpCoder> *) coder
 {
@@ -563,12 +601,82 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnCreateBSPTreeAction)
         :   coder
         ];
 
-/*
-    method kept to store BSP creation parameters later in the dev cycle
+    [ coder codeInt
+        :   (int *) & splitSearch
+        ];
+
     [ coder codeSymbol
-        : & fileName
+        : & cacheFileName
+        ];
+}
+
+@end
+
+@implementation ArnCreateBVHAction
+
+ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnCreateBVHAction)
+ARPACTION_DEFAULT_IMPLEMENTATION(ArnCreateBVHAction)
+
+- (void) performOn
+        : (ArNode <ArpNodeStack> *) nodeStack
+{
+    ArNodeRef  node_Ref_Scene  = [ nodeStack pop ];
+
+    ART_ERRORHANDLING_MANDATORY_ARPROTOCOL_CHECK(
+        ARNODEREF_POINTER(node_Ref_Scene),
+        ArpWorld
+        );
+
+    ArNode <ArpWorld>  * worldNode =
+        (ArNode <ArpWorld> *)ARNODEREF_POINTER(node_Ref_Scene);
+
+    ArNode  * sceneGeometry = [ worldNode scene ];
+
+    ArNodeRef  node_Ref_BBoxes  = [ nodeStack pop ];
+
+    ART_ERRORHANDLING_MANDATORY_CLASS_MEMBERSHIP_CHECK(
+        ARNODEREF_POINTER(node_Ref_BBoxes),
+        ArnLeafNodeBBoxCollection
+        );
+
+    ArnLeafNodeBBoxCollection  * leafNodeBBoxCollection =
+        (ArnLeafNodeBBoxCollection *) ARNODEREF_POINTER(node_Ref_BBoxes);
+
+    ArNodeRef node_Ref_OpTree = [ nodeStack pop ];
+
+    ART_ERRORHANDLING_MANDATORY_CLASS_MEMBERSHIP_CHECK(
+        ARNODEREF_POINTER(node_Ref_OpTree),
+        ArnOperationTree
+        );
+
+    ArnOperationTree  * operationTree =
+        (ArnOperationTree  *)ARNODEREF_POINTER(node_Ref_OpTree);
+
+    [ REPORTER beginTimedAction
+        :   "creating BVH"
+        ];
+
+    ArnBVH  * bvh =
+        [ ALLOC_INIT_OBJECT(ArnBVH)
+            :   HARD_NODE_REFERENCE(sceneGeometry)
+            :   leafNodeBBoxCollection
+            :   operationTree
+            ];
+
+    [ worldNode setScene
+        :   bvh
         ];
-*/
+
+    RELEASE_OBJECT( bvh );
+    RELEASE_NODE_REF( node_Ref_BBoxes );
+
+    [ REPORTER endAction ];
+
+    [ nodeStack push
+        :   node_Ref_Scene
+        ];
+
+    RELEASE_NODE_REF( node_Ref_Scene );
 }
 
 @end
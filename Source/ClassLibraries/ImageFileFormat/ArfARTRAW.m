@@ -611,6 +611,43 @@ do \
 } \
 while (0);
 
+//   Same as above, but the remainder of the line (minus leading blanks
+//   and the newline) is kept in a buffer of the given size.
+
+#define READ_LINE_STARTING_WITH_INTO(__file,__line_header,__buffer,__size) \
+do \
+{ \
+    int local_scanf_success = \
+        [ (__file) scanf \
+            :   __line_header \
+            ]; \
+\
+    TERMINATE_IF_SCANF_UNSUCCESSFUL( local_scanf_success ); \
+\
+    unsigned int  local_length = 0; \
+    char          local_c; \
+\
+    do \
+    { \
+        local_scanf_success = \
+            [ (__file) scanf \
+                :   "%c" \
+                , & local_c \
+                ]; \
+\
+        TERMINATE_IF_SCANF_UNSUCCESSFUL( local_scanf_success ); \
+\
+        if (    local_c != '\n' \
+             && ( local_length > 0 || local_c != ' ' ) \
+             && local_length + 1 < (__size) ) \
+            (__buffer)[local_length++] = local_c; \
+    } \
+    while ( local_c != '\n' ); \
+\
+    (__buffer)[local_length] = 0; \
+} \
+while (0);
+
 /* ----------------------------------------------------------------------
 
     Opening an ARTRAW for *reading*
@@ -675,7 +712,11 @@ while (0);
             ,   ARFARTRAW_VERSION
             );
 
-    //   ARTRAW 2.3 and lower had different header info
+    //   ARTRAW 2.3 and lower had different header info. Render time and
+    //   sample count are kept, e.g. for merging partial renders.
+
+    char  rendertime[256]  = "";
+    char  samplecount[256] = "";
 
     if ( artRawVersion < (float) 2.4 )
     {
@@ -688,8 +729,8 @@ while (0);
         READ_LINE_STARTING_WITH( file, "Platform:" );
         READ_LINE_STARTING_WITH( file, "Command line:" );
         READ_LINE_STARTING_WITH( file, "Creation date:" );
-        READ_LINE_STARTING_WITH( file, "Render time:" );
-        READ_LINE_STARTING_WITH( file, "Samples per pixel:" );
+        READ_LINE_STARTING_WITH_INTO( file, "Render time:", rendertime, 256 );
+        READ_LINE_STARTING_WITH_INTO( file, "Samples per pixel:", samplecount, 256 );
     }
 
     //   X and Y dimension
@@ -868,6 +909,12 @@ while (0);
             :   resolution
             ];
 
+    if ( rendertime[0] )
+        [ imageInfo setRendertimeString: rendertime ];
+
+    if ( samplecount[0] )
+        [ imageInfo setSamplecountString: samplecount ];
+
     scanline = ALLOC_ARRAY( ArLightAlpha *, XC(size) );
 
     for ( int i = 0; i < XC(size); i ++ )
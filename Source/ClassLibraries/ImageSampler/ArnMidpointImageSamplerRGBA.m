@@ -73,31 +73,51 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnMidpointImageSamplerRGBA)
     {
         YC(pixelCoord) = y + YC(imageOrigin) + 0.5;
 
-        for ( int x = 0; x < XC(imageSize); x++ )
-        {
-            XC(pixelCoord) = x + XC(imageOrigin) + 0.5;
+        //   The rays for a run of neighbouring pixels are handed to the
+        //   integrator in one go, so that it can trace them as a packet.
 
-            Ray3D              ray;
+        for ( int x = 0; x < XC(imageSize); x += RAY3DPACKET_MAX_SIZE )
+        {
+            Ray3D              ray[ RAY3DPACKET_MAX_SIZE ];
+            int                rayX[ RAY3DPACKET_MAX_SIZE ];
+            ArRGBA             sampleValue[ RAY3DPACKET_MAX_SIZE ];
             ArReferenceFrame   referenceFrame;
+            unsigned int       numberOfRays = 0;
 
-            if ( [ camera getWorldspaceRay
-                     : & VEC2D(
-                            XC(pixelCoord),
-                            YC(pixelCoord)
-                            )
-                     :   THREAD_RANDOM_GENERATOR
-                     : & referenceFrame
-                     : & ray ] )
+            int  x_end = M_MIN( x + RAY3DPACKET_MAX_SIZE, XC(imageSize) );
+
+            for ( int px = x; px < x_end; px++ )
             {
-                [ THREAD_PATHSPACE_INTEGRATOR calculateRGBASample
-                    : & ray
-                    : & RGB_PIXEL_SAMPLE_VALUE(x, y)
-                    ];
+                XC(pixelCoord) = px + XC(imageOrigin) + 0.5;
+
+                if ( [ camera getWorldspaceRay
+                         : & VEC2D(
+                                XC(pixelCoord),
+                                YC(pixelCoord)
+                                )
+                         :   THREAD_RANDOM_GENERATOR
+                         : & referenceFrame
+                         : & ray[numberOfRays] ] )
+                {
+                    rayX[numberOfRays++] = px;
+                }
+                else
+                {
+                    RGB_PIXEL_SAMPLE_VALUE(px, y) =
+                        ARRGBA(0, 0, 0, 0);
+                }
             }
-            else
+
+            if ( numberOfRays > 0 )
             {
-                RGB_PIXEL_SAMPLE_VALUE(x, y) =
-                    ARRGBA(0, 0, 0, 0);
+                [ THREAD_PATHSPACE_INTEGRATOR calculateRGBASamples
+                    :   ray
+                    :   numberOfRays
+                    :   sampleValue
+                    ];
+
+                for ( unsigned int i = 0; i < numberOfRays; i++ )
+                    RGB_PIXEL_SAMPLE_VALUE(rayX[i], y) = sampleValue[i];
             }
         }
         
@@ -120,8 +120,11 @@ ART_MODULE_INTERFACE(ArnStochasticBackwardsSampler)
     ArPathVertexptrDynArray  LightPaths;
     ArcHashgrid *hashgrid;
 
-    int lightPathsSizes;
-    pthread_mutex_t   LightPathsMutex;
+    //   Number of light subpath vertices each render thread contributes
+    //   to 'LightPaths' in the current iteration; the threads copy their
+    //   vertices into disjoint ranges of it, in thread order.
+
+    unsigned int    * lightPathsBucketSizes;
     pthread_mutex_t   HashgridsMutex;
 }
 
@@ -98,8 +98,12 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnStochasticBackwardsSampler)
             :numberOfResultImages
     ];
 
-    pthread_mutex_init(&LightPathsMutex, NULL);
     pthread_mutex_init(&HashgridsMutex, NULL);
+
+    if (lightPathsBucketSizes)
+        FREE_ARRAY(lightPathsBucketSizes);
+
+    lightPathsBucketSizes = ALLOC_ARRAY(unsigned int, numberOfRenderThreads);
     //   splatting kernel properties
 
     splattingKernelWidth = [RECONSTRUCTION_KERNEL supportSize];
@@ -416,10 +420,8 @@ typedef struct ArPixelID {
     threadPool = [[NSAutoreleasePool alloc] init];
 
 //    ArPathVertexptrDynArray *pathVertexArray = [input pointerValue];
-    if (arpvptrdynarray_size(renderBucket) > 1) {
-        arpv_free_arr_itrsc(art_gv, renderBucket);
-        arpvptrdynarray_free_contents(renderBucket);
-    }
+    [THREAD_PATHSPACE_INTEGRATOR resetLightPathVertices];
+    arpvptrdynarray_free_contents(renderBucket);
 
     const int TILE_COUNT = XC(imageSize) * YC(imageSize) / TILE_SIZE;
     if (threadIndex->value > TILE_COUNT) {
@@ -492,17 +494,24 @@ typedef struct ArPixelID {
 
 }
 
+//   Copies the vertices of one thread into its own range of 'LightPaths',
+//   which has to have been sized to hold the buckets of all threads. The
+//   ranges are disjoint, so no locking is needed.
+
 - (void)fillLightPaths
         :(ArPathVertexptrDynArray *)lightPathsBucket
         :(ArcUnsignedInteger *)threadIndex {
-    LightPaths;
-    pthread_mutex_lock(&LightPathsMutex);
-    int threadAccessOffset = threadIndex->value * arpvptrdynarray_size(lightPathsBucket);
+    unsigned int threadAccessOffset = 0;
+    for (unsigned int t = 0; t < THREAD_INDEX; t++) {
+        threadAccessOffset += lightPathsBucketSizes[t];
+    }
     for (uint32_t threadStart = 0; threadStart < arpvptrdynarray_size(lightPathsBucket); threadStart++) {
-        ArPathVertex *pv = arpvptrdynarray_i(lightPathsBucket, threadStart);
-        arpvptrdynarray_push(&LightPaths, pv);
+        arpvptrdynarray_set_i(
+            &LightPaths,
+            arpvptrdynarray_i(lightPathsBucket, threadStart),
+            threadAccessOffset + threadStart
+            );
     }
-    pthread_mutex_unlock(&LightPathsMutex);
 }
 
 - (void)renderProc
@@ -529,9 +538,6 @@ typedef struct ArPixelID {
     for (int lightIter = 0; lightIter < 1; lightIter++) {
         for (unsigned int i = 0; i < numberOfSamplesPerThread; i++) {
 
-            pthread_mutex_lock(&LightPathsMutex);
-            lightPathsSizes = 0;
-            pthread_mutex_unlock(&LightPathsMutex);
             int subpixelIdx = i % numberOfSubpixelSamples;
             px_id.sampleIndex = i;
 
@@ -689,6 +695,9 @@ typedef struct ArPixelID {
 
             if (MODE & arvcmmode_vm) {
 
+                lightPathsBucketSizes[THREAD_INDEX] = arpvptrdynarray_size(&renderBucket);
+                pthread_barrier_wait(&renderBarrier);
+
                 if(THREAD_INDEX == 0)
                 {
                     if (MODE & arvcmmode_vm) {
@@ -700,25 +709,34 @@ typedef struct ArPixelID {
                         hashgrid->VCweight = VCweight;
                     }
 
-                    LightPaths = arpvptrdynarray_init(0);
+                    unsigned int numberOfLightPathVertices = 0;
+                    for (unsigned int t = 0; t < numberOfRenderThreads; t++) {
+                        numberOfLightPathVertices += lightPathsBucketSizes[t];
+                    }
+
+                    //   all slots exist up front, so that the threads can
+                    //   fill in their own ranges of them concurrently
+                    LightPaths = arpvptrdynarray_init(numberOfLightPathVertices);
+                    for (unsigned int i = 0; i < numberOfLightPathVertices; i++) {
+                        arpvptrdynarray_push(&LightPaths, 0);
+                    }
+
+                    [hashgrid PrepareBuild:&LightPaths :radius :numberOfRenderThreads];
                 }
                 pthread_barrier_wait(&renderBarrier);
 
-                pthread_mutex_lock(&LightPathsMutex);
-                for(int iiPath = 0; iiPath < arpvptrdynarray_size(&renderBucket); iiPath++)
-                {
-                    ArPathVertex *pv = arpvptrdynarray_i(&renderBucket, iiPath);
-                    arpvptrdynarray_push(&LightPaths, pv);
-                }
+                [self fillLightPaths :&renderBucket :threadIndex];
+                pthread_barrier_wait(&renderBarrier);
 
-                pthread_mutex_unlock(&LightPathsMutex);
+                //   all render threads build the hash grid together, with
+                //   the render barrier between the passes of the build
+                [hashgrid BuildPart :THREAD_INDEX :&renderBarrier];
                 pthread_barrier_wait(&renderBarrier);
 
                 if(THREAD_INDEX == 0)
                 {
-                    [hashgrid BuildHashgrid:&LightPaths :radius];
+                    [hashgrid FinishBuild];
                 }
-                pthread_barrier_wait(&renderBarrier);
 
                 const int TILE_COUNT = XC(imageSize) * YC(imageSize) / TILE_SIZE;
                 if (threadIndex->value > TILE_COUNT) {
@@ -817,15 +835,16 @@ typedef struct ArPixelID {
 
                 pthread_barrier_wait(&renderBarrier);
                 if(THREAD_INDEX == 0)
+                {
                     [hashgrid dealloc];
+                    arpvptrdynarray_free_contents(&LightPaths);
+                }
 
             }
 
-            if (arpvptrdynarray_size(&renderBucket) > 1) {
-//                [self splatRenderLightPaths:threadIndex :subpixelIdx :&renderBucket];
-                arpv_free_arr_itrsc(art_gv, &renderBucket);
-                arpvptrdynarray_free_contents(&renderBucket);
-            }
+//            [self splatRenderLightPaths:threadIndex :subpixelIdx :&renderBucket];
+            [THREAD_PATHSPACE_INTEGRATOR resetLightPathVertices];
+            arpvptrdynarray_free_contents(&renderBucket);
 
             if (THREAD_INDEX == 0) {
                 [sampleCounter step
@@ -842,6 +861,9 @@ typedef struct ArPixelID {
 - (void)dealloc {
     FREE_ARRAY(sampleCoord);
 
+    if (lightPathsBucketSizes)
+        FREE_ARRAY(lightPathsBucketSizes);
+
     if (splattingKernelWidth > 1) {
         FREE_ARRAY(sampleSplattingFactor);
         FREE_ARRAY(sampleSplattingOffset);
@@ -23,12 +23,145 @@ typedef struct
 #import "ART_Scenegraph.h"
 #import "ART_ImageData.h"
 
+@class ArnRayCaster;
+
 
 ART_MODULE_INTERFACE(ArnMySampler)
+
+//   Adaptive sampling: if a target relative error > 0 is set, pixels are
+//   retired as soon as the standard error of their mean luminance drops
+//   below that fraction of the mean. The sample budget they leave unused
+//   goes to the pixels that are still noisy. 0 (the default) turns
+//   adaptive sampling off.
+
+void arntiledstochasticsampler_set_adaptive_sampling(
+        ART_GV  * art_gv,
+        double    targetRelativeError
+        );
+
+double arntiledstochasticsampler_adaptive_sampling(
+        ART_GV  * art_gv
+        );
+
+//   Stopping criteria: rendering ends before the requested number of
+//   samples once the wall-clock time in seconds is about to run out, or
+//   the estimated noise of the image (mean relative standard error of
+//   the pixels) has dropped below the given value. Either way, the pass
+//   that is under way is completed for the entire image first, so that
+//   all pixels end up with the same number of samples. 0 turns them off.
+
+void arntiledstochasticsampler_set_time_budget(
+        ART_GV  * art_gv,
+        double    seconds
+        );
+
+double arntiledstochasticsampler_time_budget(
+        ART_GV  * art_gv
+        );
+
+void arntiledstochasticsampler_set_noise_target(
+        ART_GV  * art_gv,
+        double    relativeError
+        );
+
+double arntiledstochasticsampler_noise_target(
+        ART_GV  * art_gv
+        );
+
+//   Checkpoints: if a file name is set, the state of the render is saved
+//   to it at the given interval (in seconds), and when rendering is
+//   interrupted. With 'resume', a render continues from the checkpoint
+//   in that file; this requires the same scene and render settings as
+//   the run that wrote it, and gives the same result as an
+//   uninterrupted run.
+
+void arntiledstochasticsampler_set_checkpoint(
+              ART_GV  * art_gv,
+        const char    * fileName,
+              double    interval
+        );
+
+void arntiledstochasticsampler_set_resume_from_checkpoint(
+        ART_GV  * art_gv,
+        BOOL      resume
+        );
+
+//   Split rendering: only slice 'index' of 'count' equal parts of the
+//   samples per pixel is rendered. The slices of a render are disjoint,
+//   and can be rendered by separate processes or machines; the partial
+//   images are then combined with art_rawmerge.
+
+void arntiledstochasticsampler_set_sample_range(
+        ART_GV        * art_gv,
+        unsigned int    index,
+        unsigned int    count
+        );
+
+//   Deferred filtering: samples are only added to the pixel they belong
+//   to, and the reconstruction kernel is applied once, to the whole
+//   image, whenever it is written. This saves the splatting work per
+//   sample and the overlap between the tiles of neighbouring windows;
+//   the kernel is evaluated at the pixel centres instead of the exact
+//   sample positions, though.
+
+void arntiledstochasticsampler_set_deferred_filtering(
+        ART_GV  * art_gv,
+        BOOL      deferred
+        );
+
+//   Tile layout: the image is rendered in square windows of the given
+//   size (0 picks one from the resolution and the number of threads).
+//   The order in which they are handed out is either by scanlines, along
+//   a Hilbert curve, which keeps the windows a thread renders one after
+//   the other close together, or in a spiral outwards from the centre of
+//   the image, which is where previews fill in first then.
+
+typedef enum ArTileOrder
+{
+    artileorder_scanline,
+    artileorder_hilbert,
+    artileorder_spiral
+}
+ArTileOrder;
+
+void arntiledstochasticsampler_set_tile_size(
+        ART_GV        * art_gv,
+        unsigned int    size
+        );
+
+void arntiledstochasticsampler_set_tile_order(
+        ART_GV       * art_gv,
+        ArTileOrder    order
+        );
+
+//   Tile updates are sent to a tev viewer by a thread of their own, at
+//   most this many times per second; updates of the same tile in between
+//   are merged. 0 sends them as fast as the viewer takes them.
+
+void arntiledstochasticsampler_set_tev_update_frequency(
+        ART_GV  * art_gv,
+        double    frequency
+        );
+
+//   Overrides the number of samples per pixel given in the action sequence
+//   for all renders started from now on, e.g. by the jobs of a render
+//   server. 0 goes back to what the action sequence says.
+
+void arntiledstochasticsampler_set_samples_per_pixel(
+        ART_GV        * art_gv,
+        unsigned int    samplesPerPixel
+        );
+
 typedef struct {
-        ArnLightAlphaImage** image;
+        ArSpectralFramebuffer** image;
         double* samples;
         IVec2D size;
+
+        //   luminance statistics of the pixels of the window, for the
+        //   current pass only (NULL unless they are collected)
+        unsigned int* pixel_samples;
+        double* pixel_mean;
+        double* pixel_m2;
 }tile_t;
 typedef struct image_window_t{
         IVec2D start,end; 
@@ -36,12 +169,12 @@ typedef struct image_window_t{
 
 typedef enum {
         RENDER,
-        MERGE,
         WRITE,
         WRITE_TONEMAP,
         WRITE_EXIT,
         TEV_CONNECT,
-        POISON,
+        TEV_UPDATE,
+        CHECKPOINT,
 }art_task_type_t;
 typedef struct {
         art_task_type_t type;
@@ -55,25 +188,47 @@ typedef struct {
         size_t tail,head,length,max_size;
         art_task_t* data;
 }queue_t;
-typedef struct {
-        queue_t queue;
-        queue_t* current;
-        pthread_mutex_t lock;
-        pthread_cond_t cond_var;
-} render_queue_t;
 typedef struct {
         queue_t queue1,queue2;
         queue_t* current,*inactive;
 
         pthread_mutex_t lock;
         pthread_cond_t cond_var;
-} merge_queue_t;
+
+        //   number of tasks waiting, readable without the lock
+        long pending;
+} control_queue_t;
+
+//   Telemetry: what a render thread has done so far. Only the thread
+//   itself writes its counters, and stats requests read them without
+//   locking; each gets a cache line of its own, so that the threads do
+//   not contend for them.
+
+typedef struct {
+        unsigned long samples;
+        unsigned long busy_nanoseconds;
+        char padding[48];
+}thread_telemetry_t;
+
+//   Work-stealing deque of render window indices (Chase & Lev). Only the
+//   render thread owning it pushes and pops at the bottom, all others
+//   steal from the top. There is at most one task per window around at
+//   any time, so a capacity of one slot per window is always enough.
+
+typedef struct {
+        long top,bottom;
+        long mask;
+        long* data;
+}work_deque_t;
 
 @interface ArnTiledStochasticSampler 
         : ArnBinary
         <ArpImageSampler, ArpImageSamplerMessenger, ArpAction,ArpConcreteClass, ArpCoding>
 {
         unsigned int                          overallNumberOfSamplesPerPixel;
+        //   What the sampler was created with - the above is changed by
+        //   each render, and is reset from this before the next one.
+        unsigned int                          requestedNumberOfSamplesPerPixel;
         int                                   randomValueGeneration;
         unsigned int                          numberOfRenderThreads;
         ArNode <ArpWorld, ArpBBox>          * world;
@@ -114,15 +269,92 @@ typedef struct {
         tile_t* tiles;
         tile_t merge_image;
         BOOL* unfinished;
-        BOOL finishedGeneratingRenderTasks;
-        BOOL poisoned_render;
         unsigned int numberOfImagesToWrite;
         image_window_t* render_windows;
-        unsigned int window_iterator;
+        long* window_order;
+        ArTileOrder tileOrder;
         unsigned int samples_per_window;
-        unsigned int samples_per_window_adaptive;
-        unsigned int samples_issued;
         BOOL renderThreadsShouldTerminate;
+
+        //   Render scheduling: one work-stealing deque per render thread,
+        //   plus one for the windows each thread has finished a pass on,
+        //   which any thread takes from once no older work is left
+        //   anywhere. The pass count of a window is only touched by the
+        //   thread that currently renders it. Threads which find no work
+        //   wait on idle_cond until work_generation changes, i.e. until a
+        //   window was deferred, or until there are no windows left.
+
+        work_deque_t* render_deque;
+        work_deque_t* deferred_deque;
+        unsigned int* window_pass;
+        pthread_mutex_t idle_lock;
+        pthread_cond_t idle_cond;
+        unsigned long work_generation;
+        long active_windows;
+        long finished_tasks;
+        pthread_mutex_t progress_lock;
+
+        //   The render threads merge their tiles into merge_image
+        //   themselves; each window of the image has a lock, which is
+        //   held while the window is written or read.
+
+        pthread_mutex_t* window_lock;
+
+        //   Adaptive sampling: running mean and sum of squared deviations
+        //   (Welford) of the luminance of each pixel, only ever touched
+        //   by the thread that renders the window of the pixel. Pixels
+        //   which converged are marked in 'unfinished'. The budget is
+        //   overallNumberOfSamplesPerPixel times the number of pixels,
+        //   but no pixel takes more than maximumNumberOfSamplesPerPixel.
+
+        double adaptiveSamplingTarget;
+        unsigned int maximumNumberOfSamplesPerPixel;
+        BOOL collectPixelStatistics;
+        unsigned int* pixel_samples;
+        double* pixel_mean;
+        double* pixel_m2;
+        long sample_budget;
+        long samples_spent;
+        unsigned int samples_reported;
+
+        //   Stopping criteria: once one is met, no pass beyond pass_limit
+        //   is started. Up to then, highest_pass is the last pass any
+        //   window has begun. The noise estimate is kept as the sum of
+        //   the relative errors of all pixels, to which each window adds
+        //   its latest share. All of these are guarded by progress_lock.
+
+        double timeBudget;
+        double noiseTarget;
+        unsigned int pass_limit;
+        unsigned int highest_pass;
+        const char* stoppingCriterion;
+        double* window_noise;
+        long* window_noise_pixels;
+        double noise_sum;
+        long noise_pixels;
+
+        //   Checkpoints. Everything they contain only changes while the
+        //   window locks are held, so the control thread takes a
+        //   consistent snapshot under all of them, and writes it to disk
+        //   once it has released them again. Windows which need no more
+        //   passes are marked as retired.
+
+        char* checkpointFileName;
+        double checkpointInterval;
+        double lastCheckpointTime;
+        BOOL checkpoint_pending;
+        char* checkpoint_buffer;
+        BOOL* window_retired;
+        double previousRenderTime;
+
+        //   Split rendering: this run takes samples sampleIndexOffset
+        //   onwards, overallNumberOfSamplesPerPixel of them, out of the
+        //   totalNumberOfSamplesPerPixel of the whole render.
+
+        unsigned int totalNumberOfSamplesPerPixel;
+        unsigned int sampleIndexOffset;
+        unsigned int sampleRangeIndex;
+        unsigned int sampleRangeCount;
         BOOL workingThreadsAreDone;
 
         unsigned int tiles_X;
@@ -132,6 +364,14 @@ typedef struct {
         unsigned int    splattingKernelArea;
         int             splattingKernelOffset;
 
+        //   how far the tiles extend beyond their windows: none with
+        //   deferred filtering, which uses the taps below instead
+
+        int             tilePadding;
+        BOOL            deferredFiltering;
+        IVec2D        * filterOffset;
+        double        * filterWeight;
+
         ArSequenceID    startingSequenceID;
         unsigned int        numberOfSubpixelSamples;
         Pnt2D         * sampleCoord;
@@ -148,12 +388,37 @@ typedef struct {
         ArcTevIntegration* tev;
         float * tev_update_tile;
         ArLightAlpha* tev_light;
+        ArSpectralFramebufferPixel* tev_pixel;
         ArSpectrum* tev_spectrum;
         ArRGB* tev_rgb;
         char**  tev_names;
-        ArnLightAlphaImage  *  out;
+
+        //   The result images are written from a snapshot of the merged
+        //   light and weights, one scanline at a time.
+
+        ArSpectralFramebuffer* out;
+        double* out_samples;
+        ArSpectralFramebuffer* out_unfiltered;
+        double* out_unfiltered_samples;
+        ArnLightAlphaImage* out_line;
+        ArSpectralFramebufferPixel* out_pixel;
 
         ArcMessageQueue* messageQueue;
+
+        //   Stats requests: the counters and the ray casters (NULL for
+        //   integrators without one) of the render threads, and the
+        //   totals at the previous request, which the rates are computed
+        //   from. The latter are only touched by the message queue
+        //   thread.
+
+        thread_telemetry_t* thread_telemetry;
+        ArnRayCaster** thread_ray_caster;
+        BOOL telemetry_active;
+        unsigned long samples_before;
+        double stats_time;
+        unsigned long stats_samples;
+        unsigned long stats_rays[3];
+        double* stats_busy_seconds;
 }
 
 - (id) init
@@ -16,14 +16,18 @@
 
 #import "ART_ImageFileFormat.h"
 #import "ART_ARM_Interface.h"
+#import "ArnPathspaceIntegrator.h"
+#import "ArnRayCaster.h"
 
 #include <signal.h>
 #include <unistd.h>
 #include <termios.h> 
+#include <sched.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 
 
-#define TILE_CONSTANT 3
 #define LOCALHOST "127.0.0.1"
 #define TEV_PORT 14158
 
@@ -84,19 +88,18 @@ struct termios original;
 sem_t writeSem;
 // sem_t writeTonemapSem;
 // sem_t writeExitSem;
-render_queue_t render_queue;
-merge_queue_t merge_queue;
+control_queue_t control_queue;
 void AtExit(){
     tcsetattr( STDIN_FILENO, TCSANOW, & original );
 }
 
-void prepend_merge_queue(merge_queue_t* q,art_task_t task);
+void prepend_control_queue(control_queue_t* q,art_task_t task);
 
-void try_prepend_merge_queue(sem_t* semaphore,art_task_type_t type){
+void try_prepend_control_queue(sem_t* semaphore,art_task_type_t type){
     if(semaphore==NULL||sem_trywait(semaphore)==0){
         art_task_t task;
         task.type=type;
-        prepend_merge_queue(&merge_queue,task);
+        prepend_control_queue(&control_queue,task);
     }  
 }
 void _image_sampler_sigint_handler(
@@ -108,7 +111,7 @@ void _image_sampler_sigint_handler(
     if(sem_wait(&writeSem)==0){
         art_task_t task;
         task.type=WRITE_EXIT;
-        prepend_merge_queue(&merge_queue,task);
+        prepend_control_queue(&control_queue,task);
     } 
 }
 
@@ -117,6 +120,103 @@ int div_roundup(int divident,int divisor){
     return (divident+(divisor-1))/divisor;
 }
 
+/* ---------------------------------------------------------------------------
+
+    Render window order
+
+    The image is cut into a grid of render windows, which are handed to
+    the render threads in one of the orders of ArTileOrder.
+
+------------------------------------------------------------------------aw- */
+
+//   Position of a cell along the Hilbert curve through an n x n grid,
+//   n being a power of two.
+
+unsigned long hilbert_index(unsigned long n,unsigned long x,unsigned long y){
+    unsigned long d=0;
+    for (unsigned long s=n/2; s>0; s/=2) {
+        unsigned long rx=(x & s)>0;
+        unsigned long ry=(y & s)>0;
+        d+=s*s*((3*rx)^ry);
+        if(ry==0){
+            if(rx==1){
+                x=n-1-x;
+                y=n-1-y;
+            }
+            unsigned long t=x;
+            x=y;
+            y=t;
+        }
+    }
+    return d;
+}
+
+typedef struct {
+        long window;
+        double key[2];
+}window_key_t;
+
+int compare_window_keys(const void* a,const void* b){
+    const window_key_t* ka=(const window_key_t*)a;
+    const window_key_t* kb=(const window_key_t*)b;
+    for (int i=0; i<2; i++) {
+        if(ka->key[i]<kb->key[i]) return -1;
+        if(ka->key[i]>kb->key[i]) return 1;
+    }
+    return (ka->window>kb->window)-(ka->window<kb->window);
+}
+
+//   Fills 'order' with the indices of a tiles_x x tiles_y grid of windows,
+//   in the order they are to be rendered in.
+
+void order_windows(
+        ArTileOrder order_type,
+        unsigned int tiles_x,
+        unsigned int tiles_y,
+        long* order
+        )
+{
+    long number_of_windows=(long)tiles_x*tiles_y;
+    window_key_t* keys=ALLOC_ARRAY(window_key_t, number_of_windows);
+
+    unsigned long n=1;
+    while(n<tiles_x || n<tiles_y)
+        n*=2;
+
+    for (unsigned int y=0; y<tiles_y; y++) {
+        for (unsigned int x=0; x<tiles_x; x++) {
+            window_key_t* k=&keys[y*tiles_x+x];
+            k->window=y*tiles_x+x;
+            switch (order_type) {
+                case artileorder_hilbert:
+                    k->key[0]=hilbert_index(n, x, y);
+                    k->key[1]=0.0;
+                    break;
+                case artileorder_spiral:{
+                    //   rings of windows around the centre, each one
+                    //   going round once
+                    double dx=x+0.5-0.5*tiles_x;
+                    double dy=y+0.5-0.5*tiles_y;
+                    k->key[0]=floor(MAX(fabs(dx),fabs(dy)));
+                    k->key[1]=atan2(dy, dx);
+                    break;
+                }
+                default:
+                    k->key[0]=k->window;
+                    k->key[1]=0.0;
+                    break;
+            }
+        }
+    }
+
+    qsort(keys, number_of_windows, sizeof(window_key_t), compare_window_keys);
+
+    for (long i=0; i<number_of_windows; i++) {
+        order[i]=keys[i].window;
+    }
+    FREE_ARRAY(keys);
+}
+
 void init_queue(queue_t* q,size_t task_number){
 
     q->tail=0;
@@ -193,57 +293,19 @@ void prepend_queue(queue_t* q,art_task_t t){
 #define SYNC_QUEUE_PTR (q->current)
 
 
-bool init_render_queue(render_queue_t* q,size_t task_number){
-    SYNC_QUEUE_PTR=&q->queue;
-    init_queue(SYNC_QUEUE_PTR,task_number);
-    pthread_mutex_init(SYNC_LOCK_PTR, NULL);
-    pthread_cond_init(SYNC_COND_PTR, NULL);
-    
-    return true;
-}
-
-void free_render_queue(render_queue_t* q){
-    free_queue(SYNC_QUEUE_PTR);
-    pthread_mutex_destroy(SYNC_LOCK_PTR);
-    pthread_cond_destroy(SYNC_COND_PTR);
-}
-
-art_task_t pop_render_queue(render_queue_t* q){
-    pthread_mutex_lock(SYNC_LOCK_PTR);
-    while(SYNC_QUEUE.length==0)
-        pthread_cond_wait(SYNC_COND_PTR, SYNC_LOCK_PTR);
-    art_task_t ret=peek_queue(SYNC_QUEUE_PTR);
-    if (ret.type!=POISON)
-        pop_queue(SYNC_QUEUE_PTR);
-    pthread_mutex_unlock(SYNC_LOCK_PTR);
-    return ret;
-}
-
-void push_render_queue(render_queue_t* q,art_task_t  task){
-    pthread_mutex_lock(SYNC_LOCK_PTR);
-    
-    push_queue(SYNC_QUEUE_PTR, task);
-    
-    pthread_mutex_unlock(SYNC_LOCK_PTR);
-    pthread_cond_broadcast(SYNC_COND_PTR);
-}
-
-
-
-
-
-bool init_merge_queue(merge_queue_t* q,size_t task_number){
+bool init_control_queue(control_queue_t* q,size_t task_number){
     SYNC_QUEUE_PTR=&q->queue1;
     q->inactive=&q->queue2;
     init_queue(&q->queue1,task_number);
     init_queue(&q->queue2,task_number);
+    q->pending=0;
     pthread_mutex_init(SYNC_LOCK_PTR, NULL);
     pthread_cond_init(SYNC_COND_PTR, NULL);
     
     return true;
 }
 
-void free_merge_queue(merge_queue_t* q){
+void free_control_queue(control_queue_t* q){
     free_queue(&q->queue1);
     free_queue(&q->queue2);
     pthread_mutex_destroy(SYNC_LOCK_PTR);
@@ -252,21 +314,23 @@ void free_merge_queue(merge_queue_t* q){
 
 
 
-void push_merge_queue(merge_queue_t* q,art_task_t task){
+void push_control_queue(control_queue_t* q,art_task_t task){
     pthread_mutex_lock(SYNC_LOCK_PTR);
     push_queue(SYNC_QUEUE_PTR, task);
+    __atomic_add_fetch(&q->pending, 1, __ATOMIC_RELAXED);
     pthread_mutex_unlock(SYNC_LOCK_PTR);
     pthread_cond_signal(SYNC_COND_PTR);
 }
 
-void prepend_merge_queue(merge_queue_t* q,art_task_t task){
+void prepend_control_queue(control_queue_t* q,art_task_t task){
     pthread_mutex_lock(SYNC_LOCK_PTR);
     prepend_queue(SYNC_QUEUE_PTR, task);
+    __atomic_add_fetch(&q->pending, 1, __ATOMIC_RELAXED);
     pthread_mutex_unlock(SYNC_LOCK_PTR);
     pthread_cond_signal(SYNC_COND_PTR);
 }
 
-void swap_merge_queue(merge_queue_t* q){
+void swap_control_queue(control_queue_t* q){
     pthread_mutex_lock(SYNC_LOCK_PTR);
     while(SYNC_QUEUE.length==0){
         pthread_cond_wait(SYNC_COND_PTR, SYNC_LOCK_PTR);
@@ -277,17 +341,298 @@ void swap_merge_queue(merge_queue_t* q){
     pthread_mutex_unlock(SYNC_LOCK_PTR);
 }
 
+//   Adds to a telemetry counter of the calling render thread. Relaxed
+//   atomics keep concurrent reads untorn, and cost nothing over a plain
+//   increment, as no other thread ever writes the counter.
+
+#define TELEMETRY_ADD(_counter,_n) \
+    __atomic_store_n( \
+        &(_counter), \
+        __atomic_load_n(&(_counter), __ATOMIC_RELAXED)+(_n), \
+        __ATOMIC_RELAXED)
+
+/* ---------------------------------------------------------------------------
+
+    Work-stealing deques
+
+    The deque of Chase & Lev, in the formulation of Le et al., "Correct
+    and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+    The owner pushes and pops at the bottom without any locking in the
+    common case; thieves take from the top with a single CAS. The buffer
+    does not grow: the sampler never has more tasks around than there are
+    render windows.
+
+------------------------------------------------------------------------aw- */
+
+void init_work_deque(work_deque_t* d,size_t capacity){
+    long size=1;
+    while((size_t)size<capacity)
+        size<<=1;
+    d->top=0;
+    d->bottom=0;
+    d->mask=size-1;
+    d->data=ALLOC_ARRAY_ZERO(long, size);
+    if(!d->data){
+        ART_ERRORHANDLING_FATAL_ERROR("Failed work deque allocation");
+    }
+}
+
+void free_work_deque(work_deque_t* d){
+    FREE_ARRAY(d->data);
+}
+
+void push_work_deque(work_deque_t* d,long window){
+    long b=__atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->data[b & d->mask], window, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&d->bottom, b+1, __ATOMIC_RELAXED);
+}
+
+BOOL pop_work_deque(work_deque_t* d,long* window){
+    long b=__atomic_load_n(&d->bottom, __ATOMIC_RELAXED)-1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long t=__atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    if(t>b){
+        //   empty
+        __atomic_store_n(&d->bottom, b+1, __ATOMIC_RELAXED);
+        return NO;
+    }
+
+    *window=__atomic_load_n(&d->data[b & d->mask], __ATOMIC_RELAXED);
+
+    if(t==b){
+        //   last element, we race the thieves for it
+        BOOL won=__atomic_compare_exchange_n(
+            &d->top, &t, t+1, NO, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&d->bottom, b+1, __ATOMIC_RELAXED);
+        return won;
+    }
+    return YES;
+}
+
+//   A thief which loses the race for the top element tries again as long
+//   as the deque is not empty, so that failing to steal always means
+//   that there was nothing left - render threads go to sleep on that.
 
+BOOL steal_work_deque(work_deque_t* d,long* window){
+    for(;;){
+        long t=__atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        long b=__atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
 
+        if(t>=b)
+            return NO;
+
+        long w=__atomic_load_n(&d->data[t & d->mask], __ATOMIC_RELAXED);
+
+        if(__atomic_compare_exchange_n(
+               &d->top, &t, t+1, NO, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)){
+            *window=w;
+            return YES;
+        }
+    }
+}
+
+
+
+
+typedef struct ArnTiledStochasticSampler_GV
+{
+    double  adaptiveSamplingTarget;
+    double  timeBudget;
+    double  noiseTarget;
+    char  * checkpointFileName;
+    double  checkpointInterval;
+    BOOL    resumeFromCheckpoint;
+    unsigned int  sampleRangeIndex;
+    unsigned int  sampleRangeCount;
+    BOOL    deferredFiltering;
+    unsigned int  tileSize;
+    ArTileOrder   tileOrder;
+    double  tevUpdateFrequency;
+    unsigned int  samplesPerPixel;
+}
+ArnTiledStochasticSampler_GV;
+
+#define ARNTILEDSTOCHASTICSAMPLER_GV \
+    art_gv->arntiledstochasticsampler_gv
 
 ART_MODULE_INITIALISATION_FUNCTION
 (
-    (void) art_gv;
     [ ArnTiledStochasticSampler registerWithRuntime ];
+
+    ARNTILEDSTOCHASTICSAMPLER_GV = ALLOC(ArnTiledStochasticSampler_GV);
+
+    ARNTILEDSTOCHASTICSAMPLER_GV->adaptiveSamplingTarget = 0.0;
+    ARNTILEDSTOCHASTICSAMPLER_GV->timeBudget = 0.0;
+    ARNTILEDSTOCHASTICSAMPLER_GV->noiseTarget = 0.0;
+    ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName = NULL;
+    ARNTILEDSTOCHASTICSAMPLER_GV->checkpointInterval = 0.0;
+    ARNTILEDSTOCHASTICSAMPLER_GV->resumeFromCheckpoint = NO;
+    ARNTILEDSTOCHASTICSAMPLER_GV->sampleRangeIndex = 0;
+    ARNTILEDSTOCHASTICSAMPLER_GV->sampleRangeCount = 1;
+    ARNTILEDSTOCHASTICSAMPLER_GV->deferredFiltering = NO;
+    ARNTILEDSTOCHASTICSAMPLER_GV->tileSize = 0;
+    ARNTILEDSTOCHASTICSAMPLER_GV->tileOrder = artileorder_scanline;
+    ARNTILEDSTOCHASTICSAMPLER_GV->tevUpdateFrequency = 30.0;
+    ARNTILEDSTOCHASTICSAMPLER_GV->samplesPerPixel = 0;
 )
 
+ART_MODULE_SHUTDOWN_FUNCTION
+(
+    if ( ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName )
+        FREE_ARRAY( ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName );
 
-ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
+    FREE( ARNTILEDSTOCHASTICSAMPLER_GV );
+)
+
+void arntiledstochasticsampler_set_adaptive_sampling(
+        ART_GV  * art_gv,
+        double    targetRelativeError
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->adaptiveSamplingTarget =
+        M_MAX( targetRelativeError, 0.0 );
+}
+
+double arntiledstochasticsampler_adaptive_sampling(
+        ART_GV  * art_gv
+        )
+{
+    return ARNTILEDSTOCHASTICSAMPLER_GV->adaptiveSamplingTarget;
+}
+
+void arntiledstochasticsampler_set_time_budget(
+        ART_GV  * art_gv,
+        double    seconds
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->timeBudget = M_MAX( seconds, 0.0 );
+}
+
+double arntiledstochasticsampler_time_budget(
+        ART_GV  * art_gv
+        )
+{
+    return ARNTILEDSTOCHASTICSAMPLER_GV->timeBudget;
+}
+
+void arntiledstochasticsampler_set_noise_target(
+        ART_GV  * art_gv,
+        double    relativeError
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->noiseTarget = M_MAX( relativeError, 0.0 );
+}
+
+double arntiledstochasticsampler_noise_target(
+        ART_GV  * art_gv
+        )
+{
+    return ARNTILEDSTOCHASTICSAMPLER_GV->noiseTarget;
+}
+
+void arntiledstochasticsampler_set_checkpoint(
+              ART_GV  * art_gv,
+        const char    * fileName,
+              double    interval
+        )
+{
+    if ( ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName )
+        FREE_ARRAY( ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName );
+
+    ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName = NULL;
+
+    if ( fileName )
+        arstring_s_copy_s(
+              fileName,
+            & ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName
+            );
+
+    ARNTILEDSTOCHASTICSAMPLER_GV->checkpointInterval = M_MAX( interval, 0.0 );
+}
+
+void arntiledstochasticsampler_set_resume_from_checkpoint(
+        ART_GV  * art_gv,
+        BOOL      resume
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->resumeFromCheckpoint = resume;
+}
+
+void arntiledstochasticsampler_set_sample_range(
+        ART_GV        * art_gv,
+        unsigned int    index,
+        unsigned int    count
+        )
+{
+    if ( count == 0 || index >= count )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "sample range %u of %u does not exist"
+            ,   index
+            ,   count
+            );
+
+    ARNTILEDSTOCHASTICSAMPLER_GV->sampleRangeIndex = index;
+    ARNTILEDSTOCHASTICSAMPLER_GV->sampleRangeCount = count;
+}
+
+void arntiledstochasticsampler_set_deferred_filtering(
+        ART_GV  * art_gv,
+        BOOL      deferred
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->deferredFiltering = deferred;
+}
+
+void arntiledstochasticsampler_set_tile_size(
+        ART_GV        * art_gv,
+        unsigned int    size
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->tileSize = size;
+}
+
+void arntiledstochasticsampler_set_tile_order(
+        ART_GV       * art_gv,
+        ArTileOrder    order
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->tileOrder = order;
+}
+
+void arntiledstochasticsampler_set_tev_update_frequency(
+        ART_GV  * art_gv,
+        double    frequency
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->tevUpdateFrequency = frequency;
+}
+
+void arntiledstochasticsampler_set_samples_per_pixel(
+        ART_GV        * art_gv,
+        unsigned int    samplesPerPixel
+        )
+{
+    ARNTILEDSTOCHASTICSAMPLER_GV->samplesPerPixel = samplesPerPixel;
+}
+
+//   Pixels are only checked for convergence once they have this many
+//   samples, as the variance estimate of fewer is too unreliable. No
+//   pixel gets more than the given multiple of the nominal sample count.
+
+#define ADAPTIVE_SAMPLING_MINIMUM_SAMPLES       64
+#define ADAPTIVE_SAMPLING_MAXIMUM_FACTOR        8
+
+//   The first two passes over a window take samples_per_window samples
+//   each, every pass after that twice as many as the one before, up to
+//   this many. Later passes thus cost fewer merges and scheduling rounds
+//   per sample, while the schedule itself stays fixed: which samples a
+//   window gets in a pass never depends on timing.
+
+#define MAXIMUM_SAMPLES_PER_PASS                256
 
 @implementation ArnTiledStochasticSampler
 
@@ -296,84 +641,829 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     :(IVec2D) size
 {
     tile->size=size;
-    tile->image=ALLOC_ARRAY(ArnLightAlphaImage*, numberOfImagesToWrite);
+    tile->image=ALLOC_ARRAY(ArSpectralFramebuffer*, numberOfImagesToWrite);
     for (unsigned int i=0 ; i <numberOfImagesToWrite; i++) {
-        tile->image[i]=[ ALLOC_OBJECT(ArnLightAlphaImage)
-                    initWithSize
-                    :   tile->size
-                    ];
+        tile->image[i]=arspectralframebuffer_alloc(art_gv, tile->size);
     }
     tile->samples=ALLOC_ARRAY(
             double,
             numberOfImagesToWrite*XC(tile->size) * YC(tile->size)
             );
+    tile->pixel_samples=NULL;
+    tile->pixel_mean=NULL;
+    tile->pixel_m2=NULL;
+}
+
+- (void) init_tile_statistics
+    :(tile_t*) tile
+{
+    long pixels=XC(tile_size)*YC(tile_size);
+    tile->pixel_samples=ALLOC_ARRAY(unsigned int, pixels);
+    tile->pixel_mean=ALLOC_ARRAY(double, pixels);
+    tile->pixel_m2=ALLOC_ARRAY(double, pixels);
 }
 
 - (void) clean_tile
     :(tile_t*) tile
 {
     for ( unsigned int i=0 ; i <numberOfImagesToWrite; i++) {
-        for ( int y = 0; y < YC(tile->size); y++ )
-        {
-            for ( int x = 0; x < XC(tile->size); x++ )
-            {
-                arlightalpha_l_init_l(
-                        art_gv,
-                        ARLIGHTALPHA_NONE_A0,
-                        tile->image[i]->data[x + y*XC(tile->size)]
-                    );
-                tile->samples[i*XC(tile->size)*YC(tile->size)+x +y*XC(tile->size)]=0.0;
-            }
-        }
+        arspectralframebuffer_clear(art_gv, tile->image[i]);
+    }
+    memset(
+        tile->samples,
+        0,
+        numberOfImagesToWrite*XC(tile->size)*YC(tile->size)*sizeof(double)
+        );
+    if(tile->pixel_samples){
+        long pixels=XC(tile_size)*YC(tile_size);
+        memset(tile->pixel_samples, 0, pixels*sizeof(unsigned int));
+        memset(tile->pixel_mean, 0, pixels*sizeof(double));
+        memset(tile->pixel_m2, 0, pixels*sizeof(double));
     }
 }
 - (void) free_tile
     :(tile_t*) tile
 {
     for (unsigned int i=0 ; i <numberOfImagesToWrite; i++) {
-        RELEASE_OBJECT(tile->image[i]);
+        arspectralframebuffer_free(art_gv, tile->image[i]);
     }
     FREE_ARRAY(tile->image);
     FREE_ARRAY(tile->samples);
+    if(tile->pixel_samples){
+        FREE_ARRAY(tile->pixel_samples);
+        FREE_ARRAY(tile->pixel_mean);
+        FREE_ARRAY(tile->pixel_m2);
+    }
 }
 
 
-- (BOOL) make_task
+//   Size and first sample of a pass as the schedule has them, before
+//   any sample or pass limits are applied.
+
+- (unsigned int) nominal_samples_of_pass
+    :(unsigned int) pass
+{
+    unsigned int samples=samples_per_window;
+    for (unsigned int p=1; p<pass && samples*2<=MAXIMUM_SAMPLES_PER_PASS; p++)
+        samples*=2;
+    return samples;
+}
+
+- (unsigned long) first_sample_of_pass
+    :(unsigned int) pass
+{
+    unsigned long sample_start=0;
+    unsigned int samples=samples_per_window;
+    for (unsigned int p=0; p<pass; p++) {
+        sample_start+=samples;
+        if(p>0 && samples*2<=MAXIMUM_SAMPLES_PER_PASS)
+            samples*=2;
+    }
+    return sample_start;
+}
+
+- (unsigned int) samples_of_pass
+    :(unsigned int) pass
+{
+    unsigned long sample_start=[self first_sample_of_pass: pass];
+    if(sample_start>=maximumNumberOfSamplesPerPixel
+       || pass>=__atomic_load_n(&pass_limit, __ATOMIC_RELAXED))
+        return 0;
+    return (unsigned int)MIN(
+        maximumNumberOfSamplesPerPixel-sample_start,
+        [self nominal_samples_of_pass: pass]);
+}
+
+//   Adds one luminance sample to the running statistics of a pixel in
+//   the work tile of a render thread.
+
+- (void) add_pixel_sample
+    :(tile_t*) tile
+    :(long) pixel
+    :(double) luminance
+{
+    tile->pixel_samples[pixel]++;
+    double delta=luminance-tile->pixel_mean[pixel];
+    tile->pixel_mean[pixel]+=delta/tile->pixel_samples[pixel];
+    tile->pixel_m2[pixel]+=delta*(luminance-tile->pixel_mean[pixel]);
+}
+
+//   Combines the statistics of a pass with those of the pixels so far
+//   (Chan et al.), while the window is locked for merging.
+
+- (void) merge_pixel_statistics
     :(art_task_t*) t
 {
-    if (finishedGeneratingRenderTasks){
-        if (poisoned_render) {
-            return false;
+    tile_t* tile=t->work_tile;
+    for (int y=YC(t->window->start); y<YC(t->window->end); y++) {
+        for (int x=XC(t->window->start); x<XC(t->window->end); x++) {
+            long local=(x-XC(t->window->start))+(y-YC(t->window->start))*XC(tile_size);
+            unsigned int nb=tile->pixel_samples[local];
+            if(nb==0)
+                continue;
+            long idx=x + y*XC(imageSize);
+            unsigned int na=pixel_samples[idx];
+            unsigned int n=na+nb;
+            double delta=tile->pixel_mean[local]-pixel_mean[idx];
+            pixel_mean[idx]+=delta*nb/n;
+            pixel_m2[idx]+=tile->pixel_m2[local]+delta*delta*na*nb/n;
+            pixel_samples[idx]=n;
         }
-        t->type=POISON;
-        poisoned_render=true;
-        return true;
     }
-    
-    t->samples=samples_per_window;
-    t->window=&render_windows[window_iterator];
-    t->sample_start=samples_issued;
-    t->type=RENDER;
-    [self task_next_iteration];
-    return true;
 }
-- (void) task_next_iteration
+
+//   Retires the converged pixels of a window after a pass, and returns
+//   how many of the pixels that took part in the pass are still
+//   unfinished. Pixels whose luminance did not vary at all (e.g. the
+//   background) count as converged.
+
+- (long) retire_converged_pixels
+    :(long) window
+    :(long*) rendered_pixels
+{
+    image_window_t* w=&render_windows[window];
+    long remaining=0;
+    *rendered_pixels=0;
+    for (int y=YC(w->start); y<YC(w->end); y++) {
+        for (int x=XC(w->start); x<XC(w->end); x++) {
+            long idx=x + y*XC(imageSize);
+            if(!unfinished[idx])
+                continue;
+            (*rendered_pixels)++;
+            unsigned int n=pixel_samples[idx];
+            if(n>=ADAPTIVE_SAMPLING_MINIMUM_SAMPLES){
+                double variance=pixel_m2[idx]/(n-1);
+                if(variance<=0.0
+                   || (pixel_mean[idx]>0.0
+                       && sqrt(variance/n)<=adaptiveSamplingTarget*pixel_mean[idx])){
+                    unfinished[idx]=NO;
+                    continue;
+                }
+            }
+            remaining++;
+        }
+    }
+    return remaining;
+}
+
+//   In adaptive mode, a window gets another pass as long as it has
+//   unfinished pixels, and either has not had the nominal number of
+//   samples yet, or the budget left unused by retired pixels is not
+//   used up.
+
+- (BOOL) window_needs_pass
+    :(long) window
+    :(unsigned int) samples_so_far
+{
+    if([self samples_of_pass: window_pass[window]]==0)
+        return NO;
+    if(adaptiveSamplingTarget<=0.0)
+        return YES;
+
+    long rendered_pixels;
+    long remaining=[self retire_converged_pixels: window : &rendered_pixels];
+    __atomic_add_fetch(&samples_spent, rendered_pixels*samples_so_far, __ATOMIC_RELAXED);
+
+    if(remaining==0)
+        return NO;
+    if([self first_sample_of_pass: window_pass[window]]<overallNumberOfSamplesPerPixel)
+        return YES;
+    return __atomic_load_n(&samples_spent, __ATOMIC_RELAXED)<sample_budget;
+}
+
+//   A render thread looks for work in its own deque first, then in the
+//   deques of all others, and only then turns to the windows that have
+//   been deferred after a pass - its own first, then those of the
+//   others. Deferred windows are always taken from the top, i.e. oldest
+//   first, so that the passes stay roughly in step over the whole image.
+
+- (BOOL) next_window
+    :(unsigned int) thread
+    :(long*) window
+{
+    if(pop_work_deque(&render_deque[thread], window))
+        return YES;
+
+    for (unsigned int i=1; i<numberOfRenderThreads; i++) {
+        if(steal_work_deque(&render_deque[(thread+i)%numberOfRenderThreads], window))
+            return YES;
+    }
+
+    for (unsigned int i=0; i<numberOfRenderThreads; i++) {
+        if(steal_work_deque(&deferred_deque[(thread+i)%numberOfRenderThreads], window))
+            return YES;
+    }
+    return NO;
+}
+
+//   Wakes up the render threads waiting for work: one, if a window has
+//   been deferred, and all of them once there are no windows left or
+//   rendering is cut short.
+
+- (void) wake_render_threads
+    :(BOOL) all
 {
-    window_iterator++;
-    if(window_iterator==tiles_X*tiles_Y){
+    pthread_mutex_lock(&idle_lock);
+    __atomic_add_fetch(&work_generation, 1, __ATOMIC_RELEASE);
+    if(all)
+        pthread_cond_broadcast(&idle_cond);
+    else
+        pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+//   Blocks until work may have turned up since 'generation' was read,
+//   which has to be before the thread last looked for work. Returns NO
+//   if there is nothing left to wait for.
+
+- (BOOL) wait_for_work
+    :(unsigned long) generation
+{
+    pthread_mutex_lock(&idle_lock);
+    while(work_generation==generation
+          && !renderThreadsShouldTerminate
+          && __atomic_load_n(&active_windows, __ATOMIC_ACQUIRE)>0)
+        pthread_cond_wait(&idle_cond, &idle_lock);
+    BOOL more=
+           !renderThreadsShouldTerminate
+        && __atomic_load_n(&active_windows, __ATOMIC_ACQUIRE)>0;
+    pthread_mutex_unlock(&idle_lock);
+    return more;
+}
+
+//   Retires a window from rendering; the last one wakes up everybody.
+
+- (void) retire_window
+{
+    if(__atomic_sub_fetch(&active_windows, 1, __ATOMIC_ACQ_REL)==0)
+        [self wake_render_threads: YES];
+}
+
+- (void) finish_window
+    :(unsigned int) thread
+    :(long) window
+    :(BOOL) needs_pass
+{
+    long number_of_windows=tiles_X*tiles_Y;
+
+    if(needs_pass){
+        push_work_deque(&deferred_deque[thread], window);
+        [self wake_render_threads: NO];
+    }else{
+        [self retire_window];
+    }
+
+    if(noiseTarget>0.0)
+        [self update_noise_estimate: window];
+
+    if(tev->connected){
+        art_task_t task;
+        task.type=TEV_UPDATE;
+        task.window=&render_windows[window];
+        push_control_queue(&control_queue, task);
+    }
+
+    //   The sample counter moves on whenever as many windows have been
+    //   finished as one pass has. In adaptive mode, it follows the
+    //   share of the sample budget that has been used up instead.
+    long finished=__atomic_add_fetch(&finished_tasks, 1, __ATOMIC_RELAXED);
+    if(adaptiveSamplingTarget>0.0){
+        long spent=__atomic_load_n(&samples_spent, __ATOMIC_RELAXED);
+        unsigned int samples=(unsigned int)MIN(
+            (double)overallNumberOfSamplesPerPixel,
+            (double)overallNumberOfSamplesPerPixel*spent/MAX(sample_budget,1));
+        pthread_mutex_lock(&progress_lock);
+        if(samples>samples_reported){
+            [ sampleCounter step: samples-samples_reported ];
+            samples_reported=samples;
+        }
+        pthread_mutex_unlock(&progress_lock);
+    }else if(finished%number_of_windows==0){
+        pthread_mutex_lock(&progress_lock);
         [ sampleCounter step
-            :   samples_per_window
+            :   [self samples_of_pass: finished/number_of_windows-1]
             ];
-        window_iterator=0;
-        samples_issued+=samples_per_window;
-        samples_per_window=samples_per_window_adaptive;
-        samples_per_window= MIN(overallNumberOfSamplesPerPixel-samples_issued,samples_per_window);
-        if(samples_per_window==0){
-            finishedGeneratingRenderTasks=true;
+        pthread_mutex_unlock(&progress_lock);
+    }
+
+    if(!stoppingCriterion)
+        [self check_stopping_criteria: finished];
+
+    if(checkpointFileName
+       && checkpointInterval>0.0
+       && [self seconds_rendered]-lastCheckpointTime>=checkpointInterval
+       && !__atomic_exchange_n(&checkpoint_pending, YES, __ATOMIC_ACQ_REL)){
+        art_task_t task;
+        task.type=CHECKPOINT;
+        push_control_queue(&control_queue, task);
+    }
+}
+
+//   Sum of the relative standard errors of the mean luminance of the
+//   pixels in a window, as used for the image-wide noise estimate.
+//   Pixels whose luminance did not vary count as noise free.
+
+- (double) window_noise
+    :(long) window
+    :(long*) pixels
+{
+    image_window_t* w=&render_windows[window];
+    double noise=0.0;
+    *pixels=0;
+    for (int y=YC(w->start); y<YC(w->end); y++) {
+        for (int x=XC(w->start); x<XC(w->end); x++) {
+            long idx=x + y*XC(imageSize);
+            unsigned int n=pixel_samples[idx];
+            if(n<2)
+                continue;
+            (*pixels)++;
+            double variance=pixel_m2[idx]/(n-1);
+            if(variance>0.0 && pixel_mean[idx]>0.0)
+                noise+=sqrt(variance/n)/pixel_mean[idx];
+        }
+    }
+    return noise;
+}
+
+- (void) update_noise_estimate
+    :(long) window
+{
+    long pixels;
+    double noise=[self window_noise: window : &pixels];
+
+    pthread_mutex_lock(&progress_lock);
+    noise_sum+=noise-window_noise[window];
+    noise_pixels+=pixels-window_noise_pixels[window];
+    window_noise[window]=noise;
+    window_noise_pixels[window]=pixels;
+    pthread_mutex_unlock(&progress_lock);
+}
+
+//   Ends rendering after the pass that is furthest along: windows which
+//   are behind still catch up with it, so that all pixels get the same
+//   number of samples.
+
+- (void) stop_after_current_pass
+    :(const char*) criterion
+{
+    pthread_mutex_lock(&progress_lock);
+    if(!stoppingCriterion){
+        stoppingCriterion=criterion;
+        __atomic_store_n(&pass_limit, highest_pass+1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&progress_lock);
+}
+
+//   The time budget counts as used up once another pass would not fit
+//   in any more, judging from the average time per sample so far - the
+//   passes are not all of the same size. The noise estimate is only
+//   looked at after each full pass, and once all pixels have enough
+//   samples for their variance to mean something.
+
+- (void) check_stopping_criteria
+    :(long) finished
+{
+    long number_of_windows=tiles_X*tiles_Y;
+    unsigned int passes=(unsigned int)(finished/number_of_windows);
+
+    if(timeBudget>0.0){
+        double elapsed=[self seconds_rendered];
+        double samples=
+              [self first_sample_of_pass: passes]
+            + (double)(finished%number_of_windows)/number_of_windows
+              * [self nominal_samples_of_pass: passes];
+        double next_pass=
+            elapsed/samples*[self nominal_samples_of_pass: passes+1];
+        if(elapsed+next_pass>=timeBudget){
+            [self stop_after_current_pass: "time budget"];
+            return;
+        }
+    }
+
+    if(noiseTarget>0.0
+       && finished%number_of_windows==0
+       && [self first_sample_of_pass: passes]>=ADAPTIVE_SAMPLING_MINIMUM_SAMPLES){
+        pthread_mutex_lock(&progress_lock);
+        double noise=noise_pixels>0 ? noise_sum/noise_pixels : 0.0;
+        pthread_mutex_unlock(&progress_lock);
+        if(noise<=noiseTarget)
+            [self stop_after_current_pass: "noise target"];
+    }
+}
+
+//   Wall-clock time spent rendering so far, including that of the runs
+//   a checkpoint was resumed from.
+
+- (double) seconds_rendered
+{
+    ArTime now;
+    artime_now(&now);
+    return previousRenderTime+artime_seconds(&now)-artime_seconds(&beginTime);
+}
+
+/* ---------------------------------------------------------------------------
+
+    Checkpoint files
+
+    The header is followed by the splatting weights and the accumulated
+    light of all result images, the luminance statistics of all pixels if
+    they are collected, the pass counts and retirement flags of all
+    windows, and the 'unfinished' flags of all pixels. The light of an
+    image is stored as the planes of its framebuffer, i.e. one plane per
+    spectral channel (and Stokes component, in polarisation mode)
+    followed by the alpha plane; in polarisation mode, the polarisation
+    flags and reference frames of the pixels come after that. Everything
+    is written in native byte order, so a checkpoint can only be resumed
+    on the same kind of machine.
+
+    The random generator of a sample is seeded from the pixel and sample
+    index alone, so the global seed and the starting sequence ID are all
+    the random state there is; they are checked along with the render
+    settings when a checkpoint is resumed.
+
+------------------------------------------------------------------------aw- */
+
+#define CHECKPOINT_MAGIC    0x4b504354
+#define CHECKPOINT_VERSION  5
+
+typedef struct ArTiledSamplerCheckpointHeader
+{
+    UInt32  magic;
+    UInt32  version;
+    Int32   imageSize[2];
+    Int32   imageOrigin[2];
+    Int32   numberOfImages;
+    Int32   spectralChannels;
+    Int32   polarisation;
+    Int32   deterministicWavelengths;
+    UInt32  overallNumberOfSamplesPerPixel;
+    UInt32  maximumNumberOfSamplesPerPixel;
+    UInt32  samplesPerWindow;
+    UInt32  totalNumberOfSamplesPerPixel;
+    UInt32  sampleIndexOffset;
+    Int32   tilesX;
+    Int32   tilesY;
+    Int32   splattingKernelWidth;
+    Int32   deferredFiltering;
+    Int32   pixelStatistics;
+    Int64   globalRandomSeed;
+    UInt64  startingSequenceID;
+    Int64   samplesSpent;
+    double  renderTime;
+}
+ArTiledSamplerCheckpointHeader;
+
+- (void) checkpoint_header
+    :(ArTiledSamplerCheckpointHeader*) header
+{
+    memset(header, 0, sizeof(ArTiledSamplerCheckpointHeader));
+
+    header->magic=CHECKPOINT_MAGIC;
+    header->version=CHECKPOINT_VERSION;
+    header->imageSize[0]=XC(imageSize);
+    header->imageSize[1]=YC(imageSize);
+    header->imageOrigin[0]=XC(imageOrigin);
+    header->imageOrigin[1]=YC(imageOrigin);
+    header->numberOfImages=numberOfImagesToWrite;
+    header->spectralChannels=spc_channels(art_gv);
+    header->polarisation=LIGHT_SUBSYSTEM_IS_IN_POLARISATION_MODE;
+    header->deterministicWavelengths=deterministicWavelengths;
+    header->overallNumberOfSamplesPerPixel=overallNumberOfSamplesPerPixel;
+    header->maximumNumberOfSamplesPerPixel=maximumNumberOfSamplesPerPixel;
+    header->samplesPerWindow=samples_per_window;
+    header->totalNumberOfSamplesPerPixel=totalNumberOfSamplesPerPixel;
+    header->sampleIndexOffset=sampleIndexOffset;
+    header->tilesX=tiles_X;
+    header->tilesY=tiles_Y;
+    header->splattingKernelWidth=splattingKernelWidth;
+    header->deferredFiltering=deferredFiltering;
+    header->pixelStatistics=collectPixelStatistics;
+    header->globalRandomSeed=arrandom_global_seed(art_gv);
+    header->startingSequenceID=startingSequenceID;
+}
+
+- (size_t) checkpoint_image_size
+{
+    ArSpectralFramebuffer* fb=merge_image.image[0];
+    size_t size=(fb->components*fb->channels+1)*fb->pixels*sizeof(double);
+    if(fb->polarised)
+        size+=fb->pixels*(sizeof(unsigned char)+sizeof(ArReferenceFrame));
+    return size;
+}
+
+- (size_t) checkpoint_body_size
+{
+    size_t number_of_windows=tiles_X*tiles_Y;
+    size_t number_of_pixels=XC(imageSize)*YC(imageSize);
+    size_t size=
+          numberOfImagesToWrite
+        * (number_of_pixels*sizeof(double)+[self checkpoint_image_size]);
+    if(collectPixelStatistics)
+        size+=number_of_pixels*(2*sizeof(double)+sizeof(unsigned int));
+    size+=number_of_windows*(sizeof(unsigned int)+sizeof(BOOL));
+    size+=number_of_pixels*sizeof(BOOL);
+    return size;
+}
+
+#define CHECKPOINT_WRITE(__p, __data, __size) \
+    memcpy( (__p), (__data), (__size) ); (__p) += (__size);
+
+#define CHECKPOINT_READ(__p, __data, __size) \
+    memcpy( (__data), (__p), (__size) ); (__p) += (__size);
+
+- (char*) write_checkpoint_image
+    :(char*) p
+    :(ArSpectralFramebuffer*) fb
+{
+    unsigned int planes=fb->components*fb->channels;
+    for (unsigned int i=0; i<planes; i++) {
+        CHECKPOINT_WRITE(p, fb->value+i*fb->stride, fb->pixels*sizeof(double));
+    }
+    CHECKPOINT_WRITE(p, fb->alpha, fb->pixels*sizeof(double));
+    if(fb->polarised){
+        CHECKPOINT_WRITE(p, fb->polarised, fb->pixels*sizeof(unsigned char));
+        CHECKPOINT_WRITE(p, fb->refframe, fb->pixels*sizeof(ArReferenceFrame));
+    }
+    return p;
+}
+
+- (const char*) read_checkpoint_image
+    :(const char*) p
+    :(ArSpectralFramebuffer*) fb
+{
+    unsigned int planes=fb->components*fb->channels;
+    for (unsigned int i=0; i<planes; i++) {
+        CHECKPOINT_READ(p, fb->value+i*fb->stride, fb->pixels*sizeof(double));
+    }
+    CHECKPOINT_READ(p, fb->alpha, fb->pixels*sizeof(double));
+    if(fb->polarised){
+        CHECKPOINT_READ(p, fb->polarised, fb->pixels*sizeof(unsigned char));
+        CHECKPOINT_READ(p, fb->refframe, fb->pixels*sizeof(ArReferenceFrame));
+    }
+    return p;
+}
+
+//   Runs on the control thread. Only the snapshot into the checkpoint
+//   buffer is taken with the windows locked; the render threads go on
+//   while it is written to disk.
+
+- (void) writeCheckpoint
+{
+    ArTiledSamplerCheckpointHeader header;
+    [self checkpoint_header: &header];
+
+    long number_of_windows=tiles_X*tiles_Y;
+    long number_of_pixels=XC(imageSize)*YC(imageSize);
+    size_t body_size=[self checkpoint_body_size];
+
+    if(!checkpoint_buffer)
+        checkpoint_buffer=ALLOC_ARRAY(char, body_size);
+
+    [self lock_all_windows];
+
+    char* p=checkpoint_buffer;
+    CHECKPOINT_WRITE(p, merge_image.samples,
+        numberOfImagesToWrite*number_of_pixels*sizeof(double));
+    for (unsigned int im=0; im<numberOfImagesToWrite; im++) {
+        p=[self write_checkpoint_image: p : merge_image.image[im]];
+    }
+    if(collectPixelStatistics){
+        CHECKPOINT_WRITE(p, pixel_mean, number_of_pixels*sizeof(double));
+        CHECKPOINT_WRITE(p, pixel_m2, number_of_pixels*sizeof(double));
+        CHECKPOINT_WRITE(p, pixel_samples, number_of_pixels*sizeof(unsigned int));
+    }
+    CHECKPOINT_WRITE(p, window_pass, number_of_windows*sizeof(unsigned int));
+    CHECKPOINT_WRITE(p, window_retired, number_of_windows*sizeof(BOOL));
+    CHECKPOINT_WRITE(p, unfinished, number_of_pixels*sizeof(BOOL));
+    header.samplesSpent=samples_spent;
+    header.renderTime=[self seconds_rendered];
+
+    [self unlock_all_windows];
+
+    //   The file is written under a temporary name first, so that an
+    //   interruption never leaves a partially written checkpoint behind.
+
+    char* temporaryFileName=ALLOC_ARRAY(char, strlen(checkpointFileName)+5);
+    sprintf(temporaryFileName, "%s.tmp", checkpointFileName);
+
+    FILE* checkpointFile=fopen(temporaryFileName, "wb");
+    BOOL writeSucceeded=(checkpointFile!=0);
+
+    if(checkpointFile){
+        writeSucceeded=
+               fwrite(&header, sizeof(ArTiledSamplerCheckpointHeader), 1, checkpointFile)==1
+            && fwrite(checkpoint_buffer, 1, body_size, checkpointFile)==body_size;
+
+        if(fclose(checkpointFile))
+            writeSucceeded=NO;
+
+        if(writeSucceeded)
+            writeSucceeded=(rename(temporaryFileName, checkpointFileName)==0);
+
+        if(!writeSucceeded)
+            unlink(temporaryFileName);
+    }
+
+    if(!writeSucceeded)
+        ART_ERRORHANDLING_WARNING(
+            "could not write checkpoint file '%s'"
+            ,   checkpointFileName
+            );
+
+    FREE_ARRAY(temporaryFileName);
+}
+
+//   Restores the state of a render from a checkpoint. A missing file
+//   just means that the render starts from scratch, e.g. when a job that
+//   always asks to be resumed runs for the first time.
+
+- (BOOL) readCheckpoint
+{
+    FILE* checkpointFile=fopen(checkpointFileName, "rb");
+
+    if(!checkpointFile){
+        ART_ERRORHANDLING_WARNING(
+            "no checkpoint file '%s' found, starting from scratch"
+            ,   checkpointFileName
+            );
+        return NO;
+    }
+
+    ArTiledSamplerCheckpointHeader header, expected;
+    [self checkpoint_header: &expected];
+
+    long number_of_windows=tiles_X*tiles_Y;
+    long number_of_pixels=XC(imageSize)*YC(imageSize);
+    size_t body_size=[self checkpoint_body_size];
+
+    checkpoint_buffer=ALLOC_ARRAY(char, body_size);
+
+    BOOL readSucceeded=
+           fread(&header, sizeof(ArTiledSamplerCheckpointHeader), 1, checkpointFile)==1
+        && fread(checkpoint_buffer, 1, body_size, checkpointFile)==body_size
+        && fgetc(checkpointFile)==EOF;
+
+    fclose(checkpointFile);
+
+    if(!readSucceeded)
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "checkpoint file '%s' is damaged"
+            ,   checkpointFileName
+            );
+
+    expected.samplesSpent=header.samplesSpent;
+    expected.renderTime=header.renderTime;
+
+    if(memcmp(&header, &expected, sizeof(ArTiledSamplerCheckpointHeader)))
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "checkpoint file '%s' does not match the current render settings"
+            ,   checkpointFileName
+            );
+
+    const char* p=checkpoint_buffer;
+    CHECKPOINT_READ(p, merge_image.samples,
+        numberOfImagesToWrite*number_of_pixels*sizeof(double));
+    for (unsigned int im=0; im<numberOfImagesToWrite; im++) {
+        p=[self read_checkpoint_image: p : merge_image.image[im]];
+    }
+    if(collectPixelStatistics){
+        CHECKPOINT_READ(p, pixel_mean, number_of_pixels*sizeof(double));
+        CHECKPOINT_READ(p, pixel_m2, number_of_pixels*sizeof(double));
+        CHECKPOINT_READ(p, pixel_samples, number_of_pixels*sizeof(unsigned int));
+    }
+    CHECKPOINT_READ(p, window_pass, number_of_windows*sizeof(unsigned int));
+    CHECKPOINT_READ(p, window_retired, number_of_windows*sizeof(BOOL));
+    CHECKPOINT_READ(p, unfinished, number_of_pixels*sizeof(BOOL));
+    samples_spent=header.samplesSpent;
+    previousRenderTime=header.renderTime;
+
+    return YES;
+}
+
+//   Hands out the windows that still need passes, after restoring the
+//   state of a checkpoint if asked to. For the first pass, each thread
+//   starts out with a contiguous stretch of the window order, or, for
+//   the spiral, with every n-th window of it, so that all threads work
+//   their way outwards together; after that, the deques balance the
+//   load.
+
+- (void) schedule_windows
+{
+    long number_of_windows=tiles_X*tiles_Y;
+
+    for (long w=0; w<number_of_windows; w++) {
+        window_retired[w]=([self samples_of_pass: 0]==0);
+    }
+
+    if(checkpointFileName
+       && ARNTILEDSTOCHASTICSAMPLER_GV->resumeFromCheckpoint
+       && [self readCheckpoint]){
+        printf(
+            "resuming from checkpoint '%s' after %.0f seconds\n",
+            checkpointFileName,
+            previousRenderTime
+            );
+    }
+    lastCheckpointTime=previousRenderTime;
+
+    active_windows=0;
+    finished_tasks=0;
+    for (long w=0; w<number_of_windows; w++) {
+        finished_tasks+=window_pass[w];
+        if(!window_retired[w])
+            active_windows++;
+        if(noiseTarget>0.0)
+            [self update_noise_estimate: w];
+    }
+
+    //   what the sample counter has to catch up with when resuming
+    if(adaptiveSamplingTarget>0.0)
+        samples_reported=(unsigned int)MIN(
+            (double)overallNumberOfSamplesPerPixel,
+            (double)overallNumberOfSamplesPerPixel*samples_spent/MAX(sample_budget,1));
+    else
+        samples_reported=(unsigned int)MIN(
+            [self first_sample_of_pass: finished_tasks/number_of_windows],
+            (unsigned long)maximumNumberOfSamplesPerPixel);
+
+    for (unsigned int t=0; t<numberOfRenderThreads; t++) {
+        long first=number_of_windows*t/numberOfRenderThreads;
+        long last=number_of_windows*(t+1)/numberOfRenderThreads;
+        long step=1;
+        if(tileOrder==artileorder_spiral){
+            first=t;
+            last=number_of_windows;
+            step=numberOfRenderThreads;
+        }
+        //   pushed in reverse, so that the owner gets them in order
+        long count=(last-first+step-1)/step;
+        for (long i=count-1; i>=0; i--) {
+            long w=window_order[first+i*step];
+            if(!window_retired[w])
+                push_work_deque(&render_deque[t], w);
         }
     }
 }
 
+//   The windows that the padded tile of a window overlaps with. Pixels
+//   outside the area covered by windows belong to the nearest one.
+
+- (void) windows_touched_by
+    :(image_window_t*) window
+    :(IVec2D*) first
+    :(IVec2D*) last
+{
+    XC(*first)=MAX(XC(window->start)-tilePadding-XC(imageOrigin),0)/XC(tile_size);
+    YC(*first)=MAX(YC(window->start)-tilePadding-YC(imageOrigin),0)/YC(tile_size);
+    XC(*last)=MIN(
+        MAX(XC(window->end)-1+tilePadding-XC(imageOrigin),0)/XC(tile_size),
+        (int)tiles_X-1);
+    YC(*last)=MIN(
+        MAX(YC(window->end)-1+tilePadding-YC(imageOrigin),0)/YC(tile_size),
+        (int)tiles_Y-1);
+}
+
+//   Locks are always taken in the order of the window index, so that two
+//   threads merging neighbouring tiles cannot deadlock.
+
+- (void) lock_windows
+    :(image_window_t*) window
+{
+    IVec2D first,last;
+    [self windows_touched_by: window : &first : &last];
+    for (int y=YC(first); y<=YC(last); y++) {
+        for (int x=XC(first); x<=XC(last); x++) {
+            pthread_mutex_lock(&window_lock[y*tiles_X+x]);
+        }
+    }
+}
+
+- (void) unlock_windows
+    :(image_window_t*) window
+{
+    IVec2D first,last;
+    [self windows_touched_by: window : &first : &last];
+    for (int y=YC(first); y<=YC(last); y++) {
+        for (int x=XC(first); x<=XC(last); x++) {
+            pthread_mutex_unlock(&window_lock[y*tiles_X+x]);
+        }
+    }
+}
+
+- (void) lock_all_windows
+{
+    for (unsigned int i=0; i<tiles_X*tiles_Y; i++) {
+        pthread_mutex_lock(&window_lock[i]);
+    }
+}
+
+- (void) unlock_all_windows
+{
+    for (unsigned int i=0; i<tiles_X*tiles_Y; i++) {
+        pthread_mutex_unlock(&window_lock[i]);
+    }
+}
+
 
 
 ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
@@ -381,14 +1471,10 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
 
 - (void) setupInternalVariables
 {
-    finishedGeneratingRenderTasks=NO;
+    requestedNumberOfSamplesPerPixel = overallNumberOfSamplesPerPixel;
     renderThreadsShouldTerminate = NO;
     workingThreadsAreDone=NO;
-    window_iterator=0;
     samples_per_window=16;
-    samples_per_window_adaptive=samples_per_window;
-    samples_issued=0;
-    samples_per_window= MIN(overallNumberOfSamplesPerPixel-samples_issued,samples_per_window);
     numberOfRenderThreads = art_maximum_number_of_working_threads(art_gv);
     if ( deterministicWavelengths )
     {
@@ -398,10 +1484,6 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
     {
         wavelengthSteps = 1;
     }
-    if(samples_per_window==0){
-        finishedGeneratingRenderTasks=true;
-    }
-
 }
 - (id) init
         : (ArNode <ArpPathspaceIntegrator> * ) newPathspaceIntegrator
@@ -462,6 +1544,19 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
 {
     (void)nWorld;
     (void)nCamera;
+
+    //   The same sampler can be run more than once, e.g. by the jobs of a
+    //   render server, so everything the previous render changed is reset.
+
+    if ( ARNTILEDSTOCHASTICSAMPLER_GV->samplesPerPixel > 0 )
+        overallNumberOfSamplesPerPixel =
+            ARNTILEDSTOCHASTICSAMPLER_GV->samplesPerPixel;
+    else
+        overallNumberOfSamplesPerPixel = requestedNumberOfSamplesPerPixel;
+
+    renderThreadsShouldTerminate = NO;
+    workingThreadsAreDone=NO;
+
     pthread_barrier_init(&renderingDone, NULL, numberOfRenderThreads+1);
     pthread_barrier_init(&mergingDone, NULL, 2);
     
@@ -471,6 +1566,11 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
 
     if ( overallNumberOfSamplesPerPixel == 0 )
     {
+        if ( ARNTILEDSTOCHASTICSAMPLER_GV->sampleRangeCount > 1 )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "open ended sampling cannot be split into sample ranges"
+                );
+
         asprintf(
             & preSamplingMessage,
               "---   interactive mode on, open ended sampling, press t to terminate   ---\n"
@@ -485,7 +1585,91 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
               overallNumberOfSamplesPerPixel
             );
     }
+
+    //   Split rendering: only the samples of slice k of n are taken, and
+    //   their indices are those they have in the whole render. As the
+    //   random sequences of a sample are seeded from its pixel and index,
+    //   the slices are disjoint, and together take exactly the samples of
+    //   a render of all of them.
+
+    totalNumberOfSamplesPerPixel=overallNumberOfSamplesPerPixel;
+    sampleIndexOffset=0;
+    sampleRangeIndex=ARNTILEDSTOCHASTICSAMPLER_GV->sampleRangeIndex;
+    sampleRangeCount=ARNTILEDSTOCHASTICSAMPLER_GV->sampleRangeCount;
+    if(sampleRangeCount>1){
+        unsigned long total=totalNumberOfSamplesPerPixel;
+        unsigned int sample_end=(unsigned int)(total*(sampleRangeIndex+1)/sampleRangeCount);
+        sampleIndexOffset=(unsigned int)(total*sampleRangeIndex/sampleRangeCount);
+        overallNumberOfSamplesPerPixel=sample_end-sampleIndexOffset;
+        if(overallNumberOfSamplesPerPixel==0)
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "slice %u of %u of %u spp contains no samples"
+                ,   sampleRangeIndex
+                ,   sampleRangeCount
+                ,   totalNumberOfSamplesPerPixel
+                );
+
+        char* nominalMessage=preSamplingMessage;
+        asprintf(
+            & preSamplingMessage,
+              "%s---   slice %u of %u: samples %u to %u   ---\n",
+              nominalMessage,
+              sampleRangeIndex,
+              sampleRangeCount,
+              sampleIndexOffset,
+              sample_end-1
+            );
+        FREE_ARRAY(nominalMessage);
+    }
     numberOfImagesToWrite=numberOfResultImages;
+
+    adaptiveSamplingTarget=arntiledstochasticsampler_adaptive_sampling(art_gv);
+    timeBudget=arntiledstochasticsampler_time_budget(art_gv);
+    noiseTarget=arntiledstochasticsampler_noise_target(art_gv);
+    collectPixelStatistics=adaptiveSamplingTarget>0.0 || noiseTarget>0.0;
+    checkpointFileName=ARNTILEDSTOCHASTICSAMPLER_GV->checkpointFileName;
+    checkpointInterval=ARNTILEDSTOCHASTICSAMPLER_GV->checkpointInterval;
+    checkpoint_pending=NO;
+    checkpoint_buffer=NULL;
+    previousRenderTime=0.0;
+    maximumNumberOfSamplesPerPixel=overallNumberOfSamplesPerPixel;
+    if(adaptiveSamplingTarget>0.0 && sampleRangeCount>1)
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "adaptive sampling cannot be combined with split rendering"
+            );
+    if(adaptiveSamplingTarget>0.0){
+        maximumNumberOfSamplesPerPixel=
+            overallNumberOfSamplesPerPixel*ADAPTIVE_SAMPLING_MAXIMUM_FACTOR;
+
+        char* nominalMessage=preSamplingMessage;
+        asprintf(
+            & preSamplingMessage,
+              "%s---   adaptive sampling, target relative error %g   ---\n",
+              nominalMessage,
+              adaptiveSamplingTarget
+            );
+        FREE_ARRAY(nominalMessage);
+    }
+    if(timeBudget>0.0){
+        char* nominalMessage=preSamplingMessage;
+        asprintf(
+            & preSamplingMessage,
+              "%s---   time budget of %g seconds   ---\n",
+              nominalMessage,
+              timeBudget
+            );
+        FREE_ARRAY(nominalMessage);
+    }
+    if(noiseTarget>0.0){
+        char* nominalMessage=preSamplingMessage;
+        asprintf(
+            & preSamplingMessage,
+              "%s---   stopping at a noise level of %g   ---\n",
+              nominalMessage,
+              noiseTarget
+            );
+        FREE_ARRAY(nominalMessage);
+    }
     
     sampleCounter =
         [ ALLOC_INIT_OBJECT(ArcSampleCounter)
@@ -503,6 +1687,12 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
             numberOfRenderThreads
             );
 
+    //   The random generators and estimators are set up for the whole
+    //   render, so that a slice draws the same values it would there.
+
+    unsigned int sequenceLength=
+        MAX(maximumNumberOfSamplesPerPixel, totalNumberOfSamplesPerPixel);
+
     //   Note that the thread RNGs initialised by the following
     //   loop are all initialised to different starting seeds.
     //   ART RNGs call the 'master RNG' of the entire system when
@@ -514,7 +1704,7 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
         randomGenerator[i] =
             ARCRANDOMGENERATOR_NEW(
                 randomValueGeneration,
-                overallNumberOfSamplesPerPixel,
+                sequenceLength,
                 ART_GLOBAL_REPORTER
                 );
 
@@ -592,6 +1782,23 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
         }
     }
 
+    pixel_samples=0;
+    pixel_mean=0;
+    pixel_m2=0;
+    sample_budget=0;
+    samples_spent=0;
+    samples_reported=0;
+    if(collectPixelStatistics){
+        long number_of_pixels=XC(imageSize)*YC(imageSize);
+        pixel_samples=ALLOC_ARRAY_ZERO(unsigned int, number_of_pixels);
+        pixel_mean=ALLOC_ARRAY_ZERO(double, number_of_pixels);
+        pixel_m2=ALLOC_ARRAY_ZERO(double, number_of_pixels);
+        for (long i=0; i<number_of_pixels; i++) {
+            if(unfinished[i])
+                sample_budget+=overallNumberOfSamplesPerPixel;
+        }
+    }
+
     pathspaceIntegrator =
         ALLOC_ARRAY(
             ArNode <ArpPathspaceIntegrator> *,
@@ -628,11 +1835,32 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
             :   lightsources
             :   [ camera eye ]
             :   [ camera near ]
-            :   overallNumberOfSamplesPerPixel
+            :   sequenceLength
             :   ART_GLOBAL_REPORTER
             ];
     }
 
+    if ( posix_memalign(
+            (void**) & thread_telemetry,
+            64,
+            numberOfRenderThreads * sizeof(thread_telemetry_t) ) != 0 )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "could not allocate the render thread telemetry"
+            );
+
+    memset(thread_telemetry, 0, numberOfRenderThreads * sizeof(thread_telemetry_t));
+    thread_ray_caster = ALLOC_ARRAY( ArnRayCaster *, numberOfRenderThreads );
+    stats_busy_seconds = ALLOC_ARRAY_ZERO( double, numberOfRenderThreads );
+
+    for ( unsigned int i = 0; i < numberOfRenderThreads; i++ )
+    {
+        if ( [ pathspaceIntegrator[i] isKindOfClass: [ ArnPathspaceIntegrator class ] ] )
+            thread_ray_caster[i] =
+                [ (ArnPathspaceIntegrator *) pathspaceIntegrator[i] rayCaster ];
+        else
+            thread_ray_caster[i] = NULL;
+    }
+
     arwavelength_sampling_data_from_current_ISR_s(
           art_gv,
         & spectralSamplingData
@@ -644,12 +1872,25 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
         );
     [self init_tile: &merge_image : imageSize];
     [self clean_tile:&merge_image];
-    tile_size=IVEC2D(16, 16);
-
+    //   Unless set, the tile size is the largest power of two from 64
+    //   down to 8 that still gives each render thread a few windows to
+    //   balance the load with.
+
+    unsigned int size=ARNTILEDSTOCHASTICSAMPLER_GV->tileSize;
+    if(size==0){
+        long pixels=(long)(XC(imageSize)-XC(imageOrigin))*(YC(imageSize)-YC(imageOrigin));
+        size=64;
+        while(size>8 && pixels/((long)size*size)<8*(long)numberOfRenderThreads)
+            size/=2;
+    }
+    tile_size=IVEC2D(size, size);
+    tileOrder=ARNTILEDSTOCHASTICSAMPLER_GV->tileOrder;
     
     tiles_X=div_roundup(XC(imageSize)-XC(imageOrigin), XC(tile_size));
     tiles_Y=div_roundup(YC(imageSize)-YC(imageOrigin), YC(tile_size));
     render_windows= ALLOC_ARRAY(image_window_t, tiles_X*tiles_Y);
+    window_order= ALLOC_ARRAY(long, tiles_X*tiles_Y);
+    order_windows(tileOrder, tiles_X, tiles_Y, window_order);
 
     int y_start=YC(imageOrigin);
     for (unsigned int y=0; y<tiles_Y; y++) {
@@ -669,8 +1910,18 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
     splattingKernelWidth  = [ RECONSTRUCTION_KERNEL supportSize ];
     splattingKernelArea   = M_SQR( splattingKernelWidth );
     splattingKernelOffset = (splattingKernelWidth - 1) / 2;
-    padded_tile_size=IVEC2D(XC(tile_size)+2*splattingKernelOffset,YC(tile_size)+2*splattingKernelOffset);
-    buffer_size=TILE_CONSTANT*numberOfRenderThreads;
+
+    //   With deferred filtering, samples only go to the pixel they belong
+    //   to, and the kernel is applied to the whole image when it is
+    //   written. Tiles then need no border for the kernel footprint.
+
+    deferredFiltering =
+           ARNTILEDSTOCHASTICSAMPLER_GV->deferredFiltering
+        && splattingKernelWidth > 1;
+    tilePadding = deferredFiltering ? 0 : splattingKernelOffset;
+    padded_tile_size=IVEC2D(XC(tile_size)+2*tilePadding,YC(tile_size)+2*tilePadding);
+    //   one work tile per render thread
+    buffer_size=numberOfRenderThreads;
     tiles = ALLOC_ARRAY(
             tile_t,
             buffer_size
@@ -680,21 +1931,42 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
           i++ )
     {
         [self init_tile: &tiles[i] : padded_tile_size];
+        if(collectPixelStatistics)
+            [self init_tile_statistics: &tiles[i]];
     }
-    init_render_queue(&render_queue, buffer_size);
-    init_merge_queue(&merge_queue, buffer_size);
-    
-    for (size_t i =0; i< buffer_size; i++) {
-        art_task_t task;
-        task.work_tile=&tiles[i];
+    init_control_queue(&control_queue, numberOfRenderThreads);
 
-        if([self make_task: &task]){
-            push_render_queue(&render_queue, task);
-        }
+    long number_of_windows=tiles_X*tiles_Y;
+    window_pass=ALLOC_ARRAY_ZERO(unsigned int, number_of_windows);
+    window_lock=ALLOC_ARRAY(pthread_mutex_t, number_of_windows);
+    for (long i=0; i<number_of_windows; i++) {
+        pthread_mutex_init(&window_lock[i], NULL);
     }
+    pthread_mutex_init(&progress_lock, NULL);
+
+    pass_limit=UINT_MAX;
+    highest_pass=0;
+    stoppingCriterion=NULL;
+    window_noise=ALLOC_ARRAY_ZERO(double, number_of_windows);
+    window_noise_pixels=ALLOC_ARRAY_ZERO(long, number_of_windows);
+    window_retired=ALLOC_ARRAY(BOOL, number_of_windows);
+    noise_sum=0.0;
+    noise_pixels=0;
+
+    render_deque=ALLOC_ARRAY(work_deque_t, numberOfRenderThreads);
+    deferred_deque=ALLOC_ARRAY(work_deque_t, numberOfRenderThreads);
+    for (unsigned int t=0; t<numberOfRenderThreads; t++) {
+        init_work_deque(&render_deque[t], number_of_windows);
+        init_work_deque(&deferred_deque[t], number_of_windows);
+    }
+    pthread_mutex_init(&idle_lock, NULL);
+    pthread_cond_init(&idle_cond, NULL);
+    work_generation=0;
+
     tev = [ ALLOC_INIT_OBJECT(ArcTevIntegration)];
     [tev setHostName:LOCALHOST ];
     [tev setHostPort:TEV_PORT];
+    [tev setUpdateFrequency:ARNTILEDSTOCHASTICSAMPLER_GV->tevUpdateFrequency];
     [tev tryConnection];
     tev_names=ALLOC_ARRAY(char*,numberOfResultImages);
 
@@ -708,6 +1980,7 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
     }
     tev_update_tile =ALLOC_ARRAY(float, 3*XC(padded_tile_size)*YC(padded_tile_size));
     tev_light = arlightalpha_alloc(art_gv);
+    tev_pixel = arspectralframebufferpixel_alloc(art_gv);
     tev_spectrum = spc_alloc(art_gv);
     tev_rgb =rgb_alloc(art_gv);
     
@@ -720,7 +1993,7 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
     // //           unique 2D subpixel coordinates in that case.
 
     numberOfSubpixelSamples =
-        M_MIN( IMAGE_SAMPLER_MAX_SUBPIXEL_SAMPLES, overallNumberOfSamplesPerPixel);
+        M_MIN( IMAGE_SAMPLER_MAX_SUBPIXEL_SAMPLES, totalNumberOfSamplesPerPixel);
     
     sampleCoord = ALLOC_ARRAY( Pnt2D, numberOfSubpixelSamples );
     // //   Actual generation of the 2D sample coordinates
@@ -790,11 +2063,51 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
                     = v - splattingKernelOffset;
             }
     }
-    out =
+
+    //   Deferred filtering gathers from the neighbours a sample at the
+    //   centre of a pixel would have been splatted to, with the weights
+    //   it would have had there.
+
+    if ( deferredFiltering )
+    {
+        filterOffset = ALLOC_ARRAY( IVec2D, splattingKernelArea );
+        filterWeight = ALLOC_ARRAY( double, splattingKernelArea );
+
+        for ( unsigned int l = 0; l < splattingKernelArea; l++ )
+        {
+            filterOffset[l] =
+                IVEC2D(
+                    -XC( sampleSplattingOffset[l] ),
+                    -YC( sampleSplattingOffset[l] )
+                    );
+
+            Pnt2D  localCoord =
+                PNT2D(
+                    -XC( sampleSplattingOffset[l] ),
+                    -YC( sampleSplattingOffset[l] )
+                    );
+
+            filterWeight[l] =
+                [ RECONSTRUCTION_KERNEL valueAt
+                    : & localCoord
+                    ];
+        }
+
+        out_unfiltered = arspectralframebuffer_alloc(art_gv, imageSize);
+        out_unfiltered_samples = ALLOC_ARRAY(double, XC(imageSize)*YC(imageSize));
+    }
+    out = arspectralframebuffer_alloc(art_gv, imageSize);
+    out_samples = ALLOC_ARRAY(double, XC(imageSize)*YC(imageSize));
+    out_line =
         [ ALLOC_OBJECT(ArnLightAlphaImage)
             initWithSize
-            :   IVEC2D(XC(imageSize), YC(imageSize))
+            :   IVEC2D(XC(imageSize), 1)
             ];
+    out_pixel = arspectralframebufferpixel_alloc(art_gv);
+
+    //   needs everything above, down to the starting sequence ID
+    [self schedule_windows];
+
     tcgetattr( STDIN_FILENO, & original );
     atexit(AtExit);
     
@@ -812,9 +2125,25 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
     //   This function sets the stage for the rendering processes to do their
     //   work, starts them, and then sleeps until they are done.
     
-    //   Detach n render threads.
+    //   Detach n render threads. The clock starts before they do, as the
+    //   time budget is checked against it.
+
+    artime_now( & beginTime );
 
     [ sampleCounter start ];
+
+    //   samples already taken by the run a checkpoint came from
+    if ( samples_reported > 0 )
+        [ sampleCounter step: samples_reported ];
+
+    samples_before =
+        adaptiveSamplingTarget > 0.0
+        ? (unsigned long) samples_spent
+        : (unsigned long) samples_reported * XC(imageSize) * YC(imageSize);
+    stats_time = previousRenderTime;
+    stats_samples = 0;
+    stats_rays[0] = stats_rays[1] = stats_rays[2] = 0;
+    __atomic_store_n( & telemetry_active, YES, __ATOMIC_RELEASE );
     unsigned int i = 0;
     ArcUnsignedInteger  * index;
     for ( ; i < numberOfRenderThreads; i++ )
@@ -831,10 +2160,9 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
     
     index = [ ALLOC_INIT_OBJECT(ArcUnsignedInteger) : i++ ];
 
-    if ( ! art_thread_detach(@selector(mergeThread:), self,  index))
+    if ( ! art_thread_detach(@selector(controlThread:), self,  index))
         ART_ERRORHANDLING_FATAL_ERROR(
-            "could not detach rendering thread %d",
-            i
+            "could not detach control thread"
             );
 
     index = [ ALLOC_INIT_OBJECT(ArcUnsignedInteger) : i++ ];
@@ -868,16 +2196,15 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
         fprintf(stderr, "Error creating pipe to I/O thread\n");
     }
 
-    artime_now( & beginTime );
-
     pthread_barrier_wait(&renderingDone);
+    __atomic_store_n( & telemetry_active, NO, __ATOMIC_RELEASE );
     //This shuts down the I/O watching thread for interactive mode
     write( read_thread_pipe[1], "q", 1 );
 
     
     art_task_t task;
     task.type=WRITE_EXIT;
-    push_merge_queue(&merge_queue,task);
+    push_control_queue(&control_queue,task);
     
     pthread_barrier_wait(&mergingDone);
 
@@ -888,6 +2215,93 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
         ];
 }
 
+//   A snapshot of the progress of the render, for a stats request. All
+//   counters are read without locking, so the numbers may be a little
+//   out of step with each other; the rates are averages since the
+//   previous request.
+
+- (void) statistics
+    :(ArRenderStatistics*) stats
+{
+    memset(stats, 0, sizeof(ArRenderStatistics));
+
+    double now=[self seconds_rendered];
+    double interval=now-stats_time;
+    unsigned long samples=0;
+    unsigned long rays[3]={0,0,0};
+    unsigned int threads=MIN(numberOfRenderThreads, ARRENDERSTATISTICS_MAX_THREADS);
+
+    for (unsigned int t=0; t<numberOfRenderThreads; t++) {
+        samples+=__atomic_load_n(&thread_telemetry[t].samples, __ATOMIC_RELAXED);
+
+        double busy=
+            1e-9*__atomic_load_n(&thread_telemetry[t].busy_nanoseconds, __ATOMIC_RELAXED);
+        if(t<threads && interval>0.0)
+            stats->threadUtilisation[t]=
+                (float)M_MIN((busy-stats_busy_seconds[t])/interval, 1.0);
+        stats_busy_seconds[t]=busy;
+
+        if(thread_ray_caster[t]){
+            ArRayCastingStatistics counts=arnraycaster_ray_counts(thread_ray_caster[t]);
+            rays[0]+=counts.firstHitRays;
+            rays[1]+=counts.anyHitRays;
+            rays[2]+=counts.packetRays;
+        }
+    }
+
+    stats->numberOfThreads=threads;
+    stats->samplesIssued=samples_before+samples;
+    stats->samplesTotal=
+        adaptiveSamplingTarget>0.0
+        ? (uint64_t)sample_budget
+        : (uint64_t)overallNumberOfSamplesPerPixel*XC(imageSize)*YC(imageSize);
+    stats->samplesPerPixelDone=[sampleCounter samplesSoFar];
+    stats->samplesPerPixel=overallNumberOfSamplesPerPixel;
+    stats->secondsRendered=now;
+
+    if(interval>0.0){
+        stats->samplesPerSecond=(samples-stats_samples)/interval;
+        stats->firstHitRaysPerSecond=(rays[0]-stats_rays[0])/interval;
+        stats->anyHitRaysPerSecond=(rays[1]-stats_rays[1])/interval;
+        stats->packetRaysPerSecond=(rays[2]-stats_rays[2])/interval;
+    }
+
+    stats->controlQueueDepth=
+        (uint32_t)__atomic_load_n(&control_queue.pending, __ATOMIC_RELAXED);
+    stats->activeWindows=
+        (uint32_t)__atomic_load_n(&active_windows, __ATOMIC_RELAXED);
+
+    //   The time remaining follows from the average rate of this run so
+    //   far, and is cut short by the time budget, if there is one.
+
+    double elapsed=now-previousRenderTime;
+    stats->secondsRemaining=-1.0;
+    if(samples>0 && elapsed>0.0 && stats->samplesTotal>stats->samplesIssued)
+        stats->secondsRemaining=
+            (stats->samplesTotal-stats->samplesIssued)/(samples/elapsed);
+    else if(stats->samplesTotal<=stats->samplesIssued)
+        stats->secondsRemaining=0.0;
+    if(timeBudget>0.0){
+        double left=M_MAX(timeBudget-now, 0.0);
+        if(stats->secondsRemaining<0.0 || left<stats->secondsRemaining)
+            stats->secondsRemaining=left;
+    }
+
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)==0){
+#ifdef __APPLE__
+        stats->peakResidentKilobytes=usage.ru_maxrss/1024;
+#else
+        stats->peakResidentKilobytes=usage.ru_maxrss;
+#endif
+    }
+
+    stats_time=now;
+    stats_samples=samples;
+    for (int i=0; i<3; i++)
+        stats_rays[i]=rays[i];
+}
+
 - (void)MessageQueueThread
     : (ArcUnsignedInteger *) threadIndex
 {
@@ -901,10 +2315,10 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
         message_t msg= [messageQueue receiveMessage];
         switch(msg.type){
             case M_WRITE:
-                try_prepend_merge_queue(&writeSem,WRITE);
+                try_prepend_control_queue(&writeSem,WRITE);
                 break;
             case M_WRITE_TONEMAP:
-                try_prepend_merge_queue(&writeSem,WRITE_TONEMAP);
+                try_prepend_control_queue(&writeSem,WRITE_TONEMAP);
                 break;
             case M_TERMINATE:
                 _image_sampler_sigint_handler(0);
@@ -916,7 +2330,17 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
                 [tev setHostName:msg.message_data];
                 break;
             case M_TEV_CONNECT:
-                try_prepend_merge_queue(NULL,TEV_CONNECT);
+                try_prepend_control_queue(NULL,TEV_CONNECT);
+                break;
+            case M_STATS:
+                //   once rendering is done, the requester just times out
+                if(__atomic_load_n(&telemetry_active, __ATOMIC_ACQUIRE)){
+                    ArRenderStatistics stats;
+                    [self statistics: &stats];
+                    [messageQueue sendStatistics: *(long*)(msg.message_data) : &stats];
+                }
+                break;
+            case M_STATS_REPLY:
                 break;
             case M_INVALID:
                 return;
@@ -935,12 +2359,63 @@ ARPACTION_DEFAULT_IMPLEMENTATION(ArnTiledStochasticSampler)
     (void) threadIndex;
     
     while(!renderThreadsShouldTerminate){
-        art_task_t curr_task= pop_render_queue(&render_queue);
-        if(curr_task.type==POISON)
+        long window;
+        unsigned long generation=
+            __atomic_load_n(&work_generation, __ATOMIC_ACQUIRE);
+        if(![self next_window: THREAD_INDEX : &window]){
+            //   the last windows are still being rendered by others
+            if(![self wait_for_work: generation])
+                break;
+            continue;
+        }
+
+        //   Once a stopping criterion has been met, windows that already
+        //   have all the passes the others will get are retired here.
+        pthread_mutex_lock(&progress_lock);
+        unsigned int samples=[self samples_of_pass: window_pass[window]];
+        if(samples>0 && window_pass[window]>highest_pass)
+            highest_pass=window_pass[window];
+        pthread_mutex_unlock(&progress_lock);
+
+        if(samples==0){
+            pthread_mutex_lock(&window_lock[window]);
+            window_retired[window]=YES;
+            pthread_mutex_unlock(&window_lock[window]);
+            [self retire_window];
+            continue;
+        }
+
+        art_task_t curr_task;
+        curr_task.type=RENDER;
+        curr_task.work_tile=&tiles[THREAD_INDEX];
+        curr_task.window=&render_windows[window];
+        curr_task.sample_start=(int)[self first_sample_of_pass: window_pass[window]];
+        curr_task.samples=samples;
+
+        ArTime task_start;
+        artime_now(&task_start);
+
+        //   a tile that was interrupted half-way is not merged
+        if(![self render_task : &curr_task: threadIndex])
             break;
-        [self render_task : &curr_task: threadIndex];
-        curr_task.type=MERGE;
-        push_merge_queue(&merge_queue, curr_task);
+
+        //   The pass only counts as done together with the merge, so
+        //   that a checkpoint never sees one without the other.
+        [self lock_windows: curr_task.window];
+        [self merge_task : &curr_task];
+        window_pass[window]++;
+        BOOL needs_pass=[self window_needs_pass: window : samples];
+        window_retired[window]=!needs_pass;
+        [self unlock_windows: curr_task.window];
+
+        ArTime task_end;
+        artime_now(&task_end);
+        TELEMETRY_ADD(
+            thread_telemetry[THREAD_INDEX].busy_nanoseconds,
+            (unsigned long)(1e9*(artime_seconds(&task_end)-artime_seconds(&task_start)))
+            );
+
+        [self finish_window: THREAD_INDEX : window : needs_pass];
     }
     
     pthread_barrier_wait(&renderingDone);
@@ -954,29 +2429,155 @@ typedef struct ArPixelID
     Pnt2D  pixelCoord;
 }
 ArPixelID;
--(void) render_task
+-(BOOL) render_task
     :(art_task_t*) t
     : (ArcUnsignedInteger *) threadIndex
 {
+    BOOL complete=YES;
     [self clean_tile : t->work_tile];
     ArPathspaceResult  ** sampleValue =
         ALLOC_ARRAY( ArPathspaceResult *, numberOfImagesToWrite );
+
+    //   A sample is splatted into a light value of its own first, which
+    //   is then added to all the pixels of the kernel footprint.
+
+    ArLightAlpha  * splatLight =
+        arlightalpha_d_alloc_init_unpolarised( art_gv, 0.0 );
+    ArSpectralFramebufferPixel  * splatPixel =
+        arspectralframebufferpixel_alloc( art_gv );
     
     ArPixelID  px_id;
 
-    px_id.threadIndex = THREAD_INDEX;
+    //   Which thread renders a window depends on the work stealing, so
+    //   it must not influence the random numbers of a sample: otherwise,
+    //   neither repeated nor resumed renders would give the same result.
+    px_id.threadIndex = 0;
     px_id.globalRandomSeed = arrandom_global_seed(art_gv);
+
+    //   The packet pre-pass below costs a second round of eye ray
+    //   generation, so it is only done if the integrator makes use of
+    //   the first intersections, and if the scene actually traces the
+    //   packets as a whole (currently only the BVH does).
+
+    BOOL  tracePrimaryRayPackets =
+        [ THREAD_PATHSPACE_INTEGRATOR usesFirstEyeRayIntersections ];
+
     for (int y=YC(t->window->start); y<YC(t->window->end); y++) {
         YC(px_id.pixelCoord) = y ;    
         for (int x=XC(t->window->start); x<XC(t->window->end); x++) {
             XC(px_id.pixelCoord) = x;
             if(!unfinished[x + y*XC(imageSize)])
                 continue;
+            ArcIntersection  * firstIntersection[ RAY3DPACKET_MAX_SIZE ];
+            int                packetStart = 0;
+
             for(int sample=0;sample<t->samples;sample++){
-                px_id.sampleIndex = t->sample_start  +sample;
+                if ( sample % RAY3DPACKET_MAX_SIZE == 0 )
+                {
+                    if ( renderThreadsShouldTerminate )
+                    {
+                        complete=NO;
+                        goto FREE_SAMPLE_VALUE;
+                    }
+
+                    TELEMETRY_ADD(
+                        thread_telemetry[THREAD_INDEX].samples,
+                        M_MIN( RAY3DPACKET_MAX_SIZE, t->samples - sample )
+                        );
+
+                    /* ----------------------------------------------------------
+                        The first segment of the eye rays for the next few
+                        samples of this pixel is traced as a packet. The rays
+                        are generated exactly as in the loop below (the random
+                        generator is re-initialised for each sample there),
+                        so the precomputed intersections belong to the same
+                        rays as those the samples actually use.
+
+                        Only the first wavelength of a sample uses the
+                        precomputed intersection; the others trace their
+                        eye ray as before.
+                    ------------------------------------------------------aw- */
+
+                    if ( tracePrimaryRayPackets )
+                    {
+                        Ray3D         packetRay[ RAY3DPACKET_MAX_SIZE ];
+                        int           packetSample[ RAY3DPACKET_MAX_SIZE ];
+                        unsigned int  numberOfPacketRays = 0;
+
+                        packetStart = sample;
+
+                        int  packetEnd =
+                            M_MIN( sample + RAY3DPACKET_MAX_SIZE, t->samples );
+
+                        for ( int s = packetStart; s < packetEnd; s++ )
+                        {
+                            firstIntersection[ s - packetStart ] = 0;
+
+                            px_id.sampleIndex = sampleIndexOffset + t->sample_start + s;
+                            int  sIdx = (px_id.sampleIndex) % numberOfSubpixelSamples;
+
+                            [ THREAD_RANDOM_GENERATOR reInitializeWith
+                                :   crc32_of_data( & px_id, sizeof(ArPixelID) )
+                                ];
+                            [ THREAD_RANDOM_GENERATOR setCurrentSequenceID
+                                :  startingSequenceID
+                                ];
+
+                            ArReferenceFrame   referenceFrame;
+                            ArWavelength       wavelength;
+
+                            if ( deterministicWavelengths )
+                                arwavelength_i_deterministic_init_w(
+                                      art_gv,
+                                      0,
+                                    & wavelength
+                                    );
+                            else
+                                arwavelength_sd_init_w(
+                                      art_gv,
+                                    & spectralSamplingData,
+                                      [ THREAD_RANDOM_GENERATOR valueFromNewSequence ],
+                                    & wavelength
+                                    );
+
+                            if ( [ camera getWorldspaceRay
+                                     : & VEC2D(
+                                            x + XC(sampleCoord[sIdx]),
+                                            y + YC(sampleCoord[sIdx])
+                                            )
+                                     :   THREAD_RANDOM_GENERATOR
+                                     : & referenceFrame
+                                     : & packetRay[numberOfPacketRays]
+                                     ] )
+                            {
+                                packetSample[numberOfPacketRays++] = s;
+                            }
+                        }
+
+                        if ( numberOfPacketRays > 0 )
+                        {
+                            ArcIntersection  * packetIntersection[ RAY3DPACKET_MAX_SIZE ];
+
+                            [ THREAD_PATHSPACE_INTEGRATOR firstEyeRayIntersections
+                                :   packetRay
+                                :   numberOfPacketRays
+                                :   packetIntersection
+                                ];
+
+                            for ( unsigned int i = 0; i < numberOfPacketRays; i++ )
+                                firstIntersection[ packetSample[i] - packetStart ] =
+                                    packetIntersection[i];
+                        }
+                    }
+                }
+
+                px_id.sampleIndex = sampleIndexOffset + t->sample_start + sample;
                 int  subpixelIdx = (px_id.sampleIndex) % numberOfSubpixelSamples;
-                if ( renderThreadsShouldTerminate )
-                    goto FREE_SAMPLE_VALUE;
+
+                //   luminance of this sample over all wavelength steps,
+                //   for the convergence test of adaptive sampling
+                double  sampleLuminance = 0.0;
+                BOOL    sampleCounted = NO;
                 
                 for ( int w = 0; w < wavelengthSteps; w++ )
                 {
@@ -1035,11 +2636,19 @@ ArPixelID;
                              ];
                     if (valid_ray  )
                     {
-                        [ THREAD_PATHSPACE_INTEGRATOR calculateLightSamples
-                            : & ray
-                            : & wavelength
-                            :   sampleValue
-                            ];
+                        if ( tracePrimaryRayPackets && w == 0 )
+                            [ THREAD_PATHSPACE_INTEGRATOR calculateLightSamples
+                                : & ray
+                                :   firstIntersection[ sample - packetStart ]
+                                : & wavelength
+                                :   sampleValue
+                                ];
+                        else
+                            [ THREAD_PATHSPACE_INTEGRATOR calculateLightSamples
+                                : & ray
+                                : & wavelength
+                                :   sampleValue
+                                ];
 
                         if ( arlightalphasample_l_valid(
                                 art_gv,
@@ -1080,55 +2689,73 @@ ArPixelID;
                         validSample = TRUE;
                     }
 
+                    if ( validSample && collectPixelStatistics )
+                    {
+                        sampleLuminance +=
+                            arlightalphasample_l_norm(
+                                art_gv,
+                                ARPATHSPACERESULT_LIGHTALPHASAMPLE(*sampleValue[0])
+                                );
+                        sampleCounted = YES;
+                    }
+
                     if ( validSample )
                     {
                         int xc=x-XC(t->window->start);
                         int yc=y-YC(t->window->start);
                         IVec2D size=t->work_tile->size;
-                        if ( splattingKernelWidth == 1 )
+                        for ( unsigned int im = 0; im < numberOfImagesToWrite; im++ )
                         {
-                            for ( unsigned int im = 0; im < numberOfImagesToWrite; im++ )
+                            ArSpectralFramebuffer* fb=t->work_tile->image[im];
+                            double* samples=
+                                t->work_tile->samples+im*XC(size)*YC(size);
+
+                            arlightalpha_l_init_l(
+                                  art_gv,
+                                  ARLIGHTALPHA_NONE_A0,
+                                  splatLight
+                                );
+                            arlightalpha_wsd_sloppy_add_l(
+                                  art_gv,
+                                  ARPATHSPACERESULT_LIGHTALPHASAMPLE(*sampleValue[im]),
+                                & wavelength,
+                                & spectralSplattingData,
+                                  3.0 DEGREES,
+                                  splatLight
+                                );
+                            arspectralframebufferpixel_l_init_p(
+                                  art_gv,
+                                  splatLight,
+                                  splatPixel
+                                );
+
+                            if ( splattingKernelWidth == 1 || deferredFiltering )
                             {
-                                t->work_tile->samples[ 
-                                    im*XC(size) * YC(size) 
-                                    + yc*XC(size)+xc]+=1.0;
-                                           
-                                arlightalpha_wsd_sloppy_add_l(
+                                samples[yc*XC(size)+xc]+=1.0;
+                                arspectralframebuffer_dp_mul_add_fbi(
                                       art_gv,
-                                      ARPATHSPACERESULT_LIGHTALPHASAMPLE(*sampleValue[im]),
-                                    & wavelength,
-                                    & spectralSplattingData,
-                                      3.0 DEGREES,
-                                      t->work_tile->image[im]->data[xc + yc*XC(size)]
+                                      1.0,
+                                      splatPixel,
+                                      fb,
+                                      xc + yc*XC(size)
                                     );
                             }
-                        }
-                        else
-                        {
-                            xc=xc+splattingKernelOffset;
-                            yc=yc+splattingKernelOffset;
-                            for ( unsigned int im = 0; im < numberOfImagesToWrite; im++ )
+                            else
                             {
                                 for ( unsigned int l = 0; l < splattingKernelArea; l++ )
                                 {
-                                int  cX = xc + XC( sampleSplattingOffset[l] );
-                                int  cY = yc + YC( sampleSplattingOffset[l] );
-                                
-                                    t->work_tile->samples[ 
-                                    im*XC(size) * YC(size) 
-                                    + cY*XC(size)+cX]+=SAMPLE_SPLATTING_FACTOR( subpixelIdx, l );
-                                    
-
-                                    arlightalpha_dwsd_mul_sloppy_add_l(
-                                            art_gv,
-                                            SAMPLE_SPLATTING_FACTOR( subpixelIdx, l ),
-                                            ARPATHSPACERESULT_LIGHTALPHASAMPLE(*sampleValue[im]),
-                                        & wavelength,
-                                        & spectralSplattingData,
-                                            5.0 DEGREES,
-                                            t->work_tile->image[im]->data[cX + cY*XC(size)]
-                                        );
+                                    int  cX = xc + tilePadding + XC( sampleSplattingOffset[l] );
+                                    int  cY = yc + tilePadding + YC( sampleSplattingOffset[l] );
 
+                                    samples[cY*XC(size)+cX]+=
+                                        SAMPLE_SPLATTING_FACTOR( subpixelIdx, l );
+                                    arspectralframebuffer_dp_mul_add_fbi(
+                                          art_gv,
+                                          SAMPLE_SPLATTING_FACTOR( subpixelIdx, l ),
+                                          splatPixel,
+                                          fb,
+                                          cX + cY*XC(size)
+                                        );
                                 }
                             }
                         }
@@ -1143,6 +2770,14 @@ ArPixelID;
                             );
                     }
                 }
+
+                if ( sampleCounted )
+                    [ self add_pixel_sample
+                        :   t->work_tile
+                        :   ( x - XC(t->window->start) )
+                          + ( y - YC(t->window->start) ) * XC(tile_size)
+                        :   sampleLuminance
+                        ];
             }
         }
     }
@@ -1150,9 +2785,12 @@ ArPixelID;
 
     FREE_SAMPLE_VALUE:
     FREE_ARRAY(sampleValue);
+    arlightalpha_free(art_gv, splatLight);
+    arspectralframebufferpixel_free(art_gv, splatPixel);
+    return complete;
 }
 
-- (void)mergeThread
+- (void)controlThread
     : (ArcUnsignedInteger *) threadIndex
 {
     
@@ -1162,21 +2800,15 @@ ArPixelID;
     (void) threadIndex;
     
     while(true){
-        swap_merge_queue(&merge_queue);
+        swap_control_queue(&control_queue);
         
-        if(merge_queue.inactive->length>=numberOfRenderThreads/2){
-            samples_per_window_adaptive=samples_per_window*2;
-        }
-        while(merge_queue.inactive->length>0){
-            art_task_t curr_task=peek_queue(merge_queue.inactive);
-            pop_queue(merge_queue.inactive);
+        while(control_queue.inactive->length>0){
+            art_task_t curr_task=peek_queue(control_queue.inactive);
+            pop_queue(control_queue.inactive);
+            __atomic_sub_fetch(&control_queue.pending, 1, __ATOMIC_RELAXED);
             switch (curr_task.type) {
-                case MERGE:
-                    [self merge_task : &curr_task];
+                case TEV_UPDATE:
                     [self tev_task : &curr_task];
-                    if([self make_task: &curr_task]){
-                        push_render_queue(&render_queue, curr_task);
-                    }
                     break;
                 case WRITE:
                     [self writeImage];
@@ -1193,10 +2825,19 @@ ArPixelID;
                             "& display thread"
                             );
                     break;
+                case CHECKPOINT:
+                    [self writeCheckpoint];
+                    lastCheckpointTime=[self seconds_rendered];
+                    __atomic_store_n(&checkpoint_pending, NO, __ATOMIC_RELEASE);
+                    break;
                 case WRITE_EXIT:
                     renderThreadsShouldTerminate = YES;
+                    [self wake_render_threads: YES];
+                    //   an interrupted render can be resumed later on
+                    if(checkpointFileName
+                       && __atomic_load_n(&active_windows, __ATOMIC_ACQUIRE)>0)
+                        [self writeCheckpoint];
                     [self writeImage];
-                case POISON:
                     goto END;
                 case TEV_CONNECT:
                     if([tev tryConnection]){
@@ -1207,7 +2848,7 @@ ArPixelID;
                     break;
                 case RENDER:
                     ART_ERRORHANDLING_FATAL_ERROR(
-                            "render task in merge queue"
+                            "render task in control queue"
                             );
                     break;
                 }
@@ -1220,30 +2861,36 @@ ArPixelID;
     :(art_task_t*) t
 {
     IVec2D size=t->work_tile->size;
+
+    //   the part of the padded tile that lies within the image
+
+    int x0=MAX(tilePadding-XC(t->window->start),0);
+    int y0=MAX(tilePadding-YC(t->window->start),0);
+    int x1=MIN(XC(size),XC(imageSize)-XC(t->window->start)+tilePadding);
+    int y1=MIN(YC(size),YC(imageSize)-YC(t->window->start)+tilePadding);
+    int cX0=XC(t->window->start)-tilePadding+x0;
+    int cY0=YC(t->window->start)-tilePadding+y0;
+
     for ( unsigned int im = 0; im < numberOfImagesToWrite; im++ ){
-        for (int y=0; y<YC(size); y++) {
-            for (int x=0; x<XC(size); x++) {
-                int cX=XC(t->window->start)-splattingKernelOffset+x;
-                int cY=YC(t->window->start)-splattingKernelOffset+y;
-                if (   cX >= 0
-                    && cX < XC(imageSize)
-                    && cY >= 0
-                    && cY < YC(imageSize) )
-                {
-                    merge_image.samples[
-                        cX+cY*XC(imageSize)+im*XC(imageSize)*YC(imageSize)
-                        ]+=
-                        t->work_tile->samples[im*XC(size)*YC(size)+x+y*XC(size)];
-                    
-                    
-                    arlightalpha_l_add_l(
-                        art_gv, 
-                        t->work_tile->image[im]->data[x+y*XC(size)], 
-                        merge_image.image[im]->data[cX+cY*XC(imageSize)]);
-                }
+        for (int y=y0; y<y1; y++) {
+            double* src=t->work_tile->samples+im*XC(size)*YC(size)+y*XC(size);
+            double* dst=
+                  merge_image.samples+im*XC(imageSize)*YC(imageSize)
+                + (cY0+y-y0)*XC(imageSize)+cX0;
+            for (int x=x0; x<x1; x++) {
+                dst[x-x0]+=src[x];
             }
         }
+        arspectralframebuffer_fbw_add_fbw(
+            art_gv,
+            t->work_tile->image[im],
+            IPNT2D(x0, y0),
+            IVEC2D(x1-x0, y1-y0),
+            IPNT2D(cX0, cY0),
+            merge_image.image[im]);
     }
+    if(collectPixelStatistics)
+        [self merge_pixel_statistics: t];
 }
 -(void) tev_task
     :(art_task_t*) t
@@ -1252,39 +2899,33 @@ ArPixelID;
         return;
     }
     image_window_t tev_window;
-    XC(tev_window.start)=MAX(XC(t->window->start)-splattingKernelOffset,0);
-    YC(tev_window.start)=MAX(YC(t->window->start)-splattingKernelOffset,0);
-    XC(tev_window.end)=MIN(XC(t->window->end)+splattingKernelOffset,XC(imageSize));
-    YC(tev_window.end)=MIN(YC(t->window->end)+splattingKernelOffset,YC(imageSize));
+    XC(tev_window.start)=MAX(XC(t->window->start)-tilePadding,0);
+    YC(tev_window.start)=MAX(YC(t->window->start)-tilePadding,0);
+    XC(tev_window.end)=MIN(XC(t->window->end)+tilePadding,XC(imageSize));
+    YC(tev_window.end)=MIN(YC(t->window->end)+tilePadding,YC(imageSize));
 
     for ( unsigned int imgIdx = 0; imgIdx < numberOfImagesToWrite; imgIdx++ )
     {
         size_t i=0;
+        [self lock_windows: t->window];
         for ( int y = YC(tev_window.start); y < YC(tev_window.end); y++ )
         {
             for ( int x = XC(tev_window.start); x < XC(tev_window.end); x++ )
             {
                 size_t idx=x +y*XC(imageSize);
                 double  pixelSampleCount = merge_image.samples[ imgIdx*XC(imageSize) * YC(imageSize) + idx];
-                arlightalpha_l_init_l(
+                arspectralframebuffer_fbi_init_p(
                         art_gv,
-                        ARLIGHTALPHA_NONE_A0,
-                        tev_light
+                        merge_image.image[imgIdx],
+                        idx,
+                        tev_pixel
                     );
-                arlightalpha_l_add_l(
+                arspectralframebufferpixel_dp_mul_init_l(
                         art_gv,
-                        merge_image.image[imgIdx]->data[idx],
+                        pixelSampleCount > 0.0 ? 1.0 / pixelSampleCount : 1.0,
+                        tev_pixel,
                         tev_light
                     );
-
-                if ( pixelSampleCount > 0.0 )
-                {
-                    arlightalpha_d_mul_l(
-                            art_gv,
-                            1.0 / pixelSampleCount,
-                            tev_light
-                        );
-                }
                 arlightalpha_to_spc(art_gv, tev_light, tev_spectrum);
                 spc_to_rgb(art_gv, tev_spectrum, tev_rgb);
                 
@@ -1297,6 +2938,7 @@ ArPixelID;
             }
 
         }
+        [self unlock_windows: t->window];
 
 
         const int64_t channel_offsets[]={0,1,2};
@@ -1317,6 +2959,81 @@ ArPixelID;
     }
     
 }
+//   Deferred filtering of the snapshot of a result image, for the
+//   rows y0 to y1: both the light and the weights of the samples are
+//   filtered, so their ratio is the same as if each sample had been
+//   splatted right away.
+
+- (void) filter_rows
+    :(int) y0
+    :(int) y1
+{
+    arspectralframebuffer_fb_kw_filter_fb(
+        art_gv,
+        out_unfiltered,
+        splattingKernelArea,
+        filterOffset,
+        filterWeight,
+        y0,
+        y1,
+        out);
+
+    for (int y=y0; y<y1; y++) {
+        double* d=out_samples+y*XC(imageSize);
+        memset(d, 0, XC(imageSize)*sizeof(double));
+        for (unsigned int l=0; l<splattingKernelArea; l++) {
+            int sy=y+YC(filterOffset[l]);
+            int ox=XC(filterOffset[l]);
+            if(sy<0 || sy>=YC(imageSize))
+                continue;
+            const double* src=out_unfiltered_samples+sy*XC(imageSize)+ox;
+            int xa=MAX(0,-ox);
+            int xb=MIN(XC(imageSize),XC(imageSize)-ox);
+            for (int x=xa; x<xb; x++) {
+                d[x]+=filterWeight[l]*src[x];
+            }
+        }
+    }
+}
+
+typedef struct {
+        ArnTiledStochasticSampler* sampler;
+        int y0,y1;
+}filter_band_t;
+
+static void* filter_band(void* arg)
+{
+    filter_band_t* band=(filter_band_t*)arg;
+    [band->sampler filter_rows: band->y0 : band->y1];
+    return NULL;
+}
+
+//   The image is split into one band of rows per render thread, which
+//   are filtered in parallel.
+
+- (void) filter_snapshot
+{
+    unsigned int number_of_bands=MAX(MIN(numberOfRenderThreads,(unsigned int)YC(imageSize)),1);
+    pthread_t* thread=ALLOC_ARRAY(pthread_t, number_of_bands);
+    filter_band_t* band=ALLOC_ARRAY(filter_band_t, number_of_bands);
+
+    for (unsigned int i=0; i<number_of_bands; i++) {
+        band[i].sampler=self;
+        band[i].y0=(int)((long)YC(imageSize)*i/number_of_bands);
+        band[i].y1=(int)((long)YC(imageSize)*(i+1)/number_of_bands);
+        if(i>0 && pthread_create(&thread[i], NULL, filter_band, &band[i]))
+            filter_band(&band[i]);
+    }
+    //   the first band is done by the calling thread
+    filter_band(&band[0]);
+    for (unsigned int i=1; i<number_of_bands; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    FREE_ARRAY(thread);
+    FREE_ARRAY(band);
+}
+
 - (void)writeImage
 {
    
@@ -1335,6 +3052,24 @@ ArPixelID;
 
         unsigned long int  overallSampleCount = 0;
         unsigned long int  nonzeroPixels = 0;
+
+        //   the render threads keep merging while we write, so they are
+        //   only held up while a snapshot of the image is taken
+        [self lock_all_windows];
+        memcpy(
+            deferredFiltering ? out_unfiltered_samples : out_samples,
+            merge_image.samples+imgIdx*overallNumberOfPixels,
+            overallNumberOfPixels*sizeof(double)
+            );
+        arspectralframebuffer_fb_copy_fb(
+            art_gv,
+            merge_image.image[imgIdx],
+            deferredFiltering ? out_unfiltered : out
+            );
+        [self unlock_all_windows];
+
+        if(deferredFiltering)
+            [self filter_snapshot];
         
         for ( int y = 0; y < YC(imageSize); y++ )
         {
@@ -1343,8 +3078,7 @@ ArPixelID;
                 unsigned int  pixelSampleCount = 0;
                 size_t idx=x +y*XC(imageSize);
                 //ASK: this is weird... why are we doing this with int and not doubles???
-                pixelSampleCount +=merge_image.samples[ 
-                    imgIdx*XC(imageSize) * YC(imageSize) + idx];
+                pixelSampleCount +=out_samples[idx];
                 
                 if ( pixelSampleCount > 0 )
                 {
@@ -1407,6 +3141,73 @@ ArPixelID;
                 );
         }
 
+        //   The figures above are splatting weights; the number of
+        //   samples actually taken follows from the passes completed.
+        //   If a stopping criterion ended rendering, that is noted, too.
+
+        unsigned int  minRendered = UINT_MAX;
+        unsigned int  maxRendered = 0;
+
+        for ( unsigned int w = 0; w < tiles_X*tiles_Y; w++ )
+        {
+            unsigned int  rendered =
+                (unsigned int) MIN( [ self first_sample_of_pass: window_pass[w] ],
+                                    maximumNumberOfSamplesPerPixel );
+
+            minRendered = MIN( minRendered, rendered );
+            maxRendered = MAX( maxRendered, rendered );
+        }
+
+        char  * weightString = samplecountString;
+
+        if ( minRendered == maxRendered )
+            asprintf(
+                & samplecountString,
+                    "%s, %d spp rendered",
+                    weightString,
+                    minRendered
+                );
+        else
+            asprintf(
+                & samplecountString,
+                    "%s, %d-%d spp rendered",
+                    weightString,
+                    minRendered,
+                    maxRendered
+                );
+
+        FREE( weightString );
+
+        if ( sampleRangeCount > 1 )
+        {
+            weightString = samplecountString;
+
+            asprintf(
+                & samplecountString,
+                    "%s, slice %u of %u of %u spp",
+                    weightString,
+                    sampleRangeIndex,
+                    sampleRangeCount,
+                    totalNumberOfSamplesPerPixel
+                );
+
+            FREE( weightString );
+        }
+
+        if ( stoppingCriterion )
+        {
+            weightString = samplecountString;
+
+            asprintf(
+                & samplecountString,
+                    "%s, stopped by %s",
+                    weightString,
+                    stoppingCriterion
+                );
+
+            FREE( weightString );
+        }
+
         [ outputImage[imgIdx] setSamplecountString
             :   samplecountString
             ];
@@ -1416,8 +3217,9 @@ ArPixelID;
         artime_now( & endTime );
 
         writeThreadWallClockDuration =
-                artime_seconds( & endTime )
-            - artime_seconds( & beginTime);
+                previousRenderTime
+            +   artime_seconds( & endTime )
+            -   artime_seconds( & beginTime);
 
         char  * rendertimeString = NULL;
         
@@ -1438,34 +3240,27 @@ ArPixelID;
             for ( int x = 0; x < XC(imageSize); x++ )
             {
                 size_t idx=XC(imageSize)*y+x;
-                arlightalpha_l_init_l(
+                double  pixelSampleCount = out_samples[idx];
+
+                arspectralframebuffer_fbi_init_p(
                         art_gv,
-                        ARLIGHTALPHA_NONE_A0,
-                        out->data[idx]
+                        out,
+                        idx,
+                        out_pixel
                     );
-                arlightalpha_l_add_l(
+                arspectralframebufferpixel_dp_mul_init_l(
                         art_gv,
-                        merge_image.image[imgIdx]->data[idx],
-                        out->data[idx]
+                        pixelSampleCount > 0.0 ? 1.0 / pixelSampleCount : 1.0,
+                        out_pixel,
+                        out_line->data[x]
                     );
-                double  pixelSampleCount = merge_image.samples[ imgIdx*overallNumberOfPixels + idx];
-
-
-                if ( pixelSampleCount > 0.0 )
-                {
-                    arlightalpha_d_mul_l(
-                            art_gv,
-                            1.0 / pixelSampleCount,
-                            out->data[idx]
-                        );
-                }
             }
 
+            [ outputImage[imgIdx] setPlainImage
+                :   IPNT2D(0,y)
+                :   out_line
+                ];
         }
-        [ outputImage[imgIdx] setPlainImage
-            :   IPNT2D(0,0)
-            :   out
-            ];
     }
 }
 - (void) terminalIOThread
@@ -1541,12 +3336,12 @@ ArPixelID;
             {
                 if ( line[0] == 'w' )
                 {
-                    try_prepend_merge_queue(&writeSem,WRITE);
+                    try_prepend_control_queue(&writeSem,WRITE);
                 }
 
                 if ( line[0] == 'd' )
                 {
-                    try_prepend_merge_queue(&writeSem,WRITE_TONEMAP);
+                    try_prepend_control_queue(&writeSem,WRITE_TONEMAP);
                 }
 
                 if ( line[0] == 't' )
@@ -1556,7 +3351,7 @@ ArPixelID;
 
                 if ( line[0] == 'c' )
                 {
-                    try_prepend_merge_queue(NULL,TEV_CONNECT);
+                    try_prepend_control_queue(NULL,TEV_CONNECT);
                 }
             }
         }
@@ -1641,8 +3436,23 @@ ArPixelID;
         : (ArNode <ArpImageWriter> **) image
         : (int) numberOfResultImages
 {
-    free_render_queue(&render_queue);
-    free_merge_queue(&merge_queue);
+    free_control_queue(&control_queue);
+
+    for (unsigned int t=0; t<numberOfRenderThreads; t++) {
+        free_work_deque(&render_deque[t]);
+        free_work_deque(&deferred_deque[t]);
+    }
+    FREE_ARRAY(render_deque);
+    FREE_ARRAY(deferred_deque);
+    pthread_mutex_destroy(&idle_lock);
+    pthread_cond_destroy(&idle_cond);
+
+    for (unsigned int i=0; i<tiles_X*tiles_Y; i++) {
+        pthread_mutex_destroy(&window_lock[i]);
+    }
+    FREE_ARRAY(window_lock);
+    FREE_ARRAY(window_pass);
+    pthread_mutex_destroy(&progress_lock);
     pthread_barrier_destroy(&renderingDone);
     pthread_barrier_destroy(&mergingDone);
     sem_destroy(&writeSem);
@@ -1657,6 +3467,10 @@ ArPixelID;
         RELEASE_OBJECT( randomGenerator[i] );
     }
     FREE_ARRAY( randomGenerator );
+    free( thread_telemetry );
+    FREE_ARRAY( thread_ray_caster );
+    FREE_ARRAY( stats_busy_seconds );
+
     for ( unsigned int i = 0; i < numberOfRenderThreads; i++ )
     {
         [ pathspaceIntegrator[i] cleanupAfterEstimation: ART_GLOBAL_REPORTER ];
@@ -1684,7 +3498,18 @@ ArPixelID;
     FREE_ARRAY(tiles);
 
     FREE_ARRAY(unfinished);
+    FREE_ARRAY(window_noise);
+    FREE_ARRAY(window_noise_pixels);
+    FREE_ARRAY(window_retired);
+    if(checkpoint_buffer)
+        FREE_ARRAY(checkpoint_buffer);
+    if(collectPixelStatistics){
+        FREE_ARRAY(pixel_samples);
+        FREE_ARRAY(pixel_mean);
+        FREE_ARRAY(pixel_m2);
+    }
     FREE_ARRAY(render_windows);
+    FREE_ARRAY(window_order);
 
     RELEASE_OBJECT(tev);
     FREE_ARRAY(tev_update_tile);
@@ -1694,9 +3519,19 @@ ArPixelID;
     }
     FREE_ARRAY(tev_names);
     arlightalpha_free(art_gv,tev_light);
+    arspectralframebufferpixel_free(art_gv,tev_pixel);
     spc_free(art_gv,tev_spectrum);
     rgb_free(art_gv,tev_rgb);
-    RELEASE_OBJECT(out);
+    arspectralframebuffer_free(art_gv, out);
+    FREE_ARRAY(out_samples);
+    if(deferredFiltering){
+        arspectralframebuffer_free(art_gv, out_unfiltered);
+        FREE_ARRAY(out_unfiltered_samples);
+        FREE_ARRAY(filterOffset);
+        FREE_ARRAY(filterWeight);
+    }
+    RELEASE_OBJECT(out_line);
+    arspectralframebufferpixel_free(art_gv, out_pixel);
 
 }
 
@@ -41,8 +41,9 @@ ART_MODULE_INTERFACE(ArcAreaLightsource)
 
     'lightsourceRadiantPowerPercentile'
 
-    For each patch, the percentile in which it lies is pre-computed for
-    faster random selection during rendering. For the first patch, this
+    For each patch, the percentile in which it lies. Random selection
+    during rendering uses the alias table 'patchSelectionTable' instead,
+    which does not depend on the number of patches. For the first patch, this
     value is equal to 'percentOfLightsourceRadiantPower', for the next one,
     'lightsourceRadiantPowerPercentile' of the previous one, plus its own
     'percentOfLightsourceRadiantPower'. And so on. The last patch has to have
@@ -77,6 +78,18 @@ ArAreaLightsourcePatch;
     ArSpectralIntensity     * emission;
     ArLightIntensity        * intensityAtPoint;
     ArNode <ArpMapping>     * mapping;
+
+    //   Selects a patch in proportion to 'percentOfLightsourceRadiantPower'
+    //   in constant time; entry i is patch[i].
+
+    ArAliasTable              patchSelectionTable;
+
+    //   Worldspace bounds of all patches, and a cone which contains all
+    //   their normals, as returned by 'getSpatialBounds'.
+
+    Box3D                     spatialBounds;
+    Vec3D                     emissionAxis;
+    double                    emissionSpread;
 }
 
 - (id) init
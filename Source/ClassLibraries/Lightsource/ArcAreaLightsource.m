@@ -29,6 +29,7 @@
 #import "ArcAreaLightsource.h"
 #import "ArnLightsourceCollector.h"
 #import "FoundationAssertionMacros.h"
+#import "ArcParameterisation.h"
 
 ART_NO_MODULE_INITIALISATION_FUNCTION_NECESSARY
 
@@ -43,6 +44,155 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
 @implementation ArcAreaLightsource
 
+- (void) _preparePatchSelectionTable
+{
+    double  * weight = ALLOC_ARRAY( double, numberOfPatches );
+
+    for ( unsigned int i = 0; i < numberOfPatches; i++ )
+        weight[i] = patch[i].percentOfLightsourceRadiantPower;
+
+    araliastable_init(
+        & patchSelectionTable,
+          weight,
+          numberOfPatches
+        );
+
+    FREE_ARRAY( weight );
+}
+
+/* ---------------------------------------------------------------------------
+
+    '_prepareSpatialBounds'
+
+    The bounds are taken from a regular grid of points on each patch,
+    which includes the patch corners. For curved patches, the box is
+    padded, and the cone of normals widened, to account for what lies
+    between the grid points. A cone which cannot be told apart from
+    the whole sphere of directions is made to be exactly that.
+
+------------------------------------------------------------------------aw- */
+
+#define ARALS_BOUNDS_GRID_RESOLUTION    5
+#define ARALS_BOUNDS_PADDING            0.05
+#define ARALS_BOUNDS_SPREAD_MARGIN      ( MATH_PI / 18.0 )
+
+- (void) _prepareSpatialBounds
+{
+    const unsigned int  gridSteps = ARALS_BOUNDS_GRID_RESOLUTION - 1;
+
+    Vec3D  * normal =
+        ALLOC_ARRAY(
+            Vec3D,
+            numberOfPatches * M_SQR( ARALS_BOUNDS_GRID_RESOLUTION )
+            );
+
+    unsigned int  numberOfNormals = 0;
+    Vec3D         normalSum       = VEC3D( 0.0, 0.0, 0.0 );
+
+    spatialBounds = BOX3D_EMPTY;
+
+    for ( unsigned int i = 0; i < numberOfPatches; i++ )
+    {
+        //   Barycentric parameter ranges only cover the lower left half
+        //   of the unit square.
+
+        BOOL  triangularPatch =
+            [ patch[i].parameterisation isSubclassOfClass
+                :   [ ArcBarycentricParameterisation class ]
+                ];
+
+        for ( unsigned int x = 0; x <= gridSteps; x++ )
+        {
+            for ( unsigned int y = 0; y <= gridSteps; y++ )
+            {
+                if ( triangularPatch && x + y > gridSteps )
+                    continue;
+
+                Pnt2DE  point2D;
+
+                PNT2DE_PATCHINDEX(point2D) = patch[i].index;
+                PNT2DE_XC(point2D) = x / (double) gridSteps;
+                PNT2DE_YC(point2D) = y / (double) gridSteps;
+
+                Pnt3DE  point3D;
+
+                if ( ! [ mapping getObjectSpacePnt3DE_for_Pnt2DE
+                           : & traversalState
+                           : & point2D
+                           : & point3D
+                           ] )
+                    continue;
+
+                [ shape calculateNormalForLocalPnt3DE
+                    : & traversalState
+                    : & point3D
+                    ];
+
+                pnt3de_trafo_p(
+                      ARTS_TRAFO(traversalState),
+                    & point3D
+                    );
+
+                box3d_p_add_b(
+                    & PNT3DE_COORD(point3D),
+                    & spatialBounds
+                    );
+
+                normal[numberOfNormals++] = PNT3DE_NORMAL(point3D);
+
+                vec3d_v_add_v(
+                    & PNT3DE_NORMAL(point3D),
+                    & normalSum
+                    );
+            }
+        }
+    }
+
+    if ( numberOfNormals > 0 )
+    {
+        Vec3D  size;
+
+        box3d_b_size_v( & spatialBounds, & size );
+
+        double  padding = ARALS_BOUNDS_PADDING * vec3d_v_len( & size );
+
+        for ( int d = 0; d < 3; d++ )
+        {
+            BOX3D_MIN_I(spatialBounds,d) -= padding;
+            BOX3D_MAX_I(spatialBounds,d) += padding;
+        }
+    }
+
+    //   Normals which (nearly) cancel each other out, as on a closed
+    //   shape, do not have a meaningful axis.
+
+    emissionAxis   = VEC3D( 0.0, 0.0, 1.0 );
+    emissionSpread = MATH_PI;
+
+    if ( vec3d_v_len( & normalSum ) > 0.1 * numberOfNormals )
+    {
+        vec3d_v_norm_v( & normalSum, & emissionAxis );
+
+        double  minimumCosine = 1.0;
+
+        for ( unsigned int n = 0; n < numberOfNormals; n++ )
+            minimumCosine =
+                M_MIN(
+                    minimumCosine,
+                    vec3d_vv_dot( & emissionAxis, & normal[n] )
+                    );
+
+        emissionSpread =
+            M_MIN(
+                acos( M_CLAMP( minimumCosine, -1.0, 1.0 ) )
+                    + ARALS_BOUNDS_SPREAD_MARGIN,
+                MATH_PI
+                );
+    }
+
+    FREE_ARRAY( normal );
+}
+
 - (id) init
         : (ArNode *) shapeRef
         : (ArTraversalState *) state
@@ -159,6 +309,8 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
             ,   radiantPower
             ];
 
+        patchSelectionTable.size = 0;
+
         if ( radiantPower > 0.0 )
         {
             for ( unsigned int i = 0; i < numberOfPatches; i++ )
@@ -167,31 +319,13 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
                      patch[i].radiantPower  / radiantPower;
             }
 
-            BOOL swap;
+            //   Patches are drawn via an alias table, which does not need
+            //   them sorted by power; they stay in mapping order, so that
+            //   patch[i] is the patch with index i.
 
-            //   Bubblesort - not very efficient, but this is not intended for
-            //   lightsources with huge numbers of patches.
+            [ self _preparePatchSelectionTable ];
 
-            do
-            {
-                swap = NO;
-
-                for ( unsigned int i = 0; i < numberOfPatches - 1; i++ )
-                {
-                    if (   patch[i  ].percentOfLightsourceRadiantPower
-                         < patch[i+1].percentOfLightsourceRadiantPower )
-                    {
-                        ArAreaLightsourcePatch  temp;
-
-                        temp = patch[i];
-                        patch[i] = patch[i+1];
-                        patch[i+1] = temp;
-
-                        swap = YES;
-                    }
-                }
-            }
-            while( swap );
+            [ self _prepareSpatialBounds ];
 
             patch[0].lightsourceRadiantPowerPercentile =
                 patch[0].percentOfLightsourceRadiantPower;
@@ -238,6 +372,11 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
         //clone->radiantEmittance       = radiantEmittance;
         clone->mapping         = [ mapping copy ];
         clone->numberOfPatches = numberOfPatches;
+        clone->spatialBounds   = spatialBounds;
+        clone->emissionAxis    = emissionAxis;
+        clone->emissionSpread  = emissionSpread;
+
+        [ clone _preparePatchSelectionTable ];
     }
 
     return clone;
@@ -257,6 +396,8 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
     FREE_ARRAY(patch);
 
+    araliastable_free_contents( & patchSelectionTable );
+
     artraversalstate_free_contents( & traversalState );
 
     [ super dealloc ];
@@ -284,6 +425,21 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     return NO;
 }
 
+- (BOOL) getSpatialBounds
+        : (Box3D *)  bounds
+        : (Vec3D *)  newEmissionAxis
+        : (double *) newEmissionSpread
+{
+    if ( box3d_b_isempty( & spatialBounds ) )
+        return NO;
+
+    *bounds            = spatialBounds;
+    *newEmissionAxis   = emissionAxis;
+    *newEmissionSpread = emissionSpread;
+
+    return YES;
+}
+
 @end
 
 // ===========================================================================
@@ -129,6 +129,18 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     return YES;
 }
 
+- (BOOL) getSpatialBounds
+        : (Box3D *)  bounds
+        : (Vec3D *)  emissionAxis
+        : (double *) emissionSpread
+{
+    (void) bounds;
+    (void) emissionAxis;
+    (void) emissionSpread;
+
+    return NO;
+}
+
 - (double)selectionProbabilityOfRegion:(ArSamplingRegion *)lightsourceSamplingRegion :(const Pnt3D *)queryLocationWorldspace {
     ART__CODE_IS_WORK_IN_PROGRESS__EXIT_WITH_ERROR
     return 0.;
@@ -99,6 +99,22 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     return self;
 }
 
+//   A point lightsource is a single point which emits in all directions.
+
+- (BOOL) getSpatialBounds
+        : (Box3D *)  bounds
+        : (Vec3D *)  emissionAxis
+        : (double *) emissionSpread
+{
+    BOX3D_MIN(*bounds) = position;
+    BOX3D_MAX(*bounds) = position;
+
+    *emissionAxis   = VEC3D( 0.0, 0.0, 1.0 );
+    *emissionSpread = MATH_PI;
+
+    return YES;
+}
+
 @end
 
 // ===========================================================================
@@ -32,6 +32,31 @@ ART_MODULE_INTERFACE(ArnLightsourceCollection)
 
 #define LSC_LIGHT(__a,__i)      light[(__a)+(__i)*PSM_ARRAYSIZE]
 
+//   Number of adjacent spectral channels that share one light selection
+//   alias table.
+
+#define LSC_SELECTION_BIN_CHANNELS      10
+
+/* ---------------------------------------------------------------------------
+
+    'ArLightTreeCluster' struct
+
+    What the light tree knows about a group of lights - a single one for
+    the lights in leaf nodes: their worldspace bounding box, a cone which
+    contains all directions their surfaces face (see 'getSpatialBounds'
+    in ArpLightsource), and their overall visible range radiant power.
+
+------------------------------------------------------------------------aw- */
+
+typedef struct ArLightTreeCluster
+{
+    Box3D   bounds;
+    Vec3D   emissionAxis;
+    double  emissionSpread;
+    double  power;
+}
+ArLightTreeCluster;
+
 typedef struct ArLightsourceEntry
 {
     id <ArpLightsource>   source;
@@ -66,12 +91,54 @@ ArLightsourceEntry;
     unsigned int           numberOfActualSlots;
     unsigned int           numberOfLights;
     ArLightsourceEntry  * light;
+
+    //   Power-proportional light selection: one alias table over all
+    //   lights per bin of LSC_SELECTION_BIN_CHANNELS spectral channels,
+    //   for altitude 0. Built once all lights have been added, and shared
+    //   with copies of the collection.
+
+    BOOL                   ownsLightSelectionTables;
+    unsigned int           numberOfSelectionBins;
+    ArAliasTable         * lightSelectionTable;
+
+    //   Light tree for spatially aware light selection: a BVH over all
+    //   lights of altitude 0, with one cluster per node, and one per
+    //   light in the order the leaves reference them. 'lightTreeLeaf'
+    //   is the leaf node each light is in. Built once all lights have
+    //   been added, unless one of them has no spatial bounds, and
+    //   shared with copies of the collection.
+
+    ArLightsourceSelection lightsourceSelection;
+    BOOL                   lightTreeHasBeenPrepared;
+    BOOL                   ownsLightTree;
+    long                   numberOfLightTreeNodes;
+    BVHNode              * lightTreeNode;
+    ArLightTreeCluster   * lightTreeNodeCluster;
+    ArLightTreeCluster   * lightTreeLightCluster;
+    unsigned int         * lightTreeLightIndex;
+    long                 * lightTreeLeaf;
 }
 
 - (id) init
         : (ArcObject <ArpSampling2D> *) newSampler2D
         : (double) newResolution
         ;
+
+/* ---------------------------------------------------------------------------
+
+    'lightSelectionTable'
+
+    The alias table for drawing a light in proportion to its share of the
+    overall emitted power in the spectral bin of the hero wavelength, or
+    NULL if no light emits there. Entry i of the table is light i of
+    altitude 0.
+
+------------------------------------------------------------------------aw- */
+
+- (const ArAliasTable *) lightSelectionTable
+        : (const ArWavelength *) wavelength
+        ;
+
 @end
 
 // ===========================================================================
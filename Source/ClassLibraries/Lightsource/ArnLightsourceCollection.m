@@ -129,6 +129,301 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
     return self;
 }
 
+- (void) _freeLightSelectionTables
+{
+    if ( lightSelectionTable && ownsLightSelectionTables )
+    {
+        for ( unsigned int b = 0; b < numberOfSelectionBins; b++ )
+            araliastable_free_contents( & lightSelectionTable[b] );
+
+        FREE_ARRAY( lightSelectionTable );
+    }
+
+    lightSelectionTable      = 0;
+    numberOfSelectionBins    = 0;
+    ownsLightSelectionTables = NO;
+}
+
+/* ---------------------------------------------------------------------------
+
+    '_prepareLightSelectionTables'
+
+    The weight of a light in the table for a spectral bin is its emitted
+    power summed over the channels of that bin. This costs O(number of
+    lights) per bin, once; drawing a light afterwards is O(1).
+
+------------------------------------------------------------------------aw- */
+
+- (void) _prepareLightSelectionTables
+{
+    LOCK_ADDITION_MUTEX;
+
+    if ( ! lightSelectionTable )
+    {
+        unsigned int  numberOfChannels = s500_channels( art_gv );
+
+        numberOfSelectionBins =
+              ( numberOfChannels + LSC_SELECTION_BIN_CHANNELS - 1 )
+            / LSC_SELECTION_BIN_CHANNELS;
+
+        ArAliasTable  * newTable =
+            ALLOC_ARRAY( ArAliasTable, numberOfSelectionBins );
+
+        double  * binPower = ALLOC_ARRAY( double, M_MAX( numberOfLights, 1 ) );
+
+        for ( unsigned int b = 0; b < numberOfSelectionBins; b++ )
+        {
+            unsigned int  firstChannel = b * LSC_SELECTION_BIN_CHANNELS;
+            unsigned int  endChannel   =
+                M_MIN( firstChannel + LSC_SELECTION_BIN_CHANNELS,
+                       numberOfChannels );
+
+            for ( unsigned int i = 0; i < numberOfLights; i++ )
+            {
+                binPower[i] = 0.0;
+
+                for ( unsigned int c = firstChannel; c < endChannel; c++ )
+                    binPower[i] +=
+                        arspectralintensity_li(
+                            art_gv,
+                            LSC_LIGHT(0,i).spectralPower,
+                            c
+                            );
+            }
+
+            araliastable_init(
+                & newTable[b],
+                  binPower,
+                  numberOfLights
+                );
+        }
+
+        FREE_ARRAY( binPower );
+
+        lightSelectionTable      = newTable;
+        ownsLightSelectionTables = YES;
+    }
+
+    UNLOCK_ADDITION_MUTEX;
+}
+
+- (void) _freeLightTree
+{
+    if ( ownsLightTree )
+    {
+        bvhnode_free_array( lightTreeNode );
+
+        FREE_ARRAY( lightTreeNodeCluster );
+        FREE_ARRAY( lightTreeLightCluster );
+        FREE_ARRAY( lightTreeLightIndex );
+        FREE_ARRAY( lightTreeLeaf );
+    }
+
+    lightTreeNode            = 0;
+    lightTreeNodeCluster     = 0;
+    lightTreeLightCluster    = 0;
+    lightTreeLightIndex      = 0;
+    lightTreeLeaf            = 0;
+    numberOfLightTreeNodes   = 0;
+    ownsLightTree            = NO;
+    lightTreeHasBeenPrepared = NO;
+}
+
+/* ---------------------------------------------------------------------------
+
+    '_lighttree_cc_union_c'
+
+    The cluster which contains both c0 and c1. The wider of the two
+    cones is rotated towards the narrower one, and opened just far enough
+    to contain it as well. Once it would have to open beyond MATH_PI, or
+    if the axes point in opposite directions, it covers all directions.
+
+------------------------------------------------------------------------aw- */
+
+static void _lighttree_cc_union_c(
+        const ArLightTreeCluster  * c0,
+        const ArLightTreeCluster  * c1,
+              ArLightTreeCluster  * cr
+        )
+{
+    const ArLightTreeCluster  * wide   = c0;
+    const ArLightTreeCluster  * narrow = c1;
+
+    if ( narrow->emissionSpread > wide->emissionSpread )
+    {
+        wide   = c1;
+        narrow = c0;
+    }
+
+    double  axisAngle =
+        acos(
+            M_CLAMP(
+                vec3d_vv_dot( & wide->emissionAxis, & narrow->emissionAxis ),
+                -1.0,
+                 1.0
+                )
+            );
+
+    Vec3D   emissionAxis   = wide->emissionAxis;
+    double  emissionSpread = wide->emissionSpread;
+
+    if ( M_MIN( axisAngle + narrow->emissionSpread, MATH_PI ) > emissionSpread )
+    {
+        double  unionSpread =
+            0.5 * ( wide->emissionSpread + axisAngle + narrow->emissionSpread );
+
+        if ( unionSpread >= MATH_PI || sin( axisAngle ) < 1e-6 )
+        {
+            emissionSpread = MATH_PI;
+        }
+        else
+        {
+            double  rotation = unionSpread - wide->emissionSpread;
+
+            vec3d_dv_mul_dv_mul_add_v(
+                  sin( axisAngle - rotation ) / sin( axisAngle ),
+                & wide->emissionAxis,
+                  sin( rotation ) / sin( axisAngle ),
+                & narrow->emissionAxis,
+                & emissionAxis
+                );
+
+            vec3d_norm_v( & emissionAxis );
+
+            emissionSpread = unionSpread;
+        }
+    }
+
+    box3d_bb_or_b(
+        & c0->bounds,
+        & c1->bounds,
+        & cr->bounds
+        );
+
+    cr->power          = c0->power + c1->power;
+    cr->emissionAxis   = emissionAxis;
+    cr->emissionSpread = emissionSpread;
+}
+
+/* ---------------------------------------------------------------------------
+
+    '_prepareLightTree'
+
+    The tree topology is that of an ordinary binned SAH BVH over the
+    bounding boxes of the lights, with one light per leaf; the clusters
+    of the inner nodes are then accumulated bottom-up. The tree is only
+    built if all lights can provide spatial bounds.
+
+------------------------------------------------------------------------aw- */
+
+- (void) _prepareLightTree
+{
+    LOCK_ADDITION_MUTEX;
+
+    if ( ! lightTreeHasBeenPrepared )
+    {
+        lightTreeHasBeenPrepared = YES;
+
+        BOOL  allLightsAreBounded =
+            ( numberOfLights > 0 && ! complexSkydomePresent );
+
+        BVHBuildPrimitive  * primitive =
+            ALLOC_ARRAY( BVHBuildPrimitive, M_MAX( numberOfLights, 1 ) );
+        ArLightTreeCluster  * cluster =
+            ALLOC_ARRAY( ArLightTreeCluster, M_MAX( numberOfLights, 1 ) );
+
+        for ( unsigned int i = 0; allLightsAreBounded && i < numberOfLights; i++ )
+        {
+            if ( ! [ LSC_LIGHT(0,i).source getSpatialBounds
+                       : & cluster[i].bounds
+                       : & cluster[i].emissionAxis
+                       : & cluster[i].emissionSpread
+                       ] )
+                allLightsAreBounded = NO;
+
+            cluster[i].power = LSC_LIGHT(0,i).radiantPower;
+
+            primitive[i].box   = cluster[i].bounds;
+            primitive[i].index = i;
+
+            box3d_b_center_p(
+                & primitive[i].box,
+                & primitive[i].centroid
+                );
+        }
+
+        if ( allLightsAreBounded )
+        {
+            lightTreeNode =
+                bvhtree_build_binned_sah(
+                      primitive,
+                      numberOfLights,
+                      1,
+                    & numberOfLightTreeNodes,
+                      0
+                    );
+
+            lightTreeNodeCluster =
+                ALLOC_ARRAY( ArLightTreeCluster, numberOfLightTreeNodes );
+            lightTreeLightCluster =
+                ALLOC_ARRAY( ArLightTreeCluster, numberOfLights );
+            lightTreeLightIndex =
+                ALLOC_ARRAY( unsigned int, numberOfLights );
+            lightTreeLeaf =
+                ALLOC_ARRAY( long, numberOfLights );
+
+            //   The build has reordered the primitives into leaf order.
+
+            for ( unsigned int j = 0; j < numberOfLights; j++ )
+            {
+                lightTreeLightIndex[j]   = primitive[j].index;
+                lightTreeLightCluster[j] = cluster[ primitive[j].index ];
+            }
+
+            //   Both children of a node come after it in the node array,
+            //   so a backwards pass has always seen them already.
+
+            for ( long n = numberOfLightTreeNodes - 1; n >= 0; n-- )
+            {
+                const BVHNode  * node = & lightTreeNode[n];
+
+                if ( BVH_NODE_IS_LEAF(*node) )
+                {
+                    long  first = BVH_NODE_PRIMITIVE_OFFSET(*node);
+                    long  end   = first + BVH_NODE_PRIMITIVE_COUNT(*node);
+
+                    lightTreeNodeCluster[n] = lightTreeLightCluster[first];
+
+                    for ( long j = first; j < end; j++ )
+                    {
+                        if ( j > first )
+                            _lighttree_cc_union_c(
+                                & lightTreeNodeCluster[n],
+                                & lightTreeLightCluster[j],
+                                & lightTreeNodeCluster[n]
+                                );
+
+                        lightTreeLeaf[ lightTreeLightIndex[j] ] = n;
+                    }
+                }
+                else
+                    _lighttree_cc_union_c(
+                        & lightTreeNodeCluster[ n + 1 ],
+                        & lightTreeNodeCluster[ BVH_NODE_SECOND_CHILD(*node) ],
+                        & lightTreeNodeCluster[n]
+                        );
+            }
+
+            ownsLightTree = YES;
+        }
+
+        FREE_ARRAY( primitive );
+        FREE_ARRAY( cluster );
+    }
+
+    UNLOCK_ADDITION_MUTEX;
+}
+
 - (void) addLightsource
         : (ArcObject <ArpLightsource> *)newLightsource
         : (ArcObject <ArpReporter> *) reporter
@@ -169,6 +464,11 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
     {
         LOCK_ADDITION_MUTEX;
 
+        //   Any light selection tables built so far no longer apply.
+
+        [ self _freeLightSelectionTables ];
+        [ self _freeLightTree ];
+
         int  newLightIndex = numberOfLights;
         
         overallArea            += [ newLightsource area ];
@@ -320,6 +620,48 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
     }
 }
 
+- (const ArAliasTable *) lightSelectionTable
+        : (const ArWavelength *) wavelength
+{
+    if ( ! lightSelectionTable )
+        [ self _prepareLightSelectionTables ];
+
+    //   The same channel lookup as in sps_s500w_init_s, for the hero
+    //   wavelength only.
+
+    double  rangeStart   = s500_channel_lower_bound( art_gv, 0 );
+    double  channelWidth = s500_channel_width( art_gv, 0 );
+    double  heroWavelength = ARWL_WI( *wavelength, 0 );
+
+    if ( heroWavelength < rangeStart )
+        return 0;
+
+    unsigned int  channel =
+        (unsigned int)( ( heroWavelength - rangeStart ) / channelWidth );
+
+    if ( channel >= s500_channels( art_gv ) )
+        return 0;
+
+    const ArAliasTable  * table =
+        & lightSelectionTable[ channel / LSC_SELECTION_BIN_CHANNELS ];
+
+    if ( ARALIASTABLE_IS_EMPTY( *table ) )
+        return 0;
+
+    return table;
+}
+
+- (ArLightsourceSelection) lightsourceSelection
+{
+    return lightsourceSelection;
+}
+
+- (void) setLightsourceSelection
+        : (ArLightsourceSelection) newLightsourceSelection
+{
+    lightsourceSelection = newLightsourceSelection;
+}
+
 - (ArSpectralIntensity *) overallSpectralPower
 {
     return overallSpectralPower[0];
@@ -365,9 +707,21 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
         :   "Overall radiant power of all lightsources: %f\n"
         ,   overallRadiantPower ];
 
+    [ self _prepareLightSelectionTables ];
+    [ self _prepareLightTree ];
+
+    if ( lightTreeNode )
+        [ reporter printf
+            :   "Number of light tree nodes: %ld\n"
+            ,   numberOfLightTreeNodes ];
+
     [ reporter endAction ];
 }
 
+//   Without a wavelength to pick a spectral bin with, the probability of
+//   selecting a light is its share of the overall radiant power, i.e. the
+//   average of its per-bin selection probabilities weighted by bin power.
+
 - (double) selectionProbabilityOfSource
         : ( ArNode *)               emissiveObject
         : ( ArSamplingRegion *)     samplingRegionOnEmissiveObject
@@ -376,15 +730,16 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
     unsigned int  i = 0;
 
     while (   i < ( numberOfLights - 1 )
-           && (id)[ light[i].source shape ] != (id)emissiveObject )
+           && (id)[ LSC_LIGHT(0,i).source shape ] != (id)emissiveObject )
         i++;
 
-    *lightsource = light[i].source;
+    *lightsource = LSC_LIGHT(0,i).source;
 
     return
-        [ light[i].source selectionProbabilityOfRegion
-            :   samplingRegionOnEmissiveObject
-            ];
+          LSC_LIGHT(0,i).percentOfOverallRadiantPower
+        * [ LSC_LIGHT(0,i).source selectionProbabilityOfRegion
+              :   samplingRegionOnEmissiveObject
+              ];
 }
 
 - (double) selectionProbabilityOfSource
@@ -396,16 +751,17 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
     unsigned int  i = 0;
 
     while (   i < ( numberOfLights - 1 )
-           && (id)[ light[i].source shape ] != (id)emissiveObject )
+           && (id)[ LSC_LIGHT(0,i).source shape ] != (id)emissiveObject )
         i++;
 
-    *lightsource = light[i].source;
+    *lightsource = LSC_LIGHT(0,i).source;
 
     return
-        [ light[i].source selectionProbabilityOfRegion
-            :   samplingRegionOnEmissiveObject
-            :   queryLocationWorldspace
-            ];
+          LSC_LIGHT(0,i).percentOfOverallRadiantPower
+        * [ LSC_LIGHT(0,i).source selectionProbabilityOfRegion
+              :   samplingRegionOnEmissiveObject
+              :   queryLocationWorldspace
+              ];
 }
 
 - (void) dealloc
@@ -419,6 +775,9 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
 
     FREE_ARRAY( light );
 
+    [ self _freeLightSelectionTables ];
+    [ self _freeLightTree ];
+
     [ super dealloc ];
 }
 
@@ -433,6 +792,24 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLightsourceCollection)
 
     for ( unsigned int i = 0; i < numberOfActualSlots; i++ )
         light[i] = otherLSC->light[i];
+
+    [ otherLSC _prepareLightSelectionTables ];
+
+    ownsLightSelectionTables = NO;
+    numberOfSelectionBins    = otherLSC->numberOfSelectionBins;
+    lightSelectionTable      = otherLSC->lightSelectionTable;
+
+    [ otherLSC _prepareLightTree ];
+
+    lightsourceSelection     = otherLSC->lightsourceSelection;
+    lightTreeHasBeenPrepared = YES;
+    ownsLightTree            = NO;
+    numberOfLightTreeNodes   = otherLSC->numberOfLightTreeNodes;
+    lightTreeNode            = otherLSC->lightTreeNode;
+    lightTreeNodeCluster     = otherLSC->lightTreeNodeCluster;
+    lightTreeLightCluster    = otherLSC->lightTreeLightCluster;
+    lightTreeLightIndex      = otherLSC->lightTreeLightIndex;
+    lightTreeLeaf            = otherLSC->lightTreeLeaf;
 }
 
 - (void) _copyLightsourcesOfOtherLSC
@@ -6,16 +6,32 @@
 #include "ArPathVertex.h"
 ART_MODULE_INTERFACE(ArcHashgrid)
 
-typedef struct ArIndexHolder
-{
-    uint32_t index;
-} ArIndexHolder;
+#include <pthread.h>
+
+/* ---------------------------------------------------------------------------
+
+    'ArcHashgrid'
+
+    Grid of cells with twice the merging radius as edge length, used to
+    find the light vertices near an eye vertex for vertex merging. The
+    cells are hashed into a table with (at least) as many entries as there
+    are vertices, so its size is proportional to the number of vertices,
+    not to the extent of the scene.
+
+    The table is built by a counting sort, in parallel: the vertex indices
+    of hash table entry c are cellIndices[ cellStart[c] ] up to, but not
+    including, cellIndices[ cellStart[c + 1] ], in ascending order.
 
+    Threads which already exist, such as the render threads of a sampler,
+    build the table together: one of them calls 'PrepareBuild', then each
+    of them calls 'BuildPart' with its own index and a barrier for all of
+    them, and once they are through, one of them calls 'FinishBuild'.
+    'BuildHashgrid' does all of that with threads of its own.
 
-ARDYNARRAY_INTERFACE_FOR_ARTYPE(IndexHolder,iholder,iholder);
-ARDYNARRAY_INTERFACE_FOR_ARTYPE_PTR(IndexHolder,iholder,iholder);
+------------------------------------------------------------------------aw- */
+
+struct ArcHashgridBuild;
 
-#define CELL_SIZE 70
 @interface ArcHashgrid
         : ArcObject
 {
@@ -23,18 +39,21 @@ ARDYNARRAY_INTERFACE_FOR_ARTYPE_PTR(IndexHolder,iholder,iholder);
 Vec3D bboxMin;
 Vec3D bboxMax;
 
-double cellsize[3];
-ArIndexHolderDynArray cells[CELL_SIZE][CELL_SIZE][CELL_SIZE];
-
-ArIntArray *indices;
-ArIntArray *ends;
+unsigned int  numberOfCells;
+unsigned int  numberOfVertices;
+unsigned int  allocatedCells;
+unsigned int  allocatedVertices;
+uint32_t    * cellStart;
+uint32_t    * cellIndices;
 
 double radius;
 double radiusSQR;
 
+double cellSize;
 double invCellSize;
 
-int DEBUG_COUNT;
+struct ArcHashgridBuild  * build;
+
 double                                vmNormalization;
 double                                VMweight;
 double                                VCweight;
@@ -43,11 +62,13 @@ double                                VCweight;
 - (void) CLEAR
         ;
 
-- (Pnt3D) GetCellIndex
-        : (Pnt3D) position
+- (uint32_t) GetCellIndex
+        : (int) x
+        : (int) y
+        : (int) z
         ;
 
-- (int) GetCellIndexF
+- (uint32_t) GetCellIndexOf
         : (Pnt3D) position
         ;
 
@@ -56,8 +77,18 @@ double                                VCweight;
         ;
 
 - (void) GetCellRange
-        : (int) cellIndex
-        : (Pnt2D*) cellRange
+        : (uint32_t) cellIndex
+        : (uint32_t *) rangeStart
+        : (uint32_t *) rangeEnd
+        ;
+
+//   Writes the distinct table entries of the 2x2x2 cells that can hold
+//   vertices within the radius of the position to "cells" (which needs
+//   room for 8), and returns how many there are.
+
+- (unsigned int) GetCellsNear
+        : (Pnt3D) position
+        : (uint32_t *) cells
         ;
 
 - (void) ProcessContribution
@@ -76,18 +107,24 @@ double                                VCweight;
         : (ART_GV *) gv
         ;
 
--(void) CalculateBoundingBoxesForThread
-        :(ArPathVertexptrDynArray *)  vertices
+- (void) PrepareBuild
+        : (ArPathVertexptrDynArray *) vertices
+        : (double)         radius
+        : (unsigned int)   numberOfThreads
+        ;
+
+- (void) BuildPart
+        : (unsigned int)        thread
+        : (pthread_barrier_t *) barrier
         ;
 
-- (void) CalculateOverallBoundingBox
-        : (Vec3D*) min
-        : (Vec3D*) max
+- (void) FinishBuild
         ;
 
 - (void) BuildHashgrid
         : (ArPathVertexptrDynArray *) vertices
         : (double)         radius
+        : (unsigned int)   numberOfThreads
         ;
 
 @end
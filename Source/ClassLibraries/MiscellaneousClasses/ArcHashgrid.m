@@ -12,25 +12,49 @@ ART_NO_MODULE_INITIALISATION_FUNCTION_NECESSARY
 //)
 ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
-ArIndexHolder _iholder_retain(
-        ArIndexHolder pv
-)
+//   Hash of the integer coordinates of a grid cell, as proposed by
+//   Teschner et al. for spatial hashing.
+
+#define HASHGRID_CELL_HASH(_x,_y,_z) \
+    (   ( (uint32_t)(_x) * 73856093u ) \
+      ^ ( (uint32_t)(_y) * 19349663u ) \
+      ^ ( (uint32_t)(_z) * 83492791u ) )
+
+#define HASHGRID_VERTEX_POSITION(_vertices,_i) \
+    (arpvptrdynarray_i( (_vertices), (_i) )->worldHitPoint->worldspace_point)
+
+typedef struct ArcHashgridBuild
 {
-    return pv;
+    ArPathVertexptrDynArray   * vertices;
+    unsigned int                numberOfThreads;
+    Vec3D                     * threadMin;
+    Vec3D                     * threadMax;
+    uint32_t                  * vertexCell;
+    uint32_t                  * cellCursor;
 }
+ArcHashgridBuild;
 
-ArIndexHolder _iholder_release(
-        ArIndexHolder pv
-)
+typedef struct ArcHashgridBuildThread
 {
-    return pv;
+    ArcHashgrid        * hashgrid;
+    unsigned int         thread;
+    pthread_barrier_t  * barrier;
 }
-ARDYNARRAY_IMPLEMENTATION_FOR_MANAGED_TYPE(
-        ArIndexHolder ,IndexHolder,iholder,iholder, (ArIndexHolder){ 0 },
-        _iholder_retain,,_iholder_release
-);
+ArcHashgridBuildThread;
+
+static void * hashgrid_build_thread(
+        void  * argument
+        )
+{
+    ArcHashgridBuildThread  * task = (ArcHashgridBuildThread *) argument;
+
+    [ task->hashgrid BuildPart
+        :   task->thread
+        :   task->barrier
+        ];
 
-ARDYNARRAY_IMPLEMENTATION_FOR_ARTYPE_PTR(IndexHolder,iholder,iholder,0);
+    return NULL;
+}
 
 @implementation ArcHashgrid
 
@@ -52,156 +76,305 @@ ARDYNARRAY_IMPLEMENTATION_FOR_ARTYPE_PTR(IndexHolder,iholder,iholder,0);
     );
 }
 
-- (void) CLEAR
+- (void) dealloc
 {
+    [ self CLEAR ];
 
-    for(uint32_t x= 0; x < CELL_SIZE; x++ )
-    {
-        for(uint32_t y= 0; y < CELL_SIZE; y++ )
-        {
-            for(uint32_t z= 0; z < CELL_SIZE; z++ )
-            {
-                ariholderdynarray_free(&cells[x][y][z]);
-            }
-        }
-    }
+    [ super dealloc ];
+}
 
+- (void) CLEAR
+{
+    if ( cellStart )
+        FREE_ARRAY( cellStart );
+
+    if ( cellIndices )
+        FREE_ARRAY( cellIndices );
+
+    cellStart = 0;
+    cellIndices = 0;
+    allocatedCells = 0;
+    allocatedVertices = 0;
+    numberOfCells = 0;
+    numberOfVertices = 0;
 }
+
+//   The hash table has the next power of two of entries at or above the
+//   number of vertices, so the average cell holds at most one vertex.
+
 - (void) Reserve
         :(unsigned int) numVertices
 {
+    unsigned int  cells = 1;
+
+    while ( cells < numVertices && cells < 0x80000000u )
+        cells <<= 1;
 
-    for(uint32_t x= 0; x < CELL_SIZE; x++ )
+    if ( cells > allocatedCells )
     {
-        for(uint32_t y= 0; y < CELL_SIZE; y++ )
-        {
-            for(uint32_t z= 0; z < CELL_SIZE; z++ )
-            {
-                cells[x][y][z] = ariholderdynarray_init(1);
-            }
-        }
+        if ( cellStart )
+            FREE_ARRAY( cellStart );
+
+        cellStart = ALLOC_ARRAY( uint32_t, cells + 1 );
+        allocatedCells = cells;
+    }
+
+    if ( numVertices > allocatedVertices )
+    {
+        if ( cellIndices )
+            FREE_ARRAY( cellIndices );
+
+        cellIndices = ALLOC_ARRAY( uint32_t, numVertices );
+        allocatedVertices = numVertices;
     }
 
-    self->bboxMin = VEC3D(1e36f, 1e36f, 1e36f);
-    self->bboxMax = VEC3D(-1e36f, -1e36f, -1e36f);
+    numberOfCells = cells;
 }
 
--(void) CalculateBoundingBoxesForThread
-        :(ArPathVertexptrDynArray *)  vertices
+//   Sets up the grid for a build by the given number of threads, which
+//   then each have to call 'BuildPart'. The vertex positions are only
+//   looked at from there on, so the vertex array may still be filled in
+//   the meantime - only its size has to be final.
+
+- (void) PrepareBuild
+        : (ArPathVertexptrDynArray *) vertices
+        : (double) newRadius
+        : (unsigned int) numberOfThreads
 {
+    self->radius = newRadius;
+    self->radiusSQR = M_SQR(newRadius);
 
-    Vec3D min = VEC3D(1e36f, 1e36f, 1e36f);
-    Vec3D max = VEC3D(-1e36f, -1e36f, -1e36f);
+    //   With cells twice the radius wide, the merging sphere around any
+    //   point overlaps at most the 2x2x2 cells closest to it.
 
-    for (unsigned int i = 0; i < arpvptrdynarray_size(vertices); i++)
-    {
-        ArPathVertex *pv = arpvptrdynarray_i(vertices, i);
+    cellSize = 2.0 * newRadius;
+    invCellSize = newRadius > 0.0 ? 1.0 / cellSize : 0.0;
 
-        Pnt3D pos = pv->worldHitPoint->worldspace_point;
+    numberOfVertices = arpvptrdynarray_size(vertices);
 
-        for(uint32_t j = 0; j < 3; j++)
-        {
-            VEC3D_I(min, j) = fmin( VEC3D_I(min, j), PNT3D_I(pos, j));
-            VEC3D_I(max, j) = fmax( VEC3D_I(max, j), PNT3D_I(pos, j));
-        }
+    [ self Reserve: numberOfVertices ];
 
-    }
-    vec3d_d_mul_v(1.1f, &max);
-    vec3d_d_mul_v(1.1f, &min);
+    build = ALLOC( ArcHashgridBuild );
+
+    build->vertices = vertices;
+    build->numberOfThreads = MAX( numberOfThreads, 1u );
+    build->threadMin = ALLOC_ARRAY( Vec3D, build->numberOfThreads );
+    build->threadMax = ALLOC_ARRAY( Vec3D, build->numberOfThreads );
+    build->vertexCell = ALLOC_ARRAY( uint32_t, MAX( numberOfVertices, 1u ) );
+    build->cellCursor = ALLOC_ARRAY( uint32_t, numberOfCells );
 
-    [self CalculateOverallBoundingBox: &min : &max];
+    memset( build->cellCursor, 0, numberOfCells * sizeof(uint32_t) );
 }
 
-- (void) CalculateOverallBoundingBox
-        : (Vec3D*) min
-        : (Vec3D*) max
+//   The share of the build done by one of the threads given to
+//   'PrepareBuild'. All of them have to call this, as each pass ends at
+//   the barrier, which is for exactly that many threads; a thread whose
+//   share of the vertices is empty still waits for the others.
+
+- (void) BuildPart
+        : (unsigned int) thread
+        : (pthread_barrier_t *) barrier
 {
-    for(uint32_t j = 0; j < 3; j++)
+    unsigned int  t = thread;
+    unsigned int  n = numberOfVertices;
+    unsigned int  c = numberOfCells;
+
+    unsigned int  v0 = (unsigned int)( (uint64_t) n * t / build->numberOfThreads );
+    unsigned int  v1 = (unsigned int)( (uint64_t) n * (t + 1) / build->numberOfThreads );
+    unsigned int  c0 = (unsigned int)( (uint64_t) c * t / build->numberOfThreads );
+    unsigned int  c1 = (unsigned int)( (uint64_t) c * (t + 1) / build->numberOfThreads );
+
+    //   Pass 1: bounding box of the vertices of this thread.
+
+    Vec3D  min = VEC3D(  MATH_HUGE_DOUBLE,  MATH_HUGE_DOUBLE,  MATH_HUGE_DOUBLE );
+    Vec3D  max = VEC3D( -MATH_HUGE_DOUBLE, -MATH_HUGE_DOUBLE, -MATH_HUGE_DOUBLE );
+
+    for ( unsigned int i = v0; i < v1; i++ )
     {
-        VEC3D_I(self->bboxMin, j) = fmin(VEC3D_I(self->bboxMin, j), VEC3D_I(*min, j));
-        VEC3D_I(self->bboxMax, j) = fmax(VEC3D_I(self->bboxMax, j), VEC3D_I(*max, j));
+        Pnt3D  pos = HASHGRID_VERTEX_POSITION( build->vertices, i );
+
+        for ( uint32_t j = 0; j < 3; j++ )
+        {
+            VEC3D_I(min, j) = fmin( VEC3D_I(min, j), PNT3D_I(pos, j) );
+            VEC3D_I(max, j) = fmax( VEC3D_I(max, j), PNT3D_I(pos, j) );
+        }
     }
 
-    cellsize[0] = fabs(VEC3D_I(self->bboxMax, 0) - VEC3D_I(self->bboxMin, 0)) / CELL_SIZE;
-    cellsize[1] = fabs(VEC3D_I(self->bboxMax, 1) - VEC3D_I(self->bboxMin, 1)) / CELL_SIZE;
-    cellsize[2] = fabs(VEC3D_I(self->bboxMax, 2) - VEC3D_I(self->bboxMin, 2)) / CELL_SIZE;
-}
+    build->threadMin[t] = min;
+    build->threadMax[t] = max;
 
-- (void)BuildHashgrid
-        :(ArPathVertexptrDynArray *)  vertices
-        :(double)          radius
-{
-    self->radius = radius;
-    self->radiusSQR = M_SQR(radius);
+    pthread_barrier_wait( barrier );
 
-    self->bboxMin = VEC3D(1e36f, 1e36f, 1e36f);
-    self->bboxMax = VEC3D(-1e36f, -1e36f, -1e36f);
+    if ( t == 0 )
+    {
+        for ( unsigned int i = 1; i < build->numberOfThreads; i++ )
+            for ( uint32_t j = 0; j < 3; j++ )
+            {
+                VEC3D_I(min, j) = fmin( VEC3D_I(min, j), VEC3D_I(build->threadMin[i], j) );
+                VEC3D_I(max, j) = fmax( VEC3D_I(max, j), VEC3D_I(build->threadMax[i], j) );
+            }
+
+        bboxMin = min;
+        bboxMax = max;
+    }
+
+    pthread_barrier_wait( barrier );
 
-    for (unsigned int i = 0; i < arpvptrdynarray_size(vertices); i++)
+    //   Pass 2: the cell of each vertex, and the number of vertices in
+    //   each cell.
+
+    for ( unsigned int i = v0; i < v1; i++ )
     {
-        ArPathVertex *pv = arpvptrdynarray_i(vertices, i);
+        uint32_t  cell =
+            [ self GetCellIndexOf
+                :   HASHGRID_VERTEX_POSITION( build->vertices, i )
+                ];
+
+        build->vertexCell[i] = cell;
+
+        __atomic_fetch_add( & build->cellCursor[cell], 1, __ATOMIC_RELAXED );
+    }
 
-        Pnt3D pos = pv->worldHitPoint->worldspace_point;
+    pthread_barrier_wait( barrier );
 
-        for(uint32_t j = 0; j < 3; j++)
+    //   Pass 3: the cell start table is the prefix sum of the counts.
+
+    if ( t == 0 )
+    {
+        uint32_t  start = 0;
+
+        for ( unsigned int i = 0; i < c; i++ )
         {
-            VEC3D_I(self->bboxMin, j) = fmin( VEC3D_I(self->bboxMin, j), PNT3D_I(pos, j));
-            VEC3D_I(self->bboxMax, j) = fmax( VEC3D_I(self->bboxMax, j), PNT3D_I(pos, j));
+            uint32_t  count = build->cellCursor[i];
+
+            cellStart[i] = start;
+            build->cellCursor[i] = start;
+            start += count;
         }
 
+        cellStart[c] = start;
     }
 
-    vec3d_d_mul_v(1.1f, &self->bboxMax);
-    vec3d_d_mul_v(1.1f, &self->bboxMin);
+    pthread_barrier_wait( barrier );
 
-    cellsize[0] = fabs(VEC3D_I(self->bboxMax, 0) - VEC3D_I(self->bboxMin, 0)) / CELL_SIZE;
-    cellsize[1] = fabs(VEC3D_I(self->bboxMax, 1) - VEC3D_I(self->bboxMin, 1)) / CELL_SIZE;
-    cellsize[2] = fabs(VEC3D_I(self->bboxMax, 2) - VEC3D_I(self->bboxMin, 2)) / CELL_SIZE;
+    //   Pass 4: each vertex index is put into a free slot of its cell.
 
-    for(uint32_t x= 0; x < CELL_SIZE; x++ )
+    for ( unsigned int i = v0; i < v1; i++ )
     {
-        for(uint32_t y= 0; y < CELL_SIZE; y++ )
+        uint32_t  slot =
+            __atomic_fetch_add(
+                & build->cellCursor[ build->vertexCell[i] ],
+                1,
+                __ATOMIC_RELAXED
+                );
+
+        cellIndices[slot] = i;
+    }
+
+    pthread_barrier_wait( barrier );
+
+    //   Pass 5: the order of the indices within a cell depends on thread
+    //   timing, so they are sorted, to make the lookups - and thereby the
+    //   sums of the contributions they find - repeatable. Cells only hold
+    //   a handful of vertices, so insertion sort does.
+
+    for ( unsigned int i = c0; i < c1; i++ )
+    {
+        uint32_t  * cell = cellIndices + cellStart[i];
+        uint32_t    size = cellStart[i + 1] - cellStart[i];
+
+        for ( uint32_t j = 1; j < size; j++ )
         {
-            for(uint32_t z= 0; z < CELL_SIZE; z++ )
+            uint32_t  index = cell[j];
+            uint32_t  k = j;
+
+            while ( k > 0 && cell[k - 1] > index )
             {
-                cells[x][y][z] = ariholderdynarray_init(1);
+                cell[k] = cell[k - 1];
+                k--;
             }
+
+            cell[k] = index;
         }
     }
+}
 
-    for(size_t i=0; i < arpvptrdynarray_size(vertices); i++)
-    {
-        Pnt3D  pos  = (arpvptrdynarray_i(vertices, i))->worldHitPoint->worldspace_point;
+- (void) FinishBuild
+{
+    FREE_ARRAY( build->threadMin );
+    FREE_ARRAY( build->threadMax );
+    FREE_ARRAY( build->vertexCell );
+    FREE_ARRAY( build->cellCursor );
+    FREE( build );
+
+    build = 0;
+}
+
+- (void) BuildHashgrid
+        : (ArPathVertexptrDynArray *) vertices
+        : (double) newRadius
+        : (unsigned int) numberOfThreads
+{
+    //   Threads of its own are only worth starting for a fair number of
+    //   vertices each.
+
+    unsigned int  threads =
+        MAX( MIN( numberOfThreads, arpvptrdynarray_size(vertices) / 1024 ), 1u );
+
+    [ self PrepareBuild
+        :   vertices
+        :   newRadius
+        :   threads
+        ];
+
+    pthread_barrier_t  barrier;
 
-        Pnt3D temp = [self GetCellIndex: pos];
+    pthread_barrier_init( & barrier, NULL, threads );
 
-//        NSLog(@"%f %f %f", PNT3D_I(temp, 0), PNT3D_I(temp, 1), PNT3D_I(temp, 2));
+    pthread_t               * thread = ALLOC_ARRAY( pthread_t, threads );
+    ArcHashgridBuildThread  * task = ALLOC_ARRAY( ArcHashgridBuildThread, threads );
 
-        ariholderdynarray_push(&cells[(int) PNT3D_I(temp, 0)][ (int) PNT3D_I(temp, 1)][ (int) PNT3D_I(temp, 2)], (ArIndexHolder){i});
+    for ( unsigned int i = 0; i < threads; i++ )
+    {
+        task[i].hashgrid = self;
+        task[i].thread = i;
+        task[i].barrier = & barrier;
     }
 
-//    uint32_t count = 0;
-//    for(uint32_t x= 0; x < 10; x++ )
-//    {
-//        for(uint32_t y= 0; y < 10; y++ )
-//        {
-//            for(uint32_t z= 0; z < 10; z++ )
-//            {
-//                count += ariholderdynarray_size(&cells[x][y][z]);
-//            }
-//        }
-//    }
+    //   All threads take part in each pass, so they have to exist before
+    //   the first barrier.
+
+    for ( unsigned int i = 1; i < threads; i++ )
+    {
+        if ( pthread_create( & thread[i], NULL, hashgrid_build_thread, & task[i] ) )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "could not start hash grid build thread %u"
+                ,   i
+                );
+    }
+
+    //   the first share of the work is done by the calling thread
+
+    hashgrid_build_thread( & task[0] );
 
-    return;
+    for ( unsigned int i = 1; i < threads; i++ )
+        pthread_join( thread[i], NULL );
 
+    pthread_barrier_destroy( & barrier );
+
+    FREE_ARRAY( thread );
+    FREE_ARRAY( task );
+
+    [ self FinishBuild ];
 }
 
 - (void) GetCellRange
-        : (int) cellIndex
-        : (Pnt2D *) cellRange
+        : (uint32_t) cellIndex
+        : (uint32_t *) rangeStart
+        : (uint32_t *) rangeEnd
 {
-    if(cellIndex == 0) *cellRange = PNT2D(0, ARARRAY_I(*ends, 0));
-    *cellRange = PNT2D( ARARRAY_I(*ends, cellIndex - 1), ARARRAY_I(*ends, cellIndex) );
+    *rangeStart = cellStart[cellIndex];
+    *rangeEnd   = cellStart[cellIndex + 1];
 }
 
 
@@ -241,6 +414,53 @@ ARDYNARRAY_IMPLEMENTATION_FOR_ARTYPE_PTR(IndexHolder,iholder,iholder,0);
     return YES;
 }
 
+- (unsigned int) GetCellsNear
+        : (Pnt3D) position
+        : (uint32_t *) cells
+{
+    //   Of the cells around the one the position is in, only the 2x2x2
+    //   block on the side of the position can hold vertices within the
+    //   radius.
+
+    int  cellMin[3];
+
+    for ( uint32_t j = 0; j < 3; j++ )
+    {
+        double  coordinate =
+            ( PNT3D_I(position, j) - VEC3D_I(self->bboxMin, j) ) * invCellSize;
+        double  cell = floor( coordinate );
+
+        cellMin[j] = (int) cell - ( coordinate - cell < 0.5 ? 1 : 0 );
+    }
+
+    //   Different cells can hash to the same table entry, which must only
+    //   be searched once.
+
+    unsigned int  numberOfNearbyCells = 0;
+
+    for ( int x = cellMin[0]; x <= cellMin[0] + 1; x++ )
+    {
+        for ( int y = cellMin[1]; y <= cellMin[1] + 1; y++ )
+        {
+            for ( int z = cellMin[2]; z <= cellMin[2] + 1; z++ )
+            {
+                uint32_t  cellIndex = [ self GetCellIndex: x : y : z ];
+
+                BOOL  seen = NO;
+
+                for ( unsigned int k = 0; k < numberOfNearbyCells; k++ )
+                    if ( cells[k] == cellIndex )
+                        seen = YES;
+
+                if ( ! seen )
+                    cells[numberOfNearbyCells++] = cellIndex;
+            }
+        }
+    }
+
+    return numberOfNearbyCells;
+}
+
 - (bool) Process
         : (ArPathVertex *) currentState
         : (Pnt3D) position
@@ -249,46 +469,47 @@ ARDYNARRAY_IMPLEMENTATION_FOR_ARTYPE_PTR(IndexHolder,iholder,iholder,0);
         : (ArBSDFSampleGenerationContext *)       sgc
         : (ART_GV *) gv
 {
+    if ( numberOfVertices == 0 || invCellSize == 0.0 )
+        return YES;
 
-    Pnt3D cellIndex = [self GetCellIndex: position];
+    uint32_t      cells[8];
+    unsigned int  numberOfNearbyCells =
+        [ self GetCellsNear
+            :   position
+            :   cells
+            ];
 
-    for(uint32_t x = MAX(0, PNT3D_I(cellIndex, 0) - 1); x <= MIN(CELL_SIZE-1, PNT3D_I(cellIndex, 0) + 1); x++)
+    for ( unsigned int c = 0; c < numberOfNearbyCells; c++ )
     {
-        for(uint32_t y = MAX(0, PNT3D_I(cellIndex, 1) - 1); y <= MIN(CELL_SIZE-1, PNT3D_I(cellIndex, 1) + 1); y++)
-        {
-            for(uint32_t z = MAX(0, PNT3D_I(cellIndex, 2) - 1); z <= MIN(CELL_SIZE-1, PNT3D_I(cellIndex, 2) + 1); z++)
-            {
-
-                ArIndexHolderDynArray indexes = cells[x][y][z];
+        uint32_t  rangeStart = cellStart[cells[c]];
+        uint32_t  rangeEnd   = cellStart[cells[c] + 1];
 
-                for(uint32_t j = 0; j < ariholderdynarray_size(&indexes); j++)
-                {
-                    ArPathVertex *particle = arpvptrdynarray_i(vertices, ariholderdynarray_i(&indexes, j).index);
+        for(uint32_t j = rangeStart; j < rangeEnd; j++)
+        {
+            ArPathVertex *particle = arpvptrdynarray_i(vertices, cellIndices[j]);
 
-                    Vec3D distVec;
-                    vec3d_pp_sub_v(&particle->worldHitPoint->worldspace_point, &position, &distVec);
+            Vec3D distVec;
+            vec3d_pp_sub_v(&particle->worldHitPoint->worldspace_point, &position, &distVec);
 
-                    int areWavelengthDependent = arwavelength_ww_equal_ranged(&currentState->outgoingWavelength,
-                                                                              &particle->outgoingWavelength,
-                                                                              5 NM
-                                                                              );
+            int areWavelengthDependent = arwavelength_ww_equal_ranged(&currentState->outgoingWavelength,
+                                                                      &particle->outgoingWavelength,
+                                                                      5 NM
+                                                                      );
 
-                    if(areWavelengthDependent == -1)
-                        continue;
+            if(areWavelengthDependent == -1)
+                continue;
 
 
-//                    if(!areWavelengthDependent)
-//                    {
-//                        continue;
-//                    }
+//            if(!areWavelengthDependent)
+//            {
+//                continue;
+//            }
 
-                    double distSqr = M_SQR(vec3d_v_len(&distVec));
+            double distSqr = vec3d_v_sqrlen(&distVec);
 
-                    if(distSqr <= self->radiusSQR)
-                    {
-                        [self ProcessContribution: currentState : particle : contribution : sgc : gv : areWavelengthDependent];
-                    }
-                }
+            if(distSqr <= self->radiusSQR)
+            {
+                [self ProcessContribution: currentState : particle : contribution : sgc : gv : areWavelengthDependent];
             }
         }
     }
@@ -392,37 +613,21 @@ ARDYNARRAY_IMPLEMENTATION_FOR_ARTYPE_PTR(IndexHolder,iholder,iholder,0);
 }
 
 
-- (int) GetCellIndexF
-        : (Pnt3D) position
+- (uint32_t) GetCellIndex
+        : (int) x
+        : (int) y
+        : (int) z
 {
-    Vec3D distMin;
-    VEC3D_I(distMin, 0) = VEC3D_I(position, 0) - VEC3D_I(self->bboxMin, 0);
-    VEC3D_I(distMin, 1) = VEC3D_I(position, 1) - VEC3D_I(self->bboxMin, 1);
-    VEC3D_I(distMin, 2) = VEC3D_I(position, 2) - VEC3D_I(self->bboxMin, 2);
-
-    VEC3D_I(distMin, 0) = floor(invCellSize * VEC3D_I(distMin, 0));
-    VEC3D_I(distMin, 1) = floor(invCellSize * VEC3D_I(distMin, 1));
-    VEC3D_I(distMin, 2) = floor(invCellSize * VEC3D_I(distMin, 2));
-
-//    return [self GetCellIndex: PNT3D((int) VEC3D_I(distMin, 0), (int) VEC3D_I(distMin, 1), (int) VEC3D_I(distMin, 2))];
+    return HASHGRID_CELL_HASH( x, y, z ) & ( numberOfCells - 1 );
 }
 
-- (Pnt3D) GetCellIndex
+- (uint32_t) GetCellIndexOf
         : (Pnt3D) position
 {
-    uint32_t x = (uint32_t) ( ( VEC3D_I(position, 0) - VEC3D_I(self->bboxMin, 0) ) / cellsize[0] );
-    uint32_t y = (uint32_t) ( ( VEC3D_I(position, 1) - VEC3D_I(self->bboxMin, 1) ) / cellsize[1] );
-    uint32_t z = (uint32_t) ( ( VEC3D_I(position, 2) - VEC3D_I(self->bboxMin, 2) ) / cellsize[2] );
-
-//    uint32_t x = (uint32_t) VEC3D_I(position, 0);
-//    uint32_t y = (uint32_t) VEC3D_I(position, 1);
-//    uint32_t z = (uint32_t) VEC3D_I(position, 2);
-//
-//    int test = (int)(( (x * 73856093) ^ (y * 19349663) ^ (z * 83492791) ) % (uint) arintarray_size(ends));
-//
-//    return test;
-
-    return PNT3D(x, y, z);
+    int  x = (int) floor( ( PNT3D_I(position, 0) - VEC3D_I(self->bboxMin, 0) ) * invCellSize );
+    int  y = (int) floor( ( PNT3D_I(position, 1) - VEC3D_I(self->bboxMin, 1) ) * invCellSize );
+    int  z = (int) floor( ( PNT3D_I(position, 2) - VEC3D_I(self->bboxMin, 2) ) * invCellSize );
 
+    return [ self GetCellIndex: x : y : z ];
 }
 @end
@@ -9,6 +9,8 @@ typedef enum{
         M_PORT,
         M_HOST,
         M_TEV_CONNECT,
+        M_STATS,
+        M_STATS_REPLY,
         M_INVALID,
 } message_type_t;
 typedef struct {
@@ -16,6 +18,36 @@ typedef struct {
     char message_data[MAX_MESSAGE_LENGTH];
 } message_t;
 
+//   The reply to a stats request (M_STATS, which carries the pid the
+//   reply goes to): a snapshot of the progress and throughput of a
+//   running render. The rates are averages since the previous request
+//   (or the start of rendering), the time remaining is negative if it
+//   cannot be estimated yet, and utilisation is the fraction of wall
+//   clock time each render thread spent working on windows.
+
+#define ARRENDERSTATISTICS_MAX_THREADS  64
+
+typedef struct ArRenderStatistics {
+    uint64_t samplesIssued;
+    uint64_t samplesTotal;
+    double secondsRendered;
+    double secondsRemaining;
+    double samplesPerSecond;
+    double firstHitRaysPerSecond;
+    double anyHitRaysPerSecond;
+    double packetRaysPerSecond;
+    uint64_t peakResidentKilobytes;
+    uint32_t samplesPerPixelDone;
+    uint32_t samplesPerPixel;
+    uint32_t controlQueueDepth;
+    uint32_t activeWindows;
+    uint32_t numberOfThreads;
+    float threadUtilisation[ARRENDERSTATISTICS_MAX_THREADS];
+} ArRenderStatistics;
+
+typedef char ArRenderStatistics_fits_into_message
+    [ sizeof(ArRenderStatistics) <= MAX_MESSAGE_LENGTH ? 1 : -1 ];
+
 
 @interface ArcMessageQueue 
         : ArcObject
@@ -38,8 +70,19 @@ typedef struct {
         : (long)pid
         : (const char *) name
         ;
+- (void) sendStatisticsRequest
+        :(long)pid
+        ;
+- (void) sendStatistics
+        :(long)pid
+        :(const ArRenderStatistics*) statistics
+        ;
 - (message_t) receiveMessage
         ;
+- (BOOL) receiveMessage
+        :(message_t*) message
+        :(double) timeoutSeconds
+        ;
 - (void) clearMessages
         ;
 - (void) clearMessages
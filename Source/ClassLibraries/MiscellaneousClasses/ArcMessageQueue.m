@@ -82,6 +82,26 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     return m.mtext;
 }
 
+//   Polls, so that a reply that never comes does not block forever.
+
+- (BOOL)receiveMessage:(message_t*)message :(double)timeoutSeconds {
+    msgbuf_t m;
+    double waited=0.0;
+    while(true){
+        int r=msgrcv(message_queue, &m, sizeof(message_t), process_id, IPC_NOWAIT);
+        if(r!=-1){
+            *message=m.mtext;
+            return YES;
+        }
+        if(errno==EINTR)
+            continue;
+        if(errno!=ENOMSG || waited>=timeoutSeconds)
+            return NO;
+        usleep(10000);
+        waited+=0.01;
+    }
+}
+
 
 - (void) messageSend : (msgbuf_t*) mbuff{
     while(true){
@@ -113,6 +133,25 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     [self messageSend:&m];
 }
 
+- (void)sendStatisticsRequest:(long)pid {
+    msgbuf_t m;
+    m.mtext.type=M_STATS;
+    m.mtype=pid;
+    *(long*)(m.mtext.message_data)=process_id;
+    [self messageSend:&m];
+}
+
+- (void)sendStatistics:(long)pid :(const ArRenderStatistics*)statistics {
+    msgbuf_t m;
+    m.mtext.type=M_STATS_REPLY;
+    m.mtype=pid;
+    memcpy(m.mtext.message_data, statistics, sizeof(ArRenderStatistics));
+    //   the renderer must not block on a requester that went away
+    while(msgsnd(message_queue, &m, sizeof(message_t), IPC_NOWAIT)==-1
+          && errno==EINTR)
+        ;
+}
+
 - (void)sendHostPort:(long)pid :(uint32_t) port {
     msgbuf_t m;
     m.mtext.type=M_PORT;
@@ -66,6 +66,12 @@ ART_MODULE_INTERFACE(ArcSampleCounter)
         : (double) duration
         ;
 
+//   The samples per pixel stepped through so far; unlike the other
+//   methods, this can be called from any thread at any time.
+
+- (int) samplesSoFar
+        ;
+
 @end
 
 // ===========================================================================
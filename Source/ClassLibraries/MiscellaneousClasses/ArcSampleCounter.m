@@ -90,7 +90,11 @@ int int_num_digits(int x)
 - (void) step
         : (unsigned int) addedSamples
 {
-    samplesSoFar += addedSamples;
+    __atomic_store_n(
+        & samplesSoFar,
+        samplesSoFar + (int) addedSamples,
+        __ATOMIC_RELAXED
+        );
 
     [ reporter consolePrintf
         :   "\b\b\b\b"
@@ -126,6 +130,11 @@ int int_num_digits(int x)
     }
 }
 
+- (int) samplesSoFar
+{
+    return __atomic_load_n( & samplesSoFar, __ATOMIC_RELAXED );
+}
+
 - (void) dealloc
 {
     [ reporter modifyIndent
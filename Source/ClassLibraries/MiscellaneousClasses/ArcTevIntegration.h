@@ -1,5 +1,6 @@
 #include "ART_Foundation.h"
 //#include <bits/stdint-uintn.h>
+#include <pthread.h>
 
 typedef  struct {
     char* data;
@@ -8,6 +9,24 @@ typedef  struct {
     uint32_t max_size;
 } message_buffer;
 
+//   A message waiting to be sent. Image updates carry a key made from the
+//   image name and the region, so that a newer update of the same region
+//   can take the place of one that has not been sent yet.
+
+typedef struct tev_message {
+    struct tev_message* next;
+    char* data;
+    uint32_t len;
+    char* key;
+} tev_message;
+
+//   All messages are queued, and sent to tev by a thread of their own, so
+//   that a slow or unresponsive viewer never holds up the caller. The
+//   sender transmits whatever has accumulated at most 'frequency' times
+//   per second (0: as fast as it can); if more than the maximum number of
+//   messages pile up in between, the oldest image updates are dropped,
+//   and only if there are none left, the oldest other messages.
+
 @interface ArcTevIntegration 
         : ArcObject
 {
@@ -15,6 +34,19 @@ typedef  struct {
         char* _hostName;
         char* _hostPort;
         message_buffer buffer;
+
+        pthread_t sender;
+        pthread_mutex_t queue_lock;
+        pthread_cond_t queue_cond;
+        tev_message* queue_head;
+        tev_message* queue_tail;
+        tev_message* queue_barrier;
+        unsigned int queued_messages;
+        unsigned int max_queued_updates;
+        unsigned long dropped_updates;
+        double update_interval;
+        BOOL sender_running;
+        BOOL sender_should_stop;
         @public 
         BOOL connected;
 }
@@ -29,6 +61,14 @@ typedef  struct {
         ;
 - (BOOL) tryConnection
         ;
+- (void) setUpdateFrequency
+        :(double) frequency
+        ;
+- (void) setMaximumQueuedUpdates
+        :(unsigned int) maximum
+        ;
+- (unsigned long) droppedUpdates
+        ;
 
 - (void) createImage
         :(const char*) name
@@ -27,7 +27,9 @@
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #include <netdb.h>
+#include <time.h>
 #include <unistd.h>
 
 #import "ArcTevIntegration.h"
@@ -57,6 +59,14 @@ float htolefloat(float x){
 
 ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
+//   Defaults: up to 30 transmissions per second, and as many pending
+//   messages as a 4K image has 16x16 tiles. A viewer that does not
+//   take any data for this long is disconnected.
+
+#define TEV_DEFAULT_FREQUENCY           30.0
+#define TEV_DEFAULT_MAX_QUEUED_UPDATES  32768
+#define TEV_SEND_TIMEOUT_SECONDS        5
+
 
 @implementation ArcTevIntegration
 
@@ -161,10 +171,210 @@ void char_buff_set_len(message_buffer * buff){
         _hostPort=NULL;
         connected=NO;
         init_char_buff(&buffer);   
+
+        pthread_mutex_init(&queue_lock, NULL);
+        pthread_cond_init(&queue_cond, NULL);
+        queue_head=NULL;
+        queue_tail=NULL;
+        queue_barrier=NULL;
+        queued_messages=0;
+        max_queued_updates=TEV_DEFAULT_MAX_QUEUED_UPDATES;
+        dropped_updates=0;
+        update_interval=1.0/TEV_DEFAULT_FREQUENCY;
+        sender_running=NO;
+        sender_should_stop=NO;
     }
     
     return self;
 }
+
+- (void) setUpdateFrequency
+    :(double) frequency
+{
+    pthread_mutex_lock(&queue_lock);
+    update_interval=(frequency>0.0 ? 1.0/frequency : 0.0);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+- (void) setMaximumQueuedUpdates
+    :(unsigned int) maximum
+{
+    pthread_mutex_lock(&queue_lock);
+    max_queued_updates=MAX(maximum,1);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+- (unsigned long) droppedUpdates
+{
+    pthread_mutex_lock(&queue_lock);
+    unsigned long dropped=dropped_updates;
+    pthread_mutex_unlock(&queue_lock);
+    return dropped;
+}
+
+void free_tev_message(tev_message* message){
+    FREE_ARRAY(message->data);
+    if(message->key)
+        FREE_ARRAY(message->key);
+    FREE(message);
+}
+
+double tev_monotonic_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec+1e-9*now.tv_nsec;
+}
+
+//   Hands the message in the buffer over to the sender thread. An update
+//   of a region that is still waiting to be sent just replaces the data
+//   of the pending one - unless a message other than an update has been
+//   queued since, e.g. one that closes or recreates the image: the new
+//   pixels must not overtake it. 'queue_barrier' is the last such message.
+
+- (void) enqueue
+    :(const char*) key
+{
+    pthread_mutex_lock(&queue_lock);
+
+    if(key){
+        tev_message* m=(queue_barrier ? queue_barrier->next : queue_head);
+        for (; m; m=m->next) {
+            if(m->key && strcmp(m->key, key)==0){
+                m->data=REALLOC_ARRAY(m->data, char, buffer.len);
+                memcpy(m->data, buffer.data, buffer.len);
+                m->len=buffer.len;
+                pthread_mutex_unlock(&queue_lock);
+                return;
+            }
+        }
+    }
+
+    //   the oldest pending updates are the stalest; other messages only
+    //   go if nothing else is left to drop
+    while(queued_messages>=max_queued_updates){
+        tev_message* prev=NULL;
+        tev_message* m=queue_head;
+        while(m && !m->key){
+            prev=m;
+            m=m->next;
+        }
+        if(!m){
+            prev=NULL;
+            m=queue_head;
+        }
+        if(!m)
+            break;
+        if(prev)
+            prev->next=m->next;
+        else
+            queue_head=m->next;
+        if(queue_tail==m)
+            queue_tail=prev;
+        if(queue_barrier==m)
+            queue_barrier=NULL;
+        free_tev_message(m);
+        queued_messages--;
+        dropped_updates++;
+    }
+
+    tev_message* message=ALLOC(tev_message);
+    message->next=NULL;
+    message->data=ALLOC_ARRAY(char, buffer.len);
+    memcpy(message->data, buffer.data, buffer.len);
+    message->len=buffer.len;
+    message->key=NULL;
+    if(key)
+        arstring_s_copy_s(key, &message->key);
+    else
+        queue_barrier=message;
+    queued_messages++;
+
+    if(queue_tail)
+        queue_tail->next=message;
+    else
+        queue_head=message;
+    queue_tail=message;
+
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+- (void) sendLoop
+{
+    double last_flush=0.0;
+
+    pthread_mutex_lock(&queue_lock);
+    while(YES){
+        while(!queue_head && !sender_should_stop)
+            pthread_cond_wait(&queue_cond, &queue_lock);
+        if(!queue_head && sender_should_stop)
+            break;
+
+        //   Everything that has accumulated goes out in one go; updates
+        //   that arrive meanwhile are coalesced for the next round.
+
+        tev_message* batch=queue_head;
+        queue_head=NULL;
+        queue_tail=NULL;
+        queue_barrier=NULL;
+        queued_messages=0;
+        double interval=update_interval;
+        BOOL stopping=sender_should_stop;
+        pthread_mutex_unlock(&queue_lock);
+
+        while(batch){
+            tev_message* next=batch->next;
+            if(__atomic_load_n(&connected, __ATOMIC_ACQUIRE))
+                [self send: batch->data : batch->len];
+            free_tev_message(batch);
+            batch=next;
+        }
+
+        if(interval>0.0 && !stopping){
+            double wait=last_flush+interval-tev_monotonic_seconds();
+            if(wait>0.0){
+                struct timespec pause;
+                pause.tv_sec=(time_t)wait;
+                pause.tv_nsec=(long)((wait-pause.tv_sec)*1e9);
+                nanosleep(&pause, NULL);
+            }
+        }
+        last_flush=tev_monotonic_seconds();
+
+        pthread_mutex_lock(&queue_lock);
+    }
+    pthread_mutex_unlock(&queue_lock);
+}
+
+void* tev_sender_thread(void* tev){
+    [(ArcTevIntegration*)tev sendLoop];
+    return NULL;
+}
+
+- (void) startSender
+{
+    if(sender_running)
+        return;
+    sender_should_stop=NO;
+    if(pthread_create(&sender, NULL, tev_sender_thread, self)==0)
+        sender_running=YES;
+    else
+        ART_ERRORHANDLING_WARNING("could not start the tev sender thread");
+}
+
+//   Sends what is still queued, and waits for the sender to finish.
+
+- (void) stopSender
+{
+    if(!sender_running)
+        return;
+    pthread_mutex_lock(&queue_lock);
+    sender_should_stop=YES;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+    pthread_join(sender, NULL);
+    sender_running=NO;
+}
 - (void) bufferStart
 {
     clean_char_buff(&buffer);
@@ -206,11 +416,22 @@ typedef struct addrinfo addrinfo;
                 close(potentialSocket);
                 result=result->ai_next;
             }else{
+                //   the sender must not write to the socket it replaces
+                [self stopSender];
                 if(connected){
                     close(socket_handle);
                 }
+                struct timeval timeout;
+                timeout.tv_sec=TEV_SEND_TIMEOUT_SECONDS;
+                timeout.tv_usec=0;
+                setsockopt(potentialSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+                int on=1;
+                setsockopt(potentialSocket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
                 socket_handle=potentialSocket;
-                connected=YES;
+                __atomic_store_n(&connected, YES, __ATOMIC_RELEASE);
+                [self startSender];
                 ret=YES;
                 break;
             }
@@ -220,17 +441,26 @@ typedef struct addrinfo addrinfo;
     return ret;
 }
 
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL  0
+#endif
+
+//   Only ever called on the sender thread. A viewer that went away, or
+//   did not take any data before the send timeout, is disconnected.
+
 - (void) send
+    :(const char*) data
+    :(uint32_t) len
 {
     size_t bytes_written=0;
-    while(bytes_written!=buffer.len){
-        int bytes=write(socket_handle, buffer.data+bytes_written, buffer.len-bytes_written);
+    while(bytes_written!=len){
+        ssize_t bytes=send(socket_handle, data+bytes_written, len-bytes_written, MSG_NOSIGNAL);
         if(bytes==-1){
             if(close(socket_handle)==-1){
                 ART_ERRORHANDLING_FATAL_ERROR("Closing error\n");
             }else{
                 socket_handle=-1;
-                connected=NO;
+                __atomic_store_n(&connected, NO, __ATOMIC_RELEASE);
             }
             break;
         }else{
@@ -260,7 +490,7 @@ typedef struct addrinfo addrinfo;
     char_buff_set_len(&buffer);
     
 
-    [self send];
+    [self enqueue: NULL];
 }
 -(void) appendChannelNames
     :(const char*) channel_names
@@ -309,7 +539,10 @@ typedef struct addrinfo addrinfo;
     
     
     char_buff_set_len(&buffer);
-    [self send];
+    char* key=NULL;
+    asprintf(&key, "%s:%d:%d:%d:%d", name, x, y, width, height);
+    [self enqueue: key];
+    FREE(key);
 }
 
 - (void)openImage
@@ -325,7 +558,7 @@ typedef struct addrinfo addrinfo;
     char_buff_append_str(&buffer, name);
     char_buff_append_str(&buffer, channel_selector);
     char_buff_set_len(&buffer);
-    [self send];
+    [self enqueue: NULL];
 }
 
 - (void)closeImage
@@ -337,7 +570,7 @@ typedef struct addrinfo addrinfo;
     char_buff_append_char(&buffer,CloseImage);
     char_buff_append_str(&buffer, name);
     char_buff_set_len(&buffer);
-    [self send];
+    [self enqueue: NULL];
 }
 
 - (void)reloadImage
@@ -351,11 +584,19 @@ typedef struct addrinfo addrinfo;
     char_buff_append_char(&buffer,grabfocus); 
     char_buff_append_str(&buffer, name);
     char_buff_set_len(&buffer);
-    [self send];
+    [self enqueue: NULL];
 }
 
 - (void)dealloc
 {
+    [self stopSender];
+    while(queue_head){
+        tev_message* next=queue_head->next;
+        free_tev_message(queue_head);
+        queue_head=next;
+    }
+    pthread_mutex_destroy(&queue_lock);
+    pthread_cond_destroy(&queue_cond);
     free_char_buff(&buffer);
     FREE_ARRAY(_hostName);
     FREE_ARRAY(_hostPort);
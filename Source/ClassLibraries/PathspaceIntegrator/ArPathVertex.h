@@ -163,4 +163,59 @@ ARDYNARRAY_INTERFACE_FOR_ARTYPE_PTR(PathVertex,pv,pv);
 
 ArPathVertex* arpv_alloc(const ART_GV *art_gv);
 void arpv_free_pv(const ART_GV *art_gv, ArPathVertex *pv);
-void arpv_free_arr_itrsc(const ART_GV  * art_gv, ArPathVertexptrDynArray *arr);
\ No newline at end of file
+void arpv_free_arr_itrsc(const ART_GV  * art_gv, ArPathVertexptrDynArray *arr);
+
+/* ---------------------------------------------------------------------------
+
+    'ArPathVertexArena'
+
+    Per-thread storage for the light subpath vertices of one iteration.
+    Vertices are handed out from fixed-size blocks by bumping an index,
+    so their addresses stay valid until the arena is reset, and resetting
+    it only rewinds that index.
+
+    Each slot keeps the light and attenuation samples it was first handed
+    out with, so that the spectral payloads are allocated once per slot
+    and not once per vertex. The hit point a vertex took over is released
+    when its slot is handed out again, or when the arena is freed.
+
+------------------------------------------------------------------------aw- */
+
+#define ARPVARENA_BLOCK_SIZE    1024
+
+typedef struct ArPathVertexArenaSlot
+{
+    ArPathVertex           vertex;
+    ArLightAlphaSample   * lightSample;
+    ArLightAlphaSample   * cameraLightSample;
+    ArAttenuationSample  * attenuationSample;
+}
+ArPathVertexArenaSlot;
+
+typedef struct ArPathVertexArena
+{
+    ArPathVertexArenaSlot  ** block;
+    unsigned int              numberOfBlocks;
+    unsigned int              numberOfUsedSlots;
+    unsigned int              numberOfTouchedSlots;
+}
+ArPathVertexArena;
+
+void arpvarena_init(
+        ArPathVertexArena  * arena
+        );
+
+ArPathVertex * arpvarena_alloc_pv(
+        const ART_GV             * art_gv,
+              ArPathVertexArena  * arena,
+              BOOL                 withAttenuation
+        );
+
+void arpvarena_reset(
+        ArPathVertexArena  * arena
+        );
+
+void arpvarena_free_contents(
+        const ART_GV             * art_gv,
+              ArPathVertexArena  * arena
+        );
\ No newline at end of file
@@ -100,4 +100,122 @@ ArPathVertex* arpv_alloc(const ART_GV *art_gv)
     pv->worldHitPoint = 0;
 
     return pv;
-}
\ No newline at end of file
+}
+
+
+void arpvarena_init(
+        ArPathVertexArena  * arena
+        )
+{
+    arena->block = 0;
+    arena->numberOfBlocks = 0;
+    arena->numberOfUsedSlots = 0;
+    arena->numberOfTouchedSlots = 0;
+}
+
+ArPathVertex * arpvarena_alloc_pv(
+        const ART_GV             * art_gv,
+              ArPathVertexArena  * arena,
+              BOOL                 withAttenuation
+        )
+{
+    unsigned int  blockIndex = arena->numberOfUsedSlots / ARPVARENA_BLOCK_SIZE;
+
+    if ( blockIndex == arena->numberOfBlocks )
+    {
+        if ( arena->block )
+            arena->block =
+                REALLOC_ARRAY(
+                    arena->block,
+                    ArPathVertexArenaSlot *,
+                    arena->numberOfBlocks + 1
+                    );
+        else
+            arena->block = ALLOC_ARRAY( ArPathVertexArenaSlot *, 1 );
+
+        arena->block[ blockIndex ] =
+            ALLOC_ARRAY( ArPathVertexArenaSlot, ARPVARENA_BLOCK_SIZE );
+
+        memset(
+            arena->block[ blockIndex ],
+            0,
+            ARPVARENA_BLOCK_SIZE * sizeof(ArPathVertexArenaSlot)
+            );
+
+        arena->numberOfBlocks++;
+    }
+
+    ArPathVertexArenaSlot  * slot =
+        & arena->block[ blockIndex ]
+                      [ arena->numberOfUsedSlots % ARPVARENA_BLOCK_SIZE ];
+
+    //   A slot that is handed out again still holds the hit point of the
+    //   vertex it was used for in a previous iteration.
+
+    if ( slot->vertex.worldHitPoint )
+        RELEASE_OBJECT( slot->vertex.worldHitPoint );
+
+    if ( ! slot->lightSample )
+        slot->lightSample = arlightalphasample_alloc( art_gv );
+
+    if ( ! slot->cameraLightSample )
+        slot->cameraLightSample = arlightalphasample_alloc( art_gv );
+
+    if ( withAttenuation && ! slot->attenuationSample )
+        slot->attenuationSample = arattenuationsample_alloc( art_gv );
+
+    slot->vertex = ARPV_EMPTY;
+
+    slot->vertex.lightSample = slot->lightSample;
+    slot->vertex.cameraLightSample = slot->cameraLightSample;
+
+    if ( withAttenuation )
+        slot->vertex.attenuationSample = slot->attenuationSample;
+
+    arena->numberOfUsedSlots++;
+
+    if ( arena->numberOfUsedSlots > arena->numberOfTouchedSlots )
+        arena->numberOfTouchedSlots = arena->numberOfUsedSlots;
+
+    return & slot->vertex;
+}
+
+void arpvarena_reset(
+        ArPathVertexArena  * arena
+        )
+{
+    arena->numberOfUsedSlots = 0;
+}
+
+void arpvarena_free_contents(
+        const ART_GV             * art_gv,
+              ArPathVertexArena  * arena
+        )
+{
+    for ( unsigned int i = 0; i < arena->numberOfTouchedSlots; i++ )
+    {
+        ArPathVertexArenaSlot  * slot =
+            & arena->block[ i / ARPVARENA_BLOCK_SIZE ]
+                          [ i % ARPVARENA_BLOCK_SIZE ];
+
+        if ( slot->vertex.worldHitPoint )
+            RELEASE_OBJECT( slot->vertex.worldHitPoint );
+
+        if ( slot->lightSample )
+            arlightalphasample_free( art_gv, slot->lightSample );
+
+        if ( slot->cameraLightSample )
+            arlightalphasample_free( art_gv, slot->cameraLightSample );
+
+        if ( slot->attenuationSample )
+            arattenuationsample_free( art_gv, slot->attenuationSample );
+    }
+
+    for ( unsigned int i = 0; i < arena->numberOfBlocks; i++ )
+        FREE_ARRAY( arena->block[i] );
+
+    if ( arena->block )
+        FREE_ARRAY( arena->block );
+
+    arpvarena_init( arena );
+}
@@ -56,10 +56,15 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
     --------------------------------------------------------------------aw- */
     
-    double  powerThreshold = [ RANDOM_GENERATOR valueFromNewSequence ];
-    int     i = 0;
+    if ( ARALIASTABLE_IS_EMPTY( patchSelectionTable ) )
+        return NO;
 
-    while( patch[i].lightsourceRadiantPowerPercentile < powerThreshold ) i++;
+    double  powerThreshold = [ RANDOM_GENERATOR valueFromNewSequence ];
+    int     i =
+        araliastable_sample(
+            & patchSelectionTable,
+              powerThreshold
+            );
     
     /* -----------------------------------------------------------------------
 
@@ -232,10 +237,15 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
         : (      ArLightSample *)                lightSample
 {
 
-    double  powerThreshold = [ RANDOM_GENERATOR valueFromNewSequence ];
-    int     i = 0;
+    if ( ARALIASTABLE_IS_EMPTY( patchSelectionTable ) )
+        return NO;
 
-    while( patch[i].lightsourceRadiantPowerPercentile < powerThreshold ) i++;
+    double  powerThreshold = [ RANDOM_GENERATOR valueFromNewSequence ];
+    int     i =
+        araliastable_sample(
+            & patchSelectionTable,
+              powerThreshold
+            );
 
     do
     {
@@ -49,22 +49,11 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnFirstHitNormalShadingTracer)
 
 ARPCODING_DEFAULT_IMPLEMENTATION
 
-- (void) calculateRGBASample
-        : (const Ray3D *)   viewRay
-        : (      ArRGBA *)  result
+- (void) _shadeIntersection
+        : (ArcIntersection *) intersection
+        : (const Ray3D *)     viewRay
+        : (      ArRGBA *)    result
 {
-    ASSERT_ALLOCATED_RAY3D(viewRay);
-    ASSERT_VALID_RAY3D(*viewRay);
-    ASSERT_ALLOCATED_RGBA(result);
-
-    ArcIntersection  * intersection =
-        [ RAYCASTER firstRayObjectIntersection
-            :   entireScene
-            :   eyePoint
-            :   viewRay
-            :   MATH_HUGE_DOUBLE
-            ];
-
     if ( intersection )
     {
 #ifdef WITH_RSA_STATISTICS
@@ -101,6 +90,61 @@ ARPCODING_DEFAULT_IMPLEMENTATION
     ASSERT_VALID_RGBA(result);
 }
 
+- (void) calculateRGBASample
+        : (const Ray3D *)   viewRay
+        : (      ArRGBA *)  result
+{
+    ASSERT_ALLOCATED_RAY3D(viewRay);
+    ASSERT_VALID_RAY3D(*viewRay);
+    ASSERT_ALLOCATED_RGBA(result);
+
+    ArcIntersection  * intersection =
+        [ RAYCASTER firstRayObjectIntersection
+            :   entireScene
+            :   eyePoint
+            :   viewRay
+            :   MATH_HUGE_DOUBLE
+            ];
+
+    [ self _shadeIntersection
+        :   intersection
+        :   viewRay
+        :   result
+        ];
+}
+
+- (void) calculateRGBASamples
+        : (const Ray3D *)   viewRays
+        : (unsigned int)    numberOfRays
+        : (      ArRGBA *)  results
+{
+    ArcIntersection  * intersection[ RAY3DPACKET_MAX_SIZE ];
+
+    for ( unsigned int first = 0;
+          first < numberOfRays;
+          first += RAY3DPACKET_MAX_SIZE )
+    {
+        unsigned int  packetSize =
+            M_MIN( numberOfRays - first, RAY3DPACKET_MAX_SIZE );
+
+        [ RAYCASTER firstRayObjectIntersections
+            :   entireScene
+            :   eyePoint
+            : & viewRays[first]
+            :   packetSize
+            :   MATH_HUGE_DOUBLE
+            :   intersection
+            ];
+
+        for ( unsigned int i = 0; i < packetSize; i++ )
+            [ self _shadeIntersection
+                :   intersection[i]
+                : & viewRays[first + i]
+                : & results[first + i]
+                ];
+    }
+}
+
 - (const char *) descriptionString
 {
     return arnfirsthitnormalshadingtracer_description;
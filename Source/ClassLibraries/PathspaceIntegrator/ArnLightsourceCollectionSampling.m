@@ -37,6 +37,276 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 #define LIGHTSOURCE(__a,__i) \
     ((id <ArpLightsourceSampling>)LSC_LIGHT((__a),(__i)).source)
 
+/* ---------------------------------------------------------------------------
+
+    '_lighttree_cp_importance'
+
+    Estimate of how much a cluster of lights contributes to a point, as
+    proposed by Conty Estevez & Kulla: its power over the squared distance
+    to its centre, times the cosine of the smallest angle under which any
+    of its surfaces could face the point. The distance is clamped to half
+    the extent of the cluster, so that points close to or within it do
+    not get arbitrarily large estimates. Clusters which cannot face the
+    point at all get an estimate of zero.
+
+------------------------------------------------------------------------aw- */
+
+static double _lighttree_cp_importance(
+        const ArLightTreeCluster  * c0,
+        const Pnt3D               * p0
+        )
+{
+    if ( c0->power <= 0.0 )
+        return 0.0;
+
+    Pnt3D  centre;
+
+    box3d_b_center_p( & c0->bounds, & centre );
+
+    Vec3D  toPoint;
+
+    vec3d_pp_sub_v( p0, & centre, & toPoint );
+
+    Vec3D  size;
+
+    box3d_b_size_v( & c0->bounds, & size );
+
+    double  distance = vec3d_v_len( & toPoint );
+    double  radius   = 0.5 * vec3d_v_len( & size );
+
+    double  sqrDistance =
+        M_MAX( M_SQR( distance ), M_MAX( M_SQR( radius ), MATH_TINY_DOUBLE ) );
+
+    if ( c0->emissionSpread >= MATH_PI || distance <= radius )
+        return c0->power / sqrDistance;
+
+    double  angle =
+        acos(
+            M_CLAMP(
+                vec3d_vv_dot( & c0->emissionAxis, & toPoint ) / distance,
+                -1.0,
+                 1.0
+                )
+            );
+
+    double  boundsAngle = asin( radius / distance );
+
+    double  facingAngle =
+        M_MAX( angle - c0->emissionSpread - boundsAngle, 0.0 );
+
+    if ( facingAngle >= MATH_PI_DIV_2 )
+        return 0.0;
+
+    return c0->power * cos( facingAngle ) / sqrDistance;
+}
+
+@interface ArnLightsourceCollection ( RaySampling_LightTree )
+
+- (BOOL) _lightTreeIsUsable
+        : (ArcPointContext *) illuminatedPoint
+        ;
+
+- (BOOL) _sampleLightTree
+        : (const Pnt3D *) illuminatedPoint
+        : (double) randomValue
+        : (unsigned int *) lightIndex
+        : (double *) selectionProbability
+        ;
+
+- (double) _lightTreeSelectionProbability
+        : (const Pnt3D *) illuminatedPoint
+        : (unsigned int) lightIndex
+        ;
+
+@end
+
+@implementation ArnLightsourceCollection ( RaySampling_LightTree )
+
+- (BOOL) _lightTreeIsUsable
+        : (ArcPointContext *) illuminatedPoint
+{
+    return
+        (    lightsourceSelection == arlightsourceselection_light_tree
+          && lightTreeNode
+          && illuminatedPoint );
+}
+
+/* ---------------------------------------------------------------------------
+
+    '_sampleLightTree'
+
+    Descends from the root, choosing each child with a probability
+    proportional to its importance, and then a light within the leaf the
+    same way. The random value is rescaled after every decision, so a
+    single one suffices for the entire descent.
+
+------------------------------------------------------------------------aw- */
+
+- (BOOL) _sampleLightTree
+        : (const Pnt3D *) illuminatedPoint
+        : (double) randomValue
+        : (unsigned int *) lightIndex
+        : (double *) selectionProbability
+{
+    double  u = randomValue;
+    long    n = 0;
+
+    *selectionProbability = 1.0;
+
+    while ( BVH_NODE_IS_INNER( lightTreeNode[n] ) )
+    {
+        long    second = BVH_NODE_SECOND_CHILD( lightTreeNode[n] );
+
+        double  firstImportance =
+            _lighttree_cp_importance(
+                & lightTreeNodeCluster[ n + 1 ],
+                  illuminatedPoint
+                );
+        double  secondImportance =
+            _lighttree_cp_importance(
+                & lightTreeNodeCluster[ second ],
+                  illuminatedPoint
+                );
+
+        if ( firstImportance + secondImportance <= 0.0 )
+            return NO;
+
+        double  firstProbability =
+            firstImportance / ( firstImportance + secondImportance );
+
+        if ( u < firstProbability )
+        {
+            u /= firstProbability;
+            *selectionProbability *= firstProbability;
+            n = n + 1;
+        }
+        else
+        {
+            u = ( u - firstProbability ) / ( 1.0 - firstProbability );
+            *selectionProbability *= 1.0 - firstProbability;
+            n = second;
+        }
+
+        u = M_MIN( u, 1.0 - MATH_TINY_DOUBLE );
+    }
+
+    long    first = BVH_NODE_PRIMITIVE_OFFSET( lightTreeNode[n] );
+    long    end   = first + BVH_NODE_PRIMITIVE_COUNT( lightTreeNode[n] );
+    double  leafImportance = 0.0;
+
+    for ( long j = first; j < end; j++ )
+        leafImportance +=
+            _lighttree_cp_importance(
+                & lightTreeLightCluster[j],
+                  illuminatedPoint
+                );
+
+    if ( leafImportance <= 0.0 )
+        return NO;
+
+    double  threshold = u * leafImportance;
+
+    for ( long j = first; j < end; j++ )
+    {
+        double  importance =
+            _lighttree_cp_importance(
+                & lightTreeLightCluster[j],
+                  illuminatedPoint
+                );
+
+        if ( importance > 0.0 && ( threshold < importance || j == end - 1 ) )
+        {
+            *lightIndex = lightTreeLightIndex[j];
+            *selectionProbability *= importance / leafImportance;
+
+            return YES;
+        }
+
+        threshold -= importance;
+    }
+
+    return NO;
+}
+
+/* ---------------------------------------------------------------------------
+
+    '_lightTreeSelectionProbability'
+
+    The probability with which '_sampleLightTree' picks the given light:
+    the product of the branch probabilities on the way from the root to
+    its leaf. With the depth-first node layout, the leaf lies below the
+    first child of an inner node exactly if its index is smaller than
+    that of the second child.
+
+------------------------------------------------------------------------aw- */
+
+- (double) _lightTreeSelectionProbability
+        : (const Pnt3D *) illuminatedPoint
+        : (unsigned int) lightIndex
+{
+    long    leaf = lightTreeLeaf[ lightIndex ];
+    long    n    = 0;
+    double  selectionProbability = 1.0;
+
+    while ( n != leaf )
+    {
+        long    second = BVH_NODE_SECOND_CHILD( lightTreeNode[n] );
+
+        double  firstImportance =
+            _lighttree_cp_importance(
+                & lightTreeNodeCluster[ n + 1 ],
+                  illuminatedPoint
+                );
+        double  secondImportance =
+            _lighttree_cp_importance(
+                & lightTreeNodeCluster[ second ],
+                  illuminatedPoint
+                );
+
+        if ( firstImportance + secondImportance <= 0.0 )
+            return 0.0;
+
+        if ( leaf < second )
+        {
+            selectionProbability *=
+                firstImportance / ( firstImportance + secondImportance );
+            n = n + 1;
+        }
+        else
+        {
+            selectionProbability *=
+                secondImportance / ( firstImportance + secondImportance );
+            n = second;
+        }
+    }
+
+    long    first = BVH_NODE_PRIMITIVE_OFFSET( lightTreeNode[n] );
+    long    end   = first + BVH_NODE_PRIMITIVE_COUNT( lightTreeNode[n] );
+    double  leafImportance  = 0.0;
+    double  lightImportance = 0.0;
+
+    for ( long j = first; j < end; j++ )
+    {
+        double  importance =
+            _lighttree_cp_importance(
+                & lightTreeLightCluster[j],
+                  illuminatedPoint
+                );
+
+        leafImportance += importance;
+
+        if ( lightTreeLightIndex[j] == lightIndex )
+            lightImportance = importance;
+    }
+
+    if ( leafImportance <= 0.0 )
+        return 0.0;
+
+    return selectionProbability * lightImportance / leafImportance;
+}
+
+@end
+
 @implementation ArnLightsourceCollection ( RaySampling )
 
 - (BOOL) sampleLightsource
@@ -53,40 +323,44 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     double  percentileThreshold = [ RANDOM_GENERATOR valueFromNewSequence ];
 
     unsigned int i;
-    // int  i = -1;
     int  a = 0;
+    double  selectionProbability = 1.0;
 
     if ( complexSkydomePresent )
     {
         i = 0;
     }
+    else if ( [ self _lightTreeIsUsable: illuminatedPoint ] )
+    {
+        if ( ! [ self _sampleLightTree
+                   : & ARCPOINTCONTEXT_WORLDSPACE_POINT(illuminatedPoint)
+                   :   percentileThreshold
+                   : & i
+                   : & selectionProbability
+                   ] )
+            return NO;
+    }
     else
     {
-        ArSpectralSample percentile;
-
-        for (i = 0; i < numberOfLights; i++) {
-            // the same method as is used later in pdf multiplication
-            // (as spc_sd_value_at_wavelength behaves differently)
-            sps_s500w_init_s(
-                art_gv,
-                LSC_LIGHT(a,i).overallSpectralPowerPercentile,
-                wavelength,
-                & percentile
-                );
+        //   Lights are drawn in proportion to their power in the spectral
+        //   bin of the hero wavelength, in constant time.
 
-            // decide based on the hero wavelength only
-            if (SPS_CI(percentile, 0) >= percentileThreshold) {
-                break;
-            }
-        }
+        const ArAliasTable  * selectionTable =
+            [ self lightSelectionTable
+                :   wavelength
+                ];
 
-        if (i == numberOfLights) {
+        if ( ! selectionTable )
             return NO;
-        }
+
+        i = araliastable_sample( selectionTable, percentileThreshold );
+
+        selectionProbability =
+            araliastable_probability( selectionTable, i );
     }
         
     BOOL result =
-        [ LIGHTSOURCE(a,0) sampleLightsource
+        [ LIGHTSOURCE(a,i) sampleLightsource
             : illuminatedPoint
             : samplingContext
             : wavelength
@@ -100,31 +374,17 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     
     if ( result )
     {
-        if ( illuminationProbability || emissionProbability )
-        {
-//            ArSpectralSample pdf;
-//
-//            sps_s500w_init_s(
-//                  art_gv,
-//                  LSC_LIGHT(a,i).percentOfOverallSpectralPower,
-//                  wavelength,
-//                & pdf
-//                );
-//
-//            if(illuminationProbability)
-//                arpdfvalue_d_mul_p(
-//                    ARPDFVALUE_MAIN(pdf),
-//                    illuminationProbability
-//                  );
-//
-//            if(emissionProbability)
-//                arpdfvalue_d_mul_p(
-//                    ARPDFVALUE_MAIN(pdf),
-//                    emissionProbability
-//                  );
-
+        if ( illuminationProbability )
+            arpdfvalue_d_mul_p(
+                selectionProbability,
+                illuminationProbability
+              );
 
-        }
+        if ( emissionProbability )
+            arpdfvalue_d_mul_p(
+                selectionProbability,
+                emissionProbability
+              );
     }
     
     return result;
@@ -162,24 +422,44 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
     
     if ( illuminationProbability || emissionProbability )
     {
-        ArSpectralSample  pdf;
-        
-//        sps_s500w_init_s(
-//              art_gv,
-//              LSC_LIGHT(a,i).percentOfOverallSpectralPower,
-//              wavelength,
-//            & pdf
-//            );
-//
+        //   The probability with which 'sampleLightsource' would have
+        //   selected this light for the same hero wavelength.
+
+        double  selectionProbability = 1.f/ (float) numberOfLights;
+
+        if ( ! complexSkydomePresent )
+        {
+            if ( [ self _lightTreeIsUsable: illuminatedPoint ] )
+            {
+                selectionProbability =
+                    [ self _lightTreeSelectionProbability
+                        : & ARCPOINTCONTEXT_WORLDSPACE_POINT(illuminatedPoint)
+                        :   i
+                        ];
+            }
+            else
+            {
+                const ArAliasTable  * selectionTable =
+                    [ self lightSelectionTable
+                        :   wavelength
+                        ];
+
+                selectionProbability =
+                    selectionTable
+                    ? araliastable_probability( selectionTable, i )
+                    : 0.0;
+            }
+        }
+
         if(illuminationProbability)
             arpdfvalue_d_mul_p(
-                1.f/ (float) numberOfLights,
+                selectionProbability,
                 illuminationProbability
               );
 
         if(emissionProbability)
             arpdfvalue_d_mul_p(
-                    1.f/ (float) numberOfLights,
+                selectionProbability,
                 emissionProbability
               );
     }
@@ -44,7 +44,14 @@ typedef enum ArPathTracerMode
     
     arpathtracermode_weighed_flag               = 0x04,
     arpathtracermode_weighed_direction_sampling = arpathtracermode_direction_sampling | arpathtracermode_weighed_flag,
-    arpathtracermode_weighed_light_sampling     = arpathtracermode_light_sampling | arpathtracermode_weighed_flag
+    arpathtracermode_weighed_light_sampling     = arpathtracermode_light_sampling | arpathtracermode_weighed_flag,
+
+    //   Light sampling picks lights via the light tree of the lightsource
+    //   collection, instead of in proportion to their power.
+
+    arpathtracermode_light_tree_flag            = 0x08,
+    arpathtracermode_light_tree_light_sampling  = arpathtracermode_light_sampling | arpathtracermode_light_tree_flag,
+    arpathtracermode_light_tree_mis             = arpathtracermode_mis | arpathtracermode_light_tree_flag
 }
 ArPathTracerMode;
 
@@ -54,6 +61,7 @@ ArPathTracerMode;
         < ArpConcreteClass, ArpCoding >
 {
     ArPathTracerMode       mode;
+    ArLightsourceSelection lightsourceSelection;
     
     // temporary samples that are used throughout methods to compute
     // the final results for that step/approach
@@ -47,6 +47,8 @@ const char * arnpathtracer_light_sampling_description = "path tracing (light sam
 const char * arnpathtracer_mis_description = "path tracing";
 const char * arnpathtracer_weighed_direction_sampling_description = "path tracing (weighed direction sampling)";
 const char * arnpathtracer_weighed_light_sampling_description = "path tracing (weighed light sampling)";
+const char * arnpathtracer_light_tree_light_sampling_description = "path tracing (light sampling, light tree)";
+const char * arnpathtracer_light_tree_mis_description = "path tracing (light tree)";
 const char * arnpathtracer_unknown_mode_description = "path tracing (unknown mode)";
 
 
@@ -193,7 +195,15 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
 
     if ( self )
     {
-        mode = newMode;
+        //   The light tree flag only concerns the lightsource collection;
+        //   everything else in here just sees the sampling strategy.
+
+        mode = newMode & ~arpathtracermode_light_tree_flag;
+
+        lightsourceSelection =
+            ( newMode & arpathtracermode_light_tree_flag )
+            ? arlightsourceselection_light_tree
+            : arlightsourceselection_power;
 
         [ self _setupPathTracer ];
     }
@@ -206,6 +216,7 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
     ArnPathTracer  * copiedInstance = [ super copy ];
 
     copiedInstance->mode = mode;
+    copiedInstance->lightsourceSelection = lightsourceSelection;
 
     [ copiedInstance _setupPathTracer ];
 
@@ -221,12 +232,38 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
             ];
 
     copiedInstance->mode = mode;
+    copiedInstance->lightsourceSelection = lightsourceSelection;
 
     [ copiedInstance _setupPathTracer ];
 
     return copiedInstance;
 }
 
+- (void) prepareForEstimation
+        : (ArNode *) inObject
+        : (ArNode *) lightsources
+        : (const Pnt3D *) newEye
+        : (double) newNear
+        : (int) numberOfSamples
+        : (ArcObject <ArpReporter> *) reporter
+{
+    [ super prepareForEstimation
+        :   inObject
+        :   lightsources
+        :   newEye
+        :   newNear
+        :   numberOfSamples
+        :   reporter
+        ];
+
+    //   Each integrator works on its own copy of the collection.
+
+    if ( lightsourceCollection )
+        [ LIGHTSOURCE_COLLECTION setLightsourceSelection
+            :   lightsourceSelection
+            ];
+}
+
 // determines whether a sampling region should be disregard when encountered during direction sampling
 - (BOOL) isEmissionDisregarded
         : (      BOOL)               specularOnlyPath
@@ -509,37 +546,21 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
     else
         *distance_r = 1.0;
 
-    ArcIntersection  * occlusion =
-            [ RAYCASTER firstRayObjectIntersection
-                    :   entireScene
-                    :   pointFrom
-                    : & shadowRay
-                    :   terminationDistance
-            ];
-
-    if( !occlusion )
-        return NO; // no intersection means no occlusion
-
-    BOOL result;
+    // any intersection closer than the termination distance occludes;
+    // we do not necessarily need to hit pointTo, as it may be a virtual point,
+    // so a hit at (almost) exactly the termination distance does not count.
+    // if there is no point, we expect to hit the infinite sphere, which the
+    // raycaster never reports as occluder
     if(pointTo)
-    {
-        // we do not necessarily need to hit pointTo, as it may be a virtual point
-        result = m_ddd_equal( terminationDistance, ARCINTERSECTION_T(occlusion), 0.000001 )
-                 ? NO : YES;
-    }
-    else
-    {
-        // if there is no point, we expect to hit infinite sphere
-        result = [ ARCINTERSECTION_SHAPE(occlusion)
-                         isMemberOfClass
-                         :   [ ArnInfSphere class ] ] ? NO : YES;
-    }
-
-    [ INTERSECTION_FREELIST releaseInstance
-    :   occlusion
-    ];
-
-    return result;
+        terminationDistance *= 1.0 - 0.000001;
+
+    return
+        [ RAYCASTER anyRayObjectIntersection
+                :   entireScene
+                :   pointFrom
+                : & shadowRay
+                :   terminationDistance
+        ];
 }
 
 // light sampling
@@ -905,6 +926,8 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
 
 - (void) traceRay
         : (const Ray3D *)               viewRay_worldspace
+        : (      BOOL)                  firstIntersectionIsKnown
+        : (      ArcIntersection *)     firstIntersection
         : (const ArWavelength *)        initialWavelength
         : (      double *)              traceAlpha
         : (      ArLightAlphaSample *)  lightalpha_r
@@ -946,7 +969,13 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
         int attenuationIndex = pathLength; // to be multiplied with media attenuation, first initilazed here
         int contributionIndex = pathLength + 1; // to be multiplied with media attenuation, first initialized here
 
-        intersection =
+        //   The first intersection may already have been computed by the
+        //   caller, as part of a ray packet.
+
+        if ( pathLength == 0 && firstIntersectionIsKnown )
+            intersection = firstIntersection;
+        else
+            intersection =
                 [ RAYCASTER firstRayObjectIntersection
                         :   entireScene
                         :   rayOriginPoint
@@ -1248,6 +1277,48 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
 
     [ self traceRay
             :   sampling_ray
+            :   NO
+            :   0
+            :   wavelength
+            : & traceAlpha
+            :   ARPATHSPACERESULT_LIGHTALPHASAMPLE(*result[0])
+    ];
+
+    ARPATHSPACERESULT_ALPHA(*result[0]) = traceAlpha;
+
+    ASSERT_VALID_GATHERING_RESULT(result[0])
+}
+
+- (BOOL) usesFirstEyeRayIntersections
+{
+    //   Packets of primary rays are only traced as a whole by the BVH
+    //   (and without CSG operations); for all other acceleration
+    //   structures, the sampler is better off casting single rays.
+
+    return
+           [ entireScene conformsToProtocol: ARPROTOCOL(ArpRayPacketCasting) ]
+        && [ (ArNode <ArpRayPacketCasting> *) entireScene tracesRayPackets ];
+}
+
+- (void) calculateLightSamples
+        : (const Ray3D *)               sampling_ray
+        : (ArcIntersection *)           firstIntersection
+        : (const ArWavelength *)        wavelength
+        : (      ArPathspaceResult **)  result
+{
+    result[0] =
+            (ArPathspaceResult*) arfreelist_pop( pathspaceResultFreelist );
+
+    ASSERT_ALLOCATED_GATHERING_RESULT(result[0])
+
+    ARPATHSPACERESULT_INIT_AS_FROM_EYE_PATH_WITH_ZERO_CONTRIBUTION(*result[0]);
+
+    double  traceAlpha = 1.0;
+
+    [ self traceRay
+            :   sampling_ray
+            :   YES
+            :   firstIntersection
             :   wavelength
             : & traceAlpha
             :   ARPATHSPACERESULT_LIGHTALPHASAMPLE(*result[0])
@@ -1263,14 +1334,39 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathTracer)
 {
     [ super code: coder ];
 
-    [ coder codeUInt: & mode ];
+    //   The lightsource selection is stored as part of the mode.
+
+    unsigned int  codedMode = mode;
+
+    if ( lightsourceSelection == arlightsourceselection_light_tree )
+        codedMode |= arpathtracermode_light_tree_flag;
+
+    [ coder codeUInt: & codedMode ];
 
     if ( [ coder isReading ] )
+    {
+        mode = codedMode & ~arpathtracermode_light_tree_flag;
+
+        lightsourceSelection =
+            ( codedMode & arpathtracermode_light_tree_flag )
+            ? arlightsourceselection_light_tree
+            : arlightsourceselection_power;
+
         [ self _setupPathTracer ];
+    }
 }
 
 - (const char *) descriptionString
 {
+    if ( lightsourceSelection == arlightsourceselection_light_tree )
+    {
+        if ( mode == arpathtracermode_light_sampling )
+            return arnpathtracer_light_tree_light_sampling_description;
+
+        if ( mode == arpathtracermode_mis )
+            return arnpathtracer_light_tree_mis_description;
+    }
+
     switch(mode)
     {
         case arpathtracermode_direction_sampling:
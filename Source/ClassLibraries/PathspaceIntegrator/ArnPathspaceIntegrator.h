@@ -68,6 +68,7 @@ ArDistanceTrackingMode;
 
     ArLightsourceSamplingContext        lssc;
     ArBSDFSampleGenerationContext       sgc;
+    ArPathVertexArena                   lightVertexArena;
 
     //   Parameters common to all ray-based algorithms
 
@@ -87,6 +88,12 @@ ArDistanceTrackingMode;
         : (ArDistanceTrackingMode) newDistanceTrackingMode
         ;
 
+//   The ray caster this integrator traces its rays with; each copy of an
+//   integrator has one of its own.
+
+- (ArnRayCaster *) rayCaster
+        ;
+
 - (ArcRayEndpoint *) sampleVolumeTransmittanceAndDistance
         : (      ArNode <ArpVolumeMaterial> *) volume
         : (const Ray3D *) ray
@@ -79,6 +79,8 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathspaceIntegrator)
     ARLSSC_RAYCASTER(lssc) = (ArnRayCaster*) RAYCASTER;
 
     pointOfInterestAttenuation = arattenuationsample_alloc(art_gv);
+
+    arpvarena_init( & lightVertexArena );
     
     // Select the volume integrator
     switch ( distanceTrackingMode ) {
@@ -103,6 +105,16 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathspaceIntegrator)
     [ self _setupRaySampler ];
 }
 
+- (ArnRayCaster *) rayCaster
+{
+    return (ArnRayCaster *) RAYCASTER;
+}
+
+- (void) resetLightPathVertices
+{
+    arpvarena_reset( & lightVertexArena );
+}
+
 - (BOOL) requiresLightsourceCollection
 {
     return NO;
@@ -159,6 +171,11 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathspaceIntegrator)
         pointOfInterestAttenuation
         );
 
+    arpvarena_free_contents(
+          art_gv,
+        & lightVertexArena
+        );
+
     [ super dealloc ];
 }
 
@@ -501,6 +518,50 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnPathspaceIntegrator)
     ART__VIRTUAL_METHOD__EXIT_WITH_ERROR
 }
 
+- (BOOL) usesFirstEyeRayIntersections
+{
+    //   Only integrators that override the 'calculateLightSamples'
+    //   variant with a first intersection benefit from packets.
+
+    return NO;
+}
+
+- (void) firstEyeRayIntersections
+        : (const Ray3D *)               sampling_rays
+        : (unsigned int)                numberOfRays
+        : (ArcIntersection **)          intersections
+{
+    [ RAYCASTER firstRayObjectIntersections
+        :   entireScene
+        :   eyePoint
+        :   sampling_rays
+        :   numberOfRays
+        :   MATH_HUGE_DOUBLE
+        :   intersections
+        ];
+}
+
+- (void) calculateLightSamples
+        : (const Ray3D *)               sampling_ray
+        : (ArcIntersection *)           firstIntersection
+        : (const ArWavelength *)        wavelength
+        : (      ArPathspaceResult **)  result
+{
+    //   Integrators that cannot make use of the precomputed intersection
+    //   just discard it, and cast the ray again.
+
+    if ( firstIntersection )
+        [ INTERSECTION_FREELIST releaseInstance
+            :   firstIntersection
+            ];
+
+    [ self calculateLightSamples
+        :   sampling_ray
+        :   wavelength
+        :   result
+        ];
+}
+
 - (void) cleanupAfterEstimation
         : (ArcObject <ArpReporter> *) reporter
 {
@@ -608,35 +608,21 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnVCM)
     else
         *distance_r = 1.0;
 
-    ArcIntersection  * occlusion =
-            [ RAYCASTER firstRayObjectIntersection
-                    :   entireScene
-                    :   pointFrom
-                    : & shadowRay
-                    :   terminationDistance
-            ];
-
-    if( !occlusion )
-        return NO; // no intersection means no occlusion
-
-    BOOL result;
+    // any intersection closer than the termination distance occludes;
+    // we do not necessarily need to hit pointTo, as it may be a virtual point,
+    // so a hit at (almost) exactly the termination distance does not count.
+    // if there is no point, we expect to hit the infinite sphere, which the
+    // raycaster never reports as occluder
     if(pointTo)
-    {
-        // we do not necessarily need to hit pointTo, as it may be a virtual point
-        result = m_ddd_equal( terminationDistance, ARCINTERSECTION_T(occlusion), 0.000001 )
-                 ? NO : YES;
-    }
-    else
-    {
-        // if there is no point, we expect to hit infinite sphere
-        result = [ ARCINTERSECTION_SHAPE(occlusion)
-                         isMemberOfClass
-                         :   [ ArnInfSphere class ] ] ? NO : YES;
-    }
-
-    RELEASE_OBJECT(occlusion);
-
-    return result;
+        terminationDistance *= 1.0 - 0.000001;
+
+    return
+        [ RAYCASTER anyRayObjectIntersection
+                :   entireScene
+                :   pointFrom
+                : & shadowRay
+                :   terminationDistance
+        ];
 }
 
 - (BOOL) randomWalkPT
@@ -2050,21 +2036,23 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnVCM)
             currentSubPathState.dVC /= cosTheta;
         }
 
-        ArPathVertex * lightVertex = ALLOC(ArPathVertex);
+        ArPathVertex * lightVertex =
+            arpvarena_alloc_pv(
+                  gv,
+                & lightVertexArena,
+                  pathLength > 0
+                );
         lightVertex->incomingDirection = intersection->worldspace_incoming_ray.vector;
 
         lightVertex->pathPDF = currentSubPathState.pathPDF;
         lightVertex->throughput = currentSubPathState.throughput;
-        lightVertex->lightSample = arlightalphasample_alloc(gv);
         arlightsample_l_init_l(gv, generatedLightSample, lightVertex->lightSample->light);
         lightVertex->lightSample->alpha = 1.0f;
-        lightVertex->cameraLightSample = arlightalphasample_alloc(gv);
         lightVertex->cameraLightSample->alpha = 1.0f;
         lightVertex->worldHitPoint = intersection;
 
         if(pathLength > 0)
         {
-            lightVertex->attenuationSample = arattenuationsample_alloc(gv);
             arattenuationsample_a_init_a(gv, pathAttenuation, lightVertex->attenuationSample);
         }
 
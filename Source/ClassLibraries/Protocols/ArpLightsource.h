@@ -95,6 +95,35 @@ typedef enum ArLightsourceType
 }
 ArLightsourceType;
 
+/* ---------------------------------------------------------------------------
+
+    'ArLightsourceSelection'
+
+    How a lightsource collection picks the light that is sampled for a
+    given illuminated point.
+
+    arlightsourceselection_power
+
+    In proportion to the power each light emits, irrespective of where
+    the illuminated point is.
+
+    arlightsourceselection_light_tree
+
+    By traversing a bounding volume hierarchy over the lights, which
+    estimates the contribution of each subtree from its spatial extent,
+    orientation and power as seen from the illuminated point. Falls back
+    to power-proportional selection if there is no illuminated point, or
+    if any of the lights does not provide spatial bounds.
+
+------------------------------------------------------------------------aw- */
+
+typedef enum ArLightsourceSelection
+{
+    arlightsourceselection_power       = 0x00,
+    arlightsourceselection_light_tree  = 0x01
+}
+ArLightsourceSelection;
+
 @class ArNode;
 @protocol ArpShape;
 
@@ -146,6 +175,22 @@ ArLightsourceType;
         : ( double * ) probability
         ;
 
+/* ---------------------------------------------------------------------------
+    'getSpatialBounds'
+    The worldspace bounding box of a lightsource, and a cone around
+    'emissionAxis' with half-angle 'emissionSpread' which contains the
+    normals of all its emitting surfaces. Each of these emits into the
+    hemisphere around its normal; a spread of MATH_PI means that light
+    leaves in all directions. Lightsources which are not bounded in
+    space (e.g. skydomes) return NO.
+--------------------------------------------------------------------------- */
+
+- (BOOL) getSpatialBounds
+        : (Box3D *)  bounds
+        : (Vec3D *)  emissionAxis
+        : (double *) emissionSpread
+        ;
+
 @end
 
 
@@ -188,6 +233,13 @@ ArLightsourceType;
         : ( id <ArpLightsource> *)  lightsource
         ;
 
+- (ArLightsourceSelection) lightsourceSelection
+        ;
+
+- (void) setLightsourceSelection
+        : (ArLightsourceSelection) newLightsourceSelection
+        ;
+
 @end
 
 // ===========================================================================
@@ -34,6 +34,7 @@ ART_MODULE_INTERFACE(ArpPathspaceIntegrator)
 #import "ArcHashgrid.h"
 
 @protocol ArpCamera;
+@class ArcIntersection;
 
 @protocol ArpPathspaceIntegrator <ArpPathspaceIntegratorCore>
 
@@ -53,6 +54,56 @@ ART_MODULE_INTERFACE(ArpPathspaceIntegrator)
         : (      ArPathspaceResult **)  result
         ;
 
+/* ---------------------------------------------------------------------------
+
+    'usesFirstEyeRayIntersections'
+    'firstEyeRayIntersections'
+    'calculateLightSamples' (with first intersection)
+
+    Samplers can use the latter two to trace the first segment of a number
+    of eye rays as a packet: 'firstEyeRayIntersections' computes the first
+    intersection (or NULL) for each ray, and the second method then does
+    the same as the plain 'calculateLightSamples', except that it starts
+    from the given first intersection instead of casting the ray itself.
+    It takes over ownership of the intersection.
+
+    This only pays off if the integrator can actually start its paths
+    from such an intersection, and if the scene traces packets as a
+    whole; 'usesFirstEyeRayIntersections' says whether both is the case.
+    If not, samplers should just use the plain 'calculateLightSamples'.
+
+------------------------------------------------------------------------aw- */
+
+- (BOOL) usesFirstEyeRayIntersections
+        ;
+
+- (void) firstEyeRayIntersections
+        : (const Ray3D *)               sampling_rays
+        : (unsigned int)                numberOfRays
+        : (ArcIntersection **)          intersections
+        ;
+
+- (void) calculateLightSamples
+        : (const Ray3D *)               sampling_ray
+        : (ArcIntersection *)           firstIntersection
+        : (const ArWavelength *)        wavelength
+        : (      ArPathspaceResult **)  result
+        ;
+
+/* ---------------------------------------------------------------------------
+
+    'resetLightPathVertices'
+
+    The light subpath vertices the 'generateLightPaths' methods append to
+    a list come from storage owned by the integrator, and stay valid until
+    this is called. Samplers call it once they are done with the vertices
+    of an iteration, instead of freeing them one by one.
+
+------------------------------------------------------------------------aw- */
+
+- (void) resetLightPathVertices
+        ;
+
 - (void) generateLightPaths
         : (ArNode <ArpCamera>  *)      sampling_ray
         : (ArPathVertexDynArray *)     lightPathsList
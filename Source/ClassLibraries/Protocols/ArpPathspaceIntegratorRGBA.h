@@ -38,6 +38,16 @@ ART_MODULE_INTERFACE(ArpPathspaceIntegratorRGBA)
         : (      ArRGBA *)  result
         ;
 
+//   Same as calculateRGBASample for a number of rays at once, which
+//   allows the integrator to trace them as a packet. Intended for
+//   primary rays from neighbouring pixels.
+
+- (void) calculateRGBASamples
+        : (const Ray3D *)   sampling_rays
+        : (unsigned int)    numberOfRays
+        : (      ArRGBA *)  results
+        ;
+
 @end
 
 // ===========================================================================
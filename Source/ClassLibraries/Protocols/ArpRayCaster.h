@@ -104,6 +104,54 @@ struct ArIntersectionList;
         : (const double) range_end_t
         ;
 
+/* ---------------------------------------------------------------------------
+
+    'anyRayObjectIntersection'
+
+    Any-hit query for shadow and connection rays: returns YES if there is
+    at least one intersection with a t value below the given range end.
+    Unlike 'firstRayObjectIntersection', the traversal stops at the first
+    such occluder it comes across, and no ArcIntersection is returned.
+
+    The starting point is treated just like by the four parameter version
+    of 'firstRayObjectIntersection'. Hits on the infinite sphere never
+    count as occluders.
+
+--------------------------------------------------------------------------- */
+
+- (BOOL) anyRayObjectIntersection
+        : (ArNode <ArpRayCasting> *) geometryToIntersectRayWith
+        : (const ArcPointContext *) startingPoint_worldCoordinates
+        : (const Ray3D *) ray_worldCoordinates
+        : (const double) range_end_t
+        ;
+
+/* ---------------------------------------------------------------------------
+
+    'firstRayObjectIntersections'
+
+    Batch version of the four parameter 'firstRayObjectIntersection', for
+    a number of rays that all start at the same point, e.g. primary rays
+    from neighbouring pixels. The i-th result is written to
+    intersections[i], and is the same as what 'firstRayObjectIntersection'
+    returns for rays[i].
+
+    If the geometry supports it (see ArpRayPacketCasting), the rays are
+    traced as packets of up to RAY3DPACKET_MAX_SIZE rays, which share the
+    traversal of the acceleration structure. Rays that diverge are traced
+    one by one.
+
+--------------------------------------------------------------------------- */
+
+- (void) firstRayObjectIntersections
+        : (ArNode <ArpRayCasting> *) geometryToIntersectRayWith
+        : (const ArcPointContext *) startingPoint_worldCoordinates
+        : (const Ray3D *) rays_worldCoordinates
+        : (unsigned int) numberOfRays
+        : (const double) range_end_t
+        : (ArcIntersection **) intersections
+        ;
+
 /* ---------------------------------------------------------------------------
 
     'getMaterial_at_WorldPnt3D'
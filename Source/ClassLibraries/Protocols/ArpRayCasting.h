@@ -77,6 +77,47 @@ struct ArIntersectionList;
 
 @end
 
+/* ---------------------------------------------------------------------------
+    'ArpRayPacketCasting'
+        Optional protocol for nodes that can intersect a whole packet of
+        rays in one go (see ArnRayCaster 'firstRayObjectIntersections').
+
+    'getIntersectionLists'
+        Packet version of 'getIntersectionList'. 'rays' holds one ray per
+        packet lane, in the coordinate system of the node. For each lane
+        set in 'activeMask', the corresponding entry of 'intersectionLists'
+        is set to the intersection list for that ray; all other entries
+        are left alone.
+
+        Whenever per-ray work is done (e.g. the creation of intersections),
+        the ray caster has to be switched to the lane in question first,
+        via arnraycaster_select_packet_ray. Nodes that cannot process the
+        packet as a whole can also just do this for each active lane, and
+        then call 'getIntersectionList'.
+
+    'tracesRayPackets'
+        YES if the node (and whatever it passes the packet on to) actually
+        processes packets as a whole, instead of just splitting them up
+        into single rays. Callers use this to decide whether it is worth
+        assembling packets in the first place.
+--------------------------------------------------------------------------- */
+
+@protocol ArpRayPacketCasting < ArpRayCasting >
+
+- (BOOL) tracesRayPackets
+        ;
+
+- (void) getIntersectionLists
+        : (ArnRayCaster *) rayCaster
+        : (const Ray3D *) rays
+        : (unsigned int) numberOfRays
+        : (unsigned int) activeMask
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionLists
+        ;
+
+@end
+
 @protocol ArpShapeRayCasting < ArpRayCasting >
 
 - (void) calculateLocalNormalForIntersection
@@ -322,6 +322,135 @@ ARPRAYCASTING_DEFAULT_IMPLEMENTATION(AraCombinedAttributes)
             ];
 }
 
+- (BOOL) tracesRayPackets
+{
+    return
+           [ SUBNODE conformsToProtocol: ARPROTOCOL(ArpRayPacketCasting) ]
+        && [ (ArNode <ArpRayPacketCasting> *) SUBNODE tracesRayPackets ];
+}
+
+- (void) getIntersectionLists
+        : (ArnRayCaster *) rayCaster
+        : (const Ray3D *) rays
+        : (unsigned int) numberOfRays
+        : (unsigned int) activeMask
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionLists
+{
+    ArNodeRef  surfaceMaterialStore;
+
+    if ( SURFACE_MATERIAL )
+        [ rayCaster pushSurfaceMaterialRef
+            :   WEAK_NODE_REFERENCE( SURFACE_MATERIAL )
+            : & surfaceMaterialStore
+            ];
+
+    ArNodeRef  environmentMaterialStore;
+
+    if ( ENVIRONMENT_MATERIAL )
+        [ rayCaster pushEnvironmentMaterialRef
+            :   WEAK_NODE_REFERENCE( ENVIRONMENT_MATERIAL )
+            : & environmentMaterialStore
+            ];
+
+    ArNodeRef  volumeMaterialStore;
+
+    if ( VOLUME_MATERIAL )
+        [ rayCaster pushVolumeMaterialRef
+            :   WEAK_NODE_REFERENCE( VOLUME_MATERIAL )
+            : & volumeMaterialStore
+            ];
+
+    ArNodeRef  verticesStore;
+
+    if ( VERTICES )
+        [ rayCaster pushVerticesRef
+            :   WEAK_NODE_REFERENCE( VERTICES )
+            : & verticesStore
+            ];
+
+    //   The trafo is pushed for the sake of the traversal state; the rays
+    //   of the packet lanes are transformed here, since the ray caster
+    //   only transforms its current single ray.
+
+    const Ray3D  * subnodeRays = rays;
+    Ray3D          transformedRays[ RAY3DPACKET_MAX_SIZE ];
+    ArNodeRef      trafoStore;
+    Ray3DE         ray3DEStore;
+
+    if ( TRAFO )
+    {
+        [ rayCaster pushTrafo3DRef
+            :   WEAK_NODE_REFERENCE( TRAFO )
+            : & trafoStore
+            : & ray3DEStore
+            ];
+
+        for ( unsigned int i = 0; i < numberOfRays; i++ )
+            if ( activeMask & ( 1U << i ) )
+                [ TRAFO backtrafoRay3D
+                    : & rays[i]
+                    : & transformedRays[i]
+                    ];
+
+        subnodeRays = transformedRays;
+    }
+
+    if ( [ SUBNODE conformsToProtocol: ARPROTOCOL(ArpRayPacketCasting) ] )
+    {
+        [ (ArNode <ArpRayPacketCasting> *) SUBNODE getIntersectionLists
+            :   rayCaster
+            :   subnodeRays
+            :   numberOfRays
+            :   activeMask
+            :   range_of_t
+            :   intersectionLists
+            ];
+    }
+    else
+    {
+        for ( unsigned int i = 0; i < numberOfRays; i++ )
+        {
+            if ( ! ( activeMask & ( 1U << i ) ) )
+                continue;
+
+            arnraycaster_select_packet_ray( rayCaster, i, & subnodeRays[i] );
+
+            [ SUBNODE getIntersectionList
+                :   rayCaster
+                :   range_of_t
+                : & intersectionLists[i]
+                ];
+        }
+    }
+
+    if ( TRAFO )
+        [ rayCaster popTrafo3D
+            : & trafoStore
+            : & ray3DEStore
+            ];
+
+    if ( SURFACE_MATERIAL )
+        [ rayCaster popSurfaceMaterial
+            : & surfaceMaterialStore
+            ];
+
+    if ( ENVIRONMENT_MATERIAL )
+        [ rayCaster popEnvironmentMaterial
+            : & environmentMaterialStore
+            ];
+
+    if ( VOLUME_MATERIAL )
+        [ rayCaster popVolumeMaterial
+            : & volumeMaterialStore
+            ];
+
+    if ( VERTICES )
+        [ rayCaster popVertices
+            : & verticesStore
+            ];
+}
+
 @end
 
 // ===========================================================================
@@ -106,43 +106,13 @@ ARPRAYCASTING_DEFAULT_IMPLEMENTATION(AraWorld)
     }
 }
 
-- (void) getIntersectionList
-        : (ArnRayCaster *) rayCaster
-        : (Range) range_of_t
+//   Intersections that have no volume material assigned on one side lie
+//   on the surface of something that is surrounded by the world volume
+//   material.
+
+- (void) _setWorldVolumeMaterial
         : (struct ArIntersectionList *) intersectionList
 {
-    CREATE_WEAK_OBJECT_REF(
-        DEFAULT_VOLUME_MATERIAL,
-        ARNRAYCASTER_VOLUME_MATERIAL_REF(rayCaster)
-        );
-
-    CREATE_WEAK_OBJECT_REF(
-        DEFAULT_SURFACE_MATERIAL,
-        ARNRAYCASTER_SURFACE_MATERIAL_REF(rayCaster)
-        );
-
-    ARNRAYCASTER_TRAFO_REF(rayCaster) = ARNODEREF_NONE;
-    ARNRAYCASTER_WORLD(rayCaster) = self;
-
-    INTERSECTION_TEST_DEBUG_OUTPUT_INITIAL_LIST;
-
-    INTERSECTION_TEST_DEBUG_CALLING_SUBNODE(SUBNODE,"");
-
-    [ SUBNODE getIntersectionList
-        :   rayCaster
-        :   range_of_t
-        :   intersectionList
-        ];
-
-    INTERSECTION_TEST_DEBUG_OUTPUT_RESULT_LIST_WITH_COMMENT(
-        "(before processing)"
-        );
-
-    ARNRAYCASTER_VOLUME_MATERIAL_REF(rayCaster) = ARNODEREF_NONE;
-    ARNRAYCASTER_SURFACE_MATERIAL_REF(rayCaster)  = ARNODEREF_NONE;
-    ARNRAYCASTER_TRAFO_REF(rayCaster)    = ARNODEREF_NONE;
-    ARNRAYCASTER_WORLD(rayCaster)        = NULL;
-
     ArcIntersection  * head =
         ARINTERSECTIONLIST_HEAD(*intersectionList);
 
@@ -212,12 +182,124 @@ ARPRAYCASTING_DEFAULT_IMPLEMENTATION(AraWorld)
                 ARCINTERSECTION_NEXT(head);
         }
     }
+}
+
+- (void) getIntersectionList
+        : (ArnRayCaster *) rayCaster
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionList
+{
+    CREATE_WEAK_OBJECT_REF(
+        DEFAULT_VOLUME_MATERIAL,
+        ARNRAYCASTER_VOLUME_MATERIAL_REF(rayCaster)
+        );
+
+    CREATE_WEAK_OBJECT_REF(
+        DEFAULT_SURFACE_MATERIAL,
+        ARNRAYCASTER_SURFACE_MATERIAL_REF(rayCaster)
+        );
+
+    ARNRAYCASTER_TRAFO_REF(rayCaster) = ARNODEREF_NONE;
+    ARNRAYCASTER_WORLD(rayCaster) = self;
+
+    INTERSECTION_TEST_DEBUG_OUTPUT_INITIAL_LIST;
+
+    INTERSECTION_TEST_DEBUG_CALLING_SUBNODE(SUBNODE,"");
+
+    [ SUBNODE getIntersectionList
+        :   rayCaster
+        :   range_of_t
+        :   intersectionList
+        ];
+
+    INTERSECTION_TEST_DEBUG_OUTPUT_RESULT_LIST_WITH_COMMENT(
+        "(before processing)"
+        );
+
+    ARNRAYCASTER_VOLUME_MATERIAL_REF(rayCaster) = ARNODEREF_NONE;
+    ARNRAYCASTER_SURFACE_MATERIAL_REF(rayCaster)  = ARNODEREF_NONE;
+    ARNRAYCASTER_TRAFO_REF(rayCaster)    = ARNODEREF_NONE;
+    ARNRAYCASTER_WORLD(rayCaster)        = NULL;
+
+    [ self _setWorldVolumeMaterial
+        :   intersectionList
+        ];
 
     INTERSECTION_TEST_DEBUG_OUTPUT_RESULT_LIST_WITH_COMMENT(
         "(after processing)"
         );
 }
 
+- (BOOL) tracesRayPackets
+{
+    return
+           [ SUBNODE conformsToProtocol: ARPROTOCOL(ArpRayPacketCasting) ]
+        && [ (ArNode <ArpRayPacketCasting> *) SUBNODE tracesRayPackets ];
+}
+
+- (void) getIntersectionLists
+        : (ArnRayCaster *) rayCaster
+        : (const Ray3D *) rays
+        : (unsigned int) numberOfRays
+        : (unsigned int) activeMask
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionLists
+{
+    CREATE_WEAK_OBJECT_REF(
+        DEFAULT_VOLUME_MATERIAL,
+        ARNRAYCASTER_VOLUME_MATERIAL_REF(rayCaster)
+        );
+
+    CREATE_WEAK_OBJECT_REF(
+        DEFAULT_SURFACE_MATERIAL,
+        ARNRAYCASTER_SURFACE_MATERIAL_REF(rayCaster)
+        );
+
+    ARNRAYCASTER_TRAFO_REF(rayCaster) = ARNODEREF_NONE;
+    ARNRAYCASTER_WORLD(rayCaster) = self;
+
+    if ( [ SUBNODE conformsToProtocol: ARPROTOCOL(ArpRayPacketCasting) ] )
+    {
+        [ (ArNode <ArpRayPacketCasting> *) SUBNODE getIntersectionLists
+            :   rayCaster
+            :   rays
+            :   numberOfRays
+            :   activeMask
+            :   range_of_t
+            :   intersectionLists
+            ];
+    }
+    else
+    {
+        for ( unsigned int i = 0; i < numberOfRays; i++ )
+        {
+            if ( ! ( activeMask & ( 1U << i ) ) )
+                continue;
+
+            arnraycaster_select_packet_ray( rayCaster, i, & rays[i] );
+
+            [ SUBNODE getIntersectionList
+                :   rayCaster
+                :   range_of_t
+                : & intersectionLists[i]
+                ];
+        }
+    }
+
+    ARNRAYCASTER_VOLUME_MATERIAL_REF(rayCaster) = ARNODEREF_NONE;
+    ARNRAYCASTER_SURFACE_MATERIAL_REF(rayCaster)  = ARNODEREF_NONE;
+    ARNRAYCASTER_TRAFO_REF(rayCaster)    = ARNODEREF_NONE;
+    ARNRAYCASTER_WORLD(rayCaster)        = NULL;
+
+    for ( unsigned int i = 0; i < numberOfRays; i++ )
+    {
+        if ( activeMask & ( 1U << i ) )
+            [ self _setWorldVolumeMaterial
+                : & intersectionLists[i]
+                ];
+    }
+}
+
 @end
 
 // ===========================================================================
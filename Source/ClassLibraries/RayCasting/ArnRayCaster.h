@@ -48,6 +48,35 @@ typedef struct ArHashedMailboxEntry
 }
 ArHashedMailboxEntry;
 
+/* ---------------------------------------------------------------------------
+    'ArRayCastingStatistics'
+        Counters for the runtime ray casting statistics. Each ray caster
+        keeps its own set, so no locking is needed while rendering; they
+        are only merged into the global totals once the ray caster is
+        done. The per shape class test and hit counts are kept in the
+        testCountArray and hitCountArray of the ray caster.
+
+        Collection is switched on with
+        'arnraycaster_set_collect_statistics()', and costs one test per
+        counter if switched off. The three ray counts are the exception:
+        they are always kept, as a running render reports its ray rates
+        from them (see 'arnraycaster_ray_counts()').
+--------------------------------------------------------------------------- */
+
+typedef struct ArRayCastingStatistics
+{
+    unsigned long  firstHitRays;
+    unsigned long  anyHitRays;
+    unsigned long  packetRays;
+    unsigned long  nodesVisited;
+    unsigned long  primitivesTested;
+    unsigned long  mailboxHits;
+}
+ArRayCastingStatistics;
+
+#define ARRAYCASTINGSTATISTICS_EMPTY \
+    ((ArRayCastingStatistics){0,0,0,0,0,0})
+
 @protocol ArpRayCaster;
 
 @interface ArnRayCaster
@@ -71,6 +100,9 @@ ArHashedMailboxEntry;
     ArLongArray              testCountArray;
     ArLongArray              hitCountArray;
 
+    BOOL                     collectStatistics;
+    ArRayCastingStatistics   statistics;
+
     unsigned int             options;
 
     ArcFreelist            * rayIntersectionFreelist;
@@ -82,6 +114,17 @@ ArHashedMailboxEntry;
     id <ArpRandomGenerator>  randomGenerator;
 
     BOOL                   * activeNodes;
+
+    //   Only set while an any-hit query is running: intersections with
+    //   a t inside the occlusion range end the query.
+
+    BOOL                     occlusionTest;
+    Range                    occlusionTestRange;
+
+    //   Only set while a packet of rays is traced: the worldspace rays
+    //   of the packet lanes.
+
+    const Ray3D            * packetWorldRays;
 }
 
 - (id) init
@@ -112,6 +155,122 @@ ArHashedMailboxEntry;
 
 @end
 
+/* ---------------------------------------------------------------------------
+ 'arnraycaster_intersectionlist_contains_occluder'
+ For use by the ray casting acceleration structures: while the ray
+ caster performs an any-hit query, this checks whether the list contains
+ an intersection that ends the query, so that traversal can stop.
+ Always NO outside such queries.
+ --------------------------------------------------------------------------- */
+
+BOOL arnraycaster_intersectionlist_contains_occluder(
+              ArnRayCaster               * rayCaster,
+        const struct ArIntersectionList  * intersectionList
+        );
+
+/* ---------------------------------------------------------------------------
+ 'arnraycaster_select_packet_ray'
+ While a packet of rays is traced, this switches the ray caster to the
+ given lane of the packet: the worldspace ray is set to that of the
+ lane, and the objectspace ray to the given ray, which has to be the
+ ray of the lane in the coordinate system of the calling node. After
+ this, the normal single ray intersection code can be used.
+ --------------------------------------------------------------------------- */
+
+void arnraycaster_select_packet_ray(
+              ArnRayCaster  * rayCaster,
+              unsigned int    lane,
+        const Ray3D         * objectspaceRay
+        );
+
+/* ---------------------------------------------------------------------------
+    'arnraycaster_set_collect_statistics'
+    'arnraycaster_set_statistics_json_file_name'
+        Switch on the runtime ray casting statistics for all ray casters
+        that are prepared afterwards, and optionally name a file the
+        totals are written to as JSON by
+        'arnraycaster_report_statistics()'.
+
+    'arnraycaster_report_statistics'
+        Prints the totals of all ray casters that have been cleaned up so
+        far, and writes the JSON file if one was named. Does nothing if
+        the statistics were not switched on.
+--------------------------------------------------------------------------- */
+
+void arnraycaster_set_collect_statistics(
+        ART_GV  * art_gv,
+        BOOL      collectStatistics
+        );
+
+BOOL arnraycaster_collect_statistics(
+        ART_GV  * art_gv
+        );
+
+void arnraycaster_set_statistics_json_file_name(
+              ART_GV  * art_gv,
+        const char    * jsonFileName
+        );
+
+void arnraycaster_report_statistics(
+        ART_GV                    * art_gv,
+        ArcObject <ArpReporter>   * reporter
+        );
+
+/* ---------------------------------------------------------------------------
+    'arnraycaster_ray_counts'
+        The first hit, any hit and packet ray counts of a ray caster since
+        it was prepared for ray casting; all other counters of the result
+        are zero. Safe to call from any thread while the ray caster is in
+        use, and needs no locking.
+--------------------------------------------------------------------------- */
+
+ArRayCastingStatistics arnraycaster_ray_counts(
+        ArnRayCaster  * rayCaster
+        );
+
+#define ARNRAYCASTER_COLLECT_STATISTICS(_rc)    ((_rc)->collectStatistics)
+
+#define ARNRAYCASTER_COUNT(_rc,_counter) \
+do { \
+    if ( ARNRAYCASTER_COLLECT_STATISTICS(_rc) ) \
+        (_rc)->statistics._counter++; \
+} while (0)
+
+#define ARNRAYCASTER_COUNT_N(_rc,_counter,_n) \
+do { \
+    if ( ARNRAYCASTER_COLLECT_STATISTICS(_rc) ) \
+        (_rc)->statistics._counter += (_n); \
+} while (0)
+
+//   Ray counts are only ever written by the thread that owns the ray
+//   caster, but may be read by others at any time: the relaxed atomic
+//   accesses keep the reads untorn, and compile to a plain increment.
+
+#define ARNRAYCASTER_COUNT_RAYS(_rc,_counter,_n) \
+    __atomic_store_n( \
+        & (_rc)->statistics._counter, \
+          __atomic_load_n( & (_rc)->statistics._counter, __ATOMIC_RELAXED ) \
+        + (_n), \
+        __ATOMIC_RELAXED \
+        )
+
+//   Primitive tests are also counted per class of the tested shape;
+//   '_hit' is whether the test yielded any intersections.
+
+#define ARNRAYCASTER_COUNT_PRIMITIVE_TEST(_rc,_classNumber,_hit) \
+do { \
+    if ( ARNRAYCASTER_COLLECT_STATISTICS(_rc) ) \
+    { \
+        (_rc)->statistics.primitivesTested++; \
+        ARARRAY_I((_rc)->testCountArray,(_classNumber))++; \
+        if ( _hit ) \
+            ARARRAY_I((_rc)->hitCountArray,(_classNumber))++; \
+    } \
+} while (0)
+
+#define ARNRAYCASTER_OCCLUSION_TEST(_rc)        ((_rc)->occlusionTest)
+#define ARNRAYCASTER_OCCLUSION_TEST_RANGE(_rc)  ((_rc)->occlusionTestRange)
+
 #define ARNRAYCASTER_TRAVERSED_BSPS(_rc)    ((_rc)->traversed_BSPs)
 
 #define ARNRAYCASTER_MAILBOX(_rc)           ((_rc)->mailbox)
@@ -27,14 +27,288 @@
 #define ART_MODULE_NAME     ArnRayCaster
 
 #import "ArnRayCaster.h"
+#import "ArnInfSphere.h"
+
+//   Runtime ray casting statistics: whether they are collected, and
+//   the totals of all ray casters that have been cleaned up so far.
+//   The per class arrays are only allocated once the first ray caster
+//   reports, since the table of node classes is still being filled
+//   while the modules are initialised.
+
+typedef struct ArnRayCaster_GV
+{
+    BOOL                     collectStatistics;
+    char                   * jsonFileName;
+    pthread_mutex_t          mutex;
+    unsigned long            numberOfRayCasters;
+    ArRayCastingStatistics   statistics;
+    unsigned long            numberOfClasses;
+    unsigned long          * classTestCount;
+    unsigned long          * classHitCount;
+}
+ArnRayCaster_GV;
+
+#define ARNRAYCASTER_GV         art_gv->arnraycaster_gv
+#define STATISTICS_MUTEX        ARNRAYCASTER_GV->mutex
 
 ART_MODULE_INITIALISATION_FUNCTION
 (
-    (void) art_gv;
     [ ArnRayCaster registerWithRuntime ];
+
+    ARNRAYCASTER_GV = ALLOC(ArnRayCaster_GV);
+
+    ARNRAYCASTER_GV->collectStatistics = NO;
+    ARNRAYCASTER_GV->jsonFileName = NULL;
+    ARNRAYCASTER_GV->numberOfRayCasters = 0;
+    ARNRAYCASTER_GV->statistics = ARRAYCASTINGSTATISTICS_EMPTY;
+    ARNRAYCASTER_GV->numberOfClasses = 0;
+    ARNRAYCASTER_GV->classTestCount = NULL;
+    ARNRAYCASTER_GV->classHitCount = NULL;
+
+    pthread_mutex_init( & STATISTICS_MUTEX, NULL );
+)
+
+ART_MODULE_SHUTDOWN_FUNCTION
+(
+    pthread_mutex_destroy( & STATISTICS_MUTEX );
+
+    if ( ARNRAYCASTER_GV->jsonFileName )
+        FREE_ARRAY( ARNRAYCASTER_GV->jsonFileName );
+
+    if ( ARNRAYCASTER_GV->classTestCount )
+    {
+        FREE_ARRAY( ARNRAYCASTER_GV->classTestCount );
+        FREE_ARRAY( ARNRAYCASTER_GV->classHitCount );
+    }
+
+    FREE( ARNRAYCASTER_GV );
 )
 
-ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
+void arnraycaster_set_collect_statistics(
+        ART_GV  * art_gv,
+        BOOL      collectStatistics
+        )
+{
+    ARNRAYCASTER_GV->collectStatistics = collectStatistics;
+}
+
+BOOL arnraycaster_collect_statistics(
+        ART_GV  * art_gv
+        )
+{
+    return ARNRAYCASTER_GV->collectStatistics;
+}
+
+void arnraycaster_set_statistics_json_file_name(
+              ART_GV  * art_gv,
+        const char    * jsonFileName
+        )
+{
+    if ( ARNRAYCASTER_GV->jsonFileName )
+        FREE_ARRAY( ARNRAYCASTER_GV->jsonFileName );
+
+    ARNRAYCASTER_GV->jsonFileName = NULL;
+
+    if ( jsonFileName )
+        arstring_s_copy_s( jsonFileName, & ARNRAYCASTER_GV->jsonFileName );
+}
+
+//   Adds the counters of one ray caster to the global totals.
+
+static void arnraycaster_merge_statistics(
+              ART_GV                  * art_gv,
+        const ArRayCastingStatistics  * statistics,
+        const ArLongArray             * testCountArray,
+        const ArLongArray             * hitCountArray
+        )
+{
+    pthread_mutex_lock( & STATISTICS_MUTEX );
+
+    ArRayCastingStatistics  * total = & ARNRAYCASTER_GV->statistics;
+
+    total->firstHitRays     += statistics->firstHitRays;
+    total->anyHitRays       += statistics->anyHitRays;
+    total->packetRays       += statistics->packetRays;
+    total->nodesVisited     += statistics->nodesVisited;
+    total->primitivesTested += statistics->primitivesTested;
+    total->mailboxHits      += statistics->mailboxHits;
+
+    ARNRAYCASTER_GV->numberOfRayCasters++;
+
+    if ( ! ARNRAYCASTER_GV->classTestCount )
+    {
+        ARNRAYCASTER_GV->numberOfClasses = ARARRAY_SIZE(*testCountArray);
+
+        ARNRAYCASTER_GV->classTestCount =
+            ALLOC_ARRAY_ZERO( unsigned long, ARNRAYCASTER_GV->numberOfClasses );
+        ARNRAYCASTER_GV->classHitCount =
+            ALLOC_ARRAY_ZERO( unsigned long, ARNRAYCASTER_GV->numberOfClasses );
+    }
+
+    for ( unsigned long i = 0; i < ARNRAYCASTER_GV->numberOfClasses; i++ )
+    {
+        ARNRAYCASTER_GV->classTestCount[i] += ARARRAY_I(*testCountArray, i);
+        ARNRAYCASTER_GV->classHitCount[i]  += ARARRAY_I(*hitCountArray, i);
+    }
+
+    pthread_mutex_unlock( & STATISTICS_MUTEX );
+}
+
+static void arnraycaster_write_statistics_json(
+              ART_GV                  * art_gv,
+        const ArRayCastingStatistics  * total
+        )
+{
+    FILE  * jsonFile = fopen( ARNRAYCASTER_GV->jsonFileName, "w" );
+
+    if ( ! jsonFile )
+    {
+        ART_ERRORHANDLING_WARNING(
+            "Could not write ray casting statistics to file %s",
+            ARNRAYCASTER_GV->jsonFileName
+            );
+
+        return;
+    }
+
+    fprintf( jsonFile, "{\n" );
+    fprintf( jsonFile, "  \"rayCasters\": %lu,\n",
+             ARNRAYCASTER_GV->numberOfRayCasters );
+    fprintf( jsonFile, "  \"rays\": {\n" );
+    fprintf( jsonFile, "    \"firstHit\": %lu,\n", total->firstHitRays );
+    fprintf( jsonFile, "    \"anyHit\": %lu,\n", total->anyHitRays );
+    fprintf( jsonFile, "    \"packet\": %lu\n", total->packetRays );
+    fprintf( jsonFile, "  },\n" );
+    fprintf( jsonFile, "  \"nodesVisited\": %lu,\n", total->nodesVisited );
+    fprintf( jsonFile, "  \"primitivesTested\": %lu,\n",
+             total->primitivesTested );
+    fprintf( jsonFile, "  \"mailboxHits\": %lu,\n", total->mailboxHits );
+    fprintf( jsonFile, "  \"shapeClasses\": [" );
+
+    BOOL  first = YES;
+
+    for ( unsigned long i = 0; i < ARNRAYCASTER_GV->numberOfClasses; i++ )
+    {
+        if ( ! ARNRAYCASTER_GV->classTestCount[i] )
+            continue;
+
+        fprintf(
+            jsonFile,
+            "%s\n    { \"class\": \"%s\", \"tests\": %lu, \"hits\": %lu }",
+            first ? "" : ",",
+            CLASS_NAME_OF_CONCRETE_CLASS_I(i),
+            ARNRAYCASTER_GV->classTestCount[i],
+            ARNRAYCASTER_GV->classHitCount[i]
+            );
+
+        first = NO;
+    }
+
+    fprintf( jsonFile, "\n  ]\n}\n" );
+
+    fclose( jsonFile );
+}
+
+void arnraycaster_report_statistics(
+        ART_GV                    * art_gv,
+        ArcObject <ArpReporter>   * reporter
+        )
+{
+    if ( ! ARNRAYCASTER_GV->collectStatistics )
+        return;
+
+    pthread_mutex_lock( & STATISTICS_MUTEX );
+
+    ArRayCastingStatistics  total = ARNRAYCASTER_GV->statistics;
+
+    unsigned long  numberOfRays =
+        total.firstHitRays + total.anyHitRays + total.packetRays;
+
+    [ reporter beginSecondaryAction
+        :   "ray casting statistics"
+        ];
+
+    [ reporter printf
+        :   "Rays cast             : %lu\n"
+        ,   numberOfRays
+        ];
+    [ reporter printf
+        :   "  first hit           : %lu\n"
+        ,   total.firstHitRays
+        ];
+    [ reporter printf
+        :   "  any hit (shadow)    : %lu\n"
+        ,   total.anyHitRays
+        ];
+    [ reporter printf
+        :   "  in packets          : %lu\n"
+        ,   total.packetRays
+        ];
+    [ reporter printf
+        :   "Nodes visited         : %lu (%.2f per ray)\n"
+        ,   total.nodesVisited
+        ,   numberOfRays ? total.nodesVisited / (double) numberOfRays : 0.0
+        ];
+    [ reporter printf
+        :   "Primitives tested     : %lu (%.2f per ray)\n"
+        ,   total.primitivesTested
+        ,   numberOfRays ? total.primitivesTested / (double) numberOfRays : 0.0
+        ];
+    [ reporter printf
+        :   "Mailbox hits          : %lu\n"
+        ,   total.mailboxHits
+        ];
+
+    if ( total.primitivesTested )
+    {
+        [ reporter printf:
+            "\n"
+            "                      "
+            "          tests            hits       %%\n"];
+
+        for ( unsigned long i = 0; i < ARNRAYCASTER_GV->numberOfClasses; i++ )
+        {
+            if ( ARNRAYCASTER_GV->classTestCount[i] )
+            {
+                double  percent =
+                      100.0
+                    *   ARNRAYCASTER_GV->classHitCount[i]
+                      / (double) ARNRAYCASTER_GV->classTestCount[i];
+
+                [ reporter printf
+                    :   "%-20s : %15lu %15lu  %6.2f\n"
+                    ,   CLASS_NAME_OF_CONCRETE_CLASS_I(i)
+                    ,   ARNRAYCASTER_GV->classTestCount[i]
+                    ,   ARNRAYCASTER_GV->classHitCount[i]
+                    ,   percent
+                    ];
+            }
+        }
+    }
+
+    [ reporter endAction ];
+
+    if ( ARNRAYCASTER_GV->jsonFileName )
+        arnraycaster_write_statistics_json( art_gv, & total );
+
+    pthread_mutex_unlock( & STATISTICS_MUTEX );
+}
+
+ArRayCastingStatistics arnraycaster_ray_counts(
+        ArnRayCaster  * rayCaster
+        )
+{
+    ArRayCastingStatistics  counts = ARRAYCASTINGSTATISTICS_EMPTY;
+
+    counts.firstHitRays =
+        __atomic_load_n( & rayCaster->statistics.firstHitRays, __ATOMIC_RELAXED );
+    counts.anyHitRays =
+        __atomic_load_n( & rayCaster->statistics.anyHitRays, __ATOMIC_RELAXED );
+    counts.packetRays =
+        __atomic_load_n( & rayCaster->statistics.packetRays, __ATOMIC_RELAXED );
+
+    return counts;
+}
 
 
 void releaseAllIntersectionsAfterFirst(
@@ -61,6 +335,58 @@ void releaseAllIntersectionsAfterFirst(
     intersectionToKeep->next = 0;
 }
 
+BOOL arnraycaster_intersectionlist_contains_occluder(
+              ArnRayCaster               * rayCaster,
+        const struct ArIntersectionList  * intersectionList
+        )
+{
+    if ( ! ARNRAYCASTER_OCCLUSION_TEST(rayCaster) )
+        return NO;
+
+    ArcIntersection  * intersection =
+        ARINTERSECTIONLIST_HEAD(*intersectionList);
+
+    while ( intersection )
+    {
+        double  t = ARCINTERSECTION_T(intersection);
+
+        //   The list is sorted by t, so there is no point in looking
+        //   beyond the end of the range.
+
+        if ( t >= RANGE_MAX(ARNRAYCASTER_OCCLUSION_TEST_RANGE(rayCaster)) )
+            return NO;
+
+        if (   t >= RANGE_MIN(ARNRAYCASTER_OCCLUSION_TEST_RANGE(rayCaster))
+            && ! [ ARCINTERSECTION_SHAPE(intersection) isMemberOfClass
+                     :   [ ArnInfSphere class ]
+                     ] )
+            return YES;
+
+        intersection = ARCINTERSECTION_NEXT(intersection);
+    }
+
+    return NO;
+}
+
+void arnraycaster_select_packet_ray(
+              ArnRayCaster  * rayCaster,
+              unsigned int    lane,
+        const Ray3D         * objectspaceRay
+        )
+{
+    //   A new ray ID, so that the mailboxes of a BSP tree traversed for
+    //   this lane do not carry over from another lane.
+
+    ARNRAYCASTER_RAY_ID(rayCaster)++;
+
+    ARNRAYCASTER_WORLDSPACE_RAY(rayCaster) = rayCaster->packetWorldRays[lane];
+
+    ray3de_init(
+          objectspaceRay,
+        & ARNRAYCASTER_OBJECTSPACE_RAY3DE(rayCaster)
+        );
+}
+
 @implementation ArnRayCaster
 
 ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnRayCaster)
@@ -89,6 +415,13 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnRayCaster)
     randomGenerator = nil;
 
     activeNodes = NULL;
+
+    occlusionTest = NO;
+
+    packetWorldRays = NULL;
+
+    collectStatistics = NO;
+    statistics = ARRAYCASTINGSTATISTICS_EMPTY;
 }
 
 - (id) init
@@ -385,43 +718,22 @@ THIS ONLY HAS TO BE RE-ACTIVATED IF AND WHEN THE REFERENCE CACHE IS ADDED BACK
     return 0;
 }
 
-- (ArcIntersection *) firstRayObjectIntersection
-        : (ArNode <ArpRayCasting> *) geometryToIntersectRayWith
+//   Extracts the first intersection from a complete intersection list,
+//   and releases all others.
+
+- (ArcIntersection *) _firstIntersection
         : (const ArcPointContext *) startingPoint_worldCoordinates
-        : (const Ray3D *) ray_worldCoordinates
-        : (const double) range_end_t
+        : (ArIntersectionList *) intersectionList
 {
-
-    rayID++;
-
-    Range  range = RANGE( 0.0, range_end_t );
-
-    intersection_test_world_ray3d = *ray_worldCoordinates;
-
-    ray3de_init(
-        & intersection_test_world_ray3d,
-        & intersection_test_ray3de
-        );
-
-    intersection_test_origin = startingPoint_worldCoordinates;
-
-    ArIntersectionList  intersectionList = ARINTERSECTIONLIST_EMPTY;
-
-    [ geometryToIntersectRayWith getIntersectionList
-        :   self
-        :   range
-        : & intersectionList
-        ];
-
-    if ( ! ARINTERSECTIONLIST_HEAD(intersectionList) )
+    if ( ! ARINTERSECTIONLIST_HEAD(*intersectionList) )
         return 0;
 
     ArcIntersection  * intersection =
-        ARINTERSECTIONLIST_HEAD(intersectionList);
+        ARINTERSECTIONLIST_HEAD(*intersectionList);
 
 #ifdef WITH_RSA_STATISTICS
-    intersection->intersectionTests = intersectionList.intersectionTests;
-    intersection->traversalSteps = intersectionList.traversalSteps;
+    intersection->intersectionTests = intersectionList->intersectionTests;
+    intersection->traversalSteps = intersectionList->traversalSteps;
 #endif
 
     // skip close intersections only if we are actually starting at a surface point
@@ -446,7 +758,7 @@ THIS ONLY HAS TO BE RE-ACTIVATED IF AND WHEN THE REFERENCE CACHE IS ADDED BACK
 
     if (   intersection
         &&    intersection
-           != ARINTERSECTIONLIST_TAIL(intersectionList) )
+           != ARINTERSECTIONLIST_TAIL(*intersectionList) )
     {
         releaseAllIntersectionsAfterFirst(
             intersection,
@@ -457,6 +769,164 @@ THIS ONLY HAS TO BE RE-ACTIVATED IF AND WHEN THE REFERENCE CACHE IS ADDED BACK
     return intersection;
 }
 
+- (ArcIntersection *) firstRayObjectIntersection
+        : (ArNode <ArpRayCasting> *) geometryToIntersectRayWith
+        : (const ArcPointContext *) startingPoint_worldCoordinates
+        : (const Ray3D *) ray_worldCoordinates
+        : (const double) range_end_t
+{
+    ARNRAYCASTER_COUNT_RAYS( self, firstHitRays, 1 );
+
+    rayID++;
+
+    Range  range = RANGE( 0.0, range_end_t );
+
+    intersection_test_world_ray3d = *ray_worldCoordinates;
+
+    ray3de_init(
+        & intersection_test_world_ray3d,
+        & intersection_test_ray3de
+        );
+
+    intersection_test_origin = startingPoint_worldCoordinates;
+
+    ArIntersectionList  intersectionList = ARINTERSECTIONLIST_EMPTY;
+
+    [ geometryToIntersectRayWith getIntersectionList
+        :   self
+        :   range
+        : & intersectionList
+        ];
+
+    return
+        [ self _firstIntersection
+            :   startingPoint_worldCoordinates
+            : & intersectionList
+            ];
+}
+
+- (void) firstRayObjectIntersections
+        : (ArNode <ArpRayCasting> *) geometryToIntersectRayWith
+        : (const ArcPointContext *) startingPoint_worldCoordinates
+        : (const Ray3D *) rays_worldCoordinates
+        : (unsigned int) numberOfRays
+        : (const double) range_end_t
+        : (ArcIntersection **) intersections
+{
+    if ( ! [ geometryToIntersectRayWith conformsToProtocol
+             :   ARPROTOCOL(ArpRayPacketCasting)
+             ] )
+    {
+        for ( unsigned int i = 0; i < numberOfRays; i++ )
+            intersections[i] =
+                [ self firstRayObjectIntersection
+                    :   geometryToIntersectRayWith
+                    :   startingPoint_worldCoordinates
+                    : & rays_worldCoordinates[i]
+                    :   range_end_t
+                    ];
+
+        return;
+    }
+
+    intersection_test_origin = startingPoint_worldCoordinates;
+
+    for ( unsigned int first = 0;
+          first < numberOfRays;
+          first += RAY3DPACKET_MAX_SIZE )
+    {
+        unsigned int  packetSize =
+            M_MIN( numberOfRays - first, RAY3DPACKET_MAX_SIZE );
+
+        packetWorldRays = & rays_worldCoordinates[first];
+
+        ARNRAYCASTER_COUNT_RAYS( self, packetRays, packetSize );
+
+        ArIntersectionList  intersectionList[ RAY3DPACKET_MAX_SIZE ];
+
+        for ( unsigned int i = 0; i < packetSize; i++ )
+            intersectionList[i] = ARINTERSECTIONLIST_EMPTY;
+
+        [ (ArNode <ArpRayPacketCasting> *) geometryToIntersectRayWith
+            getIntersectionLists
+            :   self
+            :   packetWorldRays
+            :   packetSize
+            :   ( 1U << packetSize ) - 1U
+            :   RANGE( 0.0, range_end_t )
+            :   intersectionList
+            ];
+
+        packetWorldRays = NULL;
+
+        for ( unsigned int i = 0; i < packetSize; i++ )
+            intersections[first + i] =
+                [ self _firstIntersection
+                    :   startingPoint_worldCoordinates
+                    : & intersectionList[i]
+                    ];
+    }
+}
+
+- (BOOL) anyRayObjectIntersection
+        : (ArNode <ArpRayCasting> *) geometryToIntersectRayWith
+        : (const ArcPointContext *) startingPoint_worldCoordinates
+        : (const Ray3D *) ray_worldCoordinates
+        : (const double) range_end_t
+{
+    ARNRAYCASTER_COUNT_RAYS( self, anyHitRays, 1 );
+
+    rayID++;
+
+    intersection_test_world_ray3d = *ray_worldCoordinates;
+
+    ray3de_init(
+        & intersection_test_world_ray3d,
+        & intersection_test_ray3de
+        );
+
+    intersection_test_origin = startingPoint_worldCoordinates;
+
+    //   Same treatment of close intersections as in the four parameter
+    //   version of firstRayObjectIntersection.
+
+    double  range_start_t = 0.0;
+
+    if ( [ startingPoint_worldCoordinates isMemberOfClass
+           :   [ ArcSurfacePoint class ]
+           ] )
+        range_start_t = hitEps;
+
+    occlusionTest = YES;
+    occlusionTestRange = RANGE( range_start_t, range_end_t );
+
+    ArIntersectionList  intersectionList = ARINTERSECTIONLIST_EMPTY;
+
+    [ geometryToIntersectRayWith getIntersectionList
+        :   self
+        :   RANGE( 0.0, range_end_t )
+        : & intersectionList
+        ];
+
+    //   Not all parts of the scene graph stop early (e.g. CSG operation
+    //   trees do not), so the list has to be checked in any case.
+
+    BOOL  result =
+        arnraycaster_intersectionlist_contains_occluder(
+              self,
+            & intersectionList
+            );
+
+    occlusionTest = NO;
+
+    arintersectionlist_free_contents(
+        & intersectionList,
+          rayIntersectionFreelist
+        );
+
+    return result;
+}
+
 - (void) prepareForRayCasting
         : (ArNode <ArpWorld> *) geometryToRayCast
         : (const Pnt3D *) eyePoint_worldCoordinates
@@ -466,11 +936,26 @@ THIS ONLY HAS TO BE RE-ACTIVATED IF AND WHEN THE REFERENCE CACHE IS ADDED BACK
         ARARRAY_I(testCountArray, i) = 0;
         ARARRAY_I(hitCountArray, i)  = 0;
     }
+
+    collectStatistics = arnraycaster_collect_statistics( art_gv );
+    statistics = ARRAYCASTINGSTATISTICS_EMPTY;
 }
 
 - (void) cleanupAfterRayCasting
         : (ArNode <ArpWorld> *) geometryToRayCast
 {
+    if ( collectStatistics )
+    {
+        arnraycaster_merge_statistics(
+              art_gv,
+            & statistics,
+            & testCountArray,
+            & hitCountArray
+            );
+
+        collectStatistics = NO;
+    }
+
 /*
     ArLongArray  countArray =
         arlongarray_init( TOTAL_NUMBER_OF_CONCRETE_CLASSES );
@@ -38,37 +38,31 @@ ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
 ARPRAYCASTING_DEFAULT_IMPLEMENTATION(ArnReference)
 
+//   Point queries, and rays that are not handled by a shared bottom level
+//   BVH (see ArnLeafNodeBBoxCollection), are resolved against the named
+//   node itself.
+
+#define REFERENCED_NODE \
+    ( (ArNode <ArpRayCasting> *) \
+      [ ARNGT_RULES(rayCaster) nodeWithName: referencedName ] )
+
 - (ArNode <ArpVolumeMaterial> *) volumeMaterial_at_WorldPnt3D
         : (ArnRayCaster *) rayCaster
 {
-    (void) rayCaster;
-    
-    ART__CODE_IS_WORK_IN_PROGRESS__EXIT_WITH_ERROR
-/*
-    ArNode <ArpVolumeMaterial> * result;
-    rayCaster->state.recursion_level++;
-    result = [ [ rayCaster referencedObjectFor: self ]
-                calculateMaterial :rayCaster];
-    rayCaster->state.recursion_level--;
-    return result;
-*/
-    return 0;
+    return
+        [ REFERENCED_NODE volumeMaterial_at_WorldPnt3D
+            :   rayCaster
+            ];
 }
 
 - (void) getArcSurfacePoint_for_WorldPnt3DE
         : (ArnRayCaster *) rayCaster
         : (ArcSurfacePoint **) surfacePoint
 {
-    (void) rayCaster;
-    (void) surfacePoint;
-    
-    ART__CODE_IS_WORK_IN_PROGRESS__EXIT_WITH_ERROR
-/*
-    rayCaster->state.recursion_level++;
-    [ [ rayCaster referencedObjectFor: self ]
-        calculatePointHit: rayCaster : pointHit ];
-    rayCaster->state.recursion_level--;
-*/
+    [ REFERENCED_NODE getArcSurfacePoint_for_WorldPnt3DE
+        :   rayCaster
+        :   surfacePoint
+        ];
 }
 
 - (void) getIntersectionList
@@ -76,17 +70,11 @@ ARPRAYCASTING_DEFAULT_IMPLEMENTATION(ArnReference)
         : (Range) range_of_t
         : (struct ArIntersectionList *) intersectionList
 {
-    (void) rayCaster;
-    (void) range_of_t;
-    (void) intersectionList;
-    
-    ART__CODE_IS_WORK_IN_PROGRESS__EXIT_WITH_ERROR
-/*
-    rayCaster->state.recursion_level++;
-    [ [ rayCaster referencedObjectFor: self ]
-        rayCast: rayCaster : range : outHitList ];
-    rayCaster->state.recursion_level--;
-*/
+    [ REFERENCED_NODE getIntersectionList
+        :   rayCaster
+        :   range_of_t
+        :   intersectionList
+        ];
 }
 
 @end
@@ -34,48 +34,203 @@ ART_NO_MODULE_INITIALISATION_FUNCTION_NECESSARY
 ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
 
+//   Same slab test as the one used by ArnBVH.
+
+static inline BOOL _meshbvhnode_ray_overlap(
+        const BVHNode  * node,
+        const double   * origin,
+        const double   * invDir,
+        const int      * dirIsNegative,
+              double     tMin,
+              double     tMax
+        )
+{
+    for ( int i = 0; i < 3; i++ )
+    {
+        double  tNear =
+              ( ( dirIsNegative[i] ? node->max[i] : node->min[i] ) - origin[i] )
+            * invDir[i];
+        double  tFar =
+              ( ( dirIsNegative[i] ? node->min[i] : node->max[i] ) - origin[i] )
+            * invDir[i];
+
+        if ( tNear > tMin ) tMin = tNear;
+        if ( tFar  < tMax ) tMax = tFar;
+    }
+
+    return tMin <= tMax;
+}
+
+//   Moeller-Trumbore ray/triangle test. The barycentric coordinates are
+//   returned in the same form as by triangledata_hit, i.e. as the weights
+//   of p1 and p2. The result is 1 for hits on the obverse side (the one
+//   the normal (p1-p0) x (p2-p0) points to), -1 for hits on the reverse
+//   side, and 0 for a miss.
+
+static int _meshface_hit(
+        const Pnt3D   * p0,
+        const Pnt3D   * p1,
+        const Pnt3D   * p2,
+        const Ray3D   * ray,
+        const Range   * range,
+              double  * t,
+              Pnt2D   * crd
+        )
+{
+    Vec3D  edge1, edge2, pVec, tVec, qVec;
+
+    vec3d_pp_sub_v( p1, p0, & edge1 );
+    vec3d_pp_sub_v( p2, p0, & edge2 );
+
+    vec3d_vv_cross_v( & RAY3D_V(*ray), & edge2, & pVec );
+
+    double  det = vec3d_vv_dot( & edge1, & pVec );
+
+    //   Ray parallel to the plane of the face
+
+    if ( det == 0.0 )
+        return 0;
+
+    double  invDet = 1.0 / det;
+
+    vec3d_pp_sub_v( & RAY3D_P(*ray), p0, & tVec );
+
+    double  u = vec3d_vv_dot( & tVec, & pVec ) * invDet;
+
+    if ( u < 0.0 || u > 1.0 )
+        return 0;
+
+    vec3d_vv_cross_v( & tVec, & edge1, & qVec );
+
+    double  v = vec3d_vv_dot( & RAY3D_V(*ray), & qVec ) * invDet;
+
+    if ( v < 0.0 || u + v > 1.0 )
+        return 0;
+
+    *t = vec3d_vv_dot( & edge2, & qVec ) * invDet;
+
+    if ( *t >= RANGE_MAX(*range) || *t < RANGE_MIN(*range) )
+        return 0;
+
+    *crd = PNT2D( u, v );
+
+    //   det is the negated dot product of the ray direction and the
+    //   face normal.
+
+    return ( det > 0.0 ? 1 : -1 );
+}
+
 @implementation ArnTriangleMesh ( RayCasting )
 
 ARPRAYCASTING_DEFAULT_IMPLEMENTATION(ArnTriangleMesh)
+ARPRAYCASTING_SINGULAR_SHAPE_IMPLEMENTATION
 
 - (ArNode <ArpVolumeMaterial> *) volumeMaterial_at_WorldPnt3D
         : (ArnRayCaster *) rayCaster
 {
-    if ( [ internalMeshTree conformsToProtocol: @protocol(ArpRayCasting) ] ) {
-        return [ (ArNode <ArpRayCasting> *) internalMeshTree  volumeMaterial_at_WorldPnt3D :rayCaster ];
-    }
-    
     return 0;
 }
 
-- (void) getArcSurfacePoint_for_WorldPnt3DE
+- (void) _addFaceIntersection
         : (ArnRayCaster *) rayCaster
-        : (ArcSurfacePoint **) surfacePoint
+        : (long) bvhFace
+        : (double) t
+        : (int) side
+        : (Pnt2D *) crd
+        : (struct ArIntersectionList *) intersectionList
 {
-    [(id <ArpRayCasting>) internalMeshTree
-        getArcSurfacePoint_for_WorldPnt3DE
-        :   rayCaster
-        :   surfacePoint
-        ];
+    ArFaceOnShapeType  face_type =
+        ( side > 0
+          ?
+          arface_on_shape_obverse | arface_on_shape_is_planar
+          :
+          arface_on_shape_reverse | arface_on_shape_is_planar
+        );
+
+    //   The face index is kept in the intersection, so that the face
+    //   normal can be computed later on if it is needed.
+
+    ArIntersectionList  faceList = ARINTERSECTIONLIST_EMPTY;
+
+    arintersectionlist_init_1(
+        & faceList,
+          t,
+          ARNTRIANGLEMESH_BVH_FACE_INDEX(bvhFace),
+          face_type,
+          self,
+          rayCaster
+        );
+
+    ArcIntersection  * intersection =
+        INTERSECTIONLIST_HEAD(faceList);
+
+    Pnt3D  localPoint;
+
+    pnt3d_dr_eval_p(
+          t,
+        & OBJECTSPACE_RAY,
+        & localPoint
+        );
+
+    SET_OBJECTSPACE_POINT(intersection, localPoint);
+
+    const FVec3D  * normal_array =
+        [ ARNRAYCASTER_VERTICES(rayCaster) normalArray ];
+
+    if ( normal_array )
+    {
+        double  v = XC(*crd);
+        double  w = YC(*crd);
+        double  u = 1. - v - w;
+
+        Vec3D  n0, n1, n2;
+
+        vec3d_fv_to_v(
+            & normal_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(bvhFace,0) ],
+            & n0
+            );
+        vec3d_fv_to_v(
+            & normal_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(bvhFace,1) ],
+            & n1
+            );
+        vec3d_fv_to_v(
+            & normal_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(bvhFace,2) ],
+            & n2
+            );
+
+        SET_OBJECTSPACE_NORMAL(
+            intersection,
+            VEC3D(
+                u * XC(n0) + v * XC(n1) + w * XC(n2),
+                u * YC(n0) + v * YC(n1) + w * YC(n2),
+                u * ZC(n0) + v * ZC(n1) + w * ZC(n2)
+                )
+            );
+    }
+
+    TEXTURE_COORDS(intersection) = *crd;
+    FLAG_TEXTURE_COORDS_AS_VALID(intersection);
+
+    if ( ARINTERSECTIONLIST_HEAD(*intersectionList) )
+    {
+        arintersectionlist_or(
+              intersectionList,
+            & faceList,
+              intersectionList,
+              ARNRAYCASTER_INTERSECTION_FREELIST(rayCaster),
+              ARNRAYCASTER_EPSILON(rayCaster)
+            );
+    }
+    else
+    {
+        *intersectionList = faceList;
+    }
 }
 
-- (void) getIntersectionList
+- (void) _pairSolidMeshIntersections
         : (ArnRayCaster *) rayCaster
-        : (Range) range_of_t
         : (struct ArIntersectionList *) intersectionList
 {
-    [ (id <ArpRayCasting>) internalMeshTree
-        getIntersectionList
-        :   rayCaster
-        :   range_of_t
-        :   intersectionList
-        ];
-
-    //If the triangle mesh is declared as singular there is nothing else to do, since the
-    //triangles do return their intersections as singular shapes.
-    
-    if( shapeGeometry & arshape_singular) return;
-
     //For solid triangle mesh the intersection list needs to be processed.
     //The basic idea is that intersections are considered in pairs. The first in the
     //pair is the entering hit, the second is the exiting hit. There are two possibilities
@@ -156,6 +311,422 @@ ARPRAYCASTING_DEFAULT_IMPLEMENTATION(ArnTriangleMesh)
     *intersectionList = resultingList;
 }
 
+- (void) getIntersectionList
+        : (ArnRayCaster *) rayCaster
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionList
+{
+    *intersectionList = ARINTERSECTIONLIST_EMPTY;
+
+    if ( ! faceBVHNodes )
+        return;
+
+    //   The mesh BVH lives in object space, so it is traversed with the
+    //   object space ray. Just like the BSP tree the faces used to be
+    //   stored in, it returns all hits along the ray, since solid meshes
+    //   have to pair them up below.
+
+    const Pnt3D  * point_array =
+        [ ARNRAYCASTER_VERTICES(rayCaster) pointArray ];
+
+    double  origin[3];
+    double  invDir[3];
+    int     dirIsNegative[3];
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        origin[i]        = RAY3D_PI( OBJECTSPACE_RAY, i );
+        invDir[i]        = 1.0 / RAY3D_VI( OBJECTSPACE_RAY, i );
+        dirIsNegative[i] = signbit( invDir[i] ) ? 1 : 0;
+    }
+
+    double  tMin = RANGE_MIN(range_of_t);
+    double  tMax = RANGE_MAX(range_of_t);
+
+    long  bvhStack[ BVH_MAX_TREE_DEPTH ];
+    int   bvhStackPtr = -1;
+
+    long  nodeIndex = 0;
+
+    if ( ! _meshbvhnode_ray_overlap(
+               & faceBVHNodes[0], origin, invDir, dirIsNegative, tMin, tMax ) )
+        return;
+
+    while ( 1 )
+    {
+        BVHNode  * node = & faceBVHNodes[nodeIndex];
+
+        ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
+
+        if ( BVH_NODE_IS_INNER(*node) )
+        {
+            long  nearChild = nodeIndex + 1;
+            long  farChild  = BVH_NODE_SECOND_CHILD(*node);
+
+            if ( dirIsNegative[ BVH_NODE_SPLIT_AXIS(*node) ] )
+            {
+                long  temp = nearChild;
+                nearChild  = farChild;
+                farChild   = temp;
+            }
+
+            BOOL  hitNear =
+                _meshbvhnode_ray_overlap(
+                    & faceBVHNodes[nearChild],
+                      origin, invDir, dirIsNegative, tMin, tMax
+                    );
+            BOOL  hitFar =
+                _meshbvhnode_ray_overlap(
+                    & faceBVHNodes[farChild],
+                      origin, invDir, dirIsNegative, tMin, tMax
+                    );
+
+            if ( hitNear && hitFar )
+            {
+                bvhStack[ ++bvhStackPtr ] = farChild;
+                nodeIndex = nearChild;
+                continue;
+            }
+
+            if ( hitNear )
+            {
+                nodeIndex = nearChild;
+                continue;
+            }
+
+            if ( hitFar )
+            {
+                nodeIndex = farChild;
+                continue;
+            }
+        }
+        else
+        {
+            long  first = BVH_NODE_PRIMITIVE_OFFSET(*node);
+            long  count = BVH_NODE_PRIMITIVE_COUNT(*node);
+
+            for ( long i = first; i < first + count; i++ )
+            {
+                double  t;
+                Pnt2D   crd;
+
+                int  side =
+                    _meshface_hit(
+                        & point_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(i,0) ],
+                        & point_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(i,1) ],
+                        & point_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(i,2) ],
+                        & OBJECTSPACE_RAY,
+                        & range_of_t,
+                        & t,
+                        & crd
+                        );
+
+                //   Each face test is counted as a test of the mesh
+                //   class, just like the test of the mesh as a whole
+                //   in the BVH it is part of.
+
+                ARNRAYCASTER_COUNT_PRIMITIVE_TEST(
+                    rayCaster,
+                    [ self globalClassNumber ],
+                    side
+                    );
+
+                if ( side )
+                {
+                    [ self _addFaceIntersection
+                        :   rayCaster
+                        :   i
+                        :   t
+                        :   side
+                        : & crd
+                        :   intersectionList
+                        ];
+
+                    //   For any-hit queries, one face inside the range is
+                    //   enough; the remaining faces, and the pairing of
+                    //   the hits of solid meshes, can be skipped.
+
+                    if (   ARNRAYCASTER_OCCLUSION_TEST(rayCaster)
+                        &&    t
+                           >= RANGE_MIN(ARNRAYCASTER_OCCLUSION_TEST_RANGE(rayCaster))
+                        &&    t
+                           <  RANGE_MAX(ARNRAYCASTER_OCCLUSION_TEST_RANGE(rayCaster)) )
+                        return;
+                }
+            }
+        }
+
+        if ( bvhStackPtr == -1 )
+            break;
+
+        nodeIndex = bvhStack[ bvhStackPtr-- ];
+    }
+
+    //If the triangle mesh is declared as singular there is nothing else to do, since the
+    //faces do return their intersections as singular shapes.
+    
+    if( shapeGeometry & arshape_singular) return;
+
+    [ self _pairSolidMeshIntersections
+        :   rayCaster
+        :   intersectionList
+        ];
+}
+
+- (BOOL) tracesRayPackets
+{
+    return ( faceBVHNodes != NULL );
+}
+
+//   Packet version: the mesh BVH is traversed by all rays that reached
+//   the mesh together, and each face is tested against all of them with
+//   one call of the packet ray/triangle kernel.
+
+- (void) getIntersectionLists
+        : (ArnRayCaster *) rayCaster
+        : (const Ray3D *) rays
+        : (unsigned int) numberOfRays
+        : (unsigned int) activeMask
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionLists
+{
+    Ray3DPacket  packet;
+
+    if (   ! faceBVHNodes
+        || ! ray3dpacket_init( rays, numberOfRays, activeMask, & packet ) )
+    {
+        for ( unsigned int i = 0; i < numberOfRays; i++ )
+        {
+            if ( ! ( activeMask & ( 1U << i ) ) )
+                continue;
+
+            arnraycaster_select_packet_ray( rayCaster, i, & rays[i] );
+
+            [ self getIntersectionList
+                :   rayCaster
+                :   range_of_t
+                : & intersectionLists[i]
+                ];
+        }
+
+        return;
+    }
+
+    for ( unsigned int i = 0; i < numberOfRays; i++ )
+        if ( activeMask & ( 1U << i ) )
+            intersectionLists[i] = ARINTERSECTIONLIST_EMPTY;
+
+    const Pnt3D  * point_array =
+        [ ARNRAYCASTER_VERTICES(rayCaster) pointArray ];
+
+    double  tMin = RANGE_MIN(range_of_t);
+    double  tMax = RANGE_MAX(range_of_t);
+
+    unsigned int  laneMask =
+        ray3dpacket_box_hit_mask(
+            & packet,
+              faceBVHNodes[0].min,
+              faceBVHNodes[0].max,
+              tMin,
+              tMax,
+              activeMask
+            );
+
+    long          bvhStack[ BVH_MAX_TREE_DEPTH ];
+    unsigned int  laneMaskStack[ BVH_MAX_TREE_DEPTH ];
+    int           bvhStackPtr = -1;
+
+    long  nodeIndex = 0;
+
+    while ( laneMask )
+    {
+        BVHNode  * node = & faceBVHNodes[nodeIndex];
+
+        ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
+
+        if ( BVH_NODE_IS_INNER(*node) )
+        {
+            long  nearChild = nodeIndex + 1;
+            long  farChild  = BVH_NODE_SECOND_CHILD(*node);
+
+            if ( RAY3DPACKET_DIR_IS_NEGATIVE( packet, BVH_NODE_SPLIT_AXIS(*node) ) )
+            {
+                long  temp = nearChild;
+                nearChild  = farChild;
+                farChild   = temp;
+            }
+
+            unsigned int  nearMask =
+                ray3dpacket_box_hit_mask(
+                    & packet,
+                      faceBVHNodes[nearChild].min,
+                      faceBVHNodes[nearChild].max,
+                      tMin,
+                      tMax,
+                      laneMask
+                    );
+            unsigned int  farMask =
+                ray3dpacket_box_hit_mask(
+                    & packet,
+                      faceBVHNodes[farChild].min,
+                      faceBVHNodes[farChild].max,
+                      tMin,
+                      tMax,
+                      laneMask
+                    );
+
+            if ( nearMask && farMask )
+            {
+                ++bvhStackPtr;
+                bvhStack[ bvhStackPtr ]      = farChild;
+                laneMaskStack[ bvhStackPtr ] = farMask;
+                nodeIndex = nearChild;
+                laneMask  = nearMask;
+                continue;
+            }
+
+            if ( nearMask )
+            {
+                nodeIndex = nearChild;
+                laneMask  = nearMask;
+                continue;
+            }
+
+            if ( farMask )
+            {
+                nodeIndex = farChild;
+                laneMask  = farMask;
+                continue;
+            }
+        }
+        else
+        {
+            long  first = BVH_NODE_PRIMITIVE_OFFSET(*node);
+            long  count = BVH_NODE_PRIMITIVE_COUNT(*node);
+
+            for ( long i = first; i < first + count; i++ )
+            {
+                double  t[ RAY3DPACKET_MAX_SIZE ];
+                double  u[ RAY3DPACKET_MAX_SIZE ];
+                double  v[ RAY3DPACKET_MAX_SIZE ];
+                int     side[ RAY3DPACKET_MAX_SIZE ];
+
+                unsigned int  hitMask =
+                    ray3dpacket_triangle_hit_mask(
+                        & packet,
+                        & point_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(i,0) ],
+                        & point_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(i,1) ],
+                        & point_array[ ARNTRIANGLEMESH_BVH_FACE_VERTEX(i,2) ],
+                          tMin,
+                          tMax,
+                          laneMask,
+                          t,
+                          u,
+                          v,
+                          side
+                        );
+
+                if ( ARNRAYCASTER_COLLECT_STATISTICS(rayCaster) )
+                {
+                    for ( unsigned int j = 0; j < numberOfRays; j++ )
+                    {
+                        if ( laneMask & ( 1U << j ) )
+                            ARNRAYCASTER_COUNT_PRIMITIVE_TEST(
+                                rayCaster,
+                                [ self globalClassNumber ],
+                                hitMask & ( 1U << j )
+                                );
+                    }
+                }
+
+                for ( unsigned int j = 0; hitMask; j++ )
+                {
+                    if ( ! ( hitMask & ( 1U << j ) ) )
+                        continue;
+
+                    hitMask &= ~( 1U << j );
+
+                    //   The intersection is set up from the state of the
+                    //   ray caster, so it has to be switched to the lane.
+
+                    arnraycaster_select_packet_ray( rayCaster, j, & rays[j] );
+
+                    Pnt2D  crd = PNT2D( u[j], v[j] );
+
+                    [ self _addFaceIntersection
+                        :   rayCaster
+                        :   i
+                        :   t[j]
+                        :   side[j]
+                        : & crd
+                        : & intersectionLists[j]
+                        ];
+                }
+            }
+        }
+
+        if ( bvhStackPtr == -1 )
+            break;
+
+        nodeIndex = bvhStack[ bvhStackPtr ];
+        laneMask  = laneMaskStack[ bvhStackPtr ];
+        --bvhStackPtr;
+    }
+
+    if ( shapeGeometry & arshape_singular )
+        return;
+
+    for ( unsigned int i = 0; i < numberOfRays; i++ )
+    {
+        if (   ! ( activeMask & ( 1U << i ) )
+            || ! ARINTERSECTIONLIST_HEAD(intersectionLists[i]) )
+            continue;
+
+        arnraycaster_select_packet_ray( rayCaster, i, & rays[i] );
+
+        [ self _pairSolidMeshIntersections
+            :   rayCaster
+            : & intersectionLists[i]
+            ];
+    }
+}
+
+- (void) calculateLocalNormalForIntersection
+        : (ArcIntersection *) intersection
+{
+    const Pnt3D  * point_array =
+        [ (ArNode <ArpVertices> *)
+            ARTS_VERTICES(ARCINTERSECTION_TRAVERSALSTATE(intersection))
+            pointArray
+            ];
+
+    long  face = FACE_ID(intersection);
+
+    Vec3D  edge1, edge2;
+
+    vec3d_pp_sub_v(
+        & point_array[ ARARRAY_I( faces, face*3+1 ) ],
+        & point_array[ ARARRAY_I( faces, face*3+0 ) ],
+        & edge1
+        );
+
+    vec3d_pp_sub_v(
+        & point_array[ ARARRAY_I( faces, face*3+2 ) ],
+        & point_array[ ARARRAY_I( faces, face*3+0 ) ],
+        & edge2
+        );
+
+    vec3d_vv_cross_v(
+        & edge1,
+        & edge2,
+        & OBJECTSPACE_NORMAL(intersection)
+        );
+
+    vec3d_norm_v( & OBJECTSPACE_NORMAL(intersection) );
+
+    FLAG_OBJECTSPACE_NORMAL_AS_VALID(intersection);
+}
+
 @end
 
 // ===========================================================================
@@ -65,8 +65,8 @@ ART_MODULE_INTERFACE(ArpRayCasting_Categories)
 @interface AraTrafo3D               ( RayCasting ) < ArpRayCasting > @end
 @interface AraVertices              ( RayCasting ) < ArpRayCasting > @end
 @interface AraVariables             ( RayCasting ) < ArpRayCasting > @end
-@interface AraWorld                 ( RayCasting ) < ArpRayCasting > @end
-@interface AraCombinedAttributes    ( RayCasting ) < ArpRayCasting > @end
+@interface AraWorld                 ( RayCasting ) < ArpRayPacketCasting > @end
+@interface AraCombinedAttributes    ( RayCasting ) < ArpRayPacketCasting > @end
 @interface AraCombinedReference     ( RayCasting ) < ArpRayCasting > @end
 
 ART_MODULE_INTERFACE(AraBBoxRayCasting)
@@ -90,7 +90,7 @@ ART_MODULE_INTERFACE(AraCombinedReferenceRayCasting)
 @interface ArnReference         ( RayCasting ) < ArpRayCasting > @end
 @interface ArnRepeater          ( RayCasting ) < ArpRayCasting > @end
 @interface ArnUnion             ( RayCasting ) < ArpRayCasting > @end
-@interface ArnTriangleMesh   ( RayCasting ) < ArpRayCasting > @end
+@interface ArnTriangleMesh   ( RayCasting ) < ArpRayPacketCasting > @end
 
 ART_MODULE_INTERFACE(ArnCSGRayCasting)
 ART_MODULE_INTERFACE(ArnCSGBBoxRayCasting)
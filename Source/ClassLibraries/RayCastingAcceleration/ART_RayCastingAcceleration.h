@@ -31,6 +31,7 @@ ART_LIBRARY_INTERFACE(ART_RayCastingAcceleration)
 #import "ArSGL.h"
 
 #import "ArnBSPTree.h"
+#import "ArnBVH.h"
 #import "ArnLeafNodeBBoxCollection.h"
 #import "ArnOperationTree.h"
 
@@ -32,6 +32,7 @@ ART_LIBRARY_INITIALISATION_FUNCTION
 (
     ART_PERFORM_MODULE_INITIALISATION( ArSGL )
     ART_PERFORM_MODULE_INITIALISATION( ArnBSPTree )
+    ART_PERFORM_MODULE_INITIALISATION( ArnBVH )
     ART_PERFORM_MODULE_INITIALISATION( ArnLeafNodeBBoxCollection )
     ART_PERFORM_MODULE_INITIALISATION( ArnOperationTree )
 )
@@ -329,6 +329,12 @@ void intersect_leaf(
           intersectionList
         );
 
+    ARNRAYCASTER_COUNT_PRIMITIVE_TEST(
+        rayCaster,
+        ARSGL_SHAPE_CLASS_NUMBER(*sglPtr),
+        ARINTERSECTIONLIST_HEAD(*intersectionList)
+        );
+
     // As said before leaving the method must set the active flag to false.
     rayCaster->activeNodes[myId] = NO;
 }
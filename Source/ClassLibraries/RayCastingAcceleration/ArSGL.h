@@ -48,7 +48,21 @@ typedef struct ArSGL
     void  (*imp_getIntersectionList)
           (id, SEL, ArnRayCaster *,Range,ArIntersectionList *);
 
+    //   Same for the packet version, NULL if the leaf does not support
+    //   ArpRayPacketCasting
+
+    SEL   sel_getIntersectionLists;
+
+    void  (*imp_getIntersectionLists)
+          (id, SEL, ArnRayCaster *,const Ray3D *,unsigned int,unsigned int,
+           Range,ArIntersectionList *);
+
     int leafInOperationTree;
+
+    //   Global class number of the shape, for the per shape class
+    //   ray casting statistics
+
+    unsigned long  shapeClassNumber;
 }
 ArSGL;
 
@@ -58,6 +72,7 @@ ArSGL;
 #define ARSGL_TRAFO(__sgl)      (__sgl).trafo_world2object
 #define ARSGL_STATE(__sgl)      (__sgl).state_at_leaf
 #define ARSGL_OPERATION_LEAF(__sgl)      (__sgl).leafInOperationTree
+#define ARSGL_SHAPE_CLASS_NUMBER(__sgl)  (__sgl).shapeClassNumber
 
 #define  ARSGL_GET_INTERSECTION_LIST( \
     __sgl, \
@@ -73,8 +88,31 @@ ArSGL;
     __intersectionList \
     )
 
+#define  ARSGL_GET_INTERSECTION_LISTS( \
+    __sgl, \
+    __rayCaster, \
+    __rays, \
+    __numberOfRays, \
+    __activeMask, \
+    __range_of_t, \
+    __intersectionLists \
+    ) \
+(__sgl).imp_getIntersectionLists( \
+    ARSGL_SHAPE(__sgl), \
+    (__sgl).sel_getIntersectionLists, \
+    __rayCaster, \
+    __rays, \
+    __numberOfRays, \
+    __activeMask, \
+    __range_of_t, \
+    __intersectionLists \
+    )
+
+#define ARSGL_SUPPORTS_RAY_PACKETS(__sgl) \
+    ( (__sgl).imp_getIntersectionLists != NULL )
+
 #define ARSGL_EMPTY \
-((ArSGL){ARNODEREF_NONE,BOX3D_EMPTY,HTRAFO3D_UNIT,ARTS_EMPTY,NULL,NULL,0})
+((ArSGL){ARNODEREF_NONE,BOX3D_EMPTY,HTRAFO3D_UNIT,ARTS_EMPTY,NULL,NULL,NULL,NULL,0,0})
 
 ARDYNARRAY_INTERFACE_FOR_ARTYPE(SGL,sgl,sgl);
 
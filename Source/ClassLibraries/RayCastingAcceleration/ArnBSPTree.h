@@ -43,6 +43,52 @@ plausibleSplit;
 
 ARDYNARRAY_INTERFACE_FOR_TYPE_PTR(plausibleSplit,plausibleSplit,plausibleSplit,plausibleSplit);
 
+struct ArBSPTreeBuildQueue;
+
+/* ---------------------------------------------------------------------------
+
+    'ArBSPTreeSplitSearch' enum
+
+    How the SAH split plane is searched for during the build.
+
+    sorted_events - the original method: 6 split candidates per leaf,
+        sorted once, and exactly evaluated at each candidate position.
+
+    binned_sah    - the leaves are sorted into a fixed number of bins per
+        axis, and only the bin boundaries are considered as split planes.
+        This needs neither the candidate array nor the initial sort,
+        and is much faster for scenes with millions of primitives, at the
+        expense of slightly less optimal trees.
+
+------------------------------------------------------------------------aw- */
+
+typedef enum ArBSPTreeSplitSearch
+{
+    arbsptreesplitsearch_sorted_events = 0,
+    arbsptreesplitsearch_binned_sah    = 1
+}
+ArBSPTreeSplitSearch;
+
+/* ---------------------------------------------------------------------------
+
+    BSP tree cache
+
+    If an ArnBSPTree is given the name of a cache file, the built tree -
+    the BSP node array, the leaf arrays, and the overall AABB - is written
+    to that file. On the next run, the file is mapped into memory instead
+    of building the tree again, provided that it was built for the same
+    leaf bounding boxes (in the same order) and the same split search.
+    This is checked through a CRC32 of the leaf boxes that is stored in
+    the file header, together with the number of leaves.
+
+    The tree data itself is covered by a second CRC32, and every node is
+    checked before the tree is used. A cache file that does not match, or
+    is truncated or corrupted, is silently replaced by a freshly built
+    tree. The files are not portable between machines of different
+    endianness, which the header also detects.
+
+------------------------------------------------------------------------aw- */
+
 
 @interface ArnBSPTree
         : ArnTernary
@@ -50,6 +96,8 @@ ARDYNARRAY_INTERFACE_FOR_TYPE_PTR(plausibleSplit,plausibleSplit,plausibleSplit,p
 {
     BOOL           createBSPVisualisation;
     BOOL           outputBSPStatistics;
+    BOOL           operationTreeNeeded;
+    ArBSPTreeSplitSearch  splitSearch;
     int            indexOfNextFreeBSPNode;
     int            numberOfAllocatedBSPNodes;
     BSPNode      * bspTree;
@@ -66,6 +114,17 @@ ARDYNARRAY_INTERFACE_FOR_TYPE_PTR(plausibleSplit,plausibleSplit,plausibleSplit,p
 
     ArSGLptrDynArray  allLeaves;
     ArTraversalState  stateForVisShapes;
+
+    //   Only used while subtrees are being built in parallel
+
+    struct ArBSPTreeBuildQueue  * buildQueue;
+
+    //   Cache file, and the memory mapping of it if the BSP node
+    //   array was loaded from there
+
+    ArSymbol       cacheFileName;
+    void         * mappedCache;
+    size_t         mappedCacheSize;
 }
 
 - (id) init
@@ -74,6 +133,24 @@ ARDYNARRAY_INTERFACE_FOR_TYPE_PTR(plausibleSplit,plausibleSplit,plausibleSplit,p
         : (ArnOperationTree*) newOperationTree
         ;
 
+- (id) init
+        : (ArNodeRef) originalScenegraphRef
+        : (ArnLeafNodeBBoxCollection *) leafNodeBBoxes
+        : (ArnOperationTree*) newOperationTree
+        : (ArBSPTreeSplitSearch) newSplitSearch
+        ;
+
+- (id) init
+        : (ArNodeRef) originalScenegraphRef
+        : (ArnLeafNodeBBoxCollection *) leafNodeBBoxes
+        : (ArnOperationTree*) newOperationTree
+        : (ArBSPTreeSplitSearch) newSplitSearch
+        : (const char *) newCacheFileName
+        ;
+
+- (BOOL) wasLoadedFromCache
+        ;
+
 @end
 
 // ===========================================================================
@@ -35,6 +35,13 @@
 
 #import "ArOrder.h"
 #import "ArnLeafNodeBBoxCollection.h"
+#import "ArcUnsignedInteger.h"
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 ART_MODULE_INITIALISATION_FUNCTION
 (
@@ -111,6 +118,236 @@ printf("FarentBoundingBoxSize: (%f, %f, %f)\n", \
            );   \
 
 
+#define BSP_PARALLEL_BUILD_MINIMUM_LEAVES       4096
+#define BSP_PARALLEL_BUILD_TASKS_PER_THREAD     8
+
+/* ---------------------------------------------------------------------------
+
+    'ArBSPTreeBuildContext' struct
+
+    Everything the recursive build writes to: the node array, the array
+    of leaf arrays, and the statistics. The serial build uses just one of
+    these, which ends up as the final tree.
+
+    For a parallel build, the top levels of the tree are built into one
+    context as usual, until 'taskSpawnDepth' is reached. At that depth the
+    remaining work for each subtree is stored as an 'ArBSPTreeBuildTask',
+    and the worker threads build these subtrees into contexts of their own.
+
+    Since the split decisions for a subtree only depend on the leaves and
+    split candidates in it, the subtrees are the same as in a serial build.
+    The final merge re-creates the node and leaf array layout of the serial
+    build by walking the trees in the order the serial recursion would
+    have allocated the nodes; the result is bit-identical to a serial build.
+
+------------------------------------------------------------------------aw- */
+
+typedef struct ArBSPTreeBuildContext
+{
+    BSPNode                     * bspTree;
+    int                           indexOfNextFreeBSPNode;
+    int                           numberOfAllocatedBSPNodes;
+
+    ArSGLPArray                 * scenegraphLeafArray;
+    int                           indexOfNextFreeLeafArray;
+    int                           numberOfAllocatedLeafArrays;
+
+    int                           maximumNumberOfLeavesPerCell;
+    int                           numberOfLeafCells;
+    int                           numberOfInnerCells;
+
+    int                           taskSpawnDepth;
+    struct ArBSPTreeBuildTask   * task;
+    int                           numberOfTasks;
+    int                           numberOfAllocatedTasks;
+}
+ArBSPTreeBuildContext;
+
+typedef struct ArBSPTreeBuildTask
+{
+    int                          indexOfBSPNode;
+    ArSGLptrDynArray             leaves;
+    Box3D                        bbox;
+    int                          recursionLevel;
+    ArplausibleSplitptrDynArray  splits;
+    ArBSPTreeBuildContext        context;
+}
+ArBSPTreeBuildTask;
+
+typedef struct ArBSPTreeBuildQueue
+{
+    ArBSPTreeBuildContext  * context;
+    int                      indexOfNextTask;
+    unsigned int             numberOfActiveThreads;
+    pthread_mutex_t          mutex;
+    pthread_cond_t           threadsDone;
+}
+ArBSPTreeBuildQueue;
+
+static void arbsptreebuildcontext_init(
+        ArBSPTreeBuildContext  * context,
+        long                     numberOfLeaves,
+        int                      taskSpawnDepth
+        )
+{
+    //   Initial number of BSP nodes. This is a rough guess, and
+    //   probably always too low.
+
+    context->numberOfAllocatedBSPNodes = M_MAX( numberOfLeaves * 2, 2 );
+
+    //   The BSP node with index 0 is already taken by the first node
+    //   that is always present.
+
+    context->indexOfNextFreeBSPNode = 1;
+
+    context->bspTree =
+        ALLOC_ARRAY( BSPNode, context->numberOfAllocatedBSPNodes );
+
+    for ( int i = 0; i < context->numberOfAllocatedBSPNodes; i++ )
+        BSP_NODE_INNER(context->bspTree[i]) = BSP_NODE_INNER_EMPTY;
+
+    //   This is also a rough initial guess, and probably too low as well.
+
+    context->numberOfAllocatedLeafArrays = M_MAX( numberOfLeaves * 2, 1 );
+    context->indexOfNextFreeLeafArray = 0;
+
+    context->scenegraphLeafArray =
+        ALLOC_ARRAY( ArSGLPArray, context->numberOfAllocatedLeafArrays );
+
+    context->maximumNumberOfLeavesPerCell = 0;
+    context->numberOfLeafCells = 0;
+    context->numberOfInnerCells = 0;
+
+    context->taskSpawnDepth = taskSpawnDepth;
+    context->task = NULL;
+    context->numberOfTasks = 0;
+    context->numberOfAllocatedTasks = 0;
+}
+
+//   The task takes over the leaf and split dynarrays of the caller.
+
+static void arbsptreebuildcontext_add_task(
+        ArBSPTreeBuildContext        * context,
+        int                            indexOfBSPNode,
+        ArSGLptrDynArray             * leaves,
+        Box3D                        * bbox,
+        int                            recursionLevel,
+        ArplausibleSplitptrDynArray  * splits
+        )
+{
+    if ( context->numberOfTasks == context->numberOfAllocatedTasks )
+    {
+        context->numberOfAllocatedTasks =
+            M_MAX( context->numberOfAllocatedTasks * 2, 16 );
+
+        context->task =
+            REALLOC_ARRAY(
+                context->task,
+                ArBSPTreeBuildTask,
+                context->numberOfAllocatedTasks
+                );
+    }
+
+    ArBSPTreeBuildTask  * task = & context->task[ context->numberOfTasks++ ];
+
+    task->indexOfBSPNode = indexOfBSPNode;
+    task->leaves         = *leaves;
+    task->bbox           = *bbox;
+    task->recursionLevel = recursionLevel;
+    task->splits         = *splits;
+}
+
+//   Copies the subtree rooted at 'indexOfSourceNode' into the target
+//   context, allocating nodes and leaf arrays in exactly the same order
+//   as _createBSPTreeForScenegraphLeaves does. Subtrees that were built
+//   by a task are picked up from the task context when their (still
+//   empty) root node in the source context is reached. The leaf arrays
+//   are moved, not copied.
+
+static void arbsptreebuildcontext_merge_subtree(
+        ArBSPTreeBuildContext  * target,
+        int                      indexOfTargetNode,
+        ArBSPTreeBuildContext  * source,
+        int                      indexOfSourceNode,
+        int                    * indexOfNextTask
+        )
+{
+    if (   *indexOfNextTask < source->numberOfTasks
+        &&    source->task[*indexOfNextTask].indexOfBSPNode
+           == indexOfSourceNode )
+    {
+        ArBSPTreeBuildContext  * taskContext =
+            & source->task[ (*indexOfNextTask)++ ].context;
+
+        int  indexOfNextTaskInTask = 0;
+
+        arbsptreebuildcontext_merge_subtree(
+              target,
+              indexOfTargetNode,
+              taskContext,
+              0,
+            & indexOfNextTaskInTask
+            );
+
+        return;
+    }
+
+    BSPNode  node = source->bspTree[indexOfSourceNode];
+
+    if ( BSP_NODE_IS_LEAF(node) )
+    {
+        int  leafArrayIndex = target->indexOfNextFreeLeafArray++;
+
+        target->scenegraphLeafArray[leafArrayIndex] =
+            source->scenegraphLeafArray[ BSP_NODE_LEAF_INDEX(node) ];
+
+        SET_BSP_NODE_LEAF_ARRAY_INDEX( node, leafArrayIndex );
+
+        target->bspTree[indexOfTargetNode] = node;
+    }
+    else
+    {
+        int  indexOfSourceChildren =
+            BSP_NODE_ARRAY_OFFSET(node) / sizeof(BSPNode);
+
+        int  indexOfTargetChildren = target->indexOfNextFreeBSPNode;
+
+        target->indexOfNextFreeBSPNode += 2;
+
+        SET_BSP_NODE_ARRAY_OFFSET(
+            node,
+            indexOfTargetChildren * sizeof(BSPNode)
+            );
+
+        target->bspTree[indexOfTargetNode] = node;
+
+        for ( int i = 0; i < 2; i++ )
+            arbsptreebuildcontext_merge_subtree(
+                target,
+                indexOfTargetChildren + i,
+                source,
+                indexOfSourceChildren + i,
+                indexOfNextTask
+                );
+    }
+}
+
+//   Only frees the arrays themselves - the leaf arrays referenced from
+//   them have been moved to the merged context.
+
+static void arbsptreebuildcontext_free_merged(
+        ArBSPTreeBuildContext  * context
+        )
+{
+    for ( int i = 0; i < context->numberOfTasks; i++ )
+        arbsptreebuildcontext_free_merged( & context->task[i].context );
+
+    FREE_ARRAY( context->bspTree );
+    FREE_ARRAY( context->scenegraphLeafArray );
+
+    if ( context->task )
+        FREE_ARRAY( context->task );
+}
 
 
 @implementation ArnBSPTree
@@ -166,7 +403,7 @@ static int order_split(
     }
 }
 
-#define CURRENT_BSP_NODE  bspTree[indexOfCurrentBSPNode]
+#define CURRENT_BSP_NODE  context->bspTree[indexOfCurrentBSPNode]
 
 //   This macro returns the current split coordinate (CSC) of the
 //   point in question, hard-wired to the 'splitAxis'
@@ -631,13 +868,134 @@ void bspTree_debugprintf(
         }
 }
 
+#define BSP_NUMBER_OF_SAH_BINS  32
+
+- (BOOL) _determineSplitAxisAndCoordinateForScenegraphLeavesBinnedSAH
+        : (ArSGLptrDynArray *) scenegraphLeaves
+        : (long) numberOfScenegraphLeaves
+        : (Box3D *) bboxForScenegraphLeaves
+        : (int *) splitAxis
+        : (double *) splitCoordinate
+{
+    //   Same cost model as _determineSplitAxisAndCoordinateForScenegraphLeavesSAH,
+    //   but only evaluated at the boundaries of BSP_NUMBER_OF_SAH_BINS
+    //   equally sized bins per axis. For each bin, we count the leaves
+    //   whose AABB starts in it, and the ones whose AABB ends in it; a
+    //   single sweep over the bins then yields the number of leaves on
+    //   either side of each bin boundary. The child cells are cut from
+    //   the cell of this node, not merged from the leaf AABBs in the
+    //   bins, so empty bins need no special care.
+
+    double  noSplitCost = numberOfScenegraphLeaves * COST_INTERSECT;
+
+    Vec3D  parentSize = VEC3D_INVALID;
+
+    box3d_b_size_v( bboxForScenegraphLeaves, & parentSize );
+
+    double  parentSurfaceArea = SURFACE_AREA(parentSize);
+
+    double  bestCost = + MATH_HUGE_DOUBLE;
+
+    if ( parentSurfaceArea <= 0.0 )
+        return NO;
+
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        double  axisMin    = BOX3D_MIN_I(*bboxForScenegraphLeaves,axis);
+        double  axisExtent = VEC3D_I(parentSize,axis);
+
+        if ( axisExtent <= 0.0 )
+            continue;
+
+        double  binsPerUnit = BSP_NUMBER_OF_SAH_BINS / axisExtent;
+
+        long  numberOfStartsInBin[ BSP_NUMBER_OF_SAH_BINS ];
+        long  numberOfEndsInBin[ BSP_NUMBER_OF_SAH_BINS ];
+
+        for ( int b = 0; b < BSP_NUMBER_OF_SAH_BINS; b++ )
+        {
+            numberOfStartsInBin[b] = 0;
+            numberOfEndsInBin[b]   = 0;
+        }
+
+        for ( long i = 0; i < numberOfScenegraphLeaves; i++ )
+        {
+            ArSGL  * leaf = arsglptrdynarray_i( scenegraphLeaves, i );
+
+            int  startBin =
+                (int)(   ( BOX3D_MIN_I(ARSGL_BOX3D(*leaf),axis) - axisMin )
+                       * binsPerUnit );
+            int  endBin =
+                (int)(   ( BOX3D_MAX_I(ARSGL_BOX3D(*leaf),axis) - axisMin )
+                       * binsPerUnit );
+
+            numberOfStartsInBin[ M_CLAMP( startBin, 0, BSP_NUMBER_OF_SAH_BINS - 1 ) ]++;
+            numberOfEndsInBin[ M_CLAMP( endBin, 0, BSP_NUMBER_OF_SAH_BINS - 1 ) ]++;
+        }
+
+        long  numberOfLeavesInNearChild = 0;
+        long  numberOfLeavesInFarChild  = numberOfScenegraphLeaves;
+
+        for ( int b = 1; b < BSP_NUMBER_OF_SAH_BINS; b++ )
+        {
+            numberOfLeavesInNearChild += numberOfStartsInBin[b - 1];
+            numberOfLeavesInFarChild  -= numberOfEndsInBin[b - 1];
+
+            double  thisSplitCoordinate = axisMin + b / binsPerUnit;
+
+            Vec3D  nearChildSize = parentSize;
+            Vec3D  farChildSize  = parentSize;
+
+            VEC3D_I(nearChildSize,axis) = thisSplitCoordinate - axisMin;
+            VEC3D_I(farChildSize,axis)  = axisExtent - VEC3D_I(nearChildSize,axis);
+
+            double  splitCost =
+                  COST_TRAVERSAL
+                +   SURFACE_AREA(nearChildSize) / parentSurfaceArea
+                  * numberOfLeavesInNearChild
+                  * COST_INTERSECT
+                +   SURFACE_AREA(farChildSize) / parentSurfaceArea
+                  * numberOfLeavesInFarChild
+                  * COST_INTERSECT;
+
+            if ( splitCost < bestCost )
+            {
+                *splitAxis       = axis;
+                *splitCoordinate = thisSplitCoordinate;
+                bestCost         = splitCost;
+            }
+        }
+    }
+
+    return ( bestCost < noSplitCost );
+}
+
 - (void) _createBSPTreeForScenegraphLeaves
         : (int) indexOfCurrentBSPNode
         : (ArSGLptrDynArray *) currentScenegraphLeaves
         : (Box3D *) bboxForCurrentScenegraphLeaves
         : (int) currentRecursionLevel
         : (ArplausibleSplitptrDynArray *) plausibleSplits
+        : (ArBSPTreeBuildContext *) context
 {
+    //   Parallel build - at the task spawn depth, the subtree is not built
+    //   right away, but handed over to the worker threads. The node that
+    //   will be the root of the subtree stays empty until the final merge.
+
+    if ( currentRecursionLevel == context->taskSpawnDepth )
+    {
+        arbsptreebuildcontext_add_task(
+            context,
+            indexOfCurrentBSPNode,
+            currentScenegraphLeaves,
+            bboxForCurrentScenegraphLeaves,
+            currentRecursionLevel,
+            plausibleSplits
+            );
+
+        return;
+    }
+
     BOOL  continueRecursion = YES;
 
     //   Termination criterion 0 - recursion limit exceeded
@@ -663,6 +1021,16 @@ void bspTree_debugprintf(
         //  Termination criterion 2 - based on SAH
         if (continueRecursion)
         {
+            if ( splitSearch == arbsptreesplitsearch_binned_sah )
+                continueRecursion &=
+                    [ self _determineSplitAxisAndCoordinateForScenegraphLeavesBinnedSAH
+                        :   currentScenegraphLeaves
+                        :   numberOfCurrentLeaves
+                        :   bboxForCurrentScenegraphLeaves
+                        : & splitAxis
+                        : & splitCoordinate
+                        ];
+            else
                 continueRecursion &=
                         [ self _determineSplitAxisAndCoordinateForScenegraphLeavesSAH
                                 :   plausibleSplits
@@ -763,6 +1131,21 @@ void bspTree_debugprintf(
                 count++;
             }
 
+            //   Bin boundaries are not leaf AABB bounds, so with the
+            //   binned split search a flat leaf AABB can lie exactly in
+            //   the split plane. It then goes into the near subtree.
+
+            if (   count == 0
+                && splitSearch == arbsptreesplitsearch_binned_sah )
+            {
+                arsglptrdynarray_push(
+                    & leavesInSubTree[0],
+                      leafToSort
+                    );
+
+                count++;
+            }
+
             if ( count == 0 )
             {
                 ART_ERRORHANDLING_FATAL_ERROR(
@@ -827,26 +1210,32 @@ void bspTree_debugprintf(
         //      take two new nodes side by side, so we have to
         //      reallocate even if there is one BSP node left.
 
-        if ( indexOfNextFreeBSPNode > numberOfAllocatedBSPNodes - 2 )
+        if (   context->indexOfNextFreeBSPNode
+             > context->numberOfAllocatedBSPNodes - 2 )
         {
-            int  oldNumberOfAllocatedBSPNodes = numberOfAllocatedBSPNodes;
+            int  oldNumberOfAllocatedBSPNodes =
+                context->numberOfAllocatedBSPNodes;
 
-            numberOfAllocatedBSPNodes *= 2;
+            context->numberOfAllocatedBSPNodes *= 2;
 
-            bspTree =
-                REALLOC_ARRAY( bspTree, BSPNode, numberOfAllocatedBSPNodes );
+            context->bspTree =
+                REALLOC_ARRAY(
+                    context->bspTree,
+                    BSPNode,
+                    context->numberOfAllocatedBSPNodes
+                    );
 
             for ( int i = oldNumberOfAllocatedBSPNodes;
-                  i < numberOfAllocatedBSPNodes; i++ )
-                BSP_NODE_INNER(bspTree[i]) = BSP_NODE_INNER_EMPTY;
+                  i < context->numberOfAllocatedBSPNodes; i++ )
+                BSP_NODE_INNER(context->bspTree[i]) = BSP_NODE_INNER_EMPTY;
         }
 
         //   The base address of the next *two* BSPNodes, which are
         //   always side by side
 
-        int  indexOfSubtreeBSPNode = indexOfNextFreeBSPNode;
+        int  indexOfSubtreeBSPNode = context->indexOfNextFreeBSPNode;
 
-        indexOfNextFreeBSPNode += 2;
+        context->indexOfNextFreeBSPNode += 2;
 
         //   We only store the *offset* from the current position
         //   The reason for this is the reduced value range of the
@@ -866,10 +1255,11 @@ void bspTree_debugprintf(
                 : & bboxForSubTree[i]
                 :   currentRecursionLevel + 1
                                 : & splitsInSubTree[i]
+                :   context
                 ];
 
         }
-        numberOfInnerCells++;
+        context->numberOfInnerCells++;
     }
     else  //  otherwise, we create a BSP leaf node
     {
@@ -880,29 +1270,30 @@ void bspTree_debugprintf(
         //   shapes that can be intersected in this leaf.
 
 
-        if ( indexOfNextFreeLeafArray > numberOfAllocatedLeafArrays - 1 )
+        if (   context->indexOfNextFreeLeafArray
+             > context->numberOfAllocatedLeafArrays - 1 )
         {
-            numberOfAllocatedLeafArrays *= 2;
+            context->numberOfAllocatedLeafArrays *= 2;
 
-            scenegraphLeafArray =
+            context->scenegraphLeafArray =
                 REALLOC_ARRAY(
-                    scenegraphLeafArray,
+                    context->scenegraphLeafArray,
                     ArSGLPArray,
-                    numberOfAllocatedLeafArrays
+                    context->numberOfAllocatedLeafArrays
                     );
         }
 
-        int  leafArrayIndex = indexOfNextFreeLeafArray;
+        int  leafArrayIndex = context->indexOfNextFreeLeafArray;
 
-        indexOfNextFreeLeafArray++;
+        context->indexOfNextFreeLeafArray++;
 
-        ArSGLPArray  * sglp = & scenegraphLeafArray[leafArrayIndex];
+        ArSGLPArray  * sglp = & context->scenegraphLeafArray[leafArrayIndex];
 
         SGLPARRAY(*sglp) = ALLOC_ARRAY( ArSGL *, numberOfCurrentLeaves );
         SGLPARRAY_N(*sglp) = numberOfCurrentLeaves;
 
-        if ( numberOfCurrentLeaves > maximumNumberOfLeavesPerCell )
-            maximumNumberOfLeavesPerCell =
+        if ( numberOfCurrentLeaves > context->maximumNumberOfLeavesPerCell )
+            context->maximumNumberOfLeavesPerCell =
                 numberOfCurrentLeaves;
 
         //   Then, we copy the pointers from the dynarray used during
@@ -923,10 +1314,111 @@ void bspTree_debugprintf(
                 arsglptrdynarray_free_contents( currentScenegraphLeaves );
                 arplausibleSplitptrdynarray_free_contents( plausibleSplits );
 
-        numberOfLeafCells++;
+        context->numberOfLeafCells++;
     }
 }
 
+- (void) _createQueuedBSPSubtrees
+{
+    while ( YES )
+    {
+        pthread_mutex_lock( & buildQueue->mutex );
+
+        int  taskIndex = buildQueue->indexOfNextTask++;
+
+        pthread_mutex_unlock( & buildQueue->mutex );
+
+        if ( taskIndex >= buildQueue->context->numberOfTasks )
+            break;
+
+        ArBSPTreeBuildTask  * task =
+            & buildQueue->context->task[taskIndex];
+
+        arbsptreebuildcontext_init(
+            & task->context,
+              arsglptrdynarray_size( & task->leaves ),
+              -1
+            );
+
+        [ self _createBSPTreeForScenegraphLeaves
+            :   0
+            : & task->leaves
+            : & task->bbox
+            :   task->recursionLevel
+            : & task->splits
+            : & task->context
+            ];
+    }
+}
+
+- (void) _createBSPSubtreesThread
+        : (ArcUnsignedInteger *) threadIndex
+{
+    NSAutoreleasePool  * threadPool;
+    threadPool = [ [ NSAutoreleasePool alloc ] init ];
+    (void) threadIndex;
+
+    [ self _createQueuedBSPSubtrees ];
+
+    pthread_mutex_lock( & buildQueue->mutex );
+
+    buildQueue->numberOfActiveThreads--;
+
+    pthread_cond_signal( & buildQueue->threadsDone );
+    pthread_mutex_unlock( & buildQueue->mutex );
+
+    [ threadPool release ];
+}
+
+- (void) _createBSPSubtreesInParallel
+        : (ArBSPTreeBuildContext *) context
+        : (unsigned int) numberOfThreads
+{
+    ArBSPTreeBuildQueue  queue;
+
+    queue.context = context;
+    queue.indexOfNextTask = 0;
+    queue.numberOfActiveThreads = numberOfThreads - 1;
+
+    pthread_mutex_init( & queue.mutex, NULL );
+    pthread_cond_init( & queue.threadsDone, NULL );
+
+    buildQueue = & queue;
+
+    //   The calling thread is the last of the workers.
+
+    for ( unsigned int i = 0; i < numberOfThreads - 1; i++ )
+    {
+        ArcUnsignedInteger  * index =
+            [ ALLOC_INIT_OBJECT(ArcUnsignedInteger) : i ];
+
+        if ( ! art_thread_detach(
+                    @selector(_createBSPSubtreesThread:),
+                    self,
+                    index ) )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "could not detach BSP tree construction thread %d",
+                i
+                );
+
+        RELEASE_OBJECT( index );
+    }
+
+    [ self _createQueuedBSPSubtrees ];
+
+    pthread_mutex_lock( & queue.mutex );
+
+    while ( queue.numberOfActiveThreads > 0 )
+        pthread_cond_wait( & queue.threadsDone, & queue.mutex );
+
+    pthread_mutex_unlock( & queue.mutex );
+
+    pthread_mutex_destroy( & queue.mutex );
+    pthread_cond_destroy( & queue.threadsDone );
+
+    buildQueue = NULL;
+}
+
 - (void) _createBSPTree
 {
     //   This function is the top level of the recursive BSP tree
@@ -949,7 +1441,12 @@ void bspTree_debugprintf(
     //  there will be exactly 6 plausible splits for every leaf node in the master
     //  leaf array. These are the planes of the bouding box.
 
-    long numberOfSplits = 6 * numberOfLeaves;
+    //  The binned split search does not need them at all.
+
+    long numberOfSplits =
+        ( splitSearch == arbsptreesplitsearch_sorted_events )
+        ? 6 * numberOfLeaves
+        : 0;
 
     plausibleSplit  * plausibleSplitArray =
         ALLOC_ARRAY(plausibleSplit, numberOfSplits);
@@ -988,7 +1485,7 @@ void bspTree_debugprintf(
 
         //  ...fill 6 splits with their data.
 
-        for (long j = 0; j < 3; j++ )
+        for (long j = 0; j < 3 && numberOfSplits > 0; j++ )
         {
             plausibleSplitArray[i * 6 + j * 2].axis = j;
             plausibleSplitArray[i * 6 + j * 2].splitCoordinate = BOX3D_MIN_I(MASTER_LEAF_I_BBOX(i),j);
@@ -1010,22 +1507,25 @@ void bspTree_debugprintf(
     //  for quicksort (think meshing in strips that advance along a particular
     //  coordinate axis).
 
-    arorder_scramble(
-          art_gv,
-          plausibleSplitArray,
-          sizeof(plausibleSplit),
-          numberOfSplits
-        );
+    if ( numberOfSplits > 0 )
+    {
+        arorder_scramble(
+              art_gv,
+              plausibleSplitArray,
+              sizeof(plausibleSplit),
+              numberOfSplits
+            );
 
-    //  Now the splits have to be sorted according to the split coordinte.
+        //  Now the splits have to be sorted according to the split coordinte.
 
-    arorder_quicksort(
-          plausibleSplitArray,
-          sizeof(plausibleSplit),
-          numberOfSplits,
-          order_split,
-          NULL
-        );
+        arorder_quicksort(
+              plausibleSplitArray,
+              sizeof(plausibleSplit),
+              numberOfSplits,
+              order_split,
+              NULL
+            );
+    }
 
     //  Debugprint
 
@@ -1060,42 +1560,34 @@ void bspTree_debugprintf(
         }
 
 
-    //   Initial number of BSP nodes. This is a rough guess, and
-    //   probably always too low.
-
-    numberOfAllocatedBSPNodes = numberOfLeaves * 2;
+    //   For large scenes, the subtrees below a certain depth are built in
+    //   parallel - deep enough that there are several subtrees per
+    //   thread, so that the threads remain busy even if the tree is
+    //   unbalanced.
 
-    //   The BSP node with index 0 is already taken by the first node
-    //   that is always present.
+    unsigned int  numberOfThreads =
+        art_maximum_number_of_working_threads( art_gv );
 
-    indexOfNextFreeBSPNode = 1;
+    int  taskSpawnDepth = -1;
 
-    //   Create the BSP node array
-
-    bspTree = ALLOC_ARRAY( BSPNode, numberOfAllocatedBSPNodes );
-
-    for ( int i = 0; i < numberOfAllocatedBSPNodes; i++ )
-        BSP_NODE_INNER(bspTree[i]) = BSP_NODE_INNER_EMPTY;
-
-    //   This is also a rough initial guess, and probably too low as well.
-
-    numberOfAllocatedLeafArrays = numberOfLeaves * 2;
-
-    indexOfNextFreeLeafArray = 0;
-
-    //   Create array of scenegraph leaf node arrays
-    //   (i.e. the variable sized lists that hold the actual
-    //   scene graph leaf nodes for each BSP leaf node)
+    if (   numberOfThreads > 1
+        && numberOfLeaves >= BSP_PARALLEL_BUILD_MINIMUM_LEAVES )
+    {
+        taskSpawnDepth = 0;
 
-    scenegraphLeafArray =
-        ALLOC_ARRAY( ArSGLPArray, numberOfAllocatedLeafArrays );
+        while (   ( 1U << taskSpawnDepth )
+                < numberOfThreads * BSP_PARALLEL_BUILD_TASKS_PER_THREAD
+               && taskSpawnDepth < MAX_TREE_DEPTH / 2 )
+            taskSpawnDepth++;
+    }
 
-    //   This is just an init for the statistical values that will be
-    //   gathered during BSP tree construction.
+    ArBSPTreeBuildContext  context;
 
-    maximumNumberOfLeavesPerCell = 0;
-    numberOfLeafCells = 0;
-    numberOfInnerCells = 1;
+    arbsptreebuildcontext_init(
+        & context,
+          numberOfLeaves,
+          taskSpawnDepth
+        );
 
     //   Start recursive BSP creation with all leaves, the first
     //   node in the array, and the X axis as split axis
@@ -1106,8 +1598,91 @@ void bspTree_debugprintf(
         : & aabbForAllLeaves
         :   0                // <- recursion level of this node
         : & allSplits
+        : & context
         ];
 
+    if ( context.numberOfTasks > 0 )
+    {
+        [ self _createBSPSubtreesInParallel
+            : & context
+            :   numberOfThreads
+            ];
+
+        //   Merge the top-level tree and all subtrees into one
+        //   context with the layout of a serial build.
+
+        ArBSPTreeBuildContext  mergedContext;
+
+        mergedContext.numberOfAllocatedBSPNodes =
+            context.indexOfNextFreeBSPNode;
+        mergedContext.numberOfAllocatedLeafArrays =
+            context.indexOfNextFreeLeafArray;
+        mergedContext.maximumNumberOfLeavesPerCell =
+            context.maximumNumberOfLeavesPerCell;
+        mergedContext.numberOfLeafCells = context.numberOfLeafCells;
+        mergedContext.numberOfInnerCells = context.numberOfInnerCells;
+
+        for ( int i = 0; i < context.numberOfTasks; i++ )
+        {
+            ArBSPTreeBuildContext  * taskContext = & context.task[i].context;
+
+            //   The root of each subtree replaces the empty node that
+            //   was left for it in the top-level tree.
+
+            mergedContext.numberOfAllocatedBSPNodes +=
+                taskContext->indexOfNextFreeBSPNode - 1;
+            mergedContext.numberOfAllocatedLeafArrays +=
+                taskContext->indexOfNextFreeLeafArray;
+
+            mergedContext.maximumNumberOfLeavesPerCell =
+                M_MAX(
+                    mergedContext.maximumNumberOfLeavesPerCell,
+                    taskContext->maximumNumberOfLeavesPerCell
+                    );
+            mergedContext.numberOfLeafCells += taskContext->numberOfLeafCells;
+            mergedContext.numberOfInnerCells += taskContext->numberOfInnerCells;
+        }
+
+        mergedContext.bspTree =
+            ALLOC_ARRAY( BSPNode, mergedContext.numberOfAllocatedBSPNodes );
+        mergedContext.indexOfNextFreeBSPNode = 1;
+
+        mergedContext.scenegraphLeafArray =
+            ALLOC_ARRAY(
+                ArSGLPArray,
+                M_MAX( mergedContext.numberOfAllocatedLeafArrays, 1 )
+                );
+        mergedContext.indexOfNextFreeLeafArray = 0;
+
+        int  indexOfNextTask = 0;
+
+        arbsptreebuildcontext_merge_subtree(
+            & mergedContext,
+              0,
+            & context,
+              0,
+            & indexOfNextTask
+            );
+
+        arbsptreebuildcontext_free_merged( & context );
+
+        context = mergedContext;
+    }
+
+    bspTree                      = context.bspTree;
+    indexOfNextFreeBSPNode       = context.indexOfNextFreeBSPNode;
+    numberOfAllocatedBSPNodes    = context.numberOfAllocatedBSPNodes;
+
+    scenegraphLeafArray          = context.scenegraphLeafArray;
+    indexOfNextFreeLeafArray     = context.indexOfNextFreeLeafArray;
+    numberOfAllocatedLeafArrays  = context.numberOfAllocatedLeafArrays;
+
+    //   The interior cell count has always started at one.
+
+    maximumNumberOfLeavesPerCell = context.maximumNumberOfLeavesPerCell;
+    numberOfLeafCells            = context.numberOfLeafCells;
+    numberOfInnerCells           = context.numberOfInnerCells + 1;
+
     if ( outputBSPStatistics )
     {
         //  The next line is really only for non-standard debugging
@@ -1134,9 +1709,390 @@ void bspTree_debugprintf(
     FREE_ARRAY(plausibleSplitArray);
 }
 
+/* ---------------------------------------------------------------------------
+
+    BSP tree cache files
+
+    The header is followed by the BSP node array, the sizes of all leaf
+    arrays, and the master leaf array indices of their entries. The BSP
+    node array is used in place from the memory mapped file, while the
+    leaf arrays have to be converted back to ArSGL pointers.
+
+    Since the traversal follows the node offsets of the file blindly, a
+    cache is only used if a CRC32 over everything after the header
+    matches the one in the header, and if all nodes pass the structural
+    checks of bsptree_cache_nodes_valid. Otherwise the tree is rebuilt.
+
+------------------------------------------------------------------------aw- */
+
+#define BSP_CACHE_MAGIC     0x50534241
+#define BSP_CACHE_VERSION   2
+
+typedef struct ArBSPTreeCacheHeader
+{
+    UInt32  magic;
+    UInt32  version;
+    UInt32  leafBoxCRC;
+    UInt32  payloadCRC;
+    Int32   sizeOfBSPNode;
+    Int32   numberOfLeaves;
+    Int32   numberOfBSPNodes;
+    Int32   numberOfLeafArrays;
+    Int32   numberOfLeafReferences;
+    Int32   maximumNumberOfLeavesPerCell;
+    Int32   numberOfLeafCells;
+    Int32   numberOfInnerCells;
+    Int32   splitSearch;
+    Box3D   aabbForAllLeaves;
+}
+ArBSPTreeCacheHeader;
+
+- (UInt32) _leafBoxCRC
+{
+    UInt32  crc = CRC32_INITIAL_VALUE;
+
+    long  numberOfLeaves =
+        arsgldynarray_size( & MASTER_LEAF_ARRAY );
+
+    crc32_update_with_int( & crc, splitSearch );
+    crc32_update_with_int( & crc, (int) numberOfLeaves );
+
+    for ( long i = 0; i < numberOfLeaves; i++ )
+        crc32_update_with_data(
+            & crc,
+            & MASTER_LEAF_I_BBOX(i),
+              sizeof(Box3D)
+            );
+
+    return CRC32_VALUE(crc);
+}
+
+//   The builder always places the two children of a node after it in
+//   the node array, so requiring this also rules out cycles, and the
+//   depth of each node is known once its parent has been visited. Inner
+//   nodes deeper than the build limit would overflow the traversal stack.
+
+static BOOL bsptree_cache_nodes_valid(
+        const BSPNode  * bspNode,
+              long       numberOfBSPNodes,
+              long       numberOfLeafArrays
+        )
+{
+    unsigned char  * depth = ALLOC_ARRAY( unsigned char, numberOfBSPNodes );
+
+    memset( depth, 0, numberOfBSPNodes );
+
+    BOOL  valid = YES;
+
+    for ( long i = 0; valid && i < numberOfBSPNodes; i++ )
+    {
+        if ( BSP_NODE_IS_LEAF(bspNode[i]) )
+        {
+            if ( BSP_NODE_LEAF_INDEX(bspNode[i]) >= numberOfLeafArrays )
+                valid = NO;
+        }
+        else
+        {
+            unsigned long  offset = BSP_NODE_ARRAY_OFFSET(bspNode[i]);
+            long           child  = offset / sizeof(BSPNode);
+
+            if (   offset % sizeof(BSPNode) != 0
+                || BSP_NODE_SPLIT_AXIS(bspNode[i]) > 2
+                || child <= i
+                || child + 1 >= numberOfBSPNodes
+                || depth[i] >= MAX_TREE_DEPTH )
+                valid = NO;
+            else
+            {
+                depth[child]     = depth[i] + 1;
+                depth[child + 1] = depth[i] + 1;
+            }
+        }
+    }
+
+    FREE_ARRAY( depth );
+
+    return valid;
+}
+
+- (BOOL) _loadBSPTreeFromCache
+        : (UInt32) leafBoxCRC
+{
+    int  fd = open( cacheFileName, O_RDONLY );
+
+    if ( fd < 0 )
+        return NO;
+
+    struct stat  fileStatus;
+
+    if (   fstat( fd, & fileStatus )
+        || fileStatus.st_size < (off_t) sizeof(ArBSPTreeCacheHeader) )
+    {
+        close( fd );
+        return NO;
+    }
+
+    size_t  mappingSize = (size_t) fileStatus.st_size;
+
+    void  * mapping =
+        mmap( 0, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    close( fd );
+
+    if ( mapping == MAP_FAILED )
+        return NO;
+
+    const ArBSPTreeCacheHeader  * header = mapping;
+
+    long  numberOfLeaves =
+        arsgldynarray_size( & MASTER_LEAF_ARRAY );
+
+    //   Anything that does not match what we would build here, or that
+    //   does not add up to the size of the file, means we have to build
+    //   the tree after all.
+
+    BOOL  cacheIsValid =
+           header->magic == BSP_CACHE_MAGIC
+        && header->version == BSP_CACHE_VERSION
+        && header->sizeOfBSPNode == (Int32) sizeof(BSPNode)
+        && header->leafBoxCRC == leafBoxCRC
+        && header->splitSearch == (Int32) splitSearch
+        && header->numberOfLeaves == numberOfLeaves
+        && header->numberOfBSPNodes > 0
+        && header->numberOfLeafArrays >= 0
+        && header->numberOfLeafReferences >= 0
+        &&    sizeof(ArBSPTreeCacheHeader)
+            + sizeof(BSPNode) * (size_t) header->numberOfBSPNodes
+            + sizeof(Int32) * (size_t) header->numberOfLeafArrays
+            + sizeof(Int32) * (size_t) header->numberOfLeafReferences
+           == mappingSize;
+
+    BSPNode  * cachedBSPTree = (BSPNode *) ( header + 1 );
+
+    const Int32  * leafArraySize =
+        (const Int32 *) ( cachedBSPTree + header->numberOfBSPNodes );
+
+    const Int32  * leafIndex =
+        leafArraySize + header->numberOfLeafArrays;
+
+    if ( cacheIsValid )
+    {
+        UInt32  crc = CRC32_INITIAL_VALUE;
+
+        crc32_update_with_data(
+            & crc,
+              cachedBSPTree,
+              mappingSize - sizeof(ArBSPTreeCacheHeader)
+            );
+
+        if ( CRC32_VALUE(crc) != header->payloadCRC )
+            cacheIsValid = NO;
+    }
+
+    if ( cacheIsValid )
+        cacheIsValid =
+            bsptree_cache_nodes_valid(
+                cachedBSPTree,
+                header->numberOfBSPNodes,
+                header->numberOfLeafArrays
+                );
+
+    if ( cacheIsValid )
+    {
+        long  numberOfLeafReferences = 0;
+
+        for ( int i = 0; i < header->numberOfLeafArrays; i++ )
+        {
+            if ( leafArraySize[i] < 0 )
+                cacheIsValid = NO;
+
+            numberOfLeafReferences += leafArraySize[i];
+        }
+
+        if ( numberOfLeafReferences != header->numberOfLeafReferences )
+            cacheIsValid = NO;
+
+        for ( long i = 0; cacheIsValid && i < numberOfLeafReferences; i++ )
+            if ( leafIndex[i] < 0 || leafIndex[i] >= numberOfLeaves )
+                cacheIsValid = NO;
+    }
+
+    if ( ! cacheIsValid )
+    {
+        munmap( mapping, mappingSize );
+        return NO;
+    }
+
+    mappedCache     = mapping;
+    mappedCacheSize = mappingSize;
+
+    bspTree                   = cachedBSPTree;
+    indexOfNextFreeBSPNode    = header->numberOfBSPNodes;
+    numberOfAllocatedBSPNodes = header->numberOfBSPNodes;
+
+    indexOfNextFreeLeafArray    = header->numberOfLeafArrays;
+    numberOfAllocatedLeafArrays = header->numberOfLeafArrays;
+
+    scenegraphLeafArray =
+        ALLOC_ARRAY( ArSGLPArray, M_MAX( numberOfAllocatedLeafArrays, 1 ) );
+
+    for ( int i = 0; i < numberOfAllocatedLeafArrays; i++ )
+    {
+        ArSGLPArray  * sglp = & scenegraphLeafArray[i];
+
+        SGLPARRAY(*sglp) = ALLOC_ARRAY( ArSGL *, leafArraySize[i] );
+        SGLPARRAY_N(*sglp) = leafArraySize[i];
+
+        for ( int j = 0; j < leafArraySize[i]; j++ )
+            SGLPARRAY_I( *sglp, j ) =
+                PTR_TO_MASTER_LEAF_I( *leafIndex++ );
+    }
+
+    maximumNumberOfLeavesPerCell = header->maximumNumberOfLeavesPerCell;
+    numberOfLeafCells            = header->numberOfLeafCells;
+    numberOfInnerCells           = header->numberOfInnerCells;
+
+    aabbForAllLeaves = header->aabbForAllLeaves;
+
+    //   The link between the ArOpLeafs and the ArSGLs is set up just as
+    //   in _createBSPTree.
+
+    if ( OPERATION_TREE )
+        for ( long i = 0; i < numberOfLeaves; i++ )
+            MASTER_OPERATION_ARRAY[PTR_TO_MASTER_LEAF_I(i)->leafInOperationTree].data =
+                (unsigned long)PTR_TO_MASTER_LEAF_I(i);
+
+    return YES;
+}
+
+- (void) _writeBSPTreeToCache
+        : (UInt32) leafBoxCRC
+{
+    long  numberOfLeaves =
+        arsgldynarray_size( & MASTER_LEAF_ARRAY );
+
+    long  numberOfLeafReferences = 0;
+
+    for ( int i = 0; i < indexOfNextFreeLeafArray; i++ )
+        numberOfLeafReferences += SGLPARRAY_N( scenegraphLeafArray[i] );
+
+    ArBSPTreeCacheHeader  header;
+
+    memset( & header, 0, sizeof(ArBSPTreeCacheHeader) );
+
+    header.magic                        = BSP_CACHE_MAGIC;
+    header.version                      = BSP_CACHE_VERSION;
+    header.leafBoxCRC                   = leafBoxCRC;
+    header.sizeOfBSPNode                = sizeof(BSPNode);
+    header.numberOfLeaves               = numberOfLeaves;
+    header.numberOfBSPNodes             = indexOfNextFreeBSPNode;
+    header.numberOfLeafArrays           = indexOfNextFreeLeafArray;
+    header.numberOfLeafReferences       = numberOfLeafReferences;
+    header.maximumNumberOfLeavesPerCell = maximumNumberOfLeavesPerCell;
+    header.numberOfLeafCells            = numberOfLeafCells;
+    header.numberOfInnerCells           = numberOfInnerCells;
+    header.splitSearch                  = splitSearch;
+    header.aabbForAllLeaves             = aabbForAllLeaves;
+
+    Int32  * leafArraySize =
+        ALLOC_ARRAY( Int32, M_MAX( indexOfNextFreeLeafArray, 1 ) );
+
+    Int32  * leafIndex =
+        ALLOC_ARRAY( Int32, M_MAX( numberOfLeafReferences, 1 ) );
+
+    long  k = 0;
+
+    for ( int i = 0; i < indexOfNextFreeLeafArray; i++ )
+    {
+        ArSGLPArray  * sglp = & scenegraphLeafArray[i];
+
+        leafArraySize[i] = SGLPARRAY_N(*sglp);
+
+        for ( int j = 0; j < SGLPARRAY_N(*sglp); j++ )
+            leafIndex[k++] =
+                (Int32) ( SGLPARRAY_I(*sglp, j) - PTR_TO_MASTER_LEAF_I(0) );
+    }
+
+    UInt32  crc = CRC32_INITIAL_VALUE;
+
+    crc32_update_with_data(
+        & crc,
+          bspTree,
+          sizeof(BSPNode) * indexOfNextFreeBSPNode
+        );
+    crc32_update_with_data(
+        & crc,
+          leafArraySize,
+          sizeof(Int32) * indexOfNextFreeLeafArray
+        );
+    crc32_update_with_data(
+        & crc,
+          leafIndex,
+          sizeof(Int32) * numberOfLeafReferences
+        );
+
+    header.payloadCRC = CRC32_VALUE(crc);
+
+    //   The file is written under a temporary name first, so that
+    //   concurrent runs never see a partially written cache.
+
+    char  * temporaryFileName =
+        ALLOC_ARRAY( char, strlen(cacheFileName) + 5 );
+
+    sprintf( temporaryFileName, "%s.tmp", cacheFileName );
+
+    FILE  * cacheFile = fopen( temporaryFileName, "wb" );
+
+    BOOL  writeSucceeded = ( cacheFile != 0 );
+
+    if ( cacheFile )
+    {
+        writeSucceeded =
+               fwrite( & header, sizeof(ArBSPTreeCacheHeader), 1, cacheFile ) == 1
+            && fwrite( bspTree, sizeof(BSPNode), indexOfNextFreeBSPNode, cacheFile )
+               == (size_t) indexOfNextFreeBSPNode
+            && fwrite( leafArraySize, sizeof(Int32), indexOfNextFreeLeafArray, cacheFile )
+               == (size_t) indexOfNextFreeLeafArray
+            && fwrite( leafIndex, sizeof(Int32), numberOfLeafReferences, cacheFile )
+               == (size_t) numberOfLeafReferences;
+
+        if ( fclose( cacheFile ) )
+            writeSucceeded = NO;
+
+        if ( writeSucceeded )
+            writeSucceeded = ( rename( temporaryFileName, cacheFileName ) == 0 );
+
+        if ( ! writeSucceeded )
+            unlink( temporaryFileName );
+    }
+
+    if ( ! writeSucceeded )
+        ART_ERRORHANDLING_WARNING(
+            "could not write BSP tree cache file '%s'"
+            ,   cacheFileName
+            );
+
+    FREE_ARRAY( temporaryFileName );
+    FREE_ARRAY( leafIndex );
+    FREE_ARRAY( leafArraySize );
+}
+
+- (BOOL) wasLoadedFromCache
+{
+    return ( mappedCache != 0 );
+}
+
 - (void) _freeBSPTree
 {
-    FREE_ARRAY( bspTree );
+    if ( mappedCache )
+    {
+        munmap( mappedCache, mappedCacheSize );
+
+        mappedCache     = 0;
+        mappedCacheSize = 0;
+    }
+    else
+        FREE_ARRAY( bspTree );
 
     for ( int i = 0; i < indexOfNextFreeLeafArray; i++ )
         arsglparray_free_contents(
@@ -1401,6 +2357,38 @@ void bspTree_debugprintf(
         : (ArNodeRef) originalScenegraphRef
         : (ArnLeafNodeBBoxCollection *) leafNodeBBoxes
         : (ArnOperationTree*) operationTree
+{
+    return
+        [ self init
+            :   originalScenegraphRef
+            :   leafNodeBBoxes
+            :   operationTree
+            :   arbsptreesplitsearch_sorted_events
+            ];
+}
+
+- (id) init
+        : (ArNodeRef) originalScenegraphRef
+        : (ArnLeafNodeBBoxCollection *) leafNodeBBoxes
+        : (ArnOperationTree*) operationTree
+        : (ArBSPTreeSplitSearch) newSplitSearch
+{
+    return
+        [ self init
+            :   originalScenegraphRef
+            :   leafNodeBBoxes
+            :   operationTree
+            :   newSplitSearch
+            :   0
+            ];
+}
+
+- (id) init
+        : (ArNodeRef) originalScenegraphRef
+        : (ArnLeafNodeBBoxCollection *) leafNodeBBoxes
+        : (ArnOperationTree*) operationTree
+        : (ArBSPTreeSplitSearch) newSplitSearch
+        : (const char *) newCacheFileName
 {
     self =
         [ super init
@@ -1421,11 +2409,39 @@ void bspTree_debugprintf(
 
         outputBSPStatistics    = NO;
         createBSPVisualisation = NO;
+        splitSearch            = newSplitSearch;
+
+        //   Scenes without CSG operations - which is most of them - only
+        //   have union and leaf nodes in their operation tree. For these,
+        //   OR-ing the leaf intersection lists during the traversal gives
+        //   the same result, and allows early exits for any-hit queries;
+        //   the operation tree is only evaluated for actual CSG scenes.
+
+        operationTreeNeeded =
+               OPERATION_TREE
+            && ! [ OPERATION_TREE containsOnlyUnionsAndLeaves ];
+
+        cacheFileName   =
+            newCacheFileName ? arsymbol( art_gv, newCacheFileName ) : 0;
+        mappedCache     = 0;
+        mappedCacheSize = 0;
 
         //   Create a BSP tree for all the leaves in the
-        //   leaf node BBox colleciton.
+        //   leaf node BBox colleciton - or map a previously
+        //   built one, if there is a cache file that fits.
 
-        [ self _createBSPTree ];
+        if ( cacheFileName && ! createBSPVisualisation )
+        {
+            UInt32  leafBoxCRC = [ self _leafBoxCRC ];
+
+            if ( ! [ self _loadBSPTreeFromCache: leafBoxCRC ] )
+            {
+                [ self _createBSPTree ];
+                [ self _writeBSPTreeToCache: leafBoxCRC ];
+            }
+        }
+        else
+            [ self _createBSPTree ];
 
         //   If we want to visualise the result...
 
@@ -1577,8 +2593,16 @@ void getLeafShapeIntersectionList(
             RANGE(ARNRAYCASTER_EPSILON(rayCaster),MATH_HUGE_DOUBLE),
             intersectionList
             );
+
+        ARNRAYCASTER_COUNT_PRIMITIVE_TEST(
+            rayCaster,
+            ARSGL_SHAPE_CLASS_NUMBER(*sgl),
+            ARINTERSECTIONLIST_HEAD(*intersectionList)
+            );
 #ifdef WITH_MAILBOXING
     }
+    else
+        ARNRAYCASTER_COUNT( rayCaster, mailboxHits );
 #endif
 }
 
@@ -1815,6 +2839,7 @@ void intersectRayWithBSPTree(
     {
         while( ! BSP_NODE_IS_LEAF(*node) )
         {
+            ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
 #ifdef WITH_RSA_STATISTICS
             (*traversalSteps)++;
 #endif
@@ -1872,6 +2897,8 @@ void intersectRayWithBSPTree(
 
                 // the bsp-tree traversal has now found a leaf node.
                 // get the shapes refered from the bsp leaf node.
+        ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
+
         ArSGLPArray* leafNodeShapeArray =
             & scenegraphLeafArray[ BSP_NODE_LEAF_INDEX(*node) ];
 
@@ -1929,6 +2956,14 @@ void intersectRayWithBSPTree(
                     *intersectionList = leafIL;
                 }
 
+                //   During any-hit queries, the first occluder is all we
+                //   need; which one it is does not matter.
+
+                if ( arnraycaster_intersectionlist_contains_occluder(
+                           rayCaster,
+                           intersectionList ) )
+                    return;
+
                 // Early exit - if the closest intersection is in our
                 // current cell (t_head < t_max), we can stop.
 
@@ -2019,6 +3054,7 @@ void intersectRayWithBSPTree_UseOpTree(
     {
         while( ! BSP_NODE_IS_LEAF(*node) )
         {
+            ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
 #ifdef WITH_RSA_STATISTICS
             (*traversalSteps)++;
 #endif
@@ -2072,6 +3108,8 @@ void intersectRayWithBSPTree_UseOpTree(
         // the bsp-tree traversal has now found a leaf node.
         // get the shapes refered from the bsp leaf node.
         
+        ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
+
         ArSGLPArray  * leafNodeShapeArray =
             & scenegraphLeafArray[ BSP_NODE_LEAF_INDEX(*node) ];
 
@@ -2229,7 +3267,7 @@ void flagDebugPrint(ArnRayCaster* rayCaster, long size)
 
 #else // USE_ORIGINAL_SCENEGRAPH_FOR_RAYCASTING
 
-    if( OPERATION_TREE )
+    if( operationTreeNeeded )
     {
         //set up the active node flag array in the raycaster. If is not done jet.
         if( !rayCaster->activeNodes )
@@ -2269,6 +3307,14 @@ void flagDebugPrint(ArnRayCaster* rayCaster, long size)
               range_of_t
             );
 
+        //   The operation tree combines the leaf intersection lists, so
+        //   these have to be complete: no early exits for any-hit queries
+        //   while it assembles them.
+
+        BOOL  occlusionTest = ARNRAYCASTER_OCCLUSION_TEST(rayCaster);
+
+        ARNRAYCASTER_OCCLUSION_TEST(rayCaster) = NO;
+
         if( rayCaster->activeNodes[0] )
         {
             MASTER_OPERATION_ARRAY->intersectFunction(
@@ -2279,6 +3325,8 @@ void flagDebugPrint(ArnRayCaster* rayCaster, long size)
                 );
         }
 
+        ARNRAYCASTER_OCCLUSION_TEST(rayCaster) = occlusionTest;
+
 #ifdef WITH_RSA_STATISTICS
         intersectionList->traversalSteps = traversalSteps;
 #endif        
@@ -2305,7 +3353,11 @@ void flagDebugPrint(ArnRayCaster* rayCaster, long size)
             );
     }
 
-    if ( !ARINTERSECTIONLIST_HEAD(*intersectionList) && INFSPHERE )
+    //   The infinite sphere never occludes anything, so any-hit queries
+    //   can skip it.
+
+    if (   !ARINTERSECTIONLIST_HEAD(*intersectionList) && INFSPHERE
+        && ! ARNRAYCASTER_OCCLUSION_TEST(rayCaster) )
     {
         // the intersection list was empty but there is an infinit sphere
         // so intersect that.
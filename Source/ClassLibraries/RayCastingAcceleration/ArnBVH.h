@@ -0,0 +1,95 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#include "ART_Foundation.h"
+
+ART_MODULE_INTERFACE(ArnBVH)
+
+#include "ART_Scenegraph.h"
+
+#import "ArnLeafNodeBBoxCollection.h"
+
+/* ---------------------------------------------------------------------------
+
+    'ArnBVH' class
+
+    Bounding volume hierarchy over the scene graph leaf nodes collected in
+    an ArnLeafNodeBBoxCollection. This is an alternative to ArnBSPTree: it
+    takes exactly the same inputs, and can be used wherever an ArnBSPTree
+    is used.
+
+    The hierarchy is built top-down with a binned SAH, and stored as one
+    flat, cache aligned array of 32-byte BVHNode structs. In contrast to
+    the kd-tree, each scene graph leaf is referenced exactly once, so the
+    memory needed is bounded by (2N-1) nodes plus one pointer per leaf.
+
+    Coherent packets of rays (see ArpRayPacketCasting) traverse the
+    hierarchy together: each node box is tested against all rays of the
+    packet at once, and a subtree is only skipped if none of them hit it.
+
+    An ArnBVH can also serve as the shared bottom level structure of
+    instanced geometry (see ArnLeafNodeBBoxCollection): it then treats the
+    object space ray it is handed as its "world" ray.
+
+------------------------------------------------------------------------aw- */
+
+@interface ArnBVH
+        : ArnTernary
+        < ArpConcreteClass, ArpRayCasting, ArpRayPacketCasting >
+{
+    BOOL           outputBVHStatistics;
+    BOOL           operationTreeNeeded;
+
+    BVHNode      * bvhNodes;
+    long           numberOfBVHNodes;
+
+    ArSGL       ** primitiveArray;
+    long           numberOfPrimitives;
+
+    Box3D          aabbForAllLeaves;
+
+    int            maximumNumberOfLeavesPerNode;
+    int            maximumTreeDepth;
+    int            numberOfLeafNodes;
+    int            numberOfInnerNodes;
+}
+
+- (id) init
+        : (ArNodeRef) originalScenegraphRef
+        : (ArnLeafNodeBBoxCollection *) leafNodeBBoxes
+        : (ArnOperationTree *) newOperationTree
+        ;
+
+- (void) getBBoxOfAllLeaves
+        : (Box3D *) outBBox
+        ;
+
+- (BOOL) usesOperationTree
+        ;
+
+@end
+
+// ===========================================================================
@@ -0,0 +1,939 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#define ART_MODULE_NAME     ArnBVH
+
+#import "ArnBVH.h"
+#import "ArnRayCaster.h"
+
+#import "ART_Shape.h"
+
+#import "ArnLeafNodeBBoxCollection.h"
+
+ART_MODULE_INITIALISATION_FUNCTION
+(
+    (void) art_gv;
+    [ ArnBVH registerWithRuntime ];
+)
+
+ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
+
+
+#define ORIGINAL_SCENEGRAPH     ((ArNode <ArpRayCasting> *)ARNTERNARY_SUBNODE_0)
+#define LEAFNODE_BBOXES         ((ArnLeafNodeBBoxCollection*)ARNTERNARY_SUBNODE_1)
+#define OPERATION_TREE          ((ArnOperationTree*)ARNTERNARY_SUBNODE_2)
+
+#define MASTER_LEAF_ARRAY       (LEAFNODE_BBOXES->sgl_dynarray)
+#define MASTER_OPERATION_ARRAY  (OPERATION_TREE->opNodeArray)
+
+#define PTR_TO_MASTER_LEAF_I(__i)    \
+        arsgldynarray_ptr_to_i( & MASTER_LEAF_ARRAY, (__i) )
+
+#define MASTER_LEAF_I_BBOX(__i)    \
+        ARSGL_BOX3D(*arsgldynarray_ptr_to_i( & MASTER_LEAF_ARRAY, (__i) ))
+
+//   Build parameters. The leaves are kept fairly large, since a scene
+//   graph leaf is expensive to intersect compared to a node box.
+
+#define BVH_MAX_LEAF_SIZE       8
+
+
+@implementation ArnBVH
+
+ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnBVH)
+
+- (void) _createBVH
+{
+    numberOfPrimitives =
+        arsgldynarray_size( & MASTER_LEAF_ARRAY );
+
+    aabbForAllLeaves = BOX3D_EMPTY;
+
+    BVHBuildPrimitive  * primitives =
+        ALLOC_ARRAY( BVHBuildPrimitive, M_MAX( numberOfPrimitives, 1 ) );
+
+    for ( long i = 0; i < numberOfPrimitives; i++ )
+    {
+        //   Same link between ArOpLeaf and ArSGL that ArnBSPTree sets up
+
+        if ( OPERATION_TREE )
+        {
+            MASTER_OPERATION_ARRAY[PTR_TO_MASTER_LEAF_I(i)->leafInOperationTree].data =
+                (unsigned long)PTR_TO_MASTER_LEAF_I(i);
+        }
+
+        primitives[i].index = i;
+        primitives[i].box   = MASTER_LEAF_I_BBOX(i);
+
+        box3d_b_center_p(
+            & primitives[i].box,
+            & primitives[i].centroid
+            );
+
+        box3d_b_add_b(
+            & MASTER_LEAF_I_BBOX(i),
+            & aabbForAllLeaves
+            );
+    }
+
+    //   Scenes without CSG operations only have union and leaf nodes in
+    //   their operation tree. For these, OR-ing the leaf intersection
+    //   lists during the traversal gives the same result, so the
+    //   operation tree is only used if it contains anything else. This
+    //   also allows ray packets and early exits for any-hit queries.
+
+    operationTreeNeeded =
+           OPERATION_TREE
+        && ! [ OPERATION_TREE containsOnlyUnionsAndLeaves ];
+
+    //   An empty scene gets no nodes at all.
+
+    BVHBuildStatistics  statistics;
+
+    bvhNodes =
+        bvhtree_build_binned_sah(
+              primitives,
+              numberOfPrimitives,
+              BVH_MAX_LEAF_SIZE,
+            & numberOfBVHNodes,
+            & statistics
+            );
+
+    //   The primitive order is now final - we only keep the pointers.
+
+    primitiveArray = ALLOC_ARRAY( ArSGL *, M_MAX( numberOfPrimitives, 1 ) );
+
+    for ( long i = 0; i < numberOfPrimitives; i++ )
+        primitiveArray[i] = PTR_TO_MASTER_LEAF_I( primitives[i].index );
+
+    FREE_ARRAY( primitives );
+
+    maximumNumberOfLeavesPerNode = statistics.maximumNumberOfPrimitivesPerLeaf;
+    maximumTreeDepth   = statistics.maximumTreeDepth;
+    numberOfLeafNodes  = statistics.numberOfLeafNodes;
+    numberOfInnerNodes = statistics.numberOfInnerNodes;
+
+    if ( outputBVHStatistics )
+    {
+        printf(
+            "\nNumber of leaf nodes: %d\n"
+            ,   numberOfLeafNodes
+            );
+        printf(
+            "Number of interior nodes: %d\n"
+            ,   numberOfInnerNodes
+            );
+        printf(
+            "Maximum number of shapes per leaf: %d\n"
+            ,   maximumNumberOfLeavesPerNode
+            );
+        printf(
+            "Maximum tree depth: %d\n"
+            ,   maximumTreeDepth
+            );
+        printf(
+            "Node memory: %lu bytes\n\n"
+            ,   (unsigned long)( numberOfBVHNodes * sizeof(BVHNode) )
+            );
+    }
+}
+
+- (void) _freeBVH
+{
+    bvhnode_free_array( bvhNodes );
+    FREE_ARRAY( primitiveArray );
+}
+
+- (id) init
+        : (ArNodeRef) originalScenegraphRef
+        : (ArnLeafNodeBBoxCollection *) leafNodeBBoxes
+        : (ArnOperationTree *) operationTree
+{
+    self =
+        [ super init
+            :   originalScenegraphRef
+            :   HARD_NODE_REFERENCE(leafNodeBBoxes)
+            :   HARD_NODE_REFERENCE(operationTree)
+            ];
+
+    if ( self )
+    {
+        //   Fail if we are not given something that we could
+        //   be raycasting (i.e. valid scene geometry).
+
+        ART_ERRORHANDLING_MANDATORY_ARPROTOCOL_CHECK(
+            ARNBINARY_SUBNODE_0,
+            ArpRayCasting
+            );
+
+        outputBVHStatistics = NO;
+
+        [ self _createBVH ];
+    }
+
+    return self;
+}
+
+- (void) getBBoxOfAllLeaves
+        : (Box3D *) outBBox
+{
+    *outBBox = aabbForAllLeaves;
+}
+
+- (BOOL) usesOperationTree
+{
+    return operationTreeNeeded;
+}
+
+- (void) dealloc
+{
+    [ self _freeBVH ];
+
+    [ super dealloc ];
+}
+
+- (id) copy
+{
+    ArnBVH  * copiedInstance = [ super copy ];
+
+    ART__CODE_IS_WORK_IN_PROGRESS__EXIT_WITH_ERROR
+
+    return copiedInstance;
+}
+
+- (id) deepSemanticCopy
+        : (ArnGraphTraversal *) traversal
+{
+    ArnBVH  * copiedInstance =
+        [ super deepSemanticCopy
+            :   traversal
+            ];
+
+    ART__CODE_IS_WORK_IN_PROGRESS__EXIT_WITH_ERROR
+
+    return copiedInstance;
+}
+
+ARPRAYCASTING_DEFAULT_IMPLEMENTATION(ArnBVH)
+
+- (void) getArcSurfacePoint_for_WorldPnt3DE
+        : (ArnRayCaster *) rayCaster
+        : (ArcSurfacePoint **) surfacePoint
+{
+    [ ORIGINAL_SCENEGRAPH getArcSurfacePoint_for_WorldPnt3DE
+        :   rayCaster
+        :   surfacePoint
+        ];
+}
+
+- (ArNode <ArpVolumeMaterial> *) volumeMaterial_at_WorldPnt3D
+        : (ArnRayCaster *) rayCaster
+{
+    return
+        [ ORIGINAL_SCENEGRAPH volumeMaterial_at_WorldPnt3D
+            :   rayCaster
+            ];
+}
+
+#define RAYCASTER_VIEWING_RAY3D     ARNRAYCASTER_OBJECTSPACE_RAY(rayCaster)
+#define RAYCASTER_VIEWING_VECTOR3D  ARNRAYCASTER_OBJECTSPACE_RAY_VECTOR(rayCaster)
+#define RAYCASTER_VIEWING_INVVEC3D  ARNRAYCASTER_OBJECTSPACE_RAY_INVVEC(rayCaster)
+#define RAYCASTER_VIEWING_RAYDIR    ARNRAYCASTER_OBJECTSPACE_RAYDIR(rayCaster)
+#define RAYCASTER_STATE             ARNRAYCASTER_TRAVERSALSTATE(rayCaster)
+
+/* ---------------------------------------------------------------------------
+
+    Traversal
+
+    Since every scene graph leaf is referenced by exactly one BVH leaf,
+    there is no need for the mailboxing ArnBSPTree has to do: each leaf
+    shape the ray can possibly hit is tested exactly once.
+
+    Just like ArnBSPTree, the traversal returns all intersections along the
+    ray, not just the closest one; solid triangle meshes and the CSG
+    operation tree both rely on this.
+
+------------------------------------------------------------------------aw- */
+
+//   Slab test of the ray against the single precision node box. The
+//   direction signs are taken from the inverse vector, so that rays with
+//   a -0.0 direction component are handled correctly; IEEE NaNs from
+//   0 * inf products fail all comparisons, and are thus ignored.
+
+static inline BOOL _bvhnode_ray_overlap(
+        const BVHNode  * node,
+        const double   * origin,
+        const double   * invDir,
+        const int      * dirIsNegative,
+              double     tMin,
+              double     tMax
+        )
+{
+    for ( int i = 0; i < 3; i++ )
+    {
+        double  tNear =
+              ( ( dirIsNegative[i] ? node->max[i] : node->min[i] ) - origin[i] )
+            * invDir[i];
+        double  tFar =
+              ( ( dirIsNegative[i] ? node->min[i] : node->max[i] ) - origin[i] )
+            * invDir[i];
+
+        if ( tNear > tMin ) tMin = tNear;
+        if ( tFar  < tMax ) tMax = tFar;
+    }
+
+    return tMin <= tMax;
+}
+
+static void _bvh_merge_intersection_lists(
+        ArnRayCaster        * rayCaster,
+        ArIntersectionList  * leafIL,
+        ArIntersectionList  * intersectionList
+        )
+{
+    if ( ARINTERSECTIONLIST_HEAD(*leafIL) )
+    {
+        if ( ARINTERSECTIONLIST_HEAD(*intersectionList) )
+        {
+            arintersectionlist_or(
+                  intersectionList,
+                  leafIL,
+                  intersectionList,
+                  ARNRAYCASTER_INTERSECTION_FREELIST(rayCaster),
+                  ARNRAYCASTER_EPSILON(rayCaster)
+                );
+        }
+        else
+        {
+            *intersectionList = *leafIL;
+        }
+    }
+}
+
+static void _bvh_leaf_intersection_list(
+        ArSGL               * sgl,
+        ArnRayCaster        * rayCaster,
+        Ray3D               * worldViewingRay3D,
+        ArIntersectionList  * intersectionList
+        )
+{
+    ray3d_r_htrafo3d_r(
+          worldViewingRay3D,
+        & ARSGL_TRAFO(*sgl),
+        & RAYCASTER_VIEWING_RAY3D
+        );
+
+    vec3d_vd_div_v(
+        & RAYCASTER_VIEWING_VECTOR3D,
+          1.0,
+        & RAYCASTER_VIEWING_INVVEC3D
+        );
+
+    RAYCASTER_VIEWING_RAYDIR =
+        ray3ddir_init(
+            & RAYCASTER_VIEWING_RAY3D
+            );
+
+    ArIntersectionList  leafIL = ARINTERSECTIONLIST_EMPTY;
+
+    ARSGL_GET_INTERSECTION_LIST(
+          *sgl,
+          rayCaster,
+          RANGE(ARNRAYCASTER_EPSILON(rayCaster),MATH_HUGE_DOUBLE),
+        & leafIL
+        );
+
+    ARNRAYCASTER_COUNT_PRIMITIVE_TEST(
+        rayCaster,
+        ARSGL_SHAPE_CLASS_NUMBER(*sgl),
+        ARINTERSECTIONLIST_HEAD(leafIL)
+        );
+
+    _bvh_merge_intersection_lists(
+          rayCaster,
+        & leafIL,
+          intersectionList
+        );
+}
+
+void intersectRayWithBVH(
+        BVHNode             * bvhNodes,
+        ArSGL              ** primitiveArray,
+        ArOpNode            * opArray,
+        ArnRayCaster        * rayCaster,
+        Range                 range_of_t,
+#ifdef WITH_RSA_STATISTICS
+        unsigned int        * traversalSteps,
+#endif
+        ArIntersectionList  * intersectionList
+        )
+{
+#ifdef WITH_RSA_STATISTICS
+    *traversalSteps = 0;
+#endif
+    if ( ! bvhNodes )
+        return;
+
+    Ray3D  worldViewingRay3D = RAYCASTER_VIEWING_RAY3D;
+
+    double  origin[3];
+    double  invDir[3];
+    int     dirIsNegative[3];
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        origin[i]        = RAY3D_PI( worldViewingRay3D, i );
+        invDir[i]        = 1.0 / RAY3D_VI( worldViewingRay3D, i );
+        dirIsNegative[i] = signbit( invDir[i] ) ? 1 : 0;
+    }
+
+    double  tMin = RANGE_MIN(range_of_t);
+    double  tMax = RANGE_MAX(range_of_t);
+
+    if ( ! _bvhnode_ray_overlap(
+               & bvhNodes[0], origin, invDir, dirIsNegative, tMin, tMax ) )
+        return;
+
+    long  bvhStack[ BVH_MAX_TREE_DEPTH ];
+    int   bvhStackPtr = -1;
+
+    long  nodeIndex = 0;
+
+    while ( 1 )
+    {
+        BVHNode  * node = & bvhNodes[nodeIndex];
+
+        ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
+
+        if ( BVH_NODE_IS_INNER(*node) )
+        {
+#ifdef WITH_RSA_STATISTICS
+            (*traversalSteps)++;
+#endif
+            //   Visit the child on the near side of the split axis first.
+
+            long  nearChild = nodeIndex + 1;
+            long  farChild  = BVH_NODE_SECOND_CHILD(*node);
+
+            if ( dirIsNegative[ BVH_NODE_SPLIT_AXIS(*node) ] )
+            {
+                long  temp = nearChild;
+                nearChild  = farChild;
+                farChild   = temp;
+            }
+
+            BOOL  hitNear =
+                _bvhnode_ray_overlap(
+                    & bvhNodes[nearChild],
+                      origin, invDir, dirIsNegative, tMin, tMax
+                    );
+            BOOL  hitFar =
+                _bvhnode_ray_overlap(
+                    & bvhNodes[farChild],
+                      origin, invDir, dirIsNegative, tMin, tMax
+                    );
+
+            if ( hitNear && hitFar )
+            {
+                bvhStack[ ++bvhStackPtr ] = farChild;
+                nodeIndex = nearChild;
+                continue;
+            }
+
+            if ( hitNear )
+            {
+                nodeIndex = nearChild;
+                continue;
+            }
+
+            if ( hitFar )
+            {
+                nodeIndex = farChild;
+                continue;
+            }
+        }
+        else
+        {
+            long  first = BVH_NODE_PRIMITIVE_OFFSET(*node);
+            long  count = BVH_NODE_PRIMITIVE_COUNT(*node);
+
+            for ( long i = first; i < first + count; i++ )
+            {
+                if ( opArray )
+                {
+                    //   With an operation tree, the leaves are only marked
+                    //   as active here, and the actual intersection lists
+                    //   are assembled by the operation tree afterwards.
+
+                    setActive(
+                          primitiveArray[i]->leafInOperationTree,
+                          rayCaster->activeNodes,
+                          opArray
+                        );
+                }
+                else
+                {
+                    _bvh_leaf_intersection_list(
+                          primitiveArray[i],
+                          rayCaster,
+                        & worldViewingRay3D,
+                          intersectionList
+                        );
+
+                    //   During any-hit queries, we can stop at the first
+                    //   occluder.
+
+                    if ( arnraycaster_intersectionlist_contains_occluder(
+                               rayCaster,
+                               intersectionList ) )
+                        return;
+                }
+            }
+        }
+
+        if ( bvhStackPtr == -1 )
+            return;
+
+        nodeIndex = bvhStack[ bvhStackPtr-- ];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+
+    Packet traversal
+
+    Each node box is tested against all active rays of the packet in one
+    go, and the traversal carries along the mask of rays that hit the
+    current node. Since all rays of a packet share their direction signs,
+    the near/far child order is the same for all of them.
+
+    At the leaves, shapes that support packets (e.g. triangle meshes) get
+    all rays that reached them in one call; for all others, the rays are
+    intersected one by one.
+
+------------------------------------------------------------------------aw- */
+
+static void _bvh_leaf_packet_intersection_lists(
+              ArSGL               * sgl,
+              ArnRayCaster        * rayCaster,
+        const Ray3D               * worldViewingRays,
+              unsigned int          numberOfRays,
+              unsigned int          laneMask,
+              ArIntersectionList  * intersectionLists
+        )
+{
+    //   A single ray is not worth the packet setup.
+
+    if (   ! ARSGL_SUPPORTS_RAY_PACKETS(*sgl)
+        || ! ( laneMask & ( laneMask - 1 ) ) )
+    {
+        for ( unsigned int i = 0; i < numberOfRays; i++ )
+        {
+            if ( ! ( laneMask & ( 1U << i ) ) )
+                continue;
+
+            Ray3D  worldViewingRay3D = worldViewingRays[i];
+
+            arnraycaster_select_packet_ray(
+                  rayCaster,
+                  i,
+                & worldViewingRay3D
+                );
+
+            _bvh_leaf_intersection_list(
+                  sgl,
+                  rayCaster,
+                & worldViewingRay3D,
+                & intersectionLists[i]
+                );
+        }
+
+        return;
+    }
+
+    Ray3D               objectspaceRays[ RAY3DPACKET_MAX_SIZE ];
+    ArIntersectionList  leafIL[ RAY3DPACKET_MAX_SIZE ];
+
+    for ( unsigned int i = 0; i < numberOfRays; i++ )
+    {
+        if ( ! ( laneMask & ( 1U << i ) ) )
+            continue;
+
+        ray3d_r_htrafo3d_r(
+            & worldViewingRays[i],
+            & ARSGL_TRAFO(*sgl),
+            & objectspaceRays[i]
+            );
+
+        leafIL[i] = ARINTERSECTIONLIST_EMPTY;
+    }
+
+    ARSGL_GET_INTERSECTION_LISTS(
+          *sgl,
+          rayCaster,
+          objectspaceRays,
+          numberOfRays,
+          laneMask,
+          RANGE(ARNRAYCASTER_EPSILON(rayCaster),MATH_HUGE_DOUBLE),
+          leafIL
+        );
+
+    for ( unsigned int i = 0; i < numberOfRays; i++ )
+    {
+        if ( laneMask & ( 1U << i ) )
+        {
+            ARNRAYCASTER_COUNT_PRIMITIVE_TEST(
+                rayCaster,
+                ARSGL_SHAPE_CLASS_NUMBER(*sgl),
+                ARINTERSECTIONLIST_HEAD(leafIL[i])
+                );
+
+            _bvh_merge_intersection_lists(
+                  rayCaster,
+                & leafIL[i],
+                & intersectionLists[i]
+                );
+        }
+    }
+}
+
+static void intersectRayPacketWithBVH(
+              BVHNode             * bvhNodes,
+              ArSGL              ** primitiveArray,
+              ArnRayCaster        * rayCaster,
+        const Ray3DPacket         * packet,
+        const Ray3D               * worldViewingRays,
+              unsigned int          activeMask,
+              Range                 range_of_t,
+              ArIntersectionList  * intersectionLists
+        )
+{
+    if ( ! bvhNodes )
+        return;
+
+    double  tMin = RANGE_MIN(range_of_t);
+    double  tMax = RANGE_MAX(range_of_t);
+
+    unsigned int  laneMask =
+        ray3dpacket_box_hit_mask(
+              packet,
+              bvhNodes[0].min,
+              bvhNodes[0].max,
+              tMin,
+              tMax,
+              activeMask
+            );
+
+    if ( ! laneMask )
+        return;
+
+    long          bvhStack[ BVH_MAX_TREE_DEPTH ];
+    unsigned int  laneMaskStack[ BVH_MAX_TREE_DEPTH ];
+    int           bvhStackPtr = -1;
+
+    long  nodeIndex = 0;
+
+    while ( 1 )
+    {
+        BVHNode  * node = & bvhNodes[nodeIndex];
+
+        ARNRAYCASTER_COUNT( rayCaster, nodesVisited );
+
+        if ( BVH_NODE_IS_INNER(*node) )
+        {
+            long  nearChild = nodeIndex + 1;
+            long  farChild  = BVH_NODE_SECOND_CHILD(*node);
+
+            if ( RAY3DPACKET_DIR_IS_NEGATIVE( *packet, BVH_NODE_SPLIT_AXIS(*node) ) )
+            {
+                long  temp = nearChild;
+                nearChild  = farChild;
+                farChild   = temp;
+            }
+
+            unsigned int  nearMask =
+                ray3dpacket_box_hit_mask(
+                      packet,
+                      bvhNodes[nearChild].min,
+                      bvhNodes[nearChild].max,
+                      tMin,
+                      tMax,
+                      laneMask
+                    );
+            unsigned int  farMask =
+                ray3dpacket_box_hit_mask(
+                      packet,
+                      bvhNodes[farChild].min,
+                      bvhNodes[farChild].max,
+                      tMin,
+                      tMax,
+                      laneMask
+                    );
+
+            if ( nearMask && farMask )
+            {
+                ++bvhStackPtr;
+                bvhStack[ bvhStackPtr ]      = farChild;
+                laneMaskStack[ bvhStackPtr ] = farMask;
+                nodeIndex = nearChild;
+                laneMask  = nearMask;
+                continue;
+            }
+
+            if ( nearMask )
+            {
+                nodeIndex = nearChild;
+                laneMask  = nearMask;
+                continue;
+            }
+
+            if ( farMask )
+            {
+                nodeIndex = farChild;
+                laneMask  = farMask;
+                continue;
+            }
+        }
+        else
+        {
+            long  first = BVH_NODE_PRIMITIVE_OFFSET(*node);
+            long  count = BVH_NODE_PRIMITIVE_COUNT(*node);
+
+            for ( long i = first; i < first + count; i++ )
+                _bvh_leaf_packet_intersection_lists(
+                      primitiveArray[i],
+                      rayCaster,
+                      worldViewingRays,
+                      RAY3DPACKET_SIZE(*packet),
+                      laneMask,
+                      intersectionLists
+                    );
+        }
+
+        if ( bvhStackPtr == -1 )
+            return;
+
+        nodeIndex = bvhStack[ bvhStackPtr ];
+        laneMask  = laneMaskStack[ bvhStackPtr ];
+        --bvhStackPtr;
+    }
+}
+
+#define INFSPHERE         ARLNBBC_INFSPHERE( LEAFNODE_BBOXES )
+#define INFSPHERE_TRAFO   ARLNBBC_INFSPHERE_TRAFO( LEAFNODE_BBOXES )
+#define INFSPHERE_STATE   ARLNBBC_INFSPHERE_STATE( LEAFNODE_BBOXES )
+
+//   Rays that do not hit anything else hit the infinite sphere.
+
+- (void) _intersectInfSphere
+        : (ArnRayCaster *) rayCaster
+        : (struct ArIntersectionList *) intersectionList
+{
+    ray3d_r_htrafo3d_r(
+        & RAYCASTER_VIEWING_RAY3D,
+        & INFSPHERE_TRAFO,
+        & RAYCASTER_VIEWING_RAY3D
+        );
+
+    vec3d_vd_div_v(
+        & RAYCASTER_VIEWING_VECTOR3D,
+          1.0,
+        & RAYCASTER_VIEWING_INVVEC3D
+        );
+
+    RAYCASTER_VIEWING_RAYDIR = ray3ddir_init( & RAYCASTER_VIEWING_RAY3D );
+
+    RAYCASTER_STATE = INFSPHERE_STATE;
+
+    [ INFSPHERE getIntersectionList
+        : rayCaster
+        : RANGE(0,MATH_HUGE_DOUBLE)
+        : intersectionList
+        ];
+}
+
+- (void) getIntersectionList
+        : (ArnRayCaster *) rayCaster
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionList
+{
+#ifdef WITH_RSA_STATISTICS
+    unsigned int  traversalSteps;
+#endif
+
+    if ( operationTreeNeeded )
+    {
+        //   Same active node flag array setup that ArnBSPTree does.
+
+        if ( ! rayCaster->activeNodes )
+        {
+            long  size = [ OPERATION_TREE getOpNodeCount ];
+
+            rayCaster->activeNodes = ALLOC_ARRAY( BOOL, size );
+
+            for ( int i = 0; i < size; ++i )
+                rayCaster->activeNodes[i] = NO;
+        }
+
+        intersectRayWithBVH(
+              bvhNodes,
+              primitiveArray,
+              MASTER_OPERATION_ARRAY,
+              rayCaster,
+              range_of_t,
+#ifdef WITH_RSA_STATISTICS
+            & traversalSteps,
+#endif
+              intersectionList
+            );
+
+        //   The operation tree combines the leaf intersection lists, so
+        //   these have to be complete: no early exits for any-hit queries
+        //   while it assembles them.
+
+        BOOL  occlusionTest = ARNRAYCASTER_OCCLUSION_TEST(rayCaster);
+
+        ARNRAYCASTER_OCCLUSION_TEST(rayCaster) = NO;
+
+        if ( rayCaster->activeNodes[0] )
+        {
+            MASTER_OPERATION_ARRAY->intersectFunction(
+                  0,
+                  MASTER_OPERATION_ARRAY,
+                  rayCaster,
+                  intersectionList
+                );
+        }
+
+        ARNRAYCASTER_OCCLUSION_TEST(rayCaster) = occlusionTest;
+    }
+    else
+    {
+        intersectRayWithBVH(
+              bvhNodes,
+              primitiveArray,
+              NULL,
+              rayCaster,
+              range_of_t,
+#ifdef WITH_RSA_STATISTICS
+            & traversalSteps,
+#endif
+              intersectionList
+            );
+    }
+
+#ifdef WITH_RSA_STATISTICS
+    intersectionList->traversalSteps = traversalSteps;
+#endif
+
+    //   The infinite sphere never occludes anything, so any-hit queries
+    //   can skip it.
+
+    if (   ! ARINTERSECTIONLIST_HEAD(*intersectionList) && INFSPHERE
+        && ! ARNRAYCASTER_OCCLUSION_TEST(rayCaster) )
+        [ self _intersectInfSphere
+            :   rayCaster
+            :   intersectionList
+            ];
+}
+
+- (BOOL) tracesRayPackets
+{
+    return ! operationTreeNeeded;
+}
+
+- (void) getIntersectionLists
+        : (ArnRayCaster *) rayCaster
+        : (const Ray3D *) rays
+        : (unsigned int) numberOfRays
+        : (unsigned int) activeMask
+        : (Range) range_of_t
+        : (struct ArIntersectionList *) intersectionLists
+{
+    Ray3DPacket  packet;
+
+    //   The operation tree can only be evaluated ray by ray, and packets
+    //   with diverging ray directions have to be split up as well.
+
+    if (   operationTreeNeeded
+        || ! ray3dpacket_init( rays, numberOfRays, activeMask, & packet ) )
+    {
+        for ( unsigned int i = 0; i < numberOfRays; i++ )
+        {
+            if ( ! ( activeMask & ( 1U << i ) ) )
+                continue;
+
+            arnraycaster_select_packet_ray( rayCaster, i, & rays[i] );
+
+            [ self getIntersectionList
+                :   rayCaster
+                :   range_of_t
+                : & intersectionLists[i]
+                ];
+        }
+
+        return;
+    }
+
+    for ( unsigned int i = 0; i < numberOfRays; i++ )
+        if ( activeMask & ( 1U << i ) )
+            intersectionLists[i] = ARINTERSECTIONLIST_EMPTY;
+
+    intersectRayPacketWithBVH(
+          bvhNodes,
+          primitiveArray,
+          rayCaster,
+        & packet,
+          rays,
+          activeMask,
+          range_of_t,
+          intersectionLists
+        );
+
+    for ( unsigned int i = 0; i < numberOfRays; i++ )
+    {
+        if ( ! ( activeMask & ( 1U << i ) ) )
+            continue;
+
+#ifdef WITH_RSA_STATISTICS
+        intersectionLists[i].traversalSteps = 0;
+#endif
+
+        if ( ! ARINTERSECTIONLIST_HEAD(intersectionLists[i]) && INFSPHERE )
+        {
+            arnraycaster_select_packet_ray( rayCaster, i, & rays[i] );
+
+            [ self _intersectInfSphere
+                :   rayCaster
+                : & intersectionLists[i]
+                ];
+        }
+    }
+}
+
+@end
+
+// ===========================================================================
@@ -41,6 +41,15 @@ ART_MODULE_INTERFACE(ArnLeafNodeBBoxCollection)
     ArTraversalState  state_at_infsphere;
     HTrafo3D          trafo_world2object_for_infSphere;
     ArSGLDynArray     sgl_dynarray;
+
+    //   Instancing: the shared bottom level BVHs, and the nodes they
+    //   were built for. Collections for instanced subgraphs use the
+    //   cache of the collection they were created by.
+
+    ArnLeafNodeBBoxCollection  * instanceCache;
+    ArNodeRefDynArray            instancedNodeArray;
+    ArNodeRefDynArray            bottomLevelBVHArray;
+    ArNodeRefDynArray            instanceArray;
 }
 
 - (id) init
@@ -60,6 +69,47 @@ ART_MODULE_INTERFACE(ArnLeafNodeBBoxCollection)
         : (int) operationTreeLeaf
         ;
 
+/* ---------------------------------------------------------------------------
+
+    Instancing
+
+    Subgraphs that are used more than once - the targets of ArnReference
+    nodes, and the subnode of an ArnRepeater - are not collected once per
+    copy. Instead, each of them gets one bottom level ArnBVH over its own
+    leaves, which all its instances share.
+
+    The instances are entered into the collection as ordinary leaves: an
+    AraCombinedAttributes node with the shared BVH as its subnode, which
+    carries the transformation and materials that are active at the point
+    of instancing. Rays that reach such a leaf are transformed into the
+    object space of the subgraph, and continue through its BVH. The top
+    level structure thus only grows with the number of instances, not
+    with their size.
+
+    'bottomLevelBVHForInstancedNode' returns the shared BVH for a node if
+    there already is one, and 0 otherwise. For creating it, the subgraph
+    has to be prepared for ray casting, i.e. its attributes have to be
+    pushed to its leaves, and its bounding boxes have to be initialised.
+    Subgraphs that contain CSG operations cannot be instanced.
+
+------------------------------------------------------------------------aw- */
+
+- (ArNode *) bottomLevelBVHForInstancedNode
+        : (ArNode *) instancedNode
+        ;
+
+- (ArNode *) createBottomLevelBVHForInstancedNode
+        : (ArNode *) instancedNode
+        : (ArNode *) preparedSubgraph
+        : (ArnGraphTraversal *) traversal
+        ;
+
+- (void) addInstance
+        : (ArNode *) bottomLevelBVH
+        : (ArnGraphTraversal *) traversal
+        : (int) operationTreeLeaf
+        ;
+
 @end
 
 #define ARLNBBC_INFSPHERE(__lnbbc)        (__lnbbc)->infSphere
@@ -29,6 +29,8 @@
 // #define WITH_DEBUG_PRINTFS
 
 #import "ArnLeafNodeBBoxCollection.h"
+#import "ArnBVH.h"
+#import "ArnOperationTree.h"
 
 ART_MODULE_INITIALISATION_FUNCTION
 (
@@ -52,6 +54,11 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLeafNodeBBoxCollection)
         infSphere          = 0;
         state_at_infsphere = ARTS_EMPTY;
         sgl_dynarray       = arsgldynarray_init(0);
+
+        instanceCache       = self;
+        instancedNodeArray  = arnoderefdynarray_init(0);
+        bottomLevelBVHArray = arnoderefdynarray_init(0);
+        instanceArray       = arnoderefdynarray_init(0);
     }
     
     return self;
@@ -68,6 +75,15 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLeafNodeBBoxCollection)
         trafo_world2object_for_infSphere;
     copiedInstance->sgl_dynarray = arsgldynarray_copy( & sgl_dynarray );
 
+    copiedInstance->instanceCache =
+        ( instanceCache == self ? copiedInstance : instanceCache );
+    copiedInstance->instancedNodeArray =
+        arnoderefdynarray_copy( & instancedNodeArray );
+    copiedInstance->bottomLevelBVHArray =
+        arnoderefdynarray_copy( & bottomLevelBVHArray );
+    copiedInstance->instanceArray =
+        arnoderefdynarray_copy( & instanceArray );
+
     return copiedInstance;
 }
 
@@ -116,6 +132,17 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLeafNodeBBoxCollection)
     ARSGL_STATE(newLeafNode) = artraversalstate_copy( state_at_leaf );
     ARSGL_OPERATION_LEAF(newLeafNode) = operationTreeLeaf;
 
+    //   Leaf shapes are usually wrapped in their combined attributes;
+    //   the statistics are more useful if they are kept for the shape.
+
+    ArNode  * shape = ARNODEREF_POINTER(object_to_raycast_ref);
+
+    if ( [ shape isKindOfClass: [ AraCombinedAttributes class ] ] )
+        shape = [ shape subnodeWithIndex: 0 ];
+
+    ARSGL_SHAPE_CLASS_NUMBER(newLeafNode) =
+        [ (ArNode <ArpConcreteClass> *) shape globalClassNumber ];
+
     newLeafNode.sel_getIntersectionList =
         @selector(getIntersectionList:::);
 
@@ -125,12 +152,199 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLeafNodeBBoxCollection)
             :   newLeafNode.sel_getIntersectionList
             ];
 
+    if ( [ ARNODEREF_POINTER(object_to_raycast_ref) conformsToProtocol
+           :   ARPROTOCOL(ArpRayPacketCasting)
+           ] )
+    {
+        newLeafNode.sel_getIntersectionLists =
+            @selector(getIntersectionLists::::::);
+
+        newLeafNode.imp_getIntersectionLists = (void(*)
+            (id, SEL, ArnRayCaster *,const Ray3D *,unsigned int,unsigned int,
+             Range,ArIntersectionList *))
+            [ ARNODEREF_POINTER(object_to_raycast_ref) methodForSelector
+                :   newLeafNode.sel_getIntersectionLists
+                ];
+    }
+    else
+    {
+        newLeafNode.sel_getIntersectionLists = NULL;
+        newLeafNode.imp_getIntersectionLists = NULL;
+    }
+
     arsgldynarray_push(
         & sgl_dynarray,
           newLeafNode
         );
 }
 
+- (ArNode *) bottomLevelBVHForInstancedNode
+        : (ArNode *) instancedNode
+{
+    ArnLeafNodeBBoxCollection  * cache = instanceCache;
+
+    unsigned long  numberOfBVHs =
+        arnoderefdynarray_size( & cache->instancedNodeArray );
+
+    for ( unsigned long i = 0; i < numberOfBVHs; i++ )
+    {
+        ArNodeRef  nodeRef =
+            arnoderefdynarray_i( & cache->instancedNodeArray, i );
+
+        if ( ARNODEREF_POINTER(nodeRef) == instancedNode )
+            return
+                ARNODEREF_POINTER(
+                    arnoderefdynarray_i( & cache->bottomLevelBVHArray, i )
+                    );
+    }
+
+    return 0;
+}
+
+- (ArNode *) createBottomLevelBVHForInstancedNode
+        : (ArNode *) instancedNode
+        : (ArNode *) preparedSubgraph
+        : (ArnGraphTraversal *) traversal
+{
+    //   The leaves of the subgraph are collected in its own object space,
+    //   but with the rules that are valid where it is instanced. Nested
+    //   instances end up in the same cache as this one.
+
+    ArnLeafNodeBBoxCollection  * subgraphLeaves =
+        [ ALLOC_INIT_OBJECT(ArnLeafNodeBBoxCollection) ];
+
+    subgraphLeaves->instanceCache = instanceCache;
+
+    ArnOperationTree  * subgraphOperationTree =
+        [ ALLOC_INIT_OBJECT(ArnOperationTree) ];
+
+    ArnGraphTraversal  * subgraphTraversal =
+        [ ALLOC_INIT_OBJECT(ArnGraphTraversal) ];
+
+    ArcObject  * rulesStore;
+
+    [ subgraphTraversal pushRules
+        :   ARNGT_RULES(traversal)
+        : & rulesStore
+        ];
+
+    [ preparedSubgraph collectLeafBBoxes
+        :   subgraphTraversal
+        :   subgraphLeaves
+        :   subgraphOperationTree
+        ];
+
+    [ subgraphTraversal popRules
+        :   rulesStore
+        ];
+
+    RELEASE_OBJECT(subgraphTraversal);
+
+    if ( ARLNBBC_INFSPHERE(subgraphLeaves) )
+        ART_ERRORHANDLING_WARNING(
+            "infinite sphere in instanced geometry ignored"
+            );
+
+    ArnBVH  * bottomLevelBVH =
+        [ ALLOC_INIT_OBJECT(ArnBVH)
+            :   HARD_NODE_REFERENCE(preparedSubgraph)
+            :   subgraphLeaves
+            :   subgraphOperationTree
+            ];
+
+    RELEASE_OBJECT(subgraphOperationTree);
+    RELEASE_OBJECT(subgraphLeaves);
+
+    //   The operation tree flags live in the ray caster, and are only
+    //   sized for the top level structure.
+
+    if ( [ bottomLevelBVH usesOperationTree ] )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "instanced geometry must not contain CSG operations"
+            );
+
+    arnoderefdynarray_push(
+        & instanceCache->instancedNodeArray,
+          WEAK_NODE_REFERENCE(instancedNode)
+        );
+
+    arnoderefdynarray_push(
+        & instanceCache->bottomLevelBVHArray,
+          HARD_NODE_REFERENCE(bottomLevelBVH)
+        );
+
+    RELEASE_OBJECT(bottomLevelBVH);
+
+    return bottomLevelBVH;
+}
+
+- (void) addInstance
+        : (ArNode *) bottomLevelBVH
+        : (ArnGraphTraversal *) traversal
+        : (int) operationTreeLeaf
+{
+    Box3D  objectspaceBox;
+
+    [ (ArnBVH *) bottomLevelBVH getBBoxOfAllLeaves
+        : & objectspaceBox
+        ];
+
+    //   Nothing to instance for subgraphs without any leaves.
+
+    if ( XC(BOX3D_MIN(objectspaceBox)) > XC(BOX3D_MAX(objectspaceBox)) )
+        return;
+
+    Box3D  worldspaceBox = objectspaceBox;
+
+    if ( ARNGT_TRAFO(traversal) )
+    {
+        HTrafo3D  trafo_object2world;
+        HTrafo3D  trafo_world2object;
+
+        [ ARNGT_TRAFO(traversal) getHTrafo3Ds
+            : & trafo_object2world
+            : & trafo_world2object
+            ];
+
+        box3d_b_htrafo3d_b(
+            & objectspaceBox,
+            & trafo_object2world,
+            & worldspaceBox
+            );
+    }
+
+    //   The transformation is applied by the instance node, not by the
+    //   acceleration structure, so that it also ends up in the traversal
+    //   state of the ray caster.
+
+    AraCombinedAttributes  * instance =
+        [ ALLOC_INIT_OBJECT(AraCombinedAttributes)
+            :   bottomLevelBVH
+            :   ARNGT_VOLUME_MATERIAL(traversal)
+            :   ARNGT_SURFACE_MATERIAL(traversal)
+            :   ARNGT_ENVIRONMENT_MATERIAL(traversal)
+            :   ARNGT_TRAFO(traversal)
+            :   0
+            ];
+
+    arnoderefdynarray_push(
+        & instanceArray,
+          HARD_NODE_REFERENCE(instance)
+        );
+
+    RELEASE_OBJECT(instance);
+
+    HTrafo3D  trafo_unit = HTRAFO3D_UNIT;
+
+    [ self addScenegraphLeafNode
+        :   WEAK_NODE_REFERENCE(instance)
+        : & worldspaceBox
+        : & trafo_unit
+        : & ARNGT_STATE(traversal)
+        :   operationTreeLeaf
+        ];
+}
+
 - (void) dealloc
 {
     int  numberOfLeaves = arsgldynarray_size( & sgl_dynarray );
@@ -146,6 +360,10 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnLeafNodeBBoxCollection)
 
     artraversalstate_free_contents( & state_at_infsphere );
 
+    arnoderefdynarray_free_contents( & instanceArray );
+    arnoderefdynarray_free_contents( & bottomLevelBVHArray );
+    arnoderefdynarray_free_contents( & instancedNodeArray );
+
     [ super dealloc ];
 }
 
@@ -51,6 +51,13 @@ ART_MODULE_INTERFACE(ArnOperationTree)
 - ( long ) getOpNodeCount
 ;
 
+//   YES if the tree only consists of union and leaf nodes, i.e. if the
+//   scene contains no CSG operations. Combining the leaf intersection
+//   lists with OR then gives the same result as evaluating the tree.
+
+- ( BOOL ) containsOnlyUnionsAndLeaves
+;
+
 - ( void ) pushOpNodeAt
 :       ( int ) position
 :       ( struct ArOpNode* ) opNode
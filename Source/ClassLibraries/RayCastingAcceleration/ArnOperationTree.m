@@ -93,6 +93,18 @@ ARPCONCRETECLASS_DEFAULT_IMPLEMENTATION(ArnOperationTree)
     return occupiedNodes;
 }
 
+- ( BOOL ) containsOnlyUnionsAndLeaves
+{
+    for ( int i = 0; i < occupiedNodes; i++ )
+    {
+        if (   opNodeArray[i].intersectFunction != intersect_union
+            && opNodeArray[i].intersectFunction != intersect_leaf )
+            return NO;
+    }
+
+    return YES;
+}
+
 - ( void ) pushOpNodeAt
         : ( int ) position
         : ( struct ArOpNode* ) opNode
@@ -29,6 +29,9 @@
 #import "ArnRepeater.h"
 
 #import "ArpBBoxHandling_Node.h"
+#import "ArnLeafNodeBBoxCollection.h"
+#import "ArnOperationTree.h"
+#import "ART_Trafo.h"
 
 ART_MODULE_INITIALISATION_FUNCTION
 (
@@ -206,9 +209,12 @@ ARPBBOX_DEFAULT_WORLDSPACE_BBOX_GET_IMPLEMENTATION
 - (ArNode *) pushAttributesToLeafNodes
         : (ArnGraphTraversal *) traversal
 {
-    Vec3D trafoShift;
-    [ ARNTRAVERSAL_TRAFO(traversal) transformVec3D: &shift :&trafoShift ];
-    shift = trafoShift;
+    if ( ARNTRAVERSAL_TRAFO(traversal) )
+    {
+        Vec3D trafoShift;
+        [ ARNTRAVERSAL_TRAFO(traversal) transformVec3D: &shift :&trafoShift ];
+        shift = trafoShift;
+    }
     ASSIGN_AS_HARD_NODE_REFERENCE_TO_SUBNODE( [ ARNUNARY_SUBNODE pushAttributesToLeafNodes :traversal] );
     return self;
 }
@@ -218,11 +224,93 @@ ARPBBOX_DEFAULT_WORLDSPACE_BBOX_GET_IMPLEMENTATION
 : (ArnLeafNodeBBoxCollection *) bboxCollection
 : (ArnOperationTree*) opTree
 {
-    (void) traversal;
-    (void) bboxCollection;
-    (void) opTree;
-    
-    ART__CODE_IS_WORK_IN_PROGRESS__EXIT_WITH_ERROR
+    //   The subnode already is in its final, world space form for the
+    //   first copy (see pushAttributesToLeafNodes above), so all copies
+    //   can share one BVH over it, and only differ by a translation.
+
+    ArNode  * bottomLevelBVH =
+        [ bboxCollection bottomLevelBVHForInstancedNode
+            :   self
+            ];
+
+    if ( ! bottomLevelBVH )
+        bottomLevelBVH =
+            [ bboxCollection createBottomLevelBVHForInstancedNode
+                :   self
+                :   ARNUNARY_SUBNODE
+                :   traversal
+                ];
+
+    int  myID = 0;
+    int  firstCopyID = 0;
+
+    if ( opTree )
+    {
+        ArOpNode  unionNode;
+
+        myID = opTree->myId;
+        firstCopyID = opTree->nextFreeId;
+        opTree->nextFreeId += repeat;
+
+        unionNode.superNodeID = opTree->superID;
+        unionNode.numberOfSubNodes = repeat;
+        unionNode.data = firstCopyID;
+        unionNode.intersectFunction = intersect_union;
+
+        [ opTree pushOpNodeAt
+            :   myID
+            : & unionNode
+            ];
+    }
+
+    for ( unsigned int i = 0; i < repeat; i++ )
+    {
+        ArnTranslation3D  * copyTranslation =
+            [ ALLOC_INIT_OBJECT(ArnTranslation3D)
+                :   TRANSLATION3D(
+                        i * XC(shift),
+                        i * YC(shift),
+                        i * ZC(shift)
+                        )
+                ];
+
+        ArNodeRef  trafoStore;
+
+        [ traversal pushTrafo3DRef
+            :   WEAK_NODE_REFERENCE(copyTranslation)
+            : & trafoStore
+            ];
+
+        int  copyID = 0;
+
+        if ( opTree )
+        {
+            ArOpNode  leafNode;
+
+            copyID = firstCopyID + i;
+
+            leafNode.superNodeID = myID;
+            leafNode.numberOfSubNodes = 0;
+            leafNode.intersectFunction = intersect_leaf;
+
+            [ opTree pushOpNodeAt
+                :   copyID
+                : & leafNode
+                ];
+        }
+
+        [ bboxCollection addInstance
+            :   bottomLevelBVH
+            :   traversal
+            :   copyID
+            ];
+
+        [ traversal popTrafo3D
+            : & trafoStore
+            ];
+
+        RELEASE_OBJECT(copyTranslation);
+    }
 }
 
 @end
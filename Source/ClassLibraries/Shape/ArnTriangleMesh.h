@@ -31,6 +31,22 @@ ART_MODULE_INTERFACE(ArnTriangleMesh)
 #import "ArnShape.h"
 #import "ArnVertexSet.h"
 
+//   Bottom level BVH over the faces of a mesh. Apart from the nodes, it
+//   only stores the order in which the leaves reference the faces - the
+//   vertex indices stay in the 'faces' array of the mesh. Copies of a
+//   mesh share the BVH of the original, hence the reference count, which
+//   is only changed atomically, as copies can be made and released from
+//   several threads at once.
+
+typedef struct ArnTriangleMeshFaceBVH
+{
+    BVHNode        * nodes;
+    long             numberOfNodes;
+    UInt32         * faceOrder;
+    unsigned long    references;
+}
+ArnTriangleMeshFaceBVH;
+
 @interface ArnTriangleMesh
         : ArnShape
         < ArpConcreteClass, ArpCoding, ArpExtremalPoints, ArpShape, ArpSetupNodeData >
@@ -43,7 +59,13 @@ ART_MODULE_INTERFACE(ArnTriangleMesh)
     Pnt3D        minPoint;  //extremal point.
     Pnt3D        maxPoint;  //extremal point.
 
-    ArNode     * internalMeshTree;
+    //   Bottom level BVH over the faces, built by setupNodeData. Its
+    //   nodes and face order are also kept here directly, for the
+    //   intersection code.
+
+    ArnTriangleMeshFaceBVH  * faceBVH;
+    BVHNode                 * faceBVHNodes;
+    UInt32                  * faceBVHOrder;
 }
 
 /**
@@ -62,6 +84,13 @@ ART_MODULE_INTERFACE(ArnTriangleMesh)
 
 @end
 
+//   Index in 'faces', and vertex indices, of the face at position __f of
+//   the BVH leaf order.
+
+#define ARNTRIANGLEMESH_BVH_FACE_INDEX(__f)         faceBVHOrder[ (__f) ]
+#define ARNTRIANGLEMESH_BVH_FACE_VERTEX(__f,__v) \
+    ARARRAY_I( faces, 3 * (long) ARNTRIANGLEMESH_BVH_FACE_INDEX(__f) + (__v) )
+
 // Triangle mesh init function from file.
 
 ArNode  * arntrianglemesh_heightfield_from_image(
@@ -27,16 +27,18 @@
 #define ART_MODULE_NAME     ArnTriangleMesh
 
 #import "ArnTriangleMesh.h"
-#import "ArnTriangle.h"
 #import "ARM_Scenegraph.h"
 #import "ArpNode.h"
 #import "ArcObjCCoder.h"
-#import "ArnLeafNodeBBoxCollection.h"
-#import "ArnBSPTree.h"
 #import "ART_ImageData.h"
 
 #define DIS MATH_SQRT_2_SUB_1           // tan(22.5 DEGREES)
 
+//   Intersecting a face is cheap compared to the scene graph leaves the
+//   top level structures deal with, so the mesh BVH uses small leaves.
+
+#define ARNTRIANGLEMESH_BVH_MAX_LEAF_SIZE   4
+
 ART_MODULE_INITIALISATION_FUNCTION
 (
     (void) art_gv;
@@ -554,21 +556,53 @@ ARPSHAPE_DEFAULT_IMPLEMENTATION(
         minPoint = minPoint_;
         maxPoint = maxPoint_;
 
-        internalMeshTree = 0;
+        faceBVH = NULL;
+        faceBVHNodes = NULL;
+        faceBVHOrder = NULL;
     }
     
     return self;
 }
 
+static void _arntrianglemesh_release_face_bvh(
+        ArnTriangleMeshFaceBVH  * faceBVH
+        )
+{
+    //   The last reference may go away in another thread than the one
+    //   which last used the BVH, hence the acquire/release ordering.
+
+    if (    ! faceBVH
+         || __atomic_sub_fetch( & faceBVH->references, 1, __ATOMIC_ACQ_REL ) > 0 )
+        return;
+
+    bvhnode_free_array( faceBVH->nodes );
+    FREE_ARRAY( faceBVH->faceOrder );
+    FREE( faceBVH );
+}
+
 - (void) dealloc
 {
     arlongarray_free_contents( & faces );
 
-    if ( internalMeshTree ) RELEASE_OBJECT ( internalMeshTree );
+    _arntrianglemesh_release_face_bvh( faceBVH );
 
     [ super dealloc ];
 }
 
+//   A copy has the same faces in the same order as the original, so it
+//   can just use the BVH of the original as it is.
+
+- (void) _shareFaceBVH
+        : (ArnTriangleMesh *) original
+{
+    faceBVH = original->faceBVH;
+    faceBVHNodes = original->faceBVHNodes;
+    faceBVHOrder = original->faceBVHOrder;
+
+    if ( faceBVH )
+        __atomic_add_fetch( & faceBVH->references, 1, __ATOMIC_RELAXED );
+}
+
 - (id) copy
 {
     ArnTriangleMesh  * copiedInstance = [ super copy ];
@@ -577,9 +611,7 @@ ARPSHAPE_DEFAULT_IMPLEMENTATION(
     copiedInstance->minPoint = minPoint;
     copiedInstance->maxPoint = maxPoint;
 
-    //   shallow copy of BSP tree!
-
-    copiedInstance->internalMeshTree = RETAIN_OBJECT( internalMeshTree );
+    [ copiedInstance _shareFaceBVH: self ];
 
     return copiedInstance;
 }
@@ -596,9 +628,7 @@ ARPSHAPE_DEFAULT_IMPLEMENTATION(
     copiedInstance->minPoint = minPoint;
     copiedInstance->maxPoint = maxPoint;
 
-    //   shallow copy of BSP tree!
-
-    copiedInstance->internalMeshTree = RETAIN_OBJECT( internalMeshTree );
+    [ copiedInstance _shareFaceBVH: self ];
 
     return copiedInstance;
 }
@@ -669,10 +699,10 @@ ARPSHAPE_DEFAULT_IMPLEMENTATION(
 - (void) setupNodeData
         : (ArTraversalState *) traversalState
 {
-    //   If the internal tree is not null then the setup must have
+    //   If the face BVH is not null then the setup must have
     //   been done already.
 
-    if ( internalMeshTree ) return;
+    if ( faceBVHNodes ) return;
 
     //   The number of faces is the size of the faces array divided by 3 since
     //   there are 3 indices for every face.
@@ -683,112 +713,66 @@ ARPSHAPE_DEFAULT_IMPLEMENTATION(
 
     if ( numberOfFaces == 0 ) return;
 
-    //   Fill a dynamic array with the hard references to faces
+    if ( numberOfFaces > ART_UINT32_MAX )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "triangle mesh with %ld faces is too large"
+            ,   numberOfFaces
+            );
 
-    ArNodeRefDynArray  array = arnoderefdynarray_init( numberOfFaces );
+    //   Instead of one ArnTriangle node per face, the mesh just builds a
+    //   BVH over the bounding boxes of its faces. The faces themselves are
+    //   intersected directly by the mesh, so per face there is nothing
+    //   left in memory but the vertex indices, its position in the leaf
+    //   order, and a share of the BVH nodes.
 
-    for( long i = 0; i < numberOfFaces; ++i )
-    {
-        //   Create a triange for each face.
-
-        ArnTriangle  * triangle =
-            arntriangle(
-                art_gv,
-                ARARRAY_I(faces, i*3+0),
-                ARARRAY_I(faces, i*3+1),
-                ARARRAY_I(faces, i*3+2)
-                );
+    const Pnt3D  * pointArray =
+        [ (ArNode <ArpVertices> *)ARTS_VERTICES(*traversalState) pointArray ];
 
-        //   Triangle setup.
+    BVHBuildPrimitive  * primitives =
+        ALLOC_ARRAY( BVHBuildPrimitive, numberOfFaces );
 
-        [ triangle setupNodeData: traversalState ];
+    for ( long i = 0; i < numberOfFaces; i++ )
+    {
+        primitives[i].index = i;
+        primitives[i].box   = BOX3D_EMPTY;
 
-        //   Push the triangle into the dyn array.
+        for ( int j = 0; j < 3; j++ )
+            box3d_p_add_b(
+                & pointArray[ ARARRAY_I( faces, i*3+j ) ],
+                & primitives[i].box
+                );
 
-        arnoderefdynarray_push(& array, HARD_NODE_REFERENCE(triangle));
-        
-        //debugprintf("ArnTriangleMesh::arntrianglemesh_heightfield_from_image: Created triangle %li with vertex indices (%li,%li,%li)\n", i, ARARRAY_I(triangle->indexTable, 0), ARARRAY_I(triangle->indexTable, 1), ARARRAY_I(triangle->indexTable, 2))
+        box3d_b_center_p(
+            & primitives[i].box,
+            & primitives[i].centroid
+            );
     }
 
-    //   Set the internal tree to the union of the triangles.
-
-    internalMeshTree =
-        [ ALLOC_INIT_OBJECT(ArnUnion)
-            : & array
-            :   arunion_group | arunion_use_bboxes
-            ];
-
-    arnoderefdynarray_free_contents( & array );
+    faceBVH = ALLOC( ArnTriangleMeshFaceBVH );
 
-    //   Insert BBoxes for the triangles in the mesh.
-
-    internalMeshTree =
-        [ (id <ArpBBoxHandling>)internalMeshTree allocBBoxes ];
-
-    //   Initialise the BBoxes
-
-    ArnGraphTraversal  * traversal =
-        [ ALLOC_INIT_OBJECT(ArnGraphTraversal) ];
-
-    [ traversal setReporter: ART_GLOBAL_REPORTER ];
-
-    ArNodeRef verticesStore;
-
-    [ traversal pushVerticesRef
-        :   ARTS_VERTICES_REF(*traversalState)
-        : & verticesStore
-        ];
-
-    Box3D  box;
-
-    [ (id <ArpBBoxHandling>)internalMeshTree initBBoxes
-        :   traversal
-        : & box
-        ];
-
-    Vec3D  epsilonVec = VEC3D( 0.0001, 0.0001, 0.0001 );
-
-    [ (id <ArpBBoxHandling>)internalMeshTree enlargeBBoxes
-        : & epsilonVec
-        ];
-
-    RELEASE_OBJECT(traversal);
-
-    //   Collect the BBoxes for the leaves.
-
-    ArnLeafNodeBBoxCollection *leafBBoxes =
-        [ ALLOC_INIT_OBJECT(ArnLeafNodeBBoxCollection) ];
-
-    ArnGraphTraversal  *traversal1 =
-        [ ALLOC_INIT_OBJECT(ArnGraphTraversal) ];
-
-    [ (id <ArpBBoxHandling>)internalMeshTree collectLeafBBoxes
-        :   traversal1
-        :   leafBBoxes
-        :   0
-        ];
-
-    RELEASE_OBJECT(traversal1);
+    faceBVH->references = 1;
+    faceBVH->nodes =
+        bvhtree_build_binned_sah(
+              primitives,
+              numberOfFaces,
+              ARNTRIANGLEMESH_BVH_MAX_LEAF_SIZE,
+            & faceBVH->numberOfNodes,
+              NULL
+            );
 
-    //   Insert the bsp-tree
+    //   The order in which the BVH leaves reference the faces.
 
-    internalMeshTree =
-        [ ALLOC_INIT_OBJECT(ArnBSPTree)
-            :   HARD_NODE_REFERENCE(internalMeshTree)
-            :   leafBBoxes
-            :   NULL
-            ];
+    faceBVH->faceOrder = ALLOC_ARRAY( UInt32, numberOfFaces );
 
-    //   Since the leafBBoxes node gets copied into the internal tree by
-    //   the bsp tree it can be released here.
+    for ( long i = 0; i < numberOfFaces; i++ )
+        faceBVH->faceOrder[i] = (UInt32) primitives[i].index;
 
-    RELEASE_OBJECT(leafBBoxes);
+    faceBVHNodes = faceBVH->nodes;
+    faceBVHOrder = faceBVH->faceOrder;
 
-    return;
+    FREE_ARRAY( primitives );
 }
 
-
-
 @end
 
 // ===========================================================================
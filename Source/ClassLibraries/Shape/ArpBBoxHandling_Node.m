@@ -2073,6 +2073,113 @@ ARPBBOXHANDLING_DEFAULT_IMPLEMENTATION
     }
 }
 
+- ( void ) collectLeafBBoxes
+:       (ArnGraphTraversal *) traversal
+:       (ArnLeafNodeBBoxCollection *) bboxCollection
+:       (ArnOperationTree*) opTree
+{
+    ArNode  * referencedNode =
+        [ ARNGT_RULES(traversal) nodeWithName: referencedName ];
+
+    if ( ! referencedNode )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "reference to unknown node '%s'"
+            ,   referencedName
+            );
+
+    //   All references to the same named node share one bottom level BVH.
+    //   The first one to get there prepares a private copy of the named
+    //   subgraph for it - the original is left alone, as it is still what
+    //   point queries are resolved against.
+
+    ArNode  * bottomLevelBVH =
+        [ bboxCollection bottomLevelBVHForInstancedNode
+            :   referencedNode
+            ];
+
+    if ( ! bottomLevelBVH )
+    {
+        ArnGraphTraversal  * subgraphTraversal =
+            [ ALLOC_INIT_OBJECT(ArnGraphTraversal) ];
+
+        ArNode  * rulesStore;
+
+        [ subgraphTraversal pushRules
+            :   ARNGT_RULES(traversal)
+            : & rulesStore
+            ];
+
+        ArNodeRef  subgraphRef =
+            HARD_NODE_REFERENCE(
+                [ referencedNode deepSemanticCopy
+                    :   subgraphTraversal
+                    ]
+                );
+
+        ASSIGN_AS_HARD_NODE_REFERENCE_TO(
+            subgraphRef,
+            [ ARNODEREF_POINTER(subgraphRef) pushAttributesToLeafNodes
+                :   subgraphTraversal
+                ]
+            );
+
+        ASSIGN_AS_HARD_NODE_REFERENCE_TO(
+            subgraphRef,
+            [ ARNODEREF_POINTER(subgraphRef) allocBBoxes ]
+            );
+
+        Box3D  subgraphBox;
+
+        [ ARNODEREF_POINTER(subgraphRef) initBBoxes
+            :   subgraphTraversal
+            : & subgraphBox
+            ];
+
+        [ ARNODEREF_POINTER(subgraphRef) clipToBox
+            : & subgraphBox
+            ];
+
+        [ subgraphTraversal popRules
+            :   rulesStore
+            ];
+
+        RELEASE_OBJECT(subgraphTraversal);
+
+        bottomLevelBVH =
+            [ bboxCollection createBottomLevelBVHForInstancedNode
+                :   referencedNode
+                :   ARNODEREF_POINTER(subgraphRef)
+                :   traversal
+                ];
+
+        RELEASE_NODE_REF(subgraphRef);
+    }
+
+    int  operationTreeLeaf = 0;
+
+    if ( opTree )
+    {
+        ArOpNode  newNode;
+
+        newNode.superNodeID = opTree->superID;
+        newNode.numberOfSubNodes = 0;
+        newNode.intersectFunction = intersect_leaf;
+
+        operationTreeLeaf = opTree->myId;
+
+        [ opTree pushOpNodeAt
+            :   operationTreeLeaf
+            : & newNode
+            ];
+    }
+
+    [ bboxCollection addInstance
+        :   bottomLevelBVH
+        :   traversal
+        :   operationTreeLeaf
+        ];
+}
+
 @end
 
 @implementation AraVariables (BBoxes)
@@ -2151,6 +2258,27 @@ ARPBBOXHANDLING_DEFAULT_IMPLEMENTATION
         :   nodeRefStore ];
 }
 
+- ( void ) collectLeafBBoxes
+:       (ArnGraphTraversal *) traversal
+:       (ArnLeafNodeBBoxCollection *) bboxCollection
+:       (ArnOperationTree*) opTree
+{
+    ArNode  * nodeRefStore;
+
+    [ traversal pushRules
+        :   RULES_ATTRIBUTE
+        : & nodeRefStore ];
+
+    [ super collectLeafBBoxes
+        :   traversal
+        :   bboxCollection
+        :   opTree
+        ];
+
+    [ traversal popRules
+        :   nodeRefStore ];
+}
+
 @end
 
 @implementation ArnNamedNodeSet (BBoxes)
@@ -0,0 +1,404 @@
+/* ===========================================================================
+
+    Copyright (c) 1996-2021 The ART Development Team
+    -------------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#import "AdvancedRenderingToolkit.h"
+
+/* ---------------------------------------------------------------------------
+
+    'rawmerge_samples_rendered'
+
+    The number of samples per pixel a partial render took, as the tiled
+    sampler notes it in the "Samples per pixel" line of an ARTRAW, e.g.
+    "16/16/16 min/avg/max spp, 16 spp rendered, slice 1 of 4 of 64 spp".
+    Returns 0 if the image does not say, or if its pixels did not all
+    get the same number of samples.
+
+------------------------------------------------------------------------aw- */
+
+unsigned int rawmerge_samples_rendered(
+        const char  * samplecountString
+        )
+{
+    if ( ! samplecountString )
+        return 0;
+
+    const char  * rendered = strstr( samplecountString, " spp rendered" );
+
+    if ( ! rendered )
+        return 0;
+
+    const char  * number = rendered;
+
+    while (    number > samplecountString
+            && number[-1] >= '0'
+            && number[-1] <= '9' )
+        number--;
+
+    if (    number == rendered
+         || ( number > samplecountString && number[-1] == '-' ) )
+        return 0;
+
+    return (unsigned int) strtoul( number, NULL, 10 );
+}
+
+ArnFileImage * rawmerge_open_input_image(
+        ART_GV        * art_gv,
+        const char    * fileName
+        )
+{
+    ArnFileImage  * inputImage =
+        [ ALLOC_INIT_OBJECT(ArnFileImage)
+            :   fileName
+            ];
+
+    if ( ! [ inputImage imageFileIsKindOf: [ ArfARTRAW class ] ] )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "%s is not an ARTRAW image - %s instead"
+            ,   fileName
+            ,   [ [ inputImage dataImageClass ] cStringClassName ]
+            );
+
+    return inputImage;
+}
+
+int art_rawmerge(
+        int        argc,
+        char    ** argv,
+        ART_GV   * art_gv
+        )
+{
+    ART_APPLICATION_DEFINE_STANDARD_OPTIONS_WITH_FEATURES(
+        "ARTRAW merging",
+          art_appfeatures_provide_output_filename
+        | art_appfeatures_mandatory_output_name
+        | art_appfeatures_no_threading
+        );
+
+    ART_APPLICATION_MAIN_OPTIONS_FOLLOW
+
+    id equalWeightsOpt =
+        [ FLAG_OPTION
+            :   "equalWeights"
+            :   "ew"
+            :   "weight all inputs equally, instead of by samples rendered"
+            ];
+
+    ART_SINGLE_INPUT_FILE_APPLICATION_STARTUP_WITH_SYNOPSIS(
+        "art_rawmerge",
+        "ARTRAW partial render merging utility",
+"Combines the partial results of a render that was split into several slices\n"
+"of its samples per pixel (artist option '-sampleRange'), e.g. to be rendered\n"
+"by separate processes or machines, into a single ARTRAW image. Each input is\n"
+"weighted by the number of samples per pixel it was rendered with, as noted in\n"
+"its header; polarisation information is retained.",
+        "art_rawmerge <ARTRAW 1> <ARTRAW 2> ... -o <output ARTRAW>"
+        );
+
+    if ( ! [ ART_OUTPUT_OPT hasBeenSpecified ] )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "no output file name specified, use -o <name>"
+            );
+
+    int  numberOfInputImages = NUMBER_OF_INPUT_FILES;
+
+    /* ------------------------------------------------------------------
+         First pass: only the headers of the inputs are read, with the
+         light subsystem in polarisation mode, so that the data type of
+         each input reflects whether it contains polarisation
+         information. The inputs have to agree on size and data type.
+    ---------------------------------------------------------------aw- */
+
+    art_set_isr( art_gv, art_isr( art_gv ) | ardt_polarisable );
+
+    IVec2D        size = IVEC2D( 0, 0 );
+    FVec2D        resolution = FVEC2D( 72.0, 72.0 );
+    ArDataType    dataType = ardt_unknown;
+    double      * weight = ALLOC_ARRAY( double, numberOfInputImages );
+    double        overallWeight = 0.0;
+    unsigned int  overallSamples = 0;
+    double        overallRenderTime = 0.0;
+
+    for ( int i = 0; i < numberOfInputImages; i++ )
+    {
+        const char  * inputFileName = argv[ i + 1 ];
+
+        ArnFileImage  * inputImage =
+            rawmerge_open_input_image(
+                art_gv,
+                inputFileName
+                );
+
+        if ( i == 0 )
+        {
+            size       = [ inputImage size ];
+            resolution = [ inputImage resolution ];
+            dataType   = [ inputImage fileDataType ];
+        }
+        else
+        {
+            if (   XC([ inputImage size ]) != XC(size)
+                || YC([ inputImage size ]) != YC(size) )
+                ART_ERRORHANDLING_FATAL_ERROR(
+                    "%s is %d x %d pixels, instead of %d x %d"
+                    ,   inputFileName
+                    ,   XC([ inputImage size ])
+                    ,   YC([ inputImage size ])
+                    ,   XC(size)
+                    ,   YC(size)
+                    );
+
+            if ( [ inputImage fileDataType ] != dataType )
+                ART_ERRORHANDLING_FATAL_ERROR(
+                    "%s contains %s data, instead of %s"
+                    ,   inputFileName
+                    ,   ardatatype_name( [ inputImage fileDataType ] )
+                    ,   ardatatype_name( dataType )
+                    );
+        }
+
+        unsigned int  samples =
+            rawmerge_samples_rendered( [ inputImage samplecountString ] );
+
+        if ( [ equalWeightsOpt hasBeenSpecified ] )
+            weight[i] = 1.0;
+        else
+        {
+            if ( samples == 0 )
+                ART_ERRORHANDLING_FATAL_ERROR(
+                    "the number of samples per pixel %s was rendered with "
+                    "is unknown - use '-equalWeights' if all inputs "
+                    "have the same"
+                    ,   inputFileName
+                    );
+
+            weight[i] = samples;
+        }
+
+        overallWeight  += weight[i];
+        overallSamples += samples;
+
+        double  renderTime = 0.0;
+
+        if (    [ inputImage rendertimeString ]
+             && sscanf(
+                    [ inputImage rendertimeString ],
+                    "%lf seconds",
+                    & renderTime
+                    ) == 1 )
+            overallRenderTime += renderTime;
+
+        [ ART_GLOBAL_REPORTER printf
+            :   "%s: %d x %d, %s, weight %g\n"
+            ,   inputFileName
+            ,   XC(size)
+            ,   YC(size)
+            ,   ardatatype_name( [ inputImage fileDataType ] )
+            ,   weight[i]
+            ];
+
+        RELEASE_OBJECT( inputImage );
+    }
+
+    //   From here on, the ISR matches the contents of the inputs exactly,
+    //   so that they are summed without any conversion.
+
+    art_set_isr( art_gv, dataType );
+
+    /* ------------------------------------------------------------------
+         Second pass: the weighted sum of all inputs, which are read one
+         scanline at a time.
+    ---------------------------------------------------------------aw- */
+
+    [ ART_GLOBAL_REPORTER beginTimedAction
+        :   "merging %d ARTRAW images"
+        ,   numberOfInputImages
+        ];
+
+    ArSpectralFramebuffer  * mergedImage =
+        arspectralframebuffer_alloc(
+            art_gv,
+            size
+            );
+
+    ArnLightAlphaImage  * lineBuffer =
+        [ ALLOC_OBJECT(ArnLightAlphaImage)
+            initWithSize
+            :   IVEC2D( XC(size), 1 )
+            ];
+
+    ArSpectralFramebufferPixel  * pixel =
+        arspectralframebufferpixel_alloc( art_gv );
+
+    for ( int i = 0; i < numberOfInputImages; i++ )
+    {
+        ArnFileImage  * inputImage =
+            rawmerge_open_input_image(
+                art_gv,
+                argv[ i + 1 ]
+                );
+
+        for ( int y = 0; y < YC(size); y++ )
+        {
+            [ inputImage getPlainImage
+                :   IPNT2D( 0, y )
+                :   lineBuffer
+                ];
+
+            for ( int x = 0; x < XC(size); x++ )
+            {
+                arspectralframebufferpixel_l_init_p(
+                    art_gv,
+                    lineBuffer->data[x],
+                    pixel
+                    );
+
+                arspectralframebuffer_dp_mul_add_fbi(
+                    art_gv,
+                    weight[i] / overallWeight,
+                    pixel,
+                    mergedImage,
+                    ARSPECTRALFRAMEBUFFER_PIXEL( mergedImage, x, y )
+                    );
+            }
+        }
+
+        RELEASE_OBJECT( inputImage );
+    }
+
+    [ ART_GLOBAL_REPORTER endAction ];
+
+    /* ------------------------------------------------------------------
+         The result, with the samples and render time of all inputs
+         taken together.
+    ---------------------------------------------------------------aw- */
+
+    char  * outputFileName = NULL;
+
+    const char  * extension = strrchr( [ ART_OUTPUT_OPT cStringValue ], '.' );
+
+    if ( extension && strcmp( extension + 1, ARFARTRAW_EXTENSION ) == 0 )
+        arstring_s_copy_s(
+              [ ART_OUTPUT_OPT cStringValue ],
+            & outputFileName
+            );
+    else
+        arstring_pe_copy_add_extension_p(
+              [ ART_OUTPUT_OPT cStringValue ],
+              ARFARTRAW_EXTENSION,
+            & outputFileName
+            );
+
+    [ ART_GLOBAL_REPORTER beginTimedAction
+        :   "writing %s"
+        ,   outputFileName
+        ];
+
+    ArnImageInfo  * outputImageInfo =
+        [ ALLOC_INIT_OBJECT(ArnImageInfo)
+            :   size
+            :   dataType
+            :   dataType
+            :   resolution
+            ];
+
+    char  * samplecountString = NULL;
+
+    if ( [ equalWeightsOpt hasBeenSpecified ] )
+        asprintf(
+            & samplecountString,
+              "merged from %d images",
+              numberOfInputImages
+            );
+    else
+        asprintf(
+            & samplecountString,
+              "%u spp rendered, merged from %d images",
+              overallSamples,
+              numberOfInputImages
+            );
+
+    char  * rendertimeString = NULL;
+
+    asprintf(
+        & rendertimeString,
+          "%.0f seconds",
+          overallRenderTime
+        );
+
+    [ outputImageInfo setSamplecountString: samplecountString ];
+    [ outputImageInfo setRendertimeString: rendertimeString ];
+
+    FREE_ARRAY( samplecountString );
+    FREE_ARRAY( rendertimeString );
+
+    ArnFileImage  * outputImage =
+        [ ALLOC_INIT_OBJECT(ArnFileImage)
+            :   outputFileName
+            :   [ ArfARTRAW class ]
+            :   outputImageInfo
+            ];
+
+    for ( int y = 0; y < YC(size); y++ )
+    {
+        for ( int x = 0; x < XC(size); x++ )
+        {
+            arspectralframebuffer_fbi_init_p(
+                art_gv,
+                mergedImage,
+                ARSPECTRALFRAMEBUFFER_PIXEL( mergedImage, x, y ),
+                pixel
+                );
+
+            arspectralframebufferpixel_dp_mul_init_l(
+                art_gv,
+                1.0,
+                pixel,
+                lineBuffer->data[x]
+                );
+        }
+
+        [ outputImage setPlainImage
+            :   IPNT2D( 0, y )
+            :   lineBuffer
+            ];
+    }
+
+    [ ART_GLOBAL_REPORTER endAction ];
+
+    RELEASE_OBJECT( outputImage );
+    RELEASE_OBJECT( outputImageInfo );
+    RELEASE_OBJECT( lineBuffer );
+    arspectralframebufferpixel_free( art_gv, pixel );
+    arspectralframebuffer_free( art_gv, mergedImage );
+    FREE_ARRAY( outputFileName );
+    FREE_ARRAY( weight );
+
+    return 0;
+}
+
+ADVANCED_RENDERING_TOOLKIT_MAIN(art_rawmerge)
+
+// ===========================================================================
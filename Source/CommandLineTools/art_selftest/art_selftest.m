@@ -0,0 +1,102 @@
+/* ===========================================================================
+
+    Copyright (c) 1996-2021 The ART Development Team
+    -------------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#import "art_selftest.h"
+
+/* ---------------------------------------------------------------------------
+
+    art_selftest
+
+    Runs consistency checks of library internals whose results cannot be
+    judged from a rendered image: that optimised code paths agree with
+    the straightforward ones they replace, and that acceleration data
+    structures keep their invariants. It is registered with CTest, so
+    "ctest" in the build directory runs it; given check names as
+    arguments, only those checks are run.
+
+------------------------------------------------------------------------aw- */
+
+typedef struct ArtSelftestCheck
+{
+    const char  * name;
+    BOOL       (* check)( ART_GV * art_gv );
+}
+ArtSelftestCheck;
+
+static const ArtSelftestCheck  art_selftest_checks[] =
+{
+    { "c4_arithmetic", art_selftest_c4_arithmetic },
+    { "alias_table",   art_selftest_alias_table },
+    { "bvh",           art_selftest_bvh },
+    { "hashgrid",      art_selftest_hashgrid },
+    { 0, 0 }
+};
+
+int art_selftest(
+        int        argc,
+        char    ** argv,
+        ART_GV   * art_gv
+        )
+{
+    unsigned int  checksRun    = 0;
+    unsigned int  checksFailed = 0;
+
+    for ( const ArtSelftestCheck * c = art_selftest_checks; c->name; c++ )
+    {
+        BOOL  selected = ( argc < 2 );
+
+        for ( int i = 1; i < argc && ! selected; i++ )
+            if ( strcmp( argv[i], c->name ) == 0 )
+                selected = YES;
+
+        if ( ! selected )
+            continue;
+
+        BOOL  passed = c->check( art_gv );
+
+        printf( "%-24s %s\n", c->name, passed ? "passed" : "FAILED" );
+        fflush( stdout );
+
+        checksRun++;
+
+        if ( ! passed )
+            checksFailed++;
+    }
+
+    if ( checksRun == 0 )
+    {
+        printf( "no such check\n" );
+        return 1;
+    }
+
+    printf( "%u of %u checks failed\n", checksFailed, checksRun );
+
+    return checksFailed ? 1 : 0;
+}
+
+ADVANCED_RENDERING_TOOLKIT_MAIN(art_selftest)
+
+// ===========================================================================
@@ -0,0 +1,212 @@
+/* ===========================================================================
+
+    Copyright (c) 1996-2021 The ART Development Team
+    -------------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#import "art_selftest.h"
+
+/* ---------------------------------------------------------------------------
+
+    'art_selftest_alias_table'
+
+    Builds alias tables for a few skewed sets of weights - with zero
+    weights among them, a single entry, and one entry holding all the
+    weight - and reconstructs from each table the probability with which
+    every entry gets drawn: its own threshold, plus what is left over of
+    the buckets that name it as their alias, divided by the number of
+    buckets. These have to match the normalised weights, and entries with
+    zero weight must never be drawn.
+
+------------------------------------------------------------------------aw- */
+
+#define ALIAS_TABLE_TOLERANCE       1.0e-12
+#define ALIAS_TABLE_DRAWS_PER_ENTRY 64
+
+static BOOL alias_table_check_weights(
+        const char          * name,
+        const double        * weight,
+              unsigned int    size
+        )
+{
+    ArAliasTable  table;
+
+    double  overallWeight = araliastable_init( & table, weight, size );
+
+    double  expectedWeight = 0.0;
+
+    for ( unsigned int i = 0; i < size; i++ )
+        expectedWeight += weight[i];
+
+    if ( expectedWeight == 0.0 )
+    {
+        BOOL  passed = ( overallWeight == 0.0 && ARALIASTABLE_IS_EMPTY(table) );
+
+        if ( ! passed )
+            printf( "%s: no weight, but the table is not empty\n", name );
+
+        araliastable_free_contents( & table );
+
+        return passed;
+    }
+
+    if ( fabs( overallWeight - expectedWeight ) > ALIAS_TABLE_TOLERANCE * expectedWeight )
+    {
+        printf(
+            "%s: overall weight %g instead of %g\n"
+            ,   name
+            ,   overallWeight
+            ,   expectedWeight
+            );
+
+        araliastable_free_contents( & table );
+
+        return NO;
+    }
+
+    BOOL      passed        = YES;
+    double  * reconstructed = ALLOC_ARRAY( double, size );
+
+    for ( unsigned int i = 0; i < size; i++ )
+        reconstructed[i] = 0.0;
+
+    for ( unsigned int i = 0; i < size; i++ )
+    {
+        double  threshold = table.threshold[i];
+
+        if ( threshold < 0.0 || threshold > 1.0 || table.alias[i] >= size )
+        {
+            printf(
+                "%s: bucket %u has threshold %g and alias %u\n"
+                ,   name
+                ,   i
+                ,   threshold
+                ,   table.alias[i]
+                );
+
+            passed = NO;
+            continue;
+        }
+
+        reconstructed[ i ]              += threshold / size;
+        reconstructed[ table.alias[i] ] += ( 1.0 - threshold ) / size;
+    }
+
+    for ( unsigned int i = 0; passed && i < size; i++ )
+    {
+        double  expected = weight[i] / expectedWeight;
+
+        if (    fabs( reconstructed[i] - expected ) > ALIAS_TABLE_TOLERANCE
+             || fabs( araliastable_probability( & table, i ) - expected )
+                    > ALIAS_TABLE_TOLERANCE )
+        {
+            printf(
+                "%s: entry %u is drawn with probability %g, stored as %g, "
+                "instead of %g\n"
+                ,   name
+                ,   i
+                ,   reconstructed[i]
+                ,   araliastable_probability( & table, i )
+                ,   expected
+                );
+
+            passed = NO;
+        }
+    }
+
+    //   Drawing with evenly spaced random values, including the ones right
+    //   at the bucket boundaries, must never yield a zero weight entry.
+
+    unsigned int  draws = size * ALIAS_TABLE_DRAWS_PER_ENTRY;
+
+    for ( unsigned int d = 0; passed && d < draws; d++ )
+    {
+        unsigned int  index =
+            araliastable_sample( & table, d / (double) draws );
+
+        if ( index >= size || weight[ index ] == 0.0 )
+        {
+            printf(
+                "%s: random value %g draws entry %u\n"
+                ,   name
+                ,   d / (double) draws
+                ,   index
+                );
+
+            passed = NO;
+        }
+    }
+
+    FREE_ARRAY( reconstructed );
+    araliastable_free_contents( & table );
+
+    return passed;
+}
+
+#define ALIAS_TABLE_LARGE_SIZE      1000
+
+BOOL art_selftest_alias_table(
+        ART_GV  * art_gv
+        )
+{
+    (void) art_gv;
+
+    BOOL  passed = YES;
+
+    double  single[] = { 3.5 };
+
+    passed &= alias_table_check_weights( "single entry", single, 1 );
+
+    double  allInOne[] = { 0.0, 0.0, 0.0, 7.0, 0.0, 0.0 };
+
+    passed &= alias_table_check_weights( "one of six", allInOne, 6 );
+
+    double  none[] = { 0.0, 0.0, 0.0 };
+
+    passed &= alias_table_check_weights( "no weight", none, 3 );
+
+    double  skewed[] = { 1000.0, 0.0, 1.0, 0.001, 0.0, 250.0, 1.0e-9, 3.0 };
+
+    passed &= alias_table_check_weights( "skewed", skewed, 8 );
+
+    //   Geometrically falling weights over many orders of magnitude, with
+    //   every seventh entry left out.
+
+    double  * geometric = ALLOC_ARRAY( double, ALIAS_TABLE_LARGE_SIZE );
+
+    for ( unsigned int i = 0; i < ALIAS_TABLE_LARGE_SIZE; i++ )
+        geometric[i] = ( i % 7 == 3 ) ? 0.0 : pow( 0.97, i );
+
+    passed &=
+        alias_table_check_weights(
+            "geometric",
+            geometric,
+            ALIAS_TABLE_LARGE_SIZE
+            );
+
+    FREE_ARRAY( geometric );
+
+    return passed;
+}
+
+// ===========================================================================
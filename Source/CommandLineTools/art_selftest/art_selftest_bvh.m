@@ -0,0 +1,387 @@
+/* ===========================================================================
+
+    Copyright (c) 1996-2021 The ART Development Team
+    -------------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#import "art_selftest.h"
+
+#include <stdarg.h>
+
+/* ---------------------------------------------------------------------------
+
+    'art_selftest_bvh'
+
+    Builds binned SAH BVHs (as used by ArnBVH, and for triangle mesh faces
+    and light sources) over several sets of boxes, and walks each of them
+    to check that
+
+    - every node is reached exactly once, and no deeper than the depth
+      limit, with the first child of each inner node directly following
+      it in the array,
+    - no leaf holds more than the leaf size,
+    - the box of each node lies inside that of its parent, and each
+      primitive box inside that of its leaf,
+    - the leaves cover the reordered primitive array exactly once, and the
+      primitive indices are still a permutation.
+
+    Among the sets are boxes with coinciding centres, which binning cannot
+    separate, and boxes spread out exponentially, which drive SAH splits
+    into the depth limit.
+
+------------------------------------------------------------------------aw- */
+
+typedef struct BVHCheck
+{
+    const char         * name;
+    BVHBuildPrimitive  * primitives;
+    long                 numberOfPrimitives;
+    int                  leafSize;
+    BVHNode            * nodes;
+    long                 numberOfNodes;
+    char               * nodeVisited;
+    char               * primitiveCovered;
+    BOOL                 passed;
+}
+BVHCheck;
+
+static void bvh_check_failed(
+        BVHCheck    * check,
+        const char  * format,
+        ...
+        )
+{
+    //   Only the first problem of each tree is reported.
+
+    if ( check->passed )
+    {
+        va_list  arguments;
+
+        va_start( arguments, format );
+
+        printf( "%s: ", check->name );
+        vprintf( format, arguments );
+        printf( "\n" );
+
+        va_end( arguments );
+    }
+
+    check->passed = NO;
+}
+
+static BOOL bvh_node_inside(
+        const BVHNode  * inner,
+        const BVHNode  * outer
+        )
+{
+    for ( int k = 0; k < 3; k++ )
+        if ( inner->min[k] < outer->min[k] || inner->max[k] > outer->max[k] )
+            return NO;
+
+    return YES;
+}
+
+static BOOL bvh_box_inside_node(
+        const Box3D    * box,
+        const BVHNode  * node
+        )
+{
+    for ( int k = 0; k < 3; k++ )
+        if (    BOX3D_MIN_I( *box, k ) < node->min[k]
+             || BOX3D_MAX_I( *box, k ) > node->max[k] )
+            return NO;
+
+    return YES;
+}
+
+static void bvh_check_node(
+        BVHCheck  * check,
+        long        nodeIndex,
+        long        parentIndex,
+        int         depth
+        )
+{
+    if ( ! check->passed )
+        return;
+
+    if ( nodeIndex <= parentIndex || nodeIndex >= check->numberOfNodes )
+    {
+        bvh_check_failed(
+            check, "node %ld has a child %ld outside the array",
+            parentIndex, nodeIndex );
+        return;
+    }
+
+    if ( check->nodeVisited[ nodeIndex ]++ )
+    {
+        bvh_check_failed( check, "node %ld is reached twice", nodeIndex );
+        return;
+    }
+
+    if ( depth >= BVH_MAX_TREE_DEPTH )
+    {
+        bvh_check_failed(
+            check, "node %ld lies below the depth limit", nodeIndex );
+        return;
+    }
+
+    const BVHNode  * node = & check->nodes[ nodeIndex ];
+
+    if (    parentIndex >= 0
+         && ! bvh_node_inside( node, & check->nodes[ parentIndex ] ) )
+        bvh_check_failed(
+            check, "node %ld sticks out of its parent %ld",
+            nodeIndex, parentIndex );
+
+    if ( BVH_NODE_IS_LEAF( *node ) )
+    {
+        long  first = BVH_NODE_PRIMITIVE_OFFSET( *node );
+        long  count = BVH_NODE_PRIMITIVE_COUNT( *node );
+
+        if ( count > check->leafSize )
+            bvh_check_failed(
+                check, "leaf %ld holds %ld primitives, more than %d",
+                nodeIndex, count, check->leafSize );
+
+        if ( first < 0 || first + count > check->numberOfPrimitives )
+        {
+            bvh_check_failed(
+                check, "leaf %ld references primitives %ld to %ld",
+                nodeIndex, first, first + count - 1 );
+            return;
+        }
+
+        for ( long i = first; i < first + count; i++ )
+        {
+            if ( check->primitiveCovered[i]++ )
+                bvh_check_failed(
+                    check, "primitive %ld is in more than one leaf", i );
+
+            if ( ! bvh_box_inside_node( & check->primitives[i].box, node ) )
+                bvh_check_failed(
+                    check, "primitive %ld sticks out of its leaf %ld",
+                    i, nodeIndex );
+        }
+    }
+    else
+    {
+        bvh_check_node( check, nodeIndex + 1, nodeIndex, depth + 1 );
+
+        bvh_check_node(
+            check,
+            BVH_NODE_SECOND_CHILD( *node ),
+            nodeIndex,
+            depth + 1
+            );
+    }
+}
+
+static BOOL bvh_check_tree(
+        const char          * name,
+        BVHBuildPrimitive   * primitives,
+        long                  numberOfPrimitives,
+        int                   leafSize
+        )
+{
+    BVHCheck  check;
+
+    check.name               = name;
+    check.primitives         = primitives;
+    check.numberOfPrimitives = numberOfPrimitives;
+    check.leafSize           = M_CLAMP( leafSize, 1, BVH_NODE_MAX_PRIMITIVES );
+    check.passed             = YES;
+
+    //   The same boxes get built over several times, in the order the
+    //   previous build left them in.
+
+    for ( long i = 0; i < numberOfPrimitives; i++ )
+        primitives[i].index = i;
+
+    check.nodes =
+        bvhtree_build_binned_sah(
+              primitives,
+              numberOfPrimitives,
+              leafSize,
+            & check.numberOfNodes,
+              NULL
+            );
+
+    if ( numberOfPrimitives == 0 )
+    {
+        if ( check.nodes || check.numberOfNodes != 0 )
+            bvh_check_failed( & check, "no primitives, but a tree" );
+
+        return check.passed;
+    }
+
+    check.nodeVisited      = ALLOC_ARRAY_ZERO( char, check.numberOfNodes );
+    check.primitiveCovered = ALLOC_ARRAY_ZERO( char, numberOfPrimitives );
+
+    bvh_check_node( & check, 0, -1, 0 );
+
+    for ( long i = 0; check.passed && i < check.numberOfNodes; i++ )
+        if ( ! check.nodeVisited[i] )
+            bvh_check_failed( & check, "node %ld is never reached", i );
+
+    for ( long i = 0; check.passed && i < numberOfPrimitives; i++ )
+        if ( ! check.primitiveCovered[i] )
+            bvh_check_failed( & check, "primitive %ld is in no leaf", i );
+
+    //   The reordering must not lose or duplicate any primitive index.
+
+    char  * indexSeen = ALLOC_ARRAY_ZERO( char, numberOfPrimitives );
+
+    for ( long i = 0; check.passed && i < numberOfPrimitives; i++ )
+    {
+        long  index = primitives[i].index;
+
+        if ( index < 0 || index >= numberOfPrimitives || indexSeen[ index ]++ )
+            bvh_check_failed(
+                & check, "primitive index %ld is lost or duplicated", index );
+    }
+
+    FREE_ARRAY( indexSeen );
+    FREE_ARRAY( check.primitiveCovered );
+    FREE_ARRAY( check.nodeVisited );
+
+    bvhnode_free_array( check.nodes );
+
+    return check.passed;
+}
+
+static void bvh_set_primitive(
+        BVHBuildPrimitive  * primitive,
+        long                 index,
+        Pnt3D                centre,
+        double               halfSize
+        )
+{
+    primitive->index = index;
+    primitive->box   =
+        (Box3D) BOX3D(
+            PNT3D( XC(centre) - halfSize, YC(centre) - halfSize, ZC(centre) - halfSize ),
+            PNT3D( XC(centre) + halfSize, YC(centre) + halfSize, ZC(centre) + halfSize )
+            );
+
+    box3d_b_center_p( & primitive->box, & primitive->centroid );
+}
+
+//   A small linear congruential generator, so that the boxes are the
+//   same on every run and platform.
+
+static double bvh_random(
+        unsigned long long  * state
+        )
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+    return ( *state >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+#define BVH_RANDOM_BOXES            5000
+#define BVH_COINCIDING_BOXES        300
+#define BVH_STAIRCASE_STEPS         25
+#define BVH_STAIRCASE_CLUSTER       500
+
+BOOL art_selftest_bvh(
+        ART_GV  * art_gv
+        )
+{
+    (void) art_gv;
+
+    BOOL                 passed     = YES;
+    BVHBuildPrimitive  * primitives =
+        ALLOC_ARRAY( BVHBuildPrimitive, BVH_RANDOM_BOXES );
+
+    unsigned long long  state = 1;
+
+    for ( long i = 0; i < BVH_RANDOM_BOXES; i++ )
+    {
+        Pnt3D  centre =
+            PNT3D(
+                bvh_random( & state ),
+                bvh_random( & state ),
+                bvh_random( & state )
+                );
+
+        bvh_set_primitive(
+            & primitives[i], i, centre, 0.02 * bvh_random( & state ) );
+    }
+
+    passed &= bvh_check_tree( "random, leaf size 4", primitives, BVH_RANDOM_BOXES, 4 );
+    passed &= bvh_check_tree( "random, leaf size 1", primitives, BVH_RANDOM_BOXES, 1 );
+    passed &= bvh_check_tree( "random, leaf size 0", primitives, BVH_RANDOM_BOXES, 0 );
+    passed &= bvh_check_tree( "single box", primitives, 1, 4 );
+    passed &= bvh_check_tree( "no boxes", primitives, 0, 4 );
+
+    for ( long i = 0; i < BVH_COINCIDING_BOXES; i++ )
+        bvh_set_primitive(
+            & primitives[i], i, PNT3D( 0.5, 0.5, 0.5 ), 0.1 + 0.001 * i );
+
+    passed &= bvh_check_tree( "coinciding", primitives, BVH_COINCIDING_BOXES, 4 );
+
+    //   A cluster of small boxes, and along each axis a row of boxes each
+    //   20 times further out than the previous one. The SAH cuts off one
+    //   box of the rows at a time, which runs into the depth limit long
+    //   before the cluster is split up; the coordinates stay well within
+    //   single precision.
+
+    long  numberOfBoxes = 0;
+
+    for ( int axis = 0; axis < 3; axis++ )
+        for ( int i = 1; i <= BVH_STAIRCASE_STEPS; i++ )
+        {
+            Pnt3D  centre = PNT3D( 0.0, 0.0, 0.0 );
+
+            PNT3D_I( centre, axis ) = pow( 20.0, i );
+
+            bvh_set_primitive(
+                & primitives[ numberOfBoxes ], numberOfBoxes, centre, 0.5 );
+
+            numberOfBoxes++;
+        }
+
+    for ( int i = 0; i < BVH_STAIRCASE_CLUSTER; i++ )
+    {
+        Pnt3D  centre =
+            PNT3D(
+                bvh_random( & state ),
+                bvh_random( & state ),
+                bvh_random( & state )
+                );
+
+        bvh_set_primitive(
+            & primitives[ numberOfBoxes ], numberOfBoxes, centre, 0.01 );
+
+        numberOfBoxes++;
+    }
+
+    passed &= bvh_check_tree( "staircase, leaf size 4", primitives, numberOfBoxes, 4 );
+    passed &= bvh_check_tree( "staircase, leaf size 1", primitives, numberOfBoxes, 1 );
+
+    FREE_ARRAY( primitives );
+
+    return passed;
+}
+
+// ===========================================================================
@@ -0,0 +1,223 @@
+/* ===========================================================================
+
+    Copyright (c) 1996-2021 The ART Development Team
+    -------------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#import "art_selftest.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "Cx_ImplementationMacros.h"
+
+/* ---------------------------------------------------------------------------
+
+    'art_selftest_c4_arithmetic'
+
+    The element-wise Crd4 arithmetic in C4.h is vectorised with SSE2 or
+    AVX (or a scalar stand-in, with _ART_WITHOUT_SIMD), and is meant to
+    give exactly the results of the generic Cx loops. The generic loops
+    are instantiated here as 'reference_c4_*', and both versions are run
+    on all combinations of a set of awkward values - signed zeros, NaN,
+    infinities, denormals - so that each of them ends up as divisor in
+    each lane of the safediv and inv functions. The results are compared
+    bit by bit, so that -0.0 and 0.0 count as different, but NaNs only
+    have to be NaN in both.
+
+------------------------------------------------------------------------aw- */
+
+//   The reference functions are local to this file.
+
+#undef  INLINE_INSTRUCTION
+#define INLINE_INSTRUCTION      static
+
+_Cx_ARITHMETIC_IMPLEMENTATION(reference_,,d,double,0.0,1.0,MATH_HUGE_DOUBLE,4,f)
+
+#define C4_AWKWARD_VALUES       12
+
+static double  c4_awkward_value[ C4_AWKWARD_VALUES ];
+
+static void c4_init_awkward_values(
+        void
+        )
+{
+    double  * v = c4_awkward_value;
+
+    v[ 0] =   0.0;
+    v[ 1] = - 0.0;
+    v[ 2] =   NAN;
+    v[ 3] = - NAN;
+    v[ 4] =   INFINITY;
+    v[ 5] = - INFINITY;
+    v[ 6] =   1.0;
+    v[ 7] = - 2.5;
+    v[ 8] =   DBL_MIN / 4.0;
+    v[ 9] =   DBL_MAX;
+    v[10] =   3.0e-7;
+    v[11] = - 1.0e+5;
+}
+
+//   The i-th combination of awkward values, counting in base
+//   C4_AWKWARD_VALUES with the lanes as digits, offset by a shift so
+//   that different arguments get different combinations.
+
+static Crd4 c4_awkward_crd(
+        unsigned int  i,
+        unsigned int  shift
+        )
+{
+    Crd4  c;
+
+    for ( unsigned int j = 0; j < 4; j++ )
+    {
+        C4_CI( c, j ) =
+            c4_awkward_value[ ( i + shift ) % C4_AWKWARD_VALUES ];
+
+        i /= C4_AWKWARD_VALUES;
+    }
+
+    return c;
+}
+
+//   Bit for bit, except that any NaN equals any other: which of two NaN
+//   operands survives an addition is up to the order in which the
+//   compiler puts them, and C leaves that open for both versions.
+
+static BOOL c4_same(
+        const Crd4  * c0,
+        const Crd4  * c1
+        )
+{
+    for ( unsigned int i = 0; i < 4; i++ )
+    {
+        double  d0 = C4_CI( *c0, i );
+        double  d1 = C4_CI( *c1, i );
+
+        if ( isnan( d0 ) && isnan( d1 ) )
+            continue;
+
+        if ( memcmp( & d0, & d1, sizeof(double) ) != 0 )
+            return NO;
+    }
+
+    return YES;
+}
+
+#define C4_SAME(_c0,_c1)        c4_same( & (_c0), & (_c1) )
+
+#define C4_COMPARE(_name,_call_new,_call_reference) \
+do { \
+    Crd4  resultNew       = cr; \
+    Crd4  resultReference = cr; \
+    { Crd4  * rr = & resultNew;       (void) rr; _call_new; } \
+    { Crd4  * rr = & resultReference; (void) rr; _call_reference; } \
+    if ( ! C4_SAME( resultNew, resultReference ) ) \
+    { \
+        if ( mismatches++ == 0 ) \
+            printf( \
+                "c4_%s differs from the generic loop:\n" \
+                "   c0  " C4_C_FORMAT("%g") "\n" \
+                "   c1  " C4_C_FORMAT("%g") "\n" \
+                "   cr  " C4_C_FORMAT("%g") "\n" \
+                "   d   %g\n" \
+                "   got " C4_C_FORMAT("%g") "\n" \
+                "   not " C4_C_FORMAT("%g") "\n" \
+                ,   (_name) \
+                ,   C4_C_PRINTF(c0), C4_C_PRINTF(c1), C4_C_PRINTF(cr), d \
+                ,   C4_C_PRINTF(resultNew), C4_C_PRINTF(resultReference) \
+                ); \
+    } \
+} while (0)
+
+#define C4_CHECK(_f,...) \
+    C4_COMPARE( \
+        #_f, \
+        c4_##_f( __VA_ARGS__ ), \
+        reference_c4_##_f( __VA_ARGS__ ) \
+        )
+
+BOOL art_selftest_c4_arithmetic(
+        ART_GV  * art_gv
+        )
+{
+    (void) art_gv;
+
+    c4_init_awkward_values();
+
+    unsigned long  combinations =
+          C4_AWKWARD_VALUES * C4_AWKWARD_VALUES
+        * C4_AWKWARD_VALUES * C4_AWKWARD_VALUES;
+
+    unsigned long  mismatches = 0;
+
+    for ( unsigned int i = 0; i < combinations; i++ )
+    {
+        Crd4    c0 = c4_awkward_crd( i, 0 );
+        Crd4    c1 = c4_awkward_crd( i, 5 );
+        Crd4    c2 = c4_awkward_crd( i, 7 );
+        Crd4    cr = c4_awkward_crd( i, 3 );
+        double  d  = c4_awkward_value[ ( i / 7 ) % C4_AWKWARD_VALUES ];
+        double  e  = c4_awkward_value[ ( i / 3 ) % C4_AWKWARD_VALUES ];
+
+        C4_CHECK( inv_c,                        rr );
+        C4_CHECK( c_inv_c,                      & c0, rr );
+        C4_CHECK( d_add_c,                      d, rr );
+        C4_CHECK( d_sub_c,                      d, rr );
+        C4_CHECK( d_mul_c,                      d, rr );
+        C4_CHECK( d_div_c,                      d, rr );
+        C4_CHECK( c_add_c,                      & c0, rr );
+        C4_CHECK( c_sub_c,                      & c0, rr );
+        C4_CHECK( c_mul_c,                      & c0, rr );
+        C4_CHECK( c_div_c,                      & c0, rr );
+        C4_CHECK( c_safediv_c,                  & c0, rr );
+        C4_CHECK( cc_add_c,                     & c0, & c1, rr );
+        C4_CHECK( cc_sub_c,                     & c0, & c1, rr );
+        C4_CHECK( cc_mul_c,                     & c0, & c1, rr );
+        C4_CHECK( cc_div_c,                     & c0, & c1, rr );
+        C4_CHECK( cc_safediv_c,                 & c0, & c1, rr );
+        C4_CHECK( cc_safediv_c,                 & c1, & c0, rr );
+        C4_CHECK( dc_add_c,                     d, & c0, rr );
+        C4_CHECK( dc_sub_c,                     d, & c0, rr );
+        C4_CHECK( dc_mul_c,                     d, & c0, rr );
+        C4_CHECK( dc_div_c,                     d, & c0, rr );
+        C4_CHECK( cd_sub_c,                     & c0, d, rr );
+        C4_CHECK( cd_div_c,                     & c0, d, rr );
+        C4_CHECK( dcc_interpol_c,               d, & c0, & c1, rr );
+        C4_CHECK( dc_mul_add_c,                 d, & c0, rr );
+        C4_CHECK( dc_mul_c_add_c,               d, & c0, & c1, rr );
+        C4_CHECK( dc_mul_dc_mul_add_c,          d, & c0, e, & c1, rr );
+        C4_CHECK( dc_mul_dc_mul_dc_mul_add3_c,  d, & c0, e, & c1, d, & c2, rr );
+    }
+
+    if ( mismatches )
+        printf(
+            "%lu mismatches in %lu combinations of arguments\n"
+            ,   mismatches
+            ,   combinations
+            );
+
+    return mismatches == 0;
+}
+
+// ===========================================================================
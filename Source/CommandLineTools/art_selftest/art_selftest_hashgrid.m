@@ -0,0 +1,367 @@
+/* ===========================================================================
+
+    Copyright (c) 1996-2021 The ART Development Team
+    -------------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#import "art_selftest.h"
+
+/* ---------------------------------------------------------------------------
+
+    'art_selftest_hashgrid'
+
+    Builds the vertex merging hash grid with several threads over a set of
+    vertices - random ones, copies of earlier ones, and ones right on cell
+    boundaries and cell centres, where the choice of the 2x2x2 cells to
+    search flips - and checks that
+
+    - every vertex index is stored exactly once, in the table entry of
+      its own cell, and in ascending order within that entry,
+    - the vertices within the radius of a query point, as found in the
+      cells 'GetCellsNear' names, are exactly those a brute force search
+      over all vertices finds, each of them once.
+
+    The grid is built with a small and then a large radius, so the second
+    build also reuses the tables of the first, and then once more over
+    only a few of the vertices, where the table is so small that the
+    2x2x2 cells around a query share entries, which must only be searched
+    once.
+
+------------------------------------------------------------------------aw- */
+
+#define HASHGRID_VERTICES           8192
+#define HASHGRID_THREADS            4
+#define HASHGRID_RANDOM_QUERIES     4000
+#define HASHGRID_FEW_VERTICES       5
+
+//   The same generator as in the BVH check, so that the vertices are the
+//   same on every run and platform.
+
+static double hashgrid_random(
+        unsigned long long  * state
+        )
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+    return ( *state >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+static double hashgrid_sqrdist(
+        const Pnt3D  * a,
+        const Pnt3D  * b
+        )
+{
+    Vec3D  distVec;
+
+    vec3d_pp_sub_v( a, b, & distVec );
+
+    return vec3d_v_sqrlen( & distVec );
+}
+
+static BOOL hashgrid_check_cells(
+        const char               * name,
+        ArcHashgrid              * hashgrid,
+        ArPathVertexptrDynArray  * vertices
+        )
+{
+    unsigned int  n = arpvptrdynarray_size( vertices );
+
+    if (    hashgrid->numberOfVertices != n
+         || hashgrid->cellStart[ hashgrid->numberOfCells ] != n )
+    {
+        printf(
+            "%s: %u vertices, %u stored, instead of %u\n"
+            ,   name
+            ,   hashgrid->numberOfVertices
+            ,   hashgrid->cellStart[ hashgrid->numberOfCells ]
+            ,   n
+            );
+
+        return NO;
+    }
+
+    BOOL    passed = YES;
+    char  * stored = ALLOC_ARRAY_ZERO( char, n );
+
+    for ( uint32_t c = 0; passed && c < hashgrid->numberOfCells; c++ )
+    {
+        uint32_t  rangeStart, rangeEnd;
+
+        [ hashgrid GetCellRange: c : & rangeStart : & rangeEnd ];
+
+        for ( uint32_t j = rangeStart; passed && j < rangeEnd; j++ )
+        {
+            uint32_t  index = hashgrid->cellIndices[j];
+
+            if ( index >= n || stored[index] )
+            {
+                printf( "%s: vertex %u stored twice\n", name, index );
+                passed = NO;
+            }
+            else if (    [ hashgrid GetCellIndexOf:
+                             arpvptrdynarray_i( vertices, index )
+                                 ->worldHitPoint->worldspace_point ]
+                      != c )
+            {
+                printf( "%s: vertex %u stored in entry %u\n", name, index, c );
+                passed = NO;
+            }
+            else if ( j > rangeStart && hashgrid->cellIndices[j - 1] > index )
+            {
+                printf( "%s: entry %u is not sorted\n", name, c );
+                passed = NO;
+            }
+            else
+                stored[index] = 1;
+        }
+    }
+
+    FREE_ARRAY( stored );
+
+    return passed;
+}
+
+static BOOL hashgrid_check_query(
+        const char               * name,
+        ArcHashgrid              * hashgrid,
+        ArPathVertexptrDynArray  * vertices,
+        Pnt3D                      position,
+        unsigned int             * found
+        )
+{
+    unsigned int  n = arpvptrdynarray_size( vertices );
+
+    for ( unsigned int i = 0; i < n; i++ )
+        found[i] = 0;
+
+    uint32_t      cells[8];
+    unsigned int  numberOfNearbyCells =
+        [ hashgrid GetCellsNear
+            :   position
+            :   cells
+            ];
+
+    for ( unsigned int c = 0; c < numberOfNearbyCells; c++ )
+    {
+        uint32_t  rangeStart, rangeEnd;
+
+        [ hashgrid GetCellRange: cells[c] : & rangeStart : & rangeEnd ];
+
+        for ( uint32_t j = rangeStart; j < rangeEnd; j++ )
+        {
+            uint32_t  index = hashgrid->cellIndices[j];
+
+            if (    hashgrid_sqrdist(
+                        & arpvptrdynarray_i( vertices, index )
+                              ->worldHitPoint->worldspace_point,
+                        & position )
+                 <= hashgrid->radiusSQR )
+                found[index]++;
+        }
+    }
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        unsigned int  expected =
+              hashgrid_sqrdist(
+                  & arpvptrdynarray_i( vertices, i )
+                        ->worldHitPoint->worldspace_point,
+                  & position )
+            <= hashgrid->radiusSQR;
+
+        if ( found[i] != expected )
+        {
+            printf(
+                "%s: query at (%g, %g, %g) finds vertex %u %u times "
+                "instead of %u\n"
+                ,   name
+                ,   PNT3D_I( position, 0 )
+                ,   PNT3D_I( position, 1 )
+                ,   PNT3D_I( position, 2 )
+                ,   i
+                ,   found[i]
+                ,   expected
+                );
+
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+static BOOL hashgrid_check_radius(
+        const char               * name,
+        ArcHashgrid              * hashgrid,
+        ArPathVertexptrDynArray  * vertices,
+        double                     radius
+        )
+{
+    [ hashgrid BuildHashgrid
+        :   vertices
+        :   radius
+        :   HASHGRID_THREADS
+        ];
+
+    if ( ! hashgrid_check_cells( name, hashgrid, vertices ) )
+        return NO;
+
+    unsigned int  n = arpvptrdynarray_size( vertices );
+    unsigned int  * found = ALLOC_ARRAY( unsigned int, n );
+
+    BOOL  passed = YES;
+
+    //   Queries at the vertices themselves, and at cell boundaries and
+    //   cell centres relative to the corner of the grid.
+
+    for ( unsigned int i = 0; passed && i < n; i += 7 )
+        passed &=
+            hashgrid_check_query(
+                name,
+                hashgrid,
+                vertices,
+                arpvptrdynarray_i( vertices, i )->worldHitPoint->worldspace_point,
+                found
+                );
+
+    double  halfCell = 0.5 * hashgrid->cellSize;
+
+    for ( int k = -1; passed && k * halfCell <= 1.0 + halfCell; k++ )
+    {
+        double  offset = k * halfCell;
+
+        Pnt3D  position =
+            PNT3D(
+                VEC3D_I( hashgrid->bboxMin, 0 ) + offset,
+                VEC3D_I( hashgrid->bboxMin, 1 ) + 0.5 * offset,
+                VEC3D_I( hashgrid->bboxMin, 2 ) + 1.0 - offset
+                );
+
+        passed &= hashgrid_check_query( name, hashgrid, vertices, position, found );
+    }
+
+    //   Random queries, some of them outside the bounding box.
+
+    unsigned long long  state = 12345;
+
+    for ( unsigned int i = 0; passed && i < HASHGRID_RANDOM_QUERIES; i++ )
+    {
+        Pnt3D  position =
+            PNT3D(
+                1.2 * hashgrid_random( & state ) - 0.1,
+                1.2 * hashgrid_random( & state ) - 0.1,
+                1.2 * hashgrid_random( & state ) - 0.1
+                );
+
+        passed &= hashgrid_check_query( name, hashgrid, vertices, position, found );
+    }
+
+    FREE_ARRAY( found );
+
+    return passed;
+}
+
+BOOL art_selftest_hashgrid(
+        ART_GV  * art_gv
+        )
+{
+    //   The cells are twice the smaller radius wide, and the grid starts
+    //   at the origin, as there is a vertex there.
+
+    double  radius = 0.02;
+    double  cellSize = 2.0 * radius;
+
+    ArPathVertex     * pathVertex = ALLOC_ARRAY_ZERO( ArPathVertex, HASHGRID_VERTICES );
+    ArcIntersection ** hitPoint   = ALLOC_ARRAY( ArcIntersection *, HASHGRID_VERTICES );
+
+    ArPathVertexptrDynArray  vertices = arpvptrdynarray_init( HASHGRID_VERTICES );
+
+    unsigned long long  state = 1;
+
+    for ( unsigned int i = 0; i < HASHGRID_VERTICES; i++ )
+    {
+        Pnt3D  position;
+
+        if ( i == 0 )
+            position = PNT3D( 0.0, 0.0, 0.0 );
+        else if ( i == 1 )
+            position = PNT3D( 1.0, 1.0, 1.0 );
+        else if ( i % 5 == 0 )
+            position =
+                arpvptrdynarray_i( & vertices, i / 5 )
+                    ->worldHitPoint->worldspace_point;
+        else if ( i % 5 == 1 )
+        {
+            //   On a cell boundary, or in the middle of a cell, along each
+            //   axis.
+
+            for ( uint32_t j = 0; j < 3; j++ )
+                PNT3D_I( position, j ) =
+                    0.5 * cellSize
+                    * (int)( hashgrid_random( & state ) * 2.0 / cellSize );
+        }
+        else
+            position =
+                PNT3D(
+                    hashgrid_random( & state ),
+                    hashgrid_random( & state ),
+                    hashgrid_random( & state )
+                    );
+
+        hitPoint[i] = [ ALLOC_INIT_OBJECT(ArcIntersection) ];
+        hitPoint[i]->worldspace_point = position;
+        pathVertex[i].worldHitPoint = hitPoint[i];
+
+        arpvptrdynarray_push( & vertices, & pathVertex[i] );
+    }
+
+    ArcHashgrid  * hashgrid = [ ALLOC_INIT_OBJECT(ArcHashgrid) ];
+
+    BOOL  passed = YES;
+
+    passed &= hashgrid_check_radius( "radius 0.02", hashgrid, & vertices, radius );
+    passed &= hashgrid_check_radius( "radius 0.15", hashgrid, & vertices, 0.15 );
+
+    ArPathVertexptrDynArray  fewVertices =
+        arpvptrdynarray_init( HASHGRID_FEW_VERTICES );
+
+    for ( unsigned int i = 0; i < HASHGRID_FEW_VERTICES; i++ )
+        arpvptrdynarray_push( & fewVertices, & pathVertex[i] );
+
+    passed &= hashgrid_check_radius( "few vertices", hashgrid, & fewVertices, 0.5 );
+
+    arpvptrdynarray_free_contents( & fewVertices );
+
+    RELEASE_OBJECT( hashgrid );
+
+    for ( unsigned int i = 0; i < HASHGRID_VERTICES; i++ )
+        RELEASE_OBJECT( hitPoint[i] );
+
+    arpvptrdynarray_free_contents( & vertices );
+    FREE_ARRAY( hitPoint );
+    FREE_ARRAY( pathVertex );
+
+    return passed;
+}
+
+// ===========================================================================
@@ -28,6 +28,13 @@
 #import "_ArLight_GV.h"
 #import "FoundationAssertionMacros.h"
 
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 /* ===========================================================================
 
     'artist' comand line rendering tool
@@ -109,6 +116,501 @@
 
 ========================================================================aw= */
 
+/* ===========================================================================
+
+    'artist' render server mode
+    ---------------------------
+
+    With '-server <socket>', artist loads the scene given on the command
+    line once, and then renders jobs it receives over a Unix domain socket
+    at that path, one at a time, until it is told to shut down. A job is one
+    line of space separated key=value pairs:
+
+        output=<file> [camera=<file>] [samples=<spp>] [actions=<file>]
+
+    'output' names the ARTRAW result, and thereby all files the action
+    sequence derives from it. 'camera' and 'actions' replace the camera and
+    action sequence of the scene for this job, and 'samples' overrides the
+    number of samples per pixel. Each job is answered with one line, either
+    "ok <seconds> <file>", or "error <reason>". The line "shutdown" ends the
+    server.
+
+    The point of all this is that everything which only depends on the
+    scene geometry is done once, and not once per job: the standard ray
+    casting acceleration structure and the light source collectors of the
+    action sequences are wrapped in ArnCachedAction nodes, which hand out
+    their previous results as long as they are given the same scene.
+
+    The resolution options given on the command line apply to all jobs.
+
+========================================================================aw= */
+
+#define ARTIST_SERVER_MAX_JOB_LENGTH    4096
+
+/* ---------------------------------------------------------------------------
+    'artist_server_cache_scene_preparation'
+        Walks an action sequence, and replaces the standard ray casting
+        acceleration structure creation with the given cached version of
+        it, and each light source collector with a cached one of its own.
+        Nested action sequences are processed as well.
+------------------------------------------------------------------------aw- */
+
+static void artist_server_cache_scene_preparation(
+        ART_GV                * art_gv,
+        ArNode                * actionSequence,
+        ArnCachedAction       * cachedOptimisation
+        )
+{
+    ArNode  * optimisation =
+        (ArNode *) CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE;
+
+    for ( unsigned long i = 0; i < [ actionSequence numberOfSubnodes ]; i++ )
+    {
+        ArNode  * action = [ actionSequence subnodeWithIndex: i ];
+
+        if ( action == optimisation )
+            [ actionSequence setSubnodeRefWithIndex
+                :   i
+                :   HARD_NODE_REFERENCE(cachedOptimisation)
+                ];
+        else if ( [ action isKindOfClass: [ ArnLightsourceCollector class ] ] )
+        {
+            ArnCachedAction  * cachedCollector =
+                [ ALLOC_INIT_OBJECT(ArnCachedAction)
+                    :   (ArNode <ArpAction> *) action
+                    :   2
+                    ];
+
+            [ actionSequence setSubnodeRefWithIndex
+                :   i
+                :   HARD_NODE_REFERENCE(cachedCollector)
+                ];
+
+            RELEASE_OBJECT( cachedCollector );
+        }
+        else if ( [ action isKindOfClass: [ ArnActionSequence class ] ] )
+            artist_server_cache_scene_preparation(
+                art_gv,
+                action,
+                cachedOptimisation
+                );
+    }
+}
+
+/* ---------------------------------------------------------------------------
+    'artist_server_parse_file'
+        Parsing errors are fatal, so the file is checked first; the job
+        fails if it cannot be read, or if it does not contain an object
+        with the given protocol.
+------------------------------------------------------------------------aw- */
+
+static ArNode * artist_server_parse_file(
+        ART_GV      * art_gv,
+        const char  * fileName,
+        Protocol    * protocol,
+        const char ** error
+        )
+{
+    if ( access( fileName, R_OK ) != 0 )
+    {
+        *error = "file cannot be read";
+        return 0;
+    }
+
+    id  contents =
+        art_parse_file(
+            art_gv,
+            fileName,
+            YES
+            );
+
+    if ( ! [ contents conformsToProtocol: protocol ] )
+    {
+        RELEASE_OBJECT( contents );
+
+        *error = "file does not contain a suitable object";
+        return 0;
+    }
+
+    return contents;
+}
+
+/* ---------------------------------------------------------------------------
+    'artist_server_render_job'
+        Parses and performs one job, and returns NULL on success, or the
+        reason why it failed.
+------------------------------------------------------------------------aw- */
+
+static const char * artist_server_render_job(
+        ART_GV                          * art_gv,
+        char                            * job,
+        ArNode <ArpScene, ArpAction>    * sceneGraph,
+        ArnCachedAction                 * cachedOptimisation,
+        IVec2D                            imageSize,
+        FVec2D                            resolution,
+        ArNode <ArpBasicImageInfo>      * baseImage,
+        IPnt2D                            imageOrigin,
+        double                          * renderTime,
+        char                           ** imageFileName
+        )
+{
+    const char  * outputName = 0;
+    const char  * cameraFileName = 0;
+    const char  * acsFileName = 0;
+    unsigned int  samples = 0;
+    char        * saveptr = 0;
+
+    for ( char * token = strtok_r( job, " \t\r\n", & saveptr );
+          token;
+          token = strtok_r( 0, " \t\r\n", & saveptr ) )
+    {
+        char  * value = strchr( token, '=' );
+
+        if ( ! value || value[1] == 0 )
+            return "job entries have to be of the form key=value";
+
+        *value++ = 0;
+
+        if ( strcmp( token, "output" ) == 0 )
+            outputName = value;
+        else if ( strcmp( token, "camera" ) == 0 )
+            cameraFileName = value;
+        else if ( strcmp( token, "actions" ) == 0 )
+            acsFileName = value;
+        else if ( strcmp( token, "samples" ) == 0 )
+        {
+            char  * end;
+
+            samples = (unsigned int) strtoul( value, & end, 10 );
+
+            if ( *end || samples == 0 )
+                return "samples have to be a positive number";
+        }
+        else
+            return "unknown job entry";
+    }
+
+    if ( ! outputName )
+        return "no output given";
+
+    //   Both files are read before anything is changed, so that a job
+    //   that fails leaves the scene as it was.
+
+    const char  * error = 0;
+
+    ArNode <ArpCamera>  * camera = 0;
+
+    if ( cameraFileName )
+    {
+        camera =
+            (ArNode <ArpCamera> *) artist_server_parse_file(
+                art_gv,
+                cameraFileName,
+                @protocol(ArpCamera),
+                & error
+                );
+
+        if ( ! camera )
+            return error;
+    }
+
+    ArNode <ArpActionSequence>  * actionSequence = 0;
+
+    if ( acsFileName )
+    {
+        actionSequence =
+            (ArNode <ArpActionSequence> *) artist_server_parse_file(
+                art_gv,
+                acsFileName,
+                @protocol(ArpActionSequence),
+                & error
+                );
+
+        if ( ! actionSequence )
+        {
+            if ( camera )
+                RELEASE_OBJECT( camera );
+
+            return error;
+        }
+    }
+
+    ArNode <ArpCamera>  * defaultCamera =
+        RETAIN_OBJECT( [ sceneGraph camera ] );
+    ArNode <ArpActionSequence>  * defaultActionSequence =
+        RETAIN_OBJECT( [ sceneGraph actionSequence ] );
+
+    if ( camera )
+    {
+        //   The resolution is that of the server, not of the job camera.
+
+        IVec2D  cameraImageSize;
+
+        [ defaultCamera getImageSize
+            : & cameraImageSize
+            ];
+
+        [ camera setImageSize
+            : & cameraImageSize
+            ];
+
+        [ sceneGraph setCamera: camera ];
+    }
+
+    if ( actionSequence )
+    {
+        artist_server_cache_scene_preparation(
+            art_gv,
+            actionSequence,
+            cachedOptimisation
+            );
+
+        [ sceneGraph setActionSequence: actionSequence ];
+    }
+
+    const char  * extension = strrchr( outputName, '.' );
+
+    if (   extension
+        && (   strcmp( extension + 1, ARFARTRAW_EXTENSION ) == 0
+            || strcmp( extension + 1, "exr" ) == 0 ) )
+        arstring_s_copy_s(
+              outputName,
+              imageFileName
+            );
+    else
+        arstring_pe_copy_add_extension_p(
+              outputName,
+              ARFARTRAW_EXTENSION,
+              imageFileName
+            );
+
+    ArnImageInfo  * imageInfo =
+        [ ALLOC_INIT_OBJECT(ArnImageInfo)
+            :   imageSize
+            :   art_isr( art_gv )
+            :   art_isr( art_gv )
+            :   resolution
+            ];
+
+    ArNode <ArpBasicImage>  * image =
+        [ ALLOC_INIT_OBJECT(ArnFileImage)
+            :   *imageFileName
+            :   imageInfo
+            ];
+
+    if ( baseImage )
+    {
+        ArNode <ArpBasicImage>  * partImage =
+            [ ALLOC_INIT_OBJECT(ArnPartImage)
+                :   HARD_NODE_REFERENCE(baseImage)
+                :   HARD_NODE_REFERENCE(image)
+                :   imageOrigin
+                ];
+
+        RELEASE_OBJECT( image );
+
+        image = partImage;
+    }
+
+    ART_APPLICATION_NODESTACK_PUSH(
+        image
+        );
+
+    RELEASE_OBJECT( image );
+    RELEASE_OBJECT( imageInfo );
+
+    [ ART_APPLICATION_NODESTACK setMasterOutputFilename
+        :   *imageFileName
+        ];
+
+    arntiledstochasticsampler_set_samples_per_pixel( art_gv, samples );
+
+    ArTime  renderStarted;
+    ArTime  renderFinished;
+
+    artime_now( & renderStarted );
+
+    [ sceneGraph performOn
+        :   ART_APPLICATION_NODESTACK
+        ];
+
+    artime_now( & renderFinished );
+
+    *renderTime =
+          artime_seconds( & renderFinished )
+        - artime_seconds( & renderStarted );
+
+    arntiledstochasticsampler_set_samples_per_pixel( art_gv, 0 );
+
+    //   Whatever the action sequence left on the stack would otherwise
+    //   end up in the next job.
+
+    ArNodeRef  leftover_Ref;
+
+    while ( ARNODEREF_POINTER( leftover_Ref = [ ART_APPLICATION_NODESTACK pop ] ) )
+        RELEASE_NODE_REF( leftover_Ref );
+
+    [ sceneGraph setCamera: defaultCamera ];
+    [ sceneGraph setActionSequence: defaultActionSequence ];
+
+    if ( camera )
+        RELEASE_OBJECT( camera );
+
+    if ( actionSequence )
+        RELEASE_OBJECT( actionSequence );
+
+    RELEASE_OBJECT( defaultCamera );
+    RELEASE_OBJECT( defaultActionSequence );
+
+    return 0;
+}
+
+static void artist_serve(
+        ART_GV                          * art_gv,
+        const char                      * socketPath,
+        ArNode <ArpScene, ArpAction>    * sceneGraph,
+        IVec2D                            imageSize,
+        FVec2D                            resolution,
+        ArNode <ArpBasicImageInfo>      * baseImage,
+        IPnt2D                            imageOrigin
+        )
+{
+    struct sockaddr_un  address;
+
+    if ( strlen( socketPath ) >= sizeof( address.sun_path ) )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "server socket path '%s' is too long"
+            ,   socketPath
+            );
+
+    memset( & address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    strcpy( address.sun_path, socketPath );
+
+    //   A socket left behind by a previous server is replaced, but no
+    //   other kind of file.
+
+    struct stat  socketStat;
+
+    if (    lstat( socketPath, & socketStat ) == 0
+         && S_ISSOCK( socketStat.st_mode ) )
+        unlink( socketPath );
+
+    int  serverSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+    if (    serverSocket < 0
+         || bind( serverSocket, (struct sockaddr *) & address, sizeof( address ) ) < 0
+         || listen( serverSocket, 1 ) < 0 )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "cannot listen on server socket '%s': %s"
+            ,   socketPath
+            ,   strerror( errno )
+            );
+
+    ArnCachedAction  * cachedOptimisation =
+        [ ALLOC_INIT_OBJECT(ArnCachedAction)
+            :   CREATE_STANDARD_RAYCASTING_ACCELERATION_STRUCTURE
+            :   1
+            ];
+
+    artist_server_cache_scene_preparation(
+        art_gv,
+        [ sceneGraph actionSequence ],
+        cachedOptimisation
+        );
+
+    [ ART_GLOBAL_REPORTER printf
+        :   "---   render server listening on %s   ---\n"
+        ,   socketPath
+        ];
+
+    //   A client that disconnects before it has read its reply must not
+    //   take the server and its prepared scene down with it: while the
+    //   server runs, writing to such a client fails with EPIPE instead of
+    //   raising SIGPIPE, and the connection is simply dropped.
+
+    void  (* previousSigpipeHandler)(int) = signal( SIGPIPE, SIG_IGN );
+
+    BOOL  shutdownRequested = NO;
+    char  job[ ARTIST_SERVER_MAX_JOB_LENGTH ];
+
+    while ( ! shutdownRequested )
+    {
+        int  connection = accept( serverSocket, 0, 0 );
+
+        if ( connection < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "server socket '%s' failed: %s"
+                ,   socketPath
+                ,   strerror( errno )
+                );
+        }
+
+        FILE  * input  = fdopen( connection, "r" );
+        FILE  * output = fdopen( dup( connection ), "w" );
+
+        while (    ! shutdownRequested
+                && fgets( job, ARTIST_SERVER_MAX_JOB_LENGTH, input ) )
+        {
+            if ( ! strchr( job, '\n' ) && ! feof( input ) )
+            {
+                fprintf( output, "error job too long\n" );
+                fflush( output );
+                break;
+            }
+
+            if ( strncmp( job, "shutdown", 8 ) == 0 )
+            {
+                fprintf( output, "ok shutdown\n" );
+                shutdownRequested = YES;
+                break;
+            }
+
+            double        renderTime = 0.0;
+            char        * imageFileName = 0;
+
+            const char  * error =
+                artist_server_render_job(
+                    art_gv,
+                    job,
+                    sceneGraph,
+                    cachedOptimisation,
+                    imageSize,
+                    resolution,
+                    baseImage,
+                    imageOrigin,
+                    & renderTime,
+                    & imageFileName
+                    );
+
+            if ( error )
+                fprintf( output, "error %s\n", error );
+            else
+                fprintf( output, "ok %.3f %s\n", renderTime, imageFileName );
+
+            if ( imageFileName )
+                FREE_ARRAY( imageFileName );
+
+            if ( fflush( output ) == EOF )
+                break;
+        }
+
+        fclose( output );
+        fclose( input );
+    }
+
+    close( serverSocket );
+    unlink( socketPath );
+
+    signal( SIGPIPE, previousSigpipeHandler );
+
+    RELEASE_OBJECT( cachedOptimisation );
+}
+
 int artist(
         int        argc,
         char    ** argv,
@@ -202,6 +704,136 @@ int artist(
             :   "normal shaded geometry preview"
             ] withDefaultIntegerValue: 1 ];
 
+    id bvhOpt =
+        [ FLAG_OPTION
+            :   "boundingVolumeHierarchy"
+            :   "bvh"
+            :   "use a BVH instead of a kd-tree for ray casting"
+            ];
+
+    id binnedOpt =
+        [ FLAG_OPTION
+            :   "binnedSAH"
+            :   "bsah"
+            :   "fast binned SAH kd-tree build for very large scenes"
+            ];
+
+    id bspCacheOpt =
+        [ FLAG_OPTION
+            :   "kdTreeCache"
+            :   "kdc"
+            :   "cache the kd-tree in <inputfile>.bspcache"
+            ];
+
+    id rcsOpt =
+        [ FLAG_OPTION
+            :   "rayCastingStatistics"
+            :   "rcs"
+            :   "report ray casting statistics after rendering"
+            ];
+
+    id rcsJSONOpt =
+        [ STRING_OPTION
+            :   "rayCastingStatisticsFile"
+            :   "rcsj"
+            :   "<filename>"
+            :   "also write the ray casting statistics to a JSON file"
+            ];
+
+    id adaptiveOpt =
+        [ FLOAT_OPTION
+            :   "adaptiveSampling"
+            :   "as"
+            :   "<relative error>"
+            :   "stop sampling pixels once they reach this relative error"
+            ];
+
+    id timeBudgetOpt =
+        [ FLOAT_OPTION
+            :   "timeBudget"
+            :   "tb"
+            :   "<seconds>"
+            :   "stop rendering before this much time has passed"
+            ];
+
+    id noiseTargetOpt =
+        [ FLOAT_OPTION
+            :   "noiseTarget"
+            :   "nt"
+            :   "<relative error>"
+            :   "stop rendering once the image has this noise level"
+            ];
+
+    id checkpointOpt =
+        [ STRING_OPTION
+            :   "checkpoint"
+            :   "cp"
+            :   "<filename>"
+            :   "save the render state to this file at intervals"
+            ];
+
+    id checkpointIntervalOpt =
+        [ [ FLOAT_OPTION
+            :   "checkpointInterval"
+            :   "cpi"
+            :   "<seconds>"
+            :   "time between two checkpoints"
+            ] withDefaultDoubleValue: 600.0 ];
+
+    id resumeOpt =
+        [ FLAG_OPTION
+            :   "resume"
+            :   "rsm"
+            :   "continue the render from the checkpoint file"
+            ];
+
+    id sampleRangeOpt =
+        [ STRING_OPTION
+            :   "sampleRange"
+            :   "sr"
+            :   "<k>/<n>"
+            :   "only render slice k (0..n-1) of n of the samples per pixel"
+            ];
+
+    id deferredFilteringOpt =
+        [ FLAG_OPTION
+            :   "deferredFiltering"
+            :   "df"
+            :   "apply the reconstruction filter once per image write"
+            ];
+
+    id tileSizeOpt =
+        [ INTEGER_OPTION
+            :   "tileSize"
+            :   "ts"
+            :   "<pixels>"
+            :   "size of the render windows (default: automatic)"
+            ];
+
+    id tileOrderOpt =
+        [ STRING_OPTION
+            :   "tileOrder"
+            :   "to"
+            :   "scanline|hilbert|spiral"
+            :   "order in which the render windows are handed out"
+            ];
+
+    id tevUpdateFrequencyOpt =
+        [ FLOAT_OPTION
+            :   "tevUpdateFrequency"
+            :   "tuf"
+            :   "<Hz>"
+            :   "maximum rate of tile updates sent to tev (0: unlimited)"
+            ];
+
+    id serverOpt =
+        [ STRING_OPTION
+            :   "server"
+            :   "srv"
+            :   "<socket>"
+            :   "keep the scene loaded, and render jobs sent to this socket"
+            ];
+
 // =============================   PHASE 2   =================================
 //
 //             Printing the banner, and parsing the command line.
@@ -229,7 +861,12 @@ int artist(
         "the 'impresario' tool, which allows users to control running instances of 'artist'\n"
         "that have been detached from a terminal.\n\n"
         "The simple RGB image sampler used for geometry preview renderings (the '-gpv' option)\n"
-        "does not offer this sort of feature.",
+        "does not offer this sort of feature.\n\n"
+        "Render server mode:\n\n"
+        "With '-server <socket>', the scene is prepared once, and then rendered for each\n"
+        "job line sent to the Unix socket, until the line 'shutdown' is received:\n\n"
+        "output=<file> [camera=<file>] [samples=<spp>] [actions=<file>]\n\n"
+        "Each job is answered with 'ok <seconds> <file>' or 'error <reason>'.",
         "artist <inputfile> [options]"
         );
 
@@ -245,6 +882,176 @@ int artist(
     if ( [ monoOpt hasBeenSpecified ] )
         art_set_hero_samples_to_splat( art_gv, 1 );
 
+    if ( [ bvhOpt hasBeenSpecified ] )
+    {
+        //   Both of these only apply to the kd-tree, which is not built
+        //   at all then.
+
+        if ( [ binnedOpt hasBeenSpecified ] )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "'-bsah' cannot be combined with '-bvh'"
+                );
+
+        if ( [ bspCacheOpt hasBeenSpecified ] )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "'-kdc' cannot be combined with '-bvh'"
+                );
+
+        art_set_raycasting_acceleration_structure(
+            art_gv,
+            arraycastingaccelerationstructure_bvh
+            );
+    }
+
+    if ( [ binnedOpt hasBeenSpecified ] )
+        art_set_bsp_tree_split_search(
+            art_gv,
+            arbsptreesplitsearch_binned_sah
+            );
+
+    if ( [ bspCacheOpt hasBeenSpecified ] )
+    {
+        char  * bspCacheFileName = 0;
+
+        arstring_pe_copy_add_extension_p(
+              argv[1],
+              "bspcache",
+            & bspCacheFileName
+            );
+
+        art_set_bsp_tree_cache_file_name(
+            art_gv,
+            bspCacheFileName
+            );
+
+        FREE_ARRAY(bspCacheFileName);
+    }
+
+    if ( [ rcsOpt hasBeenSpecified ] || [ rcsJSONOpt hasBeenSpecified ] )
+        arnraycaster_set_collect_statistics( art_gv, YES );
+
+    if ( [ rcsJSONOpt hasBeenSpecified ] )
+        arnraycaster_set_statistics_json_file_name(
+            art_gv,
+            [ rcsJSONOpt cStringValue ]
+            );
+
+    if ( [ adaptiveOpt hasBeenSpecified ] )
+        arntiledstochasticsampler_set_adaptive_sampling(
+            art_gv,
+            [ adaptiveOpt doubleValue ]
+            );
+
+    if ( [ timeBudgetOpt hasBeenSpecified ] )
+        arntiledstochasticsampler_set_time_budget(
+            art_gv,
+            [ timeBudgetOpt doubleValue ]
+            );
+
+    if ( [ noiseTargetOpt hasBeenSpecified ] )
+        arntiledstochasticsampler_set_noise_target(
+            art_gv,
+            [ noiseTargetOpt doubleValue ]
+            );
+
+    if ( [ resumeOpt hasBeenSpecified ] && ! [ checkpointOpt hasBeenSpecified ] )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "'-resume' needs a checkpoint file given via '-checkpoint'"
+            );
+
+    if ( [ checkpointOpt hasBeenSpecified ] )
+        arntiledstochasticsampler_set_checkpoint(
+            art_gv,
+            [ checkpointOpt cStringValue ],
+            [ checkpointIntervalOpt doubleValue ]
+            );
+
+    if ( [ resumeOpt hasBeenSpecified ] )
+        arntiledstochasticsampler_set_resume_from_checkpoint( art_gv, YES );
+
+    if ( [ sampleRangeOpt hasBeenSpecified ] )
+    {
+        unsigned int  sliceIndex, numberOfSlices;
+        char          trailing;
+
+        if (    sscanf(
+                    [ sampleRangeOpt cStringValue ],
+                    "%u/%u%c",
+                    & sliceIndex,
+                    & numberOfSlices,
+                    & trailing
+                    ) != 2
+             || numberOfSlices == 0
+             || sliceIndex >= numberOfSlices )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "'-sampleRange' expects <k>/<n> with 0 <= k < n, not '%s'"
+                ,   [ sampleRangeOpt cStringValue ]
+                );
+
+        if (    [ adaptiveOpt hasBeenSpecified ]
+             && numberOfSlices > 1 )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "'-sampleRange' cannot be combined with '-adaptiveSampling'"
+                );
+
+        arntiledstochasticsampler_set_sample_range(
+            art_gv,
+            sliceIndex,
+            numberOfSlices
+            );
+    }
+
+    if ( [ deferredFilteringOpt hasBeenSpecified ] )
+        arntiledstochasticsampler_set_deferred_filtering( art_gv, YES );
+
+    if ( [ tileSizeOpt hasBeenSpecified ] )
+    {
+        if ( [ tileSizeOpt integerValue ] < 1 )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "'-tileSize' has to be at least 1 pixel"
+                );
+
+        arntiledstochasticsampler_set_tile_size(
+            art_gv,
+            (unsigned int) [ tileSizeOpt integerValue ]
+            );
+    }
+
+    if ( [ tileOrderOpt hasBeenSpecified ] )
+    {
+        const char  * order = [ tileOrderOpt cStringValue ];
+
+        if ( strcmp( order, "scanline" ) == 0 )
+            arntiledstochasticsampler_set_tile_order( art_gv, artileorder_scanline );
+        else if ( strcmp( order, "hilbert" ) == 0 )
+            arntiledstochasticsampler_set_tile_order( art_gv, artileorder_hilbert );
+        else if ( strcmp( order, "spiral" ) == 0 )
+            arntiledstochasticsampler_set_tile_order( art_gv, artileorder_spiral );
+        else
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "unknown tile order '%s' - use scanline, hilbert or spiral"
+                ,   order
+                );
+    }
+
+    if ( [ serverOpt hasBeenSpecified ] && [ gpvOpt hasBeenSpecified ] )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "'-server' cannot be combined with '-geometryPreview'"
+            );
+
+    if ( [ tevUpdateFrequencyOpt hasBeenSpecified ] )
+    {
+        if ( [ tevUpdateFrequencyOpt doubleValue ] < 0.0 )
+            ART_ERRORHANDLING_FATAL_ERROR(
+                "'-tevUpdateFrequency' cannot be negative"
+                );
+
+        arntiledstochasticsampler_set_tev_update_frequency(
+            art_gv,
+            [ tevUpdateFrequencyOpt doubleValue ]
+            );
+    }
+
 // =============================   PHASE 4   =================================
 //
 //         Parsing the input files, and assembly of the scene graph.
@@ -841,6 +1648,31 @@ int artist(
     }
 
 
+/* ---------------------------------------------------------------------------
+    In server mode, each job creates an output image of its own, and runs
+    the scene graph on it, until the server is shut down.
+------------------------------------------------------------------------aw- */
+
+    if ( [ serverOpt hasBeenSpecified ] )
+    {
+        artist_serve(
+            art_gv,
+            [ serverOpt cStringValue ],
+            sceneGraph,
+            imageSize,
+            resolution,
+            baseImage,
+            imageOrigin
+            );
+
+        RELEASE_OBJECT(camera);
+        RELEASE_OBJECT(contentOfMainFile);
+        RELEASE_OBJECT(actionSequence);
+
+        return 0;
+    }
+
+
 /* ---------------------------------------------------------------------------
     Now that its size and sub-regions are known, we can go about the actual
     creation of the output image node.
@@ -993,6 +1825,11 @@ int artist(
         :   ART_APPLICATION_NODESTACK
         ];
 
+    arnraycaster_report_statistics(
+        art_gv,
+        ART_GLOBAL_REPORTER
+        );
+
 
 // =============================   PHASE 7   =================================
 //
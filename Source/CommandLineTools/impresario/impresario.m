@@ -37,6 +37,8 @@
 
 #define INVALID_PID                -1
 #define DEFAULT_REPEAT_FREQUENCY    15
+#define DEFAULT_WATCH_INTERVAL       2
+#define STATS_REPLY_TIMEOUT          5.0
 #define LOCALHOST "127.0.0.1"
 #define TEV_PORT 14158
 
@@ -55,6 +57,75 @@ char art_getchar(void)
     return ch;
 }
 
+//   Large counts and rates with a metric prefix, e.g. "12.3M".
+
+const char * impresario_si(
+        double    value,
+        char    * buffer
+        )
+{
+    const char  * prefix[] = { "", "k", "M", "G", "T" };
+    int           i = 0;
+
+    while ( value >= 1000.0 && i < 4 )
+    {
+        value /= 1000.0;
+        i++;
+    }
+
+    sprintf( buffer, i == 0 ? "%.0f%s" : "%.1f%s", value, prefix[i] );
+
+    return buffer;
+}
+
+void impresario_print_statistics(
+              int                   pid,
+        const ArRenderStatistics  * stats
+        )
+{
+    char  a[16], b[16], c[16], d[16], e[16];
+
+    printf(
+        "PID %d: %u/%u spp, %s of %s samples",
+        pid,
+        stats->samplesPerPixelDone,
+        stats->samplesPerPixel,
+        impresario_si( stats->samplesIssued, a ),
+        impresario_si( stats->samplesTotal, b )
+        );
+
+    if ( stats->secondsRemaining >= 0.0 )
+    {
+        long  remaining = (long) ( stats->secondsRemaining + 0.5 );
+
+        printf(
+            ", %ld:%02ld:%02ld left",
+            remaining / 3600,
+            ( remaining / 60 ) % 60,
+            remaining % 60
+            );
+    }
+
+    printf(
+        "\n    %s samples/s, rays/s: %s first hit, %s shadow, %s in packets\n"
+        "    %u windows active, %u control tasks queued, peak RSS %s\n"
+        "    thread utilisation:",
+        impresario_si( stats->samplesPerSecond, a ),
+        impresario_si( stats->firstHitRaysPerSecond, b ),
+        impresario_si( stats->anyHitRaysPerSecond, c ),
+        impresario_si( stats->packetRaysPerSecond, d ),
+        stats->activeWindows,
+        stats->controlQueueDepth,
+        impresario_si( stats->peakResidentKilobytes * 1024.0, e )
+        );
+
+    for ( unsigned int i = 0; i < stats->numberOfThreads; i++ )
+        printf( " %.0f%%", 100.0 * stats->threadUtilisation[i] );
+
+    printf( "\n" );
+    fflush( stdout );
+}
+
 int impresario(
         int        argc,
         char    ** argv,
@@ -142,6 +213,13 @@ int impresario(
             :   "c"
             :   "retry connection to tev"
             ] ;
+    id  watchOption =
+        [ [ INTEGER_OPTION
+            :   "watch"
+            :   "wt"
+            :   "<seconds>"
+            :   "print render statistics every n seconds until 'artist' terminates"
+            ] withDefaultIntegerValue: DEFAULT_WATCH_INTERVAL ];
     
 
     char  * synopsis_string;
@@ -162,8 +240,13 @@ int impresario(
           "will ultimately be over-written by the final result: via -w/-d 'impresario' only \n"
           "forces the app to flush its current results to disk (and possibly display them).\n\n"
           "You can also automatically repeat -w or -d commands every n seconds until\n"
-          "the app terminates (default: every %d seconds).",
-          DEFAULT_REPEAT_FREQUENCY
+          "the app terminates (default: every %d seconds).\n\n"
+          "Via -wt, the progress and throughput of a running instance are polled\n"
+          "and printed at intervals (default: every %d seconds): samples taken, the\n"
+          "sample and ray rates, how busy each render thread is, the backlog of\n"
+          "the writing & display tasks, the estimated time left, and peak memory use.",
+          DEFAULT_REPEAT_FREQUENCY,
+          DEFAULT_WATCH_INTERVAL
         );
 
     ART_NO_INPUT_FILES_APPLICATION_STARTUP_WITH_SYNOPSIS(
@@ -218,7 +301,19 @@ int impresario(
             ];
     }
     
-    if ( numberOfWriteOptions == 0 && numberOfTevOptions==0)
+    if ( [ watchOption hasBeenSpecified ]
+        && ( numberOfWriteOptions > 0 || numberOfTevOptions > 0 ) )
+    {
+        fprintf(stderr,"Watch mode cannot be combined with other IPC options!\n\n");
+
+        [ ArcOption fprintShortUsageAndExit
+            :   art_gv
+            :   stderr
+            ];
+    }
+
+    if (   numberOfWriteOptions == 0 && numberOfTevOptions==0
+        && ! [ watchOption hasBeenSpecified ] )
     {
         fprintf(stderr,"No renderer IPC option specified!\n\n");
 
@@ -405,6 +500,83 @@ int impresario(
     ArcMessageQueue* messageQueue= [ALLOC_INIT_OBJECT(ArcMessageQueue)];
     [messageQueue clearMessages];
     
+    //   Watch mode: one stats request per interval, to a single instance,
+    //   until it terminates.
+
+    if ( [ watchOption hasBeenSpecified ] )
+    {
+        if ( [ allOption hasBeenSpecified ] )
+        {
+            fprintf(stderr,"Only a single instance can be watched!\n\n");
+            FREE_ARRAY(pid);
+            return 0;
+        }
+
+        if ( [ watchOption integerValue ] < 1 )
+        {
+            fprintf(stderr,"The watch interval has to be at least 1 second!\n\n");
+            FREE_ARRAY(pid);
+            return 0;
+        }
+
+        do
+        {
+            message_t  reply;
+
+            [ messageQueue sendStatisticsRequest: pid_we_will_talk_to ];
+
+            if (   [ messageQueue receiveMessage: & reply : STATS_REPLY_TIMEOUT ]
+                && reply.type == M_STATS_REPLY )
+            {
+                ArRenderStatistics  stats;
+
+                memcpy( & stats, reply.message_data, sizeof(ArRenderStatistics) );
+
+                impresario_print_statistics( pid_we_will_talk_to, & stats );
+            }
+            else
+            {
+                printf(
+                    "PID %d: no statistics (not rendering at the moment)\n",
+                    pid_we_will_talk_to
+                    );
+
+                //   the request is not going to be answered any more
+                [ messageQueue clearMessages: pid_we_will_talk_to ];
+            }
+
+            sleep( [ watchOption integerValue ] );
+
+            FREE_ARRAY(pid);
+
+            art_pidof(
+                  [ targetedAppOption cStringValue ],
+                & number_of_artist_pids,
+                & pid
+                );
+
+            artist_is_still_alive = NO;
+
+            for ( int i = 0; i < number_of_artist_pids; i++ )
+            {
+                if( pid[i] == pid_we_will_talk_to )
+                    artist_is_still_alive = YES;
+            }
+        }
+        while ( artist_is_still_alive );
+
+        printf(
+            "\nPID %d is no longer running, terminating.\n",
+            pid_we_will_talk_to
+            );
+
+        [ messageQueue clearMessages: pid_we_will_talk_to ];
+        [ messageQueue clearMessages: getpid() ];
+        FREE_ARRAY(pid);
+
+        return 0;
+    }
+
     
     
     if ( [ repeatOption hasBeenSpecified ] )
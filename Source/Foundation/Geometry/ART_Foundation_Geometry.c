@@ -50,6 +50,7 @@ ART_LIBRARY_INITIALISATION_FUNCTION
     ART_PERFORM_MODULE_INITIALISATION( Ray2D )
     ART_PERFORM_MODULE_INITIALISATION( Ray3D )
     ART_PERFORM_MODULE_INITIALISATION( Ray3DE )
+    ART_PERFORM_MODULE_INITIALISATION( Ray3DPacket )
 
     ART_PERFORM_MODULE_INITIALISATION( Line2D )
 
@@ -64,6 +65,7 @@ ART_LIBRARY_INITIALISATION_FUNCTION
     ART_PERFORM_MODULE_INITIALISATION( Translation3D )
 
     ART_PERFORM_MODULE_INITIALISATION( BSPTree )
+    ART_PERFORM_MODULE_INITIALISATION( BVHTree )
 
     ART_PERFORM_MODULE_INITIALISATION( Box )
 
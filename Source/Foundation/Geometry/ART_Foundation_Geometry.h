@@ -44,6 +44,7 @@ ART_LIBRARY_INTERFACE(ART_Foundation_Geometry)
 #include "Ray2D.h"
 #include "Ray3D.h"
 #include "Ray3DE.h"
+#include "Ray3DPacket.h"
 
 #include "Line2D.h"
 
@@ -77,6 +78,7 @@ ART_LIBRARY_INTERFACE(ART_Foundation_Geometry)
 #include "Polygon3D.h"
 
 #include "BSPTree.h"
+#include "BVHTree.h"
 
 #include "Geometry2MathConversions.h"
 
@@ -0,0 +1,593 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#define ART_MODULE_NAME     BVHTree
+
+#include "BVHTree.h"
+
+#include <math.h>
+#include <string.h>
+
+ART_NO_MODULE_INITIALISATION_FUNCTION_NECESSARY
+
+ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
+
+
+BVHNode * bvhnode_alloc_array(
+        unsigned long    numberOfNodes
+        )
+{
+    void  * nodeArray = NULL;
+
+    if ( posix_memalign(
+               & nodeArray,
+                 BVH_NODE_ALIGNMENT,
+                 sizeof(BVHNode) * M_MAX( numberOfNodes, 1 )
+               ) )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "allocation of %lu BVH nodes failed"
+            ,   numberOfNodes
+            );
+
+    return (BVHNode *) nodeArray;
+}
+
+BVHNode * bvhnode_realloc_array(
+        BVHNode        * nodeArray,
+        unsigned long    oldNumberOfNodes,
+        unsigned long    newNumberOfNodes
+        )
+{
+    //   realloc() does not preserve the alignment, so we have to do
+    //   this by hand.
+
+    BVHNode  * newNodeArray =
+        bvhnode_alloc_array( newNumberOfNodes );
+
+    memcpy(
+        newNodeArray,
+        nodeArray,
+        sizeof(BVHNode) * M_MIN( oldNumberOfNodes, newNumberOfNodes )
+        );
+
+    bvhnode_free_array( nodeArray );
+
+    return newNodeArray;
+}
+
+void bvhnode_free_array(
+        BVHNode  * nodeArray
+        )
+{
+    free( nodeArray );
+}
+
+//   Conversion of a double to the nearest float which is not larger/not
+//   smaller than the original value.
+
+static float _float_rounded_down(
+        double  d
+        )
+{
+    float  f = (float) d;
+
+    if ( (double) f > d )
+        f = nextafterf( f, -INFINITY );
+
+    return f;
+}
+
+static float _float_rounded_up(
+        double  d
+        )
+{
+    float  f = (float) d;
+
+    if ( (double) f < d )
+        f = nextafterf( f, INFINITY );
+
+    return f;
+}
+
+void bvhnode_set_box3d(
+              BVHNode  * node,
+        const Box3D    * box
+        )
+{
+    for ( unsigned int i = 0; i < 3; i++ )
+    {
+        node->min[i] = _float_rounded_down( BOX3D_MIN_I( *box, i ) );
+        node->max[i] = _float_rounded_up( BOX3D_MAX_I( *box, i ) );
+    }
+}
+
+void bvhnode_get_box3d(
+        const BVHNode  * node,
+              Box3D    * box
+        )
+{
+    for ( unsigned int i = 0; i < 3; i++ )
+    {
+        BOX3D_MIN_I( *box, i ) = node->min[i];
+        BOX3D_MAX_I( *box, i ) = node->max[i];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+
+    Binned SAH construction
+
+    The build recursively partitions a contiguous range of the primitive
+    array in place. The SAH costs are the same as the ones used by
+    ArnBSPTree, so that the two structures make comparable decisions.
+
+    SAH splits can be very lopsided, and the tree must not get deeper than
+    BVH_MAX_TREE_DEPTH. A node whose SAH split would leave a child with
+    more primitives than a balanced subtree of the remaining height can
+    hold in leaves of the maximum size is split at the object median
+    instead. Median splits halve the range, so once a node is within this
+    bound, its subtree stays within it, and even leaves at the depth
+    limit never exceed the maximum leaf size.
+
+------------------------------------------------------------------------aw- */
+
+#define BVH_NUMBER_OF_BINS      16
+
+#define BVH_COST_TRAVERSAL      8
+#define BVH_COST_INTERSECT      64
+
+typedef struct BVHBin
+{
+    Box3D  box;
+    long   count;
+}
+BVHBin;
+
+typedef struct BVHBuildContext
+{
+    BVHBuildPrimitive   * primitives;
+    BVHNode             * nodes;
+    long                  indexOfNextFreeNode;
+    int                   maximumLeafSize;
+    BVHBuildStatistics    statistics;
+}
+BVHBuildContext;
+
+static double _box3d_surface_area(
+        const Box3D  * box
+        )
+{
+    double  dx = BOX3D_MAX_X(*box) - BOX3D_MIN_X(*box);
+    double  dy = BOX3D_MAX_Y(*box) - BOX3D_MIN_Y(*box);
+    double  dz = BOX3D_MAX_Z(*box) - BOX3D_MIN_Z(*box);
+
+    if ( dx < 0.0 || dy < 0.0 || dz < 0.0 )
+        return 0.0;
+
+    return 2.0 * ( dx * dy + dx * dz + dy * dz );
+}
+
+static int _bvh_bin_index(
+        const BVHBuildPrimitive  * primitive,
+        const Box3D              * centroidBounds,
+              int                  axis
+        )
+{
+    double  extent =
+          BOX3D_MAX_I(*centroidBounds,axis)
+        - BOX3D_MIN_I(*centroidBounds,axis);
+
+    int  bin =
+        (int)(   BVH_NUMBER_OF_BINS
+               * (   PNT3D_I(primitive->centroid,axis)
+                   - BOX3D_MIN_I(*centroidBounds,axis) )
+               / extent );
+
+    return M_CLAMP( bin, 0, BVH_NUMBER_OF_BINS - 1 );
+}
+
+//   Evaluates the binned SAH for all three axes. Returns 0 if no
+//   split with non-empty children exists (i.e. all centroids coincide).
+
+static int _bvh_find_best_binned_split(
+        const BVHBuildContext  * context,
+              long               begin,
+              long               end,
+        const Box3D            * bounds,
+        const Box3D            * centroidBounds,
+              int              * bestAxis,
+              int              * bestBin,
+              double           * bestCost
+        )
+{
+    double  parentSurfaceArea = _box3d_surface_area( bounds );
+
+    int  splitFound = 0;
+
+    *bestCost = MATH_HUGE_DOUBLE;
+
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        if (   BOX3D_MAX_I(*centroidBounds,axis)
+            <= BOX3D_MIN_I(*centroidBounds,axis) )
+            continue;
+
+        BVHBin  bin[ BVH_NUMBER_OF_BINS ];
+
+        for ( int b = 0; b < BVH_NUMBER_OF_BINS; b++ )
+        {
+            bin[b].box   = BOX3D_EMPTY;
+            bin[b].count = 0;
+        }
+
+        for ( long i = begin; i < end; i++ )
+        {
+            int  b =
+                _bvh_bin_index(
+                    & context->primitives[i],
+                      centroidBounds,
+                      axis
+                    );
+
+            box3d_b_add_b( & context->primitives[i].box, & bin[b].box );
+            bin[b].count++;
+        }
+
+        //   Sweep from the right, storing the area and count of everything
+        //   to the right of each bin boundary...
+        //
+        //   The box of an empty bin is BOX3D_EMPTY, whose corners lie at
+        //   +/- MATH_HUGE_DOUBLE: adding it to another box would blow that
+        //   up to the entire space, so empty bins are skipped.
+
+        double  rightArea[ BVH_NUMBER_OF_BINS ];
+        long    rightCount[ BVH_NUMBER_OF_BINS ];
+
+        Box3D  accumulatedBox   = BOX3D_EMPTY;
+        long   accumulatedCount = 0;
+
+        for ( int b = BVH_NUMBER_OF_BINS - 1; b > 0; b-- )
+        {
+            if ( bin[b].count > 0 )
+                box3d_b_add_b( & bin[b].box, & accumulatedBox );
+
+            accumulatedCount += bin[b].count;
+
+            rightArea[b]  = _box3d_surface_area( & accumulatedBox );
+            rightCount[b] = accumulatedCount;
+        }
+
+        //   ...and then from the left, evaluating the cost of splitting
+        //   between bin b-1 and bin b.
+
+        accumulatedBox   = BOX3D_EMPTY;
+        accumulatedCount = 0;
+
+        for ( int b = 1; b < BVH_NUMBER_OF_BINS; b++ )
+        {
+            if ( bin[b-1].count > 0 )
+                box3d_b_add_b( & bin[b-1].box, & accumulatedBox );
+
+            accumulatedCount += bin[b-1].count;
+
+            if ( accumulatedCount == 0 || rightCount[b] == 0 )
+                continue;
+
+            double  cost =
+                  BVH_COST_TRAVERSAL
+                +   BVH_COST_INTERSECT
+                  * (   _box3d_surface_area( & accumulatedBox )
+                      * accumulatedCount
+                      + rightArea[b] * rightCount[b] )
+                  / parentSurfaceArea;
+
+            if ( cost < *bestCost )
+            {
+                *bestCost  = cost;
+                *bestAxis  = axis;
+                *bestBin   = b;
+                splitFound = 1;
+            }
+        }
+    }
+
+    return splitFound;
+}
+
+//   Largest number of primitives a subtree of the given height can hold
+//   with median splits, without any of its leaves exceeding the maximum
+//   leaf size.
+
+static long _bvh_subtree_capacity(
+        const BVHBuildContext  * context,
+              int                height
+        )
+{
+    long  capacity = context->maximumLeafSize;
+
+    for ( int i = 0; i < height; i++ )
+    {
+        if ( capacity > ART_LONG_MAX / 2 )
+            return ART_LONG_MAX;
+
+        capacity *= 2;
+    }
+
+    return capacity;
+}
+
+//   Reorders the range so that the primitive at 'nth' is the one that
+//   would be there if the range were sorted by centroid along the given
+//   axis, with no larger centroid before and no smaller one after it
+//   (Hoare's selection algorithm).
+
+static void _bvh_select_nth_centroid(
+        BVHBuildPrimitive  * primitives,
+        long                 begin,
+        long                 end,
+        long                 nth,
+        int                  axis
+        )
+{
+    long  low  = begin;
+    long  high = end - 1;
+
+    while ( low < high )
+    {
+        double  pivot =
+            PNT3D_I( primitives[ low + ( high - low ) / 2 ].centroid, axis );
+
+        long  i = low;
+        long  j = high;
+
+        while ( i <= j )
+        {
+            while ( PNT3D_I( primitives[i].centroid, axis ) < pivot )
+                i++;
+            while ( PNT3D_I( primitives[j].centroid, axis ) > pivot )
+                j--;
+
+            if ( i <= j )
+            {
+                BVHBuildPrimitive  temp = primitives[i];
+                primitives[i] = primitives[j];
+                primitives[j] = temp;
+                i++;
+                j--;
+            }
+        }
+
+        if ( nth <= j )
+            high = j;
+        else if ( nth >= i )
+            low = i;
+        else
+            break;
+    }
+}
+
+static void _bvh_build_node(
+        BVHBuildContext  * context,
+        long               nodeIndex,
+        long               begin,
+        long               end,
+        int                depth
+        )
+{
+    BVHNode  * node = & context->nodes[nodeIndex];
+
+    Box3D  bounds         = BOX3D_EMPTY;
+    Box3D  centroidBounds = BOX3D_EMPTY;
+
+    for ( long i = begin; i < end; i++ )
+    {
+        box3d_b_add_b( & context->primitives[i].box, & bounds );
+        box3d_p_add_b( & context->primitives[i].centroid, & centroidBounds );
+    }
+
+    bvhnode_set_box3d( node, & bounds );
+
+    if ( depth > context->statistics.maximumTreeDepth )
+        context->statistics.maximumTreeDepth = depth;
+
+    long  numberOfPrimitives = end - begin;
+    long  middle = begin;
+    int   splitAxis = 0;
+
+    int  createLeaf =
+           numberOfPrimitives == 1
+        || depth >= BVH_MAX_TREE_DEPTH - 1;
+
+    if ( ! createLeaf )
+    {
+        int     bestAxis = 0;
+        int     bestBin  = 0;
+        double  bestCost;
+
+        int  splitFound =
+            _bvh_find_best_binned_split(
+                  context,
+                  begin,
+                  end,
+                & bounds,
+                & centroidBounds,
+                & bestAxis,
+                & bestBin,
+                & bestCost
+                );
+
+        double  leafCost = numberOfPrimitives * BVH_COST_INTERSECT;
+
+        if (   splitFound
+            && (   bestCost < leafCost
+                || numberOfPrimitives > context->maximumLeafSize ) )
+        {
+            //   In-place partition of the range according to the bin
+            //   the centroid falls into.
+
+            long  left  = begin;
+            long  right = end - 1;
+
+            while ( left <= right )
+            {
+                if ( _bvh_bin_index(
+                         & context->primitives[left],
+                         & centroidBounds,
+                           bestAxis ) < bestBin )
+                {
+                    left++;
+                }
+                else
+                {
+                    BVHBuildPrimitive  temp = context->primitives[left];
+                    context->primitives[left]  = context->primitives[right];
+                    context->primitives[right] = temp;
+                    right--;
+                }
+            }
+
+            middle    = left;
+            splitAxis = bestAxis;
+        }
+        else if (   ! splitFound
+                 && numberOfPrimitives > context->maximumLeafSize )
+        {
+            //   All centroids coincide - binning cannot separate them,
+            //   but the leaf would be too large, so we just halve the range.
+
+            middle    = begin + numberOfPrimitives / 2;
+            splitAxis = box3d_b_maxdim( & bounds );
+        }
+        else
+        {
+            createLeaf = 1;
+        }
+
+        long  childCapacity =
+            _bvh_subtree_capacity( context, BVH_MAX_TREE_DEPTH - 2 - depth );
+
+        if (   ! createLeaf
+            && (   middle - begin > childCapacity
+                || end - middle   > childCapacity ) )
+        {
+            splitAxis = box3d_b_maxdim( & centroidBounds );
+            middle    = begin + numberOfPrimitives / 2;
+
+            _bvh_select_nth_centroid(
+                context->primitives,
+                begin,
+                end,
+                middle,
+                splitAxis
+                );
+        }
+    }
+
+    if ( createLeaf )
+    {
+        SET_BVH_NODE_AS_LEAF( *node, begin, numberOfPrimitives );
+
+        if ( numberOfPrimitives
+             > context->statistics.maximumNumberOfPrimitivesPerLeaf )
+            context->statistics.maximumNumberOfPrimitivesPerLeaf =
+                numberOfPrimitives;
+
+        context->statistics.numberOfLeafNodes++;
+
+        return;
+    }
+
+    //   Depth-first layout: the first child always directly follows its
+    //   parent in the array, the second one is placed after the entire
+    //   subtree of the first child.
+
+    long  firstChild = context->indexOfNextFreeNode++;
+
+    _bvh_build_node( context, firstChild, begin, middle, depth + 1 );
+
+    long  secondChild = context->indexOfNextFreeNode++;
+
+    _bvh_build_node( context, secondChild, middle, end, depth + 1 );
+
+    //   'node' is still valid: the node array is never reallocated
+    //   during the build.
+
+    SET_BVH_NODE_AS_INNER( *node, splitAxis, secondChild );
+
+    context->statistics.numberOfInnerNodes++;
+}
+
+BVHNode * bvhtree_build_binned_sah(
+        BVHBuildPrimitive   * primitives,
+        long                  numberOfPrimitives,
+        int                   maximumLeafSize,
+        long                * numberOfNodes,
+        BVHBuildStatistics  * statistics
+        )
+{
+    BVHBuildContext  context;
+
+    context.primitives          = primitives;
+    context.nodes               = NULL;
+    context.indexOfNextFreeNode = 0;
+    context.maximumLeafSize     =
+        M_CLAMP( maximumLeafSize, 1, BVH_NODE_MAX_PRIMITIVES );
+
+    context.statistics.maximumNumberOfPrimitivesPerLeaf = 0;
+    context.statistics.maximumTreeDepth   = 0;
+    context.statistics.numberOfLeafNodes  = 0;
+    context.statistics.numberOfInnerNodes = 0;
+
+    if ( numberOfPrimitives > 0 )
+    {
+        //   A binary tree with N leaves has at most 2N-1 nodes, so we can
+        //   allocate the node array once and never have to grow it during
+        //   the build; the excess is trimmed afterwards.
+
+        long  maximumNumberOfNodes = 2 * numberOfPrimitives - 1;
+
+        context.nodes = bvhnode_alloc_array( maximumNumberOfNodes );
+        context.indexOfNextFreeNode = 1;
+
+        _bvh_build_node( & context, 0, 0, numberOfPrimitives, 0 );
+
+        context.nodes =
+            bvhnode_realloc_array(
+                context.nodes,
+                maximumNumberOfNodes,
+                context.indexOfNextFreeNode
+                );
+    }
+
+    *numberOfNodes = context.indexOfNextFreeNode;
+
+    if ( statistics )
+        *statistics = context.statistics;
+
+    return context.nodes;
+}
+
+/* ======================================================================== */
@@ -0,0 +1,194 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#ifndef _ART_FOUNDATION_GEOMETRY_BVH_TREE_H_
+#define _ART_FOUNDATION_GEOMETRY_BVH_TREE_H_
+
+#include "ART_Foundation_System.h"
+
+ART_MODULE_INTERFACE(BVHTree)
+
+#include "ART_Foundation_Math.h"
+#include "Box.h"
+
+
+/* ---------------------------------------------------------------------------
+
+    'BVHNode' struct
+
+    Flattened bounding volume hierarchy node, as used by ArnBVH. The tree
+    is stored in one contiguous array in depth-first order, so that the
+    first child of an inner node is always the node directly following it
+    in the array. Only the index of the second child has to be stored.
+
+    Each node is exactly 32 bytes, and the array is allocated with cache
+    line alignment, so that two sibling nodes never straddle more than one
+    cache line boundary.
+
+    The bounding box is stored in single precision. When converting from
+    the double precision Box3D, the bounds are rounded outwards, so that
+    the float box always fully contains the original one.
+
+    For inner nodes, 'count' is zero, 'offset' is the array index of the
+    second child, and 'axis' is the axis along which the children were
+    partitioned (used for ordered traversal).
+
+    For leaf nodes, 'count' is the number of primitives in the leaf, and
+    'offset' is the index of the first of them in the primitive index array.
+
+------------------------------------------------------------------------aw- */
+
+typedef struct BVHNode
+{
+    float   min[3];
+    float   max[3];
+    Int32   offset;
+    UInt16  count;
+    UInt16  axis;
+}
+BVHNode;
+
+#define BVH_NODE_ALIGNMENT              64
+
+#define BVH_NODE_IS_LEAF(_n)            ( (_n).count > 0 )
+#define BVH_NODE_IS_INNER(_n)           ( (_n).count == 0 )
+
+#define BVH_NODE_SPLIT_AXIS(_n)         (_n).axis
+#define BVH_NODE_SECOND_CHILD(_n)       (_n).offset
+#define BVH_NODE_PRIMITIVE_OFFSET(_n)   (_n).offset
+#define BVH_NODE_PRIMITIVE_COUNT(_n)    (_n).count
+
+//   Largest number of primitives a single leaf can reference
+
+#define BVH_NODE_MAX_PRIMITIVES         ART_UINT16_MAX
+
+//   Depth limit of the build, and thus also the size of the node stack
+//   a traversal needs
+
+#define BVH_MAX_TREE_DEPTH              64
+
+#define SET_BVH_NODE_AS_INNER(_n,_axis,_secondChild) \
+do{ \
+    (_n).count  = 0; \
+    (_n).axis   = (UInt16)(_axis); \
+    (_n).offset = (Int32)(_secondChild); \
+} while(0)
+
+#define SET_BVH_NODE_AS_LEAF(_n,_firstPrimitive,_numberOfPrimitives) \
+do{ \
+    if (   (_numberOfPrimitives) <= 0 \
+        || (_numberOfPrimitives) > BVH_NODE_MAX_PRIMITIVES ) \
+        ART_ERRORHANDLING_FATAL_ERROR( \
+        "invalid number of primitives in BVH leaf node" ); \
+\
+    (_n).count  = (UInt16)(_numberOfPrimitives); \
+    (_n).axis   = 0; \
+    (_n).offset = (Int32)(_firstPrimitive); \
+} while(0)
+
+/* ---------------------------------------------------------------------------
+    'bvhnode_alloc_array' / 'bvhnode_free_array'
+        Cache line aligned allocation of BVH node arrays.
+------------------------------------------------------------------------aw- */
+
+BVHNode * bvhnode_alloc_array(
+        unsigned long    numberOfNodes
+        );
+
+BVHNode * bvhnode_realloc_array(
+        BVHNode        * nodeArray,
+        unsigned long    oldNumberOfNodes,
+        unsigned long    newNumberOfNodes
+        );
+
+void bvhnode_free_array(
+        BVHNode  * nodeArray
+        );
+
+/* ---------------------------------------------------------------------------
+    'bvhnode_set_box3d'
+        Stores the given box in the node; the single precision bounds are
+        rounded outwards.
+------------------------------------------------------------------------aw- */
+
+void bvhnode_set_box3d(
+              BVHNode  * node,
+        const Box3D    * box
+        );
+
+void bvhnode_get_box3d(
+        const BVHNode  * node,
+              Box3D    * box
+        );
+
+/* ---------------------------------------------------------------------------
+
+    'BVHBuildPrimitive' struct
+
+    Build time representation of a primitive: its bounding box, the centre
+    of that box, and an index which lets the caller map the primitives back
+    to its own data once the build has reordered them.
+
+------------------------------------------------------------------------aw- */
+
+typedef struct BVHBuildPrimitive
+{
+    Box3D  box;
+    Pnt3D  centroid;
+    long   index;
+}
+BVHBuildPrimitive;
+
+typedef struct BVHBuildStatistics
+{
+    int  maximumNumberOfPrimitivesPerLeaf;
+    int  maximumTreeDepth;
+    int  numberOfLeafNodes;
+    int  numberOfInnerNodes;
+}
+BVHBuildStatistics;
+
+/* ---------------------------------------------------------------------------
+    'bvhtree_build_binned_sah'
+        Builds a BVHNode array over the given primitives, using binned
+        SAH splits along all three axes. The primitive array is reordered
+        in place: afterwards, leaf nodes reference ranges of it. No leaf
+        holds more than 'maximumLeafSize' primitives (which is clamped to
+        BVH_NODE_MAX_PRIMITIVES); near the depth limit, median splits
+        take over from the SAH to ensure this. An empty primitive array
+        yields NULL and zero nodes. 'statistics' may be NULL.
+------------------------------------------------------------------------aw- */
+
+BVHNode * bvhtree_build_binned_sah(
+        BVHBuildPrimitive   * primitives,
+        long                  numberOfPrimitives,
+        int                   maximumLeafSize,
+        long                * numberOfNodes,
+        BVHBuildStatistics  * statistics
+        );
+
+#endif /* _ART_FOUNDATION_GEOMETRY_BVH_TREE_H_ */
+/* ======================================================================== */
@@ -0,0 +1,386 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#define ART_MODULE_NAME     Ray3DPacket
+
+#include "Ray3DPacket.h"
+
+#include <string.h>
+
+ART_NO_MODULE_INITIALISATION_FUNCTION_NECESSARY
+
+ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
+
+
+int ray3dpacket_init(
+        const Ray3D        * rays,
+              unsigned int   numberOfRays,
+              unsigned int   activeMask,
+              Ray3DPacket  * packet
+        )
+{
+    if ( numberOfRays == 0 || numberOfRays > RAY3DPACKET_MAX_SIZE )
+        return 0;
+
+    activeMask &= ( 1U << numberOfRays ) - 1U;
+
+    if ( ! activeMask )
+        return 0;
+
+    unsigned int  firstActive = 0;
+
+    while ( ! ( activeMask & ( 1U << firstActive ) ) )
+        firstActive++;
+
+    for ( int i = 0; i < 3; i++ )
+        packet->dirIsNegative[i] =
+            signbit( 1.0 / RAY3D_VI( rays[firstActive], i ) ) ? 1 : 0;
+
+    for ( unsigned int j = 0; j < RAY3DPACKET_MAX_SIZE; j++ )
+    {
+        const Ray3D  * ray =
+            & rays[ ( activeMask & ( 1U << j ) ) ? j : firstActive ];
+
+        for ( int i = 0; i < 3; i++ )
+        {
+            packet->point[i][j]  = RAY3D_PI( *ray, i );
+            packet->vector[i][j] = RAY3D_VI( *ray, i );
+            packet->invvec[i][j] = 1.0 / RAY3D_VI( *ray, i );
+
+            //   Same sign test as the single ray traversal code uses.
+
+            if (   ( signbit( packet->invvec[i][j] ) ? 1 : 0 )
+                != packet->dirIsNegative[i] )
+                return 0;
+        }
+    }
+
+    packet->size = numberOfRays;
+
+    return 1;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+
+/* ---------------------------------------------------------------------------
+
+    Vector extension kernels
+
+    GCC and clang both accept vector types of any power of two size, and
+    split them into as many hardware registers as the target needs. Since
+    the ternary operator is not defined for vectors in C, lane selection
+    is done with bit masks; comparisons yield all-ones lanes where true.
+
+------------------------------------------------------------------------aw- */
+
+typedef double     RP_Double
+    __attribute__ (( vector_size( RAY3DPACKET_MAX_SIZE * sizeof(double) ) ));
+typedef long long  RP_Mask
+    __attribute__ (( vector_size( RAY3DPACKET_MAX_SIZE * sizeof(long long) ) ));
+
+//   The packet arrays are only guaranteed to be double aligned, so all
+//   loads and stores go through memcpy.
+
+#define RP_LOAD(__v,__a)    memcpy( & (__v), (__a), sizeof(RP_Double) )
+#define RP_STORE(__a,__v)   memcpy( (__a), & (__v), sizeof(RP_Double) )
+
+//   Helpers are macros rather than functions, so that no vectors are ever
+//   passed by value (which depends on the vector ABI of the target).
+
+#define RP_BROADCAST(__d)   ( (RP_Double){ 0.0 } + (__d) )
+
+#define RP_SELECT(__mask,__a,__b) \
+    ( (RP_Double)( ( (__mask) & (RP_Mask)(__a) ) | ( ~(__mask) & (RP_Mask)(__b) ) ) )
+
+static unsigned int rp_bitmask(
+        const RP_Mask  * mask
+        )
+{
+    unsigned int  result = 0;
+
+    for ( int j = 0; j < RAY3DPACKET_MAX_SIZE; j++ )
+        if ( (*mask)[j] )
+            result |= 1U << j;
+
+    return result;
+}
+
+unsigned int ray3dpacket_box_hit_mask(
+        const Ray3DPacket   * packet,
+        const float         * boxMin,
+        const float         * boxMax,
+              double          tMin,
+              double          tMax,
+              unsigned int    activeMask
+        )
+{
+    RP_Double  tNearMax = RP_BROADCAST( tMin );
+    RP_Double  tFarMin  = RP_BROADCAST( tMax );
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        double  nearPlane =
+            packet->dirIsNegative[i] ? boxMax[i] : boxMin[i];
+        double  farPlane =
+            packet->dirIsNegative[i] ? boxMin[i] : boxMax[i];
+
+        RP_Double  origin, invvec;
+
+        RP_LOAD( origin, packet->point[i] );
+        RP_LOAD( invvec, packet->invvec[i] );
+
+        RP_Double  tNear = ( nearPlane - origin ) * invvec;
+        RP_Double  tFar  = ( farPlane  - origin ) * invvec;
+
+        //   NaN lanes compare false, and leave the interval unchanged.
+
+        tNearMax = RP_SELECT( (RP_Mask)( tNear > tNearMax ), tNear, tNearMax );
+        tFarMin  = RP_SELECT( (RP_Mask)( tFar  < tFarMin  ), tFar,  tFarMin  );
+    }
+
+    RP_Mask  hit = (RP_Mask)( tNearMax <= tFarMin );
+
+    return rp_bitmask( & hit ) & activeMask;
+}
+
+unsigned int ray3dpacket_triangle_hit_mask(
+        const Ray3DPacket   * packet,
+        const Pnt3D         * p0,
+        const Pnt3D         * p1,
+        const Pnt3D         * p2,
+              double          tMin,
+              double          tMax,
+              unsigned int    activeMask,
+              double        * t,
+              double        * u,
+              double        * v,
+              int           * side
+        )
+{
+    Vec3D  edge1, edge2;
+
+    vec3d_pp_sub_v( p1, p0, & edge1 );
+    vec3d_pp_sub_v( p2, p0, & edge2 );
+
+    RP_Double  dx, dy, dz, ox, oy, oz;
+
+    RP_LOAD( dx, packet->vector[0] );
+    RP_LOAD( dy, packet->vector[1] );
+    RP_LOAD( dz, packet->vector[2] );
+    RP_LOAD( ox, packet->point[0] );
+    RP_LOAD( oy, packet->point[1] );
+    RP_LOAD( oz, packet->point[2] );
+
+    //   pVec = direction x edge2
+
+    RP_Double  px = dy * ZC(edge2) - dz * YC(edge2);
+    RP_Double  py = dz * XC(edge2) - dx * ZC(edge2);
+    RP_Double  pz = dx * YC(edge2) - dy * XC(edge2);
+
+    RP_Double  det = XC(edge1) * px + YC(edge1) * py + ZC(edge1) * pz;
+
+    //   Rays parallel to the plane of the triangle get an infinite invDet,
+    //   and are masked out below.
+
+    RP_Double  invDet = 1.0 / det;
+
+    RP_Double  tx = ox - XC(*p0);
+    RP_Double  ty = oy - YC(*p0);
+    RP_Double  tz = oz - ZC(*p0);
+
+    RP_Double  uu = ( tx * px + ty * py + tz * pz ) * invDet;
+
+    //   qVec = tVec x edge1
+
+    RP_Double  qx = ty * ZC(edge1) - tz * YC(edge1);
+    RP_Double  qy = tz * XC(edge1) - tx * ZC(edge1);
+    RP_Double  qz = tx * YC(edge1) - ty * XC(edge1);
+
+    RP_Double  vv = ( dx * qx + dy * qy + dz * qz ) * invDet;
+
+    RP_Double  tt =
+        ( XC(edge2) * qx + YC(edge2) * qy + ZC(edge2) * qz ) * invDet;
+
+    //   The conditions are the negations of the rejection tests of the
+    //   single ray code, so that NaN lanes are treated the same way.
+
+    RP_Mask  miss =
+          (RP_Mask)( det == 0.0 )
+        | (RP_Mask)( uu < 0.0 ) | (RP_Mask)( uu > 1.0 )
+        | (RP_Mask)( vv < 0.0 ) | (RP_Mask)( uu + vv > 1.0 )
+        | (RP_Mask)( tt >= tMax ) | (RP_Mask)( tt < tMin );
+
+    RP_Mask  hit = ~miss;
+
+    unsigned int  hitMask = rp_bitmask( & hit ) & activeMask;
+
+    if ( hitMask )
+    {
+        RP_STORE( t, tt );
+        RP_STORE( u, uu );
+        RP_STORE( v, vv );
+
+        for ( int j = 0; j < RAY3DPACKET_MAX_SIZE; j++ )
+            side[j] = ( det[j] > 0.0 ? 1 : -1 );
+    }
+
+    return hitMask;
+}
+
+#else
+
+/* ---------------------------------------------------------------------------
+
+    Scalar fallback kernels
+
+    Straightforward loops over the lanes of the packet, with the same
+    arithmetic as the vector versions.
+
+------------------------------------------------------------------------aw- */
+
+unsigned int ray3dpacket_box_hit_mask(
+        const Ray3DPacket   * packet,
+        const float         * boxMin,
+        const float         * boxMax,
+              double          tMin,
+              double          tMax,
+              unsigned int    activeMask
+        )
+{
+    unsigned int  result = 0;
+
+    for ( int j = 0; j < RAY3DPACKET_MAX_SIZE; j++ )
+    {
+        if ( ! ( activeMask & ( 1U << j ) ) )
+            continue;
+
+        double  tNearMax = tMin;
+        double  tFarMin  = tMax;
+
+        for ( int i = 0; i < 3; i++ )
+        {
+            double  nearPlane =
+                packet->dirIsNegative[i] ? boxMax[i] : boxMin[i];
+            double  farPlane =
+                packet->dirIsNegative[i] ? boxMin[i] : boxMax[i];
+
+            double  tNear =
+                ( nearPlane - packet->point[i][j] ) * packet->invvec[i][j];
+            double  tFar =
+                ( farPlane  - packet->point[i][j] ) * packet->invvec[i][j];
+
+            if ( tNear > tNearMax ) tNearMax = tNear;
+            if ( tFar  < tFarMin  ) tFarMin  = tFar;
+        }
+
+        if ( tNearMax <= tFarMin )
+            result |= 1U << j;
+    }
+
+    return result;
+}
+
+unsigned int ray3dpacket_triangle_hit_mask(
+        const Ray3DPacket   * packet,
+        const Pnt3D         * p0,
+        const Pnt3D         * p1,
+        const Pnt3D         * p2,
+              double          tMin,
+              double          tMax,
+              unsigned int    activeMask,
+              double        * t,
+              double        * u,
+              double        * v,
+              int           * side
+        )
+{
+    Vec3D  edge1, edge2;
+
+    vec3d_pp_sub_v( p1, p0, & edge1 );
+    vec3d_pp_sub_v( p2, p0, & edge2 );
+
+    unsigned int  result = 0;
+
+    for ( int j = 0; j < RAY3DPACKET_MAX_SIZE; j++ )
+    {
+        if ( ! ( activeMask & ( 1U << j ) ) )
+            continue;
+
+        Vec3D  direction =
+            VEC3D(
+                packet->vector[0][j],
+                packet->vector[1][j],
+                packet->vector[2][j]
+                );
+        Vec3D  tVec =
+            VEC3D(
+                packet->point[0][j] - XC(*p0),
+                packet->point[1][j] - YC(*p0),
+                packet->point[2][j] - ZC(*p0)
+                );
+
+        Vec3D  pVec, qVec;
+
+        vec3d_vv_cross_v( & direction, & edge2, & pVec );
+
+        double  det = vec3d_vv_dot( & edge1, & pVec );
+
+        if ( det == 0.0 )
+            continue;
+
+        double  invDet = 1.0 / det;
+
+        double  uu = vec3d_vv_dot( & tVec, & pVec ) * invDet;
+
+        if ( uu < 0.0 || uu > 1.0 )
+            continue;
+
+        vec3d_vv_cross_v( & tVec, & edge1, & qVec );
+
+        double  vv = vec3d_vv_dot( & direction, & qVec ) * invDet;
+
+        if ( vv < 0.0 || uu + vv > 1.0 )
+            continue;
+
+        double  tt = vec3d_vv_dot( & edge2, & qVec ) * invDet;
+
+        if ( tt >= tMax || tt < tMin )
+            continue;
+
+        t[j]    = tt;
+        u[j]    = uu;
+        v[j]    = vv;
+        side[j] = ( det > 0.0 ? 1 : -1 );
+
+        result |= 1U << j;
+    }
+
+    return result;
+}
+
+#endif
+
+// ===========================================================================
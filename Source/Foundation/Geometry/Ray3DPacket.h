@@ -0,0 +1,152 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#ifndef _ART_FOUNDATION_GEOMETRY_RAY3DPACKET_H_
+#define _ART_FOUNDATION_GEOMETRY_RAY3DPACKET_H_
+
+#include "ART_Foundation_System.h"
+
+ART_MODULE_INTERFACE(Ray3DPacket)
+
+#include "ART_Foundation_Math.h"
+
+#include "Pnt3D.h"
+#include "Ray3D.h"
+#include "Vec3D.h"
+
+/* ---------------------------------------------------------------------------
+
+    'Ray3DPacket' struct
+
+    Up to RAY3DPACKET_MAX_SIZE rays, stored as a structure of arrays so
+    that the packet kernels below can process all of them in lockstep.
+    Where the compiler supports GCC style vector extensions, these kernels
+    operate on whole vectors of doubles, and the compiler maps these to
+    whatever SIMD registers the target has (SSE/AVX on x86, NEON on arm64);
+    otherwise plain loops over the rays are used.
+
+    All rays in a packet have to share the signs of their direction
+    components ("coherent" packets), so that one traversal order and one
+    set of near/far box planes applies to all of them. Primary rays from
+    neighbouring pixels normally fulfil this; ray3dpacket_init reports
+    packets that do not, and the caller then has to fall back to tracing
+    the rays one by one.
+
+    Unused lanes are filled with copies of the first active ray, so the
+    kernels never operate on uninitialised data. The active mask passed to the
+    kernels has bit i set if lane i is to be considered, and the result
+    masks use the same convention.
+
+    The arithmetic is the same as that of the single ray code in ArnBVH
+    and ArnTriangleMesh, so results only differ from the single ray code
+    where the compiler contracts operations differently.
+
+------------------------------------------------------------------------aw- */
+
+#define RAY3DPACKET_MAX_SIZE        8
+
+typedef struct Ray3DPacket
+{
+    double        point[3][RAY3DPACKET_MAX_SIZE];
+    double        vector[3][RAY3DPACKET_MAX_SIZE];
+    double        invvec[3][RAY3DPACKET_MAX_SIZE];
+    int           dirIsNegative[3];
+    unsigned int  size;
+}
+Ray3DPacket;
+
+#define RAY3DPACKET_SIZE(__rp)              (__rp).size
+#define RAY3DPACKET_DIR_IS_NEGATIVE(__rp,__i) \
+    (__rp).dirIsNegative[(__i)]
+
+/* ---------------------------------------------------------------------------
+
+    'ray3dpacket_init'
+
+    Fills the packet with the given rays. Only the lanes set in
+    'activeMask' are used; all other lanes get a copy of the first active
+    ray, and their entries in 'rays' are never read. The return value is
+    0 if the active rays are not coherent (or if there are too many rays,
+    or no active ones), in which case the packet contents are undefined,
+    and 1 otherwise.
+
+------------------------------------------------------------------------aw- */
+
+int ray3dpacket_init(
+        const Ray3D        * rays,
+              unsigned int   numberOfRays,
+              unsigned int   activeMask,
+              Ray3DPacket  * packet
+        );
+
+/* ---------------------------------------------------------------------------
+
+    'ray3dpacket_box_hit_mask'
+
+    Slab test of all active rays against an axis aligned, single
+    precision box, for the ray parameter range [tMin, tMax]. Returns the
+    mask of rays that overlap the box.
+
+------------------------------------------------------------------------aw- */
+
+unsigned int ray3dpacket_box_hit_mask(
+        const Ray3DPacket   * packet,
+        const float         * boxMin,
+        const float         * boxMax,
+              double          tMin,
+              double          tMax,
+              unsigned int    activeMask
+        );
+
+/* ---------------------------------------------------------------------------
+
+    'ray3dpacket_triangle_hit_mask'
+
+    Moeller-Trumbore test of all active rays against the triangle p0 p1 p2.
+    Returns the mask of rays that hit it with tMin <= t < tMax. For these,
+    the t values and the barycentric weights of p1 and p2 are written to
+    the corresponding entries of the result arrays, and 'side' is set to
+    1 for hits on the obverse side of the triangle (the one the normal
+    (p1-p0) x (p2-p0) points to), and to -1 for hits on its reverse side.
+
+------------------------------------------------------------------------aw- */
+
+unsigned int ray3dpacket_triangle_hit_mask(
+        const Ray3DPacket   * packet,
+        const Pnt3D         * p0,
+        const Pnt3D         * p1,
+        const Pnt3D         * p2,
+              double          tMin,
+              double          tMax,
+              unsigned int    activeMask,
+              double        * t,
+              double        * u,
+              double        * v,
+              int           * side
+        );
+
+#endif /* _ART_FOUNDATION_GEOMETRY_RAY3DPACKET_H_ */
+// ===========================================================================
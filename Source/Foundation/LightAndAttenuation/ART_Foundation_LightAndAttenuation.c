@@ -70,6 +70,8 @@ ART_LIBRARY_INITIALISATION_FUNCTION
  
     ART_PERFORM_MODULE_INITIALISATION( ArLightAlpha )
     ART_PERFORM_MODULE_INITIALISATION( ArLightAlphaSample )
+
+    ART_PERFORM_MODULE_INITIALISATION( ArSpectralFramebuffer )
  
     ART_PERFORM_MODULE_INITIALISATION( ArPlainDirectAttenuation )
     ART_PERFORM_MODULE_INITIALISATION( ArPlainDirectAttenuationSample )
@@ -59,6 +59,8 @@ ART_LIBRARY_INTERFACE(ART_Foundation_LightAndAttenuation)
 #include "ArLightAlpha.h"
 #include "ArLightAlphaSample.h"
 
+#include "ArSpectralFramebuffer.h"
+
 #include "ArPlainDirectAttenuation.h"
 #include "ArPlainDirectAttenuationSample.h"
 
@@ -0,0 +1,562 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+#define ART_MODULE_NAME     ArSpectralFramebuffer
+
+#include "ArSpectralFramebuffer.h"
+
+ART_NO_MODULE_INITIALISATION_FUNCTION_NECESSARY
+
+ART_NO_MODULE_SHUTDOWN_FUNCTION_NECESSARY
+
+//   Planes start on cache line boundaries, so that the loops over them
+//   can use aligned vector loads and stores.
+
+#define ARSPECTRALFRAMEBUFFER_ALIGNMENT     64
+#define ARSPECTRALFRAMEBUFFER_PLANE_ALIGN \
+    ( ARSPECTRALFRAMEBUFFER_ALIGNMENT / sizeof(double) )
+
+ArSpectralFramebuffer * arspectralframebuffer_alloc(
+        const ART_GV  * art_gv,
+        const IVec2D    size
+        )
+{
+    ArSpectralFramebuffer  * fbr = ALLOC(ArSpectralFramebuffer);
+
+    fbr->size       = size;
+    fbr->channels   = spc_channels( art_gv );
+    fbr->components = LIGHT_SUBSYSTEM_IS_IN_POLARISATION_MODE ? 4 : 1;
+    fbr->pixels     = (long) XC(size) * (long) YC(size);
+    fbr->stride     =
+          ( ( fbr->pixels + ARSPECTRALFRAMEBUFFER_PLANE_ALIGN - 1 )
+        / ARSPECTRALFRAMEBUFFER_PLANE_ALIGN )
+        * ARSPECTRALFRAMEBUFFER_PLANE_ALIGN;
+
+    //   all value planes, plus the alpha plane
+
+    size_t  planes = fbr->components * fbr->channels + 1;
+    void  * block = NULL;
+
+    if ( posix_memalign(
+               & block,
+                 ARSPECTRALFRAMEBUFFER_ALIGNMENT,
+                 sizeof(double) * planes * M_MAX( fbr->stride, 1 )
+               ) )
+        ART_ERRORHANDLING_FATAL_ERROR(
+            "allocation of a %d x %d spectral framebuffer failed"
+            ,   XC(size)
+            ,   YC(size)
+            );
+
+    fbr->value = (double *) block;
+    fbr->alpha = fbr->value + ( planes - 1 ) * fbr->stride;
+
+    if ( fbr->components == 4 )
+    {
+        fbr->refframe  = ALLOC_ARRAY( ArReferenceFrame, M_MAX( fbr->pixels, 1 ) );
+        fbr->polarised = ALLOC_ARRAY( unsigned char, M_MAX( fbr->pixels, 1 ) );
+    }
+    else
+    {
+        fbr->refframe  = NULL;
+        fbr->polarised = NULL;
+    }
+
+    arspectralframebuffer_clear( art_gv, fbr );
+
+    return fbr;
+}
+
+void arspectralframebuffer_free(
+        const ART_GV                 * art_gv,
+              ArSpectralFramebuffer  * fbr
+        )
+{
+    (void) art_gv;
+
+    free( fbr->value );
+
+    if ( fbr->refframe )
+        FREE_ARRAY( fbr->refframe );
+
+    if ( fbr->polarised )
+        FREE_ARRAY( fbr->polarised );
+
+    FREE( fbr );
+}
+
+void arspectralframebuffer_clear(
+        const ART_GV                 * art_gv,
+              ArSpectralFramebuffer  * fbr
+        )
+{
+    (void) art_gv;
+
+    memset(
+        fbr->value,
+        0,
+        sizeof(double) * ( fbr->components * fbr->channels + 1 ) * fbr->stride
+        );
+
+    if ( fbr->polarised )
+        memset( fbr->polarised, 0, fbr->pixels );
+}
+
+void arspectralframebuffer_fb_copy_fb(
+        const ART_GV                 * art_gv,
+        const ArSpectralFramebuffer  * fb0,
+              ArSpectralFramebuffer  * fbr
+        )
+{
+    (void) art_gv;
+
+    memcpy(
+        fbr->value,
+        fb0->value,
+        sizeof(double) * ( fb0->components * fb0->channels + 1 ) * fb0->stride
+        );
+
+    if ( fb0->polarised )
+    {
+        memcpy( fbr->polarised, fb0->polarised, fb0->pixels );
+        memcpy(
+            fbr->refframe,
+            fb0->refframe,
+            sizeof(ArReferenceFrame) * fb0->pixels
+            );
+    }
+}
+
+/* ---------------------------------------------------------------------------
+
+    'arspectralframebuffer_sv_realign'
+
+    Rotates the linear polarisation components (s1, s2) of Stokes
+    components that refer to r0 so that they refer to r1, which has to be
+    coaxial with r0. Same as arsvlight_ld_realign_to_coaxial_refframe_sv,
+    on raw values.
+
+------------------------------------------------------------------------aw- */
+
+static inline void arspectralframebuffer_sv_realign(
+        const ArReferenceFrame  * r0,
+        const ArReferenceFrame  * r1,
+        const double              s1,
+        const double              s2,
+              double            * s1r,
+              double            * s2r
+        )
+{
+    double  cos_phi =
+        vec3d_vv_dot(
+            & ARREFFRAME_RF_I( *r0, 0 ),
+            & ARREFFRAME_RF_I( *r1, 0 )
+            );
+
+    double  sin_phi =
+        vec3d_vv_dot(
+            & ARREFFRAME_RF_I( *r0, 1 ),
+            & ARREFFRAME_RF_I( *r1, 0 )
+            );
+
+    double  cos_2phi = M_SQR( cos_phi ) - M_SQR( sin_phi );
+    double  sin_2phi = 2 * cos_phi * sin_phi;
+
+    *s1r =   cos_2phi * s1 + sin_2phi * s2;
+    *s2r = - sin_2phi * s1 + cos_2phi * s2;
+}
+
+//   Adds d0 times the polarised components 1-3 given by 'value' (with
+//   their channels 'stride' apart), which refer to r0, to pixel i0 of fbr.
+
+static void arspectralframebuffer_dsvrf_mul_add_fbi(
+        const double                   d0,
+        const double                 * value,
+        const long                     stride,
+        const ArReferenceFrame       * r0,
+              ArSpectralFramebuffer  * fbr,
+        const long                     i0
+        )
+{
+    unsigned int  channels = fbr->channels;
+    double      * s1 = ARSPECTRALFRAMEBUFFER_PLANE( fbr, 1, 0 ) + i0;
+    double      * s2 = ARSPECTRALFRAMEBUFFER_PLANE( fbr, 2, 0 ) + i0;
+    double      * s3 = ARSPECTRALFRAMEBUFFER_PLANE( fbr, 3, 0 ) + i0;
+    long          fs = fbr->stride;
+
+    const double  * v1 = value +     channels * stride;
+    const double  * v2 = value + 2 * channels * stride;
+    const double  * v3 = value + 3 * channels * stride;
+
+    //   An unpolarised pixel has no polarised components yet, so it can
+    //   just take on the reference frame of the light that is added.
+
+    if ( ! fbr->polarised[i0] )
+    {
+        fbr->refframe[i0]  = *r0;
+        fbr->polarised[i0] = 1;
+
+        for ( unsigned int c = 0; c < channels; c++ )
+        {
+            s1[ c * fs ] += d0 * v1[ c * stride ];
+            s2[ c * fs ] += d0 * v2[ c * stride ];
+            s3[ c * fs ] += d0 * v3[ c * stride ];
+        }
+    }
+    else
+    {
+        for ( unsigned int c = 0; c < channels; c++ )
+        {
+            double  r1, r2;
+
+            arspectralframebuffer_sv_realign(
+                  r0,
+                & fbr->refframe[i0],
+                  v1[ c * stride ],
+                  v2[ c * stride ],
+                & r1,
+                & r2
+                );
+
+            s1[ c * fs ] += d0 * r1;
+            s2[ c * fs ] += d0 * r2;
+            s3[ c * fs ] += d0 * v3[ c * stride ];
+        }
+    }
+}
+
+void arspectralframebuffer_fbw_add_fbw(
+        const ART_GV                 * art_gv,
+        const ArSpectralFramebuffer  * fb0,
+        const IPnt2D                   o0,
+        const IVec2D                   e0,
+        const IPnt2D                   o1,
+              ArSpectralFramebuffer  * fbr
+        )
+{
+    (void) art_gv;
+
+    //   The intensity planes and alpha can always be summed row by row;
+    //   only the remaining Stokes components of polarised pixels need
+    //   a look at their reference frames.
+
+    unsigned int  planes = fb0->channels;
+
+    for ( unsigned int p = 0; p <= planes; p++ )
+    {
+        const double  * src =
+            ( p < planes ? ARSPECTRALFRAMEBUFFER_PLANE( fb0, 0, p ) : fb0->alpha );
+        double        * dst =
+            ( p < planes ? ARSPECTRALFRAMEBUFFER_PLANE( fbr, 0, p ) : fbr->alpha );
+
+        for ( int y = 0; y < YC(e0); y++ )
+        {
+            const double  * s =
+                src + ARSPECTRALFRAMEBUFFER_PIXEL( fb0, XC(o0), YC(o0) + y );
+            double        * d =
+                dst + ARSPECTRALFRAMEBUFFER_PIXEL( fbr, XC(o1), YC(o1) + y );
+
+            for ( int x = 0; x < XC(e0); x++ )
+                d[x] += s[x];
+        }
+    }
+
+    if ( fb0->components == 4 )
+    {
+        for ( int y = 0; y < YC(e0); y++ )
+        {
+            for ( int x = 0; x < XC(e0); x++ )
+            {
+                long  i0 = ARSPECTRALFRAMEBUFFER_PIXEL( fb0, XC(o0) + x, YC(o0) + y );
+
+                if ( fb0->polarised[i0] )
+                    arspectralframebuffer_dsvrf_mul_add_fbi(
+                          1.0,
+                          fb0->value + i0,
+                          fb0->stride,
+                        & fb0->refframe[i0],
+                          fbr,
+                          ARSPECTRALFRAMEBUFFER_PIXEL( fbr, XC(o1) + x, YC(o1) + y )
+                        );
+            }
+        }
+    }
+}
+
+void arspectralframebuffer_fb_kw_filter_fb(
+        const ART_GV                 * art_gv,
+        const ArSpectralFramebuffer  * fb0,
+        const unsigned int             n0,
+        const IVec2D                 * k0,
+        const double                 * w0,
+        const int                      y0,
+        const int                      y1,
+              ArSpectralFramebuffer  * fbr
+        )
+{
+    (void) art_gv;
+
+    int           width  = XC(fb0->size);
+    int           height = YC(fb0->size);
+    unsigned int  planes = fbr->components * fbr->channels;
+    long          first  = ARSPECTRALFRAMEBUFFER_PIXEL( fbr, 0, y0 );
+    long          length = ARSPECTRALFRAMEBUFFER_PIXEL( fbr, 0, y1 ) - first;
+
+    for ( unsigned int p = 0; p <= planes; p++ )
+        memset(
+            ( p < planes ? fbr->value + p * fbr->stride : fbr->alpha ) + first,
+            0,
+            length * sizeof(double)
+            );
+
+    if ( fbr->polarised )
+        memset( fbr->polarised + first, 0, length );
+
+    //   Intensity and alpha: for each kernel tap, a shifted row of the
+    //   source is added to each row of the result.
+
+    for ( unsigned int p = 0; p <= fbr->channels; p++ )
+    {
+        const double  * src =
+            ( p < fbr->channels ? ARSPECTRALFRAMEBUFFER_PLANE( fb0, 0, p ) : fb0->alpha );
+        double        * dst =
+            ( p < fbr->channels ? ARSPECTRALFRAMEBUFFER_PLANE( fbr, 0, p ) : fbr->alpha );
+
+        for ( int y = y0; y < y1; y++ )
+        {
+            double  * d = dst + ARSPECTRALFRAMEBUFFER_PIXEL( fbr, 0, y );
+
+            for ( unsigned int k = 0; k < n0; k++ )
+            {
+                int  sy = y + YC(k0[k]);
+                int  ox = XC(k0[k]);
+
+                if ( sy < 0 || sy >= height )
+                    continue;
+
+                const double  * s = src + ARSPECTRALFRAMEBUFFER_PIXEL( fb0, ox, sy );
+                double          w = w0[k];
+                int             xa = M_MAX( 0, -ox );
+                int             xb = M_MIN( width, width - ox );
+
+                for ( int x = xa; x < xb; x++ )
+                    d[x] += w * s[x];
+            }
+        }
+    }
+
+    if ( fbr->components < 4 )
+        return;
+
+    for ( int y = y0; y < y1; y++ )
+    {
+        for ( int x = 0; x < width; x++ )
+        {
+            for ( unsigned int k = 0; k < n0; k++ )
+            {
+                int  sx = x + XC(k0[k]);
+                int  sy = y + YC(k0[k]);
+
+                if ( sx < 0 || sx >= width || sy < 0 || sy >= height )
+                    continue;
+
+                long  i0 = ARSPECTRALFRAMEBUFFER_PIXEL( fb0, sx, sy );
+
+                if ( fb0->polarised[i0] )
+                    arspectralframebuffer_dsvrf_mul_add_fbi(
+                          w0[k],
+                          fb0->value + i0,
+                          fb0->stride,
+                        & fb0->refframe[i0],
+                          fbr,
+                          ARSPECTRALFRAMEBUFFER_PIXEL( fbr, x, y )
+                        );
+            }
+        }
+    }
+}
+
+ArSpectralFramebufferPixel * arspectralframebufferpixel_alloc(
+        const ART_GV  * art_gv
+        )
+{
+    ArSpectralFramebufferPixel  * pr = ALLOC(ArSpectralFramebufferPixel);
+
+    pr->channels   = spc_channels( art_gv );
+    pr->components = LIGHT_SUBSYSTEM_IS_IN_POLARISATION_MODE ? 4 : 1;
+    pr->value      = ALLOC_ARRAY_ZERO( double, pr->components * pr->channels );
+    pr->alpha      = 0.0;
+    pr->polarised  = 0;
+    pr->spc        = spc_alloc( art_gv );
+    pr->sv         = arstokesvector_alloc( art_gv );
+
+    return pr;
+}
+
+void arspectralframebufferpixel_free(
+        const ART_GV                      * art_gv,
+              ArSpectralFramebufferPixel  * pr
+        )
+{
+    FREE_ARRAY( pr->value );
+    spc_free( art_gv, pr->spc );
+    arstokesvector_free( art_gv, pr->sv );
+    FREE( pr );
+}
+
+void arspectralframebufferpixel_l_init_p(
+        const ART_GV                      * art_gv,
+        const ArLightAlpha                * l0,
+              ArSpectralFramebufferPixel  * pr
+        )
+{
+    ArLight  * light = ARLIGHTALPHA_LIGHT(*l0);
+
+    pr->alpha = ARLIGHTALPHA_ALPHA(*l0);
+
+    if ( pr->components == 4 )
+    {
+        pr->polarised = arlight_l_polarised( art_gv, light );
+
+        if ( pr->polarised )
+        {
+            pr->refframe = *arlight_l_refframe( art_gv, light );
+
+            arlight_l_to_sv( art_gv, light, pr->sv );
+
+            for ( unsigned int j = 0; j < 4; j++ )
+                for ( unsigned int c = 0; c < pr->channels; c++ )
+                    pr->value[ j * pr->channels + c ] =
+                        spc_si( art_gv, ARSV_I( *pr->sv, j ), c );
+
+            return;
+        }
+
+        for ( unsigned int c = pr->channels; c < 4 * pr->channels; c++ )
+            pr->value[c] = 0.0;
+    }
+
+    arlight_l_init_s( art_gv, light, pr->spc );
+
+    for ( unsigned int c = 0; c < pr->channels; c++ )
+        pr->value[c] = spc_si( art_gv, pr->spc, c );
+}
+
+void arspectralframebufferpixel_dp_mul_init_l(
+        const ART_GV                      * art_gv,
+        const double                        d0,
+              ArSpectralFramebufferPixel  * p0,
+              ArLightAlpha                * lr
+        )
+{
+    ARLIGHTALPHA_ALPHA(*lr) = d0 * p0->alpha;
+
+    if ( p0->components == 4 && p0->polarised )
+    {
+        for ( unsigned int j = 0; j < 4; j++ )
+            for ( unsigned int c = 0; c < p0->channels; c++ )
+                spc_set_sid(
+                    art_gv,
+                    ARSV_I( *p0->sv, j ),
+                    c,
+                    d0 * p0->value[ j * p0->channels + c ]
+                    );
+
+        arlight_s_rf_init_polarised_l(
+              art_gv,
+              p0->sv,
+            & p0->refframe,
+              ARLIGHTALPHA_LIGHT(*lr)
+            );
+    }
+    else
+    {
+        for ( unsigned int c = 0; c < p0->channels; c++ )
+            spc_set_sid( art_gv, p0->spc, c, d0 * p0->value[c] );
+
+        arlight_s_init_unpolarised_l(
+            art_gv,
+            p0->spc,
+            ARLIGHTALPHA_LIGHT(*lr)
+            );
+    }
+}
+
+void arspectralframebuffer_fbi_init_p(
+        const ART_GV                      * art_gv,
+        const ArSpectralFramebuffer       * fb0,
+        const long                          i0,
+              ArSpectralFramebufferPixel  * pr
+        )
+{
+    (void) art_gv;
+
+    for ( unsigned int j = 0; j < fb0->components; j++ )
+        for ( unsigned int c = 0; c < fb0->channels; c++ )
+            pr->value[ j * fb0->channels + c ] =
+                ARSPECTRALFRAMEBUFFER_PLANE( fb0, j, c )[i0];
+
+    pr->alpha = fb0->alpha[i0];
+
+    if ( fb0->components == 4 )
+    {
+        pr->polarised = fb0->polarised[i0];
+
+        if ( pr->polarised )
+            pr->refframe = fb0->refframe[i0];
+    }
+}
+
+void arspectralframebuffer_dp_mul_add_fbi(
+        const ART_GV                      * art_gv,
+        const double                        d0,
+        const ArSpectralFramebufferPixel  * p0,
+              ArSpectralFramebuffer       * fbr,
+        const long                          i0
+        )
+{
+    (void) art_gv;
+
+    double  * value = fbr->value + i0;
+    long      stride = fbr->stride;
+
+    for ( unsigned int c = 0; c < fbr->channels; c++ )
+        value[ c * stride ] += d0 * p0->value[c];
+
+    fbr->alpha[i0] += d0 * p0->alpha;
+
+    if ( fbr->components == 4 && p0->polarised )
+        arspectralframebuffer_dsvrf_mul_add_fbi(
+              d0,
+              p0->value,
+              1,
+            & p0->refframe,
+              fbr,
+              i0
+            );
+}
+
+// ===========================================================================
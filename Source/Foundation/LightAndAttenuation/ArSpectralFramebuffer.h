@@ -0,0 +1,210 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+#ifndef _ART_FOUNDATION_LIGHTANDATTENUATION_ARSPECTRALFRAMEBUFFER_H_
+#define _ART_FOUNDATION_LIGHTANDATTENUATION_ARSPECTRALFRAMEBUFFER_H_
+
+#include "ART_Foundation_System.h"
+
+ART_MODULE_INTERFACE(ArSpectralFramebuffer)
+
+#include "ART_Foundation_Geometry.h"
+
+#include "ArReferenceFrame.h"
+#include "ArStokesVector.h"
+#include "ArLightAlpha.h"
+
+/* ---------------------------------------------------------------------------
+
+    'ArSpectralFramebuffer' struct
+
+    Accumulation buffer for the light that reaches the pixels of an image,
+    as an alternative to one separately allocated ArLightAlpha per pixel.
+    All values are kept in a single aligned block, as planes of one value
+    per pixel: one plane per spectral channel and Stokes component,
+    followed by the alpha plane. Adding whole windows of such a buffer to
+    another one thus boils down to a few long, contiguous loops.
+
+    In plain mode, each pixel only has the intensity component. If the
+    light subsystem is in polarisation mode when the buffer is allocated,
+    it has all four Stokes components, and additionally keeps track of
+    whether a pixel is polarised, and of the reference frame the Stokes
+    components of a polarised pixel refer to. The mode of a buffer does
+    not change after allocation.
+
+    'ARSPECTRALFRAMEBUFFER_PLANE' returns the plane of a given component
+    and channel; planes are 'stride' values apart, which is 'pixels'
+    rounded up so that each plane starts on an alignment boundary.
+
+
+    'ArSpectralFramebufferPixel' struct
+
+    The contents of a single pixel, in unpacked form. Light that is added
+    to several pixels of a buffer (e.g. a sample that gets splatted over
+    the support of a reconstruction kernel) is converted to this form only
+    once, and then added to each of the pixels with a weight.
+
+------------------------------------------------------------------------aw- */
+
+typedef struct ArSpectralFramebuffer
+{
+    IVec2D              size;
+    unsigned int        channels;
+    unsigned int        components;
+    long                pixels;
+    long                stride;
+    double            * value;
+    double            * alpha;
+    ArReferenceFrame  * refframe;
+    unsigned char     * polarised;
+}
+ArSpectralFramebuffer;
+
+#define ARSPECTRALFRAMEBUFFER_PLANE(__fb,__component,__channel) \
+    ( (__fb)->value \
+    + ( (__component) * (__fb)->channels + (__channel) ) * (__fb)->stride )
+
+#define ARSPECTRALFRAMEBUFFER_PIXEL(__fb,__x,__y) \
+    ( (long)(__x) + (long)(__y) * XC((__fb)->size) )
+
+typedef struct ArSpectralFramebufferPixel
+{
+    unsigned int        channels;
+    unsigned int        components;
+    double            * value;
+    double              alpha;
+    ArReferenceFrame    refframe;
+    unsigned int        polarised;
+
+    //   scratch space for conversions from and to ArLightAlpha
+
+    ArSpectrum        * spc;
+    ArStokesVector    * sv;
+}
+ArSpectralFramebufferPixel;
+
+ArSpectralFramebuffer * arspectralframebuffer_alloc(
+        const ART_GV  * art_gv,
+        const IVec2D    size
+        );
+
+void arspectralframebuffer_free(
+        const ART_GV                 * art_gv,
+              ArSpectralFramebuffer  * fbr
+        );
+
+//   Sets all pixels to black with alpha 0, and unpolarised.
+
+void arspectralframebuffer_clear(
+        const ART_GV                 * art_gv,
+              ArSpectralFramebuffer  * fbr
+        );
+
+//   fbr = fb0; both have to be of the same size and mode
+
+void arspectralframebuffer_fb_copy_fb(
+        const ART_GV                 * art_gv,
+        const ArSpectralFramebuffer  * fb0,
+              ArSpectralFramebuffer  * fbr
+        );
+
+//   Adds the window of fb0 with origin o0 and extent e0 to the window of
+//   the same extent with origin o1 in fbr. Both windows have to lie
+//   entirely within their buffers.
+
+void arspectralframebuffer_fbw_add_fbw(
+        const ART_GV                 * art_gv,
+        const ArSpectralFramebuffer  * fb0,
+        const IPnt2D                   o0,
+        const IVec2D                   e0,
+        const IPnt2D                   o1,
+              ArSpectralFramebuffer  * fbr
+        );
+
+//   Reconstruction filtering: rows y0 to y1 (exclusive) of fbr are set
+//   to the weighted sum of those pixels of fb0 that lie at the given
+//   offsets from them, i.e. fbr(p) = sum_k w0[k] * fb0(p + k0[k]). Offsets
+//   that fall outside fb0 are skipped. Both buffers have to be of the same
+//   size and mode, and must not be the same buffer. Distinct row ranges
+//   can be filtered concurrently.
+
+void arspectralframebuffer_fb_kw_filter_fb(
+        const ART_GV                 * art_gv,
+        const ArSpectralFramebuffer  * fb0,
+        const unsigned int             n0,
+        const IVec2D                 * k0,
+        const double                 * w0,
+        const int                      y0,
+        const int                      y1,
+              ArSpectralFramebuffer  * fbr
+        );
+
+ArSpectralFramebufferPixel * arspectralframebufferpixel_alloc(
+        const ART_GV  * art_gv
+        );
+
+void arspectralframebufferpixel_free(
+        const ART_GV                      * art_gv,
+              ArSpectralFramebufferPixel  * pr
+        );
+
+//   pr = l0
+
+void arspectralframebufferpixel_l_init_p(
+        const ART_GV                      * art_gv,
+        const ArLightAlpha                * l0,
+              ArSpectralFramebufferPixel  * pr
+        );
+
+//   lr = d0 * p0
+
+void arspectralframebufferpixel_dp_mul_init_l(
+        const ART_GV                      * art_gv,
+        const double                        d0,
+              ArSpectralFramebufferPixel  * p0,
+              ArLightAlpha                * lr
+        );
+
+//   pr = pixel i0 of fb0
+
+void arspectralframebuffer_fbi_init_p(
+        const ART_GV                      * art_gv,
+        const ArSpectralFramebuffer       * fb0,
+        const long                          i0,
+              ArSpectralFramebufferPixel  * pr
+        );
+
+//   pixel i0 of fbr += d0 * p0
+
+void arspectralframebuffer_dp_mul_add_fbi(
+        const ART_GV                      * art_gv,
+        const double                        d0,
+        const ArSpectralFramebufferPixel  * p0,
+              ArSpectralFramebuffer       * fbr,
+        const long                          i0
+        );
+
+#endif /* _ART_FOUNDATION_LIGHTANDATTENUATION_ARSPECTRALFRAMEBUFFER_H_ */
+// ===========================================================================
@@ -43,6 +43,7 @@ ART_LIBRARY_INTERFACE(ART_Foundation_Math)
 
 #include "ArFFT.h"
 #include "ArVector.h"
+#include "ArAliasTable.h"
 
 #endif /* _ART_FOUNDATION_MATH_H_ */
 /* ======================================================================== */
@@ -0,0 +1,148 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+
+#include "ArAliasTable.h"
+
+double araliastable_init(
+              ArAliasTable  * table,
+        const double        * weight,
+              unsigned int    size
+        )
+{
+    double  overallWeight = 0.0;
+
+    for ( unsigned int i = 0; i < size; i++ )
+        overallWeight += weight[i];
+
+    if ( ! ( overallWeight > 0.0 ) )
+    {
+        table->size        = 0;
+        table->probability = 0;
+        table->threshold   = 0;
+        table->alias       = 0;
+
+        return 0.0;
+    }
+
+    table->size        = size;
+    table->probability = ALLOC_ARRAY( double, size );
+    table->threshold   = ALLOC_ARRAY( double, size );
+    table->alias       = ALLOC_ARRAY( unsigned int, size );
+
+    /* -----------------------------------------------------------------------
+        Vose's variant: the entries are split into those with less and
+        those with more than the average weight, and each of the former is
+        topped up to the average with part of one of the latter. Both work
+        lists are kept in one array, the small entries growing from the
+        front and the large ones from the back.
+    ----------------------------------------------------------------------- */
+
+    unsigned int  * worklist = ALLOC_ARRAY( unsigned int, size );
+    unsigned int    numberOfSmall = 0;
+    unsigned int    numberOfLarge = 0;
+
+    for ( unsigned int i = 0; i < size; i++ )
+    {
+        table->probability[i] = weight[i] / overallWeight;
+        table->threshold[i]   = table->probability[i] * size;
+        table->alias[i]       = i;
+
+        if ( table->threshold[i] < 1.0 )
+            worklist[ numberOfSmall++ ] = i;
+        else
+            worklist[ size - 1 - numberOfLarge++ ] = i;
+    }
+
+    while ( numberOfSmall > 0 && numberOfLarge > 0 )
+    {
+        unsigned int  small = worklist[ --numberOfSmall ];
+        unsigned int  large = worklist[ size - numberOfLarge ];
+
+        table->alias[ small ] = large;
+
+        table->threshold[ large ] -= 1.0 - table->threshold[ small ];
+
+        if ( table->threshold[ large ] < 1.0 )
+        {
+            numberOfLarge--;
+            worklist[ numberOfSmall++ ] = large;
+        }
+    }
+
+    //   Whatever is left over only differs from 1 by rounding errors.
+
+    while ( numberOfLarge > 0 )
+        table->threshold[ worklist[ size - numberOfLarge-- ] ] = 1.0;
+
+    while ( numberOfSmall > 0 )
+        table->threshold[ worklist[ --numberOfSmall ] ] = 1.0;
+
+    FREE_ARRAY( worklist );
+
+    return overallWeight;
+}
+
+void araliastable_free_contents(
+        ArAliasTable  * table
+        )
+{
+    if ( table->size > 0 )
+    {
+        FREE_ARRAY( table->probability );
+        FREE_ARRAY( table->threshold );
+        FREE_ARRAY( table->alias );
+    }
+
+    table->size = 0;
+}
+
+unsigned int araliastable_sample(
+        const ArAliasTable  * table,
+              double          randomValue
+        )
+{
+    double        scaledValue = randomValue * table->size;
+    unsigned int  index       = (unsigned int) scaledValue;
+
+    if ( index >= table->size )
+        index = table->size - 1;
+
+    if ( scaledValue - index < table->threshold[ index ] )
+        return index;
+    else
+        return table->alias[ index ];
+}
+
+double araliastable_probability(
+        const ArAliasTable  * table,
+              unsigned int    index
+        )
+{
+    return table->probability[ index ];
+}
+
+/* ======================================================================== */
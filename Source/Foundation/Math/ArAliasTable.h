@@ -0,0 +1,88 @@
+/* ===========================================================================
+
+    Copyright (c) The ART Development Team
+    --------------------------------------
+
+    For a comprehensive list of the members of the development team, and a
+    description of their respective contributions, see the file
+    "ART_DeveloperList.txt" that is distributed with the libraries.
+
+    This file is part of the Advanced Rendering Toolkit (ART) libraries.
+
+    ART is free software: you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    ART is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+    for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ART.  If not, see <http://www.gnu.org/licenses/>.
+
+=========================================================================== */
+
+
+#ifndef _ART_MATH_ALIASTABLE_H_
+#define _ART_MATH_ALIASTABLE_H_
+
+#include "ART_Foundation_System.h"
+
+/* ---------------------------------------------------------------------------
+    'ArAliasTable'
+        Walker's alias method for drawing one of 'size' entries with
+        probability proportional to a set of non-negative weights. Setting
+        up the table takes O(size) time; drawing an entry, and looking up
+        the probability with which it is drawn, is O(1) regardless of the
+        number of entries.
+
+        Each entry i is either drawn directly, if the fractional part of
+        the scaled random value is below 'threshold[i]', or its alias
+        'alias[i]' is drawn instead.
+--------------------------------------------------------------------------- */
+typedef struct ArAliasTable
+{
+    unsigned int    size;
+    double        * probability;
+    double        * threshold;
+    unsigned int  * alias;
+}
+ArAliasTable;
+
+/* ---------------------------------------------------------------------------
+    'araliastable_init'
+        Sets up the table for the given weights, and returns their sum. If
+        that is zero, the table is left empty, and nothing can be drawn
+        from it.
+--------------------------------------------------------------------------- */
+double araliastable_init(
+              ArAliasTable  * table,
+        const double        * weight,
+              unsigned int    size
+        );
+
+void araliastable_free_contents(
+        ArAliasTable  * table
+        );
+
+#define ARALIASTABLE_IS_EMPTY(_t)   ( (_t).size == 0 )
+
+/* ---------------------------------------------------------------------------
+    'araliastable_sample'
+        Draws an entry using a single uniform random value in [0,1). The
+        table must not be empty.
+--------------------------------------------------------------------------- */
+unsigned int araliastable_sample(
+        const ArAliasTable  * table,
+              double          randomValue
+        );
+
+double araliastable_probability(
+        const ArAliasTable  * table,
+              unsigned int    index
+        );
+
+#endif /* _ART_MATH_ALIASTABLE_H_ */
+/* ======================================================================== */
@@ -52,7 +52,7 @@ ART_MODULE_INITIALISATION_FUNCTION_EXEC_ONLY_ONCE
 ART_NO_EXEC_ONLY_ONCE_MODULE_SHUTDOWN_FUNCTION_NECESSARY
 
 
-Cx_IMPLEMENTATION(4)
+Cx_IMPLEMENTATION_WITHOUT_DOUBLE_ARITHMETIC(4)
 
 void c4_mm_mul_m(
         const Mat4  * m0,
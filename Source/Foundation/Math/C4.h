@@ -34,7 +34,7 @@ ART_MODULE_INTERFACE(C4)
 #include "Functions.h"
 #include "Cx_InterfaceMacros.h"
 
-Cx_DEFINITION(4)
+Cx_DEFINITION_WITHOUT_DOUBLE_ARITHMETIC(4)
 
 typedef struct { double x[4][4]; } Mat4;
 
@@ -73,6 +73,457 @@ extern Mat4 C4_M_UNIT;
 #define C4_C_PRINTF(_c)         (_c).x[0],(_c).x[1],(_c).x[2],(_c).x[3]
 #define C4_C_SCANF(_c)          &(_c).x[0],&(_c).x[1],&(_c).x[2],&(_c).x[3]
 
+/* ---------------------------------------------------------------------------
+
+    Vectorised element-wise arithmetic
+
+    Crd4 is what the ArSpectralSample of hero wavelength rendering is
+    made of, so the element-wise double arithmetic below sits underneath
+    all the sps_* functions, and through them underneath the arithmetic
+    of plain light and attenuation samples. On x86 it is therefore done
+    with explicit SSE2 instructions (two lanes of two doubles), or with
+    AVX (one lane of four) if the compiler targets AVX, e.g. via -mavx or
+    -march=native. Compiling with _ART_WITHOUT_SIMD, or for any other
+    architecture, selects a scalar "vector" of one double instead.
+
+    The functions are static inline ones defined right here, so that each
+    of them compiles to a handful of instructions at the call site rather
+    than to a call into the library.
+
+    The results are bit-identical to those of the generic Cx loops: each
+    lane performs exactly the same IEEE operations in the same order, and
+    no fused multiply-adds are used explicitly. Only where two NaNs meet
+    can the sign and payload of the resulting NaN differ, as the compiler
+    may swap the operands of an addition in either version. If the
+    compiler is allowed to contract multiply-adds (GCC does so by default
+    when FMA is available), it may do so differently for the two
+    versions; the *_mul_add* functions can then differ from the scalar
+    ones by one rounding, i.e. 1 ulp per multiply-add. The c4_arithmetic
+    check of art_selftest compares the two on signed zeros, NaNs,
+    infinities and denormals.
+
+    The safediv and inv functions compute the division in all lanes and
+    mask out the ones with a zero divisor afterwards, so unlike the Cx
+    loops they may set the division by zero flag of the FPU - which ART
+    never traps on.
+
+------------------------------------------------------------------------aw- */
+
+#if ! defined(_ART_WITHOUT_SIMD) && defined(__AVX__)
+
+#include <immintrin.h>
+
+typedef __m256d  C4Vec;
+
+#define C4VEC_WIDTH             4
+#define C4VEC_LOAD(_p)          _mm256_loadu_pd( (_p) )
+#define C4VEC_STORE(_p,_v)      _mm256_storeu_pd( (_p), (_v) )
+#define C4VEC_SET1(_d)          _mm256_set1_pd( (_d) )
+#define C4VEC_ADD(_a,_b)        _mm256_add_pd( (_a), (_b) )
+#define C4VEC_SUB(_a,_b)        _mm256_sub_pd( (_a), (_b) )
+#define C4VEC_MUL(_a,_b)        _mm256_mul_pd( (_a), (_b) )
+#define C4VEC_DIV(_a,_b)        _mm256_div_pd( (_a), (_b) )
+#define C4VEC_NONZERO(_a) \
+            _mm256_cmp_pd( (_a), _mm256_setzero_pd(), _CMP_NEQ_UQ )
+#define C4VEC_SELECT(_m,_a,_b)  _mm256_blendv_pd( (_b), (_a), (_m) )
+
+#elif ! defined(_ART_WITHOUT_SIMD) && defined(__SSE2__)
+
+#include <emmintrin.h>
+
+typedef __m128d  C4Vec;
+
+#define C4VEC_WIDTH             2
+#define C4VEC_LOAD(_p)          _mm_loadu_pd( (_p) )
+#define C4VEC_STORE(_p,_v)      _mm_storeu_pd( (_p), (_v) )
+#define C4VEC_SET1(_d)          _mm_set1_pd( (_d) )
+#define C4VEC_ADD(_a,_b)        _mm_add_pd( (_a), (_b) )
+#define C4VEC_SUB(_a,_b)        _mm_sub_pd( (_a), (_b) )
+#define C4VEC_MUL(_a,_b)        _mm_mul_pd( (_a), (_b) )
+#define C4VEC_DIV(_a,_b)        _mm_div_pd( (_a), (_b) )
+#define C4VEC_NONZERO(_a)       _mm_cmpneq_pd( (_a), _mm_setzero_pd() )
+#define C4VEC_SELECT(_m,_a,_b) \
+            _mm_or_pd( _mm_and_pd( (_m), (_a) ), _mm_andnot_pd( (_m), (_b) ) )
+
+#else
+
+typedef double  C4Vec;
+
+#define C4VEC_WIDTH             1
+#define C4VEC_LOAD(_p)          (*(_p))
+#define C4VEC_STORE(_p,_v)      (*(_p) = (_v))
+#define C4VEC_SET1(_d)          (_d)
+#define C4VEC_ADD(_a,_b)        ((_a) + (_b))
+#define C4VEC_SUB(_a,_b)        ((_a) - (_b))
+#define C4VEC_MUL(_a,_b)        ((_a) * (_b))
+#define C4VEC_DIV(_a,_b)        ((_a) / (_b))
+#define C4VEC_NONZERO(_a)       ((_a) != 0.0)
+#define C4VEC_SELECT(_m,_a,_b)  ((_m) ? (_a) : (_b))
+
+#endif
+
+//   Lane-wise access to the components of a Crd4; the loop over the
+//   lanes is a constant one that the compiler unrolls.
+
+#define C4VEC_FOR_EACH_LANE(_i) \
+            for ( unsigned int _i = 0; _i < 4; _i += C4VEC_WIDTH )
+#define C4VEC_OF(_c,_i)         C4VEC_LOAD( & C4_CI(*(_c),(_i)) )
+#define C4VEC_TO(_c,_i,_v)      C4VEC_STORE( & C4_CI(*(_c),(_i)), (_v) )
+
+static inline void c4_inv_c(
+        Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+    {
+        C4Vec  vr = C4VEC_OF( cr, i );
+
+        C4VEC_TO( cr, i,
+            C4VEC_SELECT(
+                C4VEC_NONZERO( vr ),
+                C4VEC_DIV( C4VEC_SET1( 1.0 ), vr ),
+                C4VEC_SET1( MATH_HUGE_DOUBLE )
+                )
+            );
+    }
+}
+
+static inline void c4_c_inv_c(
+        const Crd4  * c0,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+    {
+        C4Vec  v0 = C4VEC_OF( c0, i );
+
+        C4VEC_TO( cr, i,
+            C4VEC_SELECT(
+                C4VEC_NONZERO( v0 ),
+                C4VEC_DIV( C4VEC_SET1( 1.0 ), v0 ),
+                C4VEC_SET1( MATH_HUGE_DOUBLE )
+                )
+            );
+    }
+}
+
+static inline void c4_d_add_c(
+        const double    d0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_ADD( C4VEC_OF( cr, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_d_sub_c(
+        const double    d0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_SUB( C4VEC_OF( cr, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_d_mul_c(
+        const double    d0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_MUL( C4VEC_OF( cr, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_d_div_c(
+        const double    d0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_DIV( C4VEC_OF( cr, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_c_add_c(
+        const Crd4  * c0,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_ADD( C4VEC_OF( cr, i ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_c_sub_c(
+        const Crd4  * c0,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_SUB( C4VEC_OF( cr, i ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_c_mul_c(
+        const Crd4  * c0,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_MUL( C4VEC_OF( cr, i ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_c_div_c(
+        const Crd4  * c0,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_DIV( C4VEC_OF( cr, i ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_c_safediv_c(
+        const Crd4  * c0,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+    {
+        C4Vec  v0 = C4VEC_OF( c0, i );
+
+        C4VEC_TO( cr, i,
+            C4VEC_SELECT(
+                C4VEC_NONZERO( v0 ),
+                C4VEC_DIV( C4VEC_OF( cr, i ), v0 ),
+                C4VEC_SET1( MATH_HUGE_DOUBLE )
+                )
+            );
+    }
+}
+
+static inline void c4_cc_add_c(
+        const Crd4  * c0,
+        const Crd4  * c1,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_ADD( C4VEC_OF( c0, i ), C4VEC_OF( c1, i ) ) );
+}
+
+static inline void c4_cc_sub_c(
+        const Crd4  * c0,
+        const Crd4  * c1,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_SUB( C4VEC_OF( c1, i ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_cc_mul_c(
+        const Crd4  * c0,
+        const Crd4  * c1,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_MUL( C4VEC_OF( c0, i ), C4VEC_OF( c1, i ) ) );
+}
+
+static inline void c4_cc_div_c(
+        const Crd4  * c0,
+        const Crd4  * c1,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_DIV( C4VEC_OF( c1, i ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_cc_safediv_c(
+        const Crd4  * c0,
+        const Crd4  * c1,
+              Crd4  * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+    {
+        C4Vec  v0 = C4VEC_OF( c0, i );
+
+        C4VEC_TO( cr, i,
+            C4VEC_SELECT(
+                C4VEC_NONZERO( v0 ),
+                C4VEC_DIV( C4VEC_OF( c1, i ), v0 ),
+                C4VEC_SET1( MATH_HUGE_DOUBLE )
+                )
+            );
+    }
+}
+
+static inline void c4_dc_add_c(
+        const double    d0,
+        const Crd4    * c0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_ADD( C4VEC_OF( c0, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_dc_sub_c(
+        const double    d0,
+        const Crd4    * c0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_SUB( C4VEC_OF( c0, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_dc_mul_c(
+        const double    d0,
+        const Crd4    * c0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_MUL( C4VEC_OF( c0, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_dc_div_c(
+        const double    d0,
+        const Crd4    * c0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_DIV( C4VEC_OF( c0, i ), C4VEC_SET1( d0 ) ) );
+}
+
+static inline void c4_cd_sub_c(
+        const Crd4    * c0,
+        const double    d0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_SUB( C4VEC_SET1( d0 ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_cd_div_c(
+        const Crd4    * c0,
+        const double    d0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i, C4VEC_DIV( C4VEC_SET1( d0 ), C4VEC_OF( c0, i ) ) );
+}
+
+static inline void c4_dcc_interpol_c(
+        const double    d0,
+        const Crd4    * c0,
+        const Crd4    * c1,
+              Crd4    * cr
+        )
+{
+    //   Same operations as M_INTERPOL: c0 + ( c1 - c0 ) * d0
+
+    C4VEC_FOR_EACH_LANE(i)
+    {
+        C4Vec  v0 = C4VEC_OF( c0, i );
+
+        C4VEC_TO( cr, i,
+            C4VEC_ADD(
+                v0,
+                C4VEC_MUL( C4VEC_SUB( C4VEC_OF( c1, i ), v0 ), C4VEC_SET1( d0 ) )
+                )
+            );
+    }
+}
+
+static inline void c4_dc_mul_add_c(
+        const double    d0,
+        const Crd4    * c0,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i,
+            C4VEC_ADD(
+                C4VEC_OF( cr, i ),
+                C4VEC_MUL( C4VEC_SET1( d0 ), C4VEC_OF( c0, i ) )
+                )
+            );
+}
+
+static inline void c4_dc_mul_c_add_c(
+        const double    d0,
+        const Crd4    * c0,
+        const Crd4    * c1,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i,
+            C4VEC_ADD(
+                C4VEC_OF( c1, i ),
+                C4VEC_MUL( C4VEC_SET1( d0 ), C4VEC_OF( c0, i ) )
+                )
+            );
+}
+
+static inline void c4_dc_mul_dc_mul_add_c(
+        const double    d0,
+        const Crd4    * c0,
+        const double    d1,
+        const Crd4    * c1,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i,
+            C4VEC_ADD(
+                C4VEC_MUL( C4VEC_SET1( d0 ), C4VEC_OF( c0, i ) ),
+                C4VEC_MUL( C4VEC_SET1( d1 ), C4VEC_OF( c1, i ) )
+                )
+            );
+}
+
+static inline void c4_dc_mul_dc_mul_dc_mul_add3_c(
+        const double    d0,
+        const Crd4    * c0,
+        const double    d1,
+        const Crd4    * c1,
+        const double    d2,
+        const Crd4    * c2,
+              Crd4    * cr
+        )
+{
+    C4VEC_FOR_EACH_LANE(i)
+        C4VEC_TO( cr, i,
+            C4VEC_ADD(
+                C4VEC_ADD(
+                    C4VEC_MUL( C4VEC_SET1( d0 ), C4VEC_OF( c0, i ) ),
+                    C4VEC_MUL( C4VEC_SET1( d1 ), C4VEC_OF( c1, i ) )
+                    ),
+                C4VEC_MUL( C4VEC_SET1( d2 ), C4VEC_OF( c2, i ) )
+                )
+            );
+}
+
+#undef C4VEC_WIDTH
+#undef C4VEC_LOAD
+#undef C4VEC_STORE
+#undef C4VEC_SET1
+#undef C4VEC_ADD
+#undef C4VEC_SUB
+#undef C4VEC_MUL
+#undef C4VEC_DIV
+#undef C4VEC_NONZERO
+#undef C4VEC_SELECT
+#undef C4VEC_FOR_EACH_LANE
+#undef C4VEC_OF
+#undef C4VEC_TO
+
 double c4_cc_dot(
         const Crd4  * c0,
         const Crd4  * c1
@@ -33,7 +33,7 @@
 #define INLINE_INSTRUCTION
 #endif
 
-#define _Cx_IMPLEMENTATION(_f,_F,_fp,_dtype,_zero,_one,_maxvalue,_n,_fpref) \
+#define _Cx_BASIC_IMPLEMENTATION(_f,_F,_fp,_dtype,_zero,_one,_maxvalue,_n,_fpref) \
 \
 INLINE_INSTRUCTION void _f##c##_n##_##_fp##_init_c( \
         const _dtype         d0, \
@@ -310,33 +310,6 @@ INLINE_INSTRUCTION void _f##c##_n##_c_fast_inv_c( \
         _F##C##_n##_CI(*cr,i) = _one / _F##C##_n##_CI(*c0,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_inv_c( \
-        _F##Crd##_n  * cr  \
-        ) \
-{ \
-    for( unsigned int i = 0; i < _n; i++ ) \
-    { \
-        if ( _F##C##_n##_CI(*cr,i) != _zero ) \
-            _F##C##_n##_CI(*cr,i) = _one / _F##C##_n##_CI(*cr,i); \
-        else \
-            _F##C##_n##_CI(*cr,i) = _maxvalue; \
-    } \
-} \
-\
-INLINE_INSTRUCTION void _f##c##_n##_c_inv_c( \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
-        ) \
-{ \
-    for( unsigned int i = 0; i < _n; i++ ) \
-    { \
-        if ( _F##C##_n##_CI(*c0,i) != _zero ) \
-            _F##C##_n##_CI(*cr,i) = _one / _F##C##_n##_CI(*c0,i); \
-        else \
-            _F##C##_n##_CI(*cr,i) = _maxvalue; \
-    } \
-} \
-\
 INLINE_INSTRUCTION void _f##c##_n##_norm_c( \
               _F##Crd##_n  * cr \
         ) \
@@ -362,326 +335,364 @@ INLINE_INSTRUCTION void _f##c##_n##_c_norm_c( \
     } \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##_add_c( \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##_atomic_add_c( \
         const _dtype     d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) += d0; \
+        _F##C##_n##_CI(*cr,i) = \
+            m_##_fp##_fp##_atomic_add ( \
+                  d0, \
+                & _F##C##_n##_CI(*cr,i) \
+                ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##_atomic_add_c( \
-        const _dtype     d0, \
+INLINE_INSTRUCTION void _f##c##_n##_c_atomic_add_c( \
+        const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
         _F##C##_n##_CI(*cr,i) = \
             m_##_fp##_fp##_atomic_add ( \
-                  d0, \
+                  _F##C##_n##_CI(*c0,i), \
                 & _F##C##_n##_CI(*cr,i) \
                 ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##_sub_c( \
-        const _dtype     d0, \
+INLINE_INSTRUCTION void _f##c##_n##_dc_pow_c( \
+        const double         d0, \
+        const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) -= d0; \
+        _F##C##_n##_CI(*cr,i) = m_dd_pow(_F##C##_n##_CI(*c0,i),d0); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##_mul_c( \
-        const _dtype     d0, \
+INLINE_INSTRUCTION void _f##c##_n##_cd_pow_c( \
+        const _F##Crd##_n  * c0, \
+        const double         d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) *= d0; \
+        _F##C##_n##_CI(*cr,i) = m_dd_pow(d0, _F##C##_n##_CI(*c0,i)); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##_div_c( \
-        const _dtype     d0, \
+INLINE_INSTRUCTION void _f##c##_n##_cd_negpow_c( \
+        const _F##Crd##_n  * c0, \
+        const double         d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) /= d0; \
+        _F##C##_n##_CI(*cr,i) = m_dd_pow(d0, -_F##C##_n##_CI(*c0,i)); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_add_c( \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
+INLINE_INSTRUCTION void _f##c##_n##_sqrt_c(  \
+        _F##Crd##_n  * cr \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) += _F##C##_n##_CI(*c0,i); \
+        _F##C##_n##_CI(*cr,i) = sqrt( _F##C##_n##_CI(*cr,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_atomic_add_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_sqrt_c( \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = \
-            m_##_fp##_fp##_atomic_add ( \
-                  _F##C##_n##_CI(*c0,i), \
-                & _F##C##_n##_CI(*cr,i) \
-                ); \
+        _F##C##_n##_CI(*cr,i) = sqrt( _F##C##_n##_CI(*c0,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_sub_c( \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
+INLINE_INSTRUCTION void _f##c##_n##_exp_c(  \
+        _F##Crd##_n  * cr \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) -= _F##C##_n##_CI(*c0,i); \
+        _F##C##_n##_CI(*cr,i) = exp( _F##C##_n##_CI(*cr,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_mul_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_exp_c( \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) *= _F##C##_n##_CI(*c0,i); \
+        _F##C##_n##_CI(*cr,i) = exp( _F##C##_n##_CI(*c0,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_div_c( \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
+INLINE_INSTRUCTION void _f##c##_n##_negexp_c(  \
+        _F##Crd##_n  * cr \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) /= _F##C##_n##_CI(*c0,i); \
+        _F##C##_n##_CI(*cr,i) = exp( - _F##C##_n##_CI(*cr,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_safediv_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_negexp_c( \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-    { \
-        if ( _F##C##_n##_CI(*c0,i) != _zero ) \
-            _F##C##_n##_CI(*cr,i) /= _F##C##_n##_CI(*c0,i); \
-        else \
-            _F##C##_n##_CI(*cr,i) = _maxvalue; \
-    } \
+        _F##C##_n##_CI(*cr,i) = exp(- _F##C##_n##_CI(*c0,i)); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_cc_add_c( \
-        const _F##Crd##_n  * c0, \
-        const _F##Crd##_n  * c1, \
-              _F##Crd##_n  * cr  \
+INLINE_INSTRUCTION void _f##c##_n##_log_c(  \
+        _F##Crd##_n  * cr \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) + _F##C##_n##_CI(*c1,i); \
+        _F##C##_n##_CI(*cr,i) = log( _F##C##_n##_CI(*cr,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_cc_sub_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_log_c( \
         const _F##Crd##_n  * c0, \
-        const _F##Crd##_n  * c1, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c1,i) - _F##C##_n##_CI(*c0,i); \
+        _F##C##_n##_CI(*cr,i) = log( _F##C##_n##_CI(*c0,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_cc_mul_c( \
-        const _F##Crd##_n  * c0, \
-        const _F##Crd##_n  * c1, \
-              _F##Crd##_n  * cr  \
+INLINE_INSTRUCTION void _f##c##_n##_logneg_c(  \
+        _F##Crd##_n  * cr \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) * _F##C##_n##_CI(*c1,i); \
+        _F##C##_n##_CI(*cr,i) = - log( _F##C##_n##_CI(*cr,i) ); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_cc_div_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_logneg_c( \
         const _F##Crd##_n  * c0, \
-        const _F##Crd##_n  * c1, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c1,i) / _F##C##_n##_CI(*c0,i); \
+        _F##C##_n##_CI(*cr,i) = - log( _F##C##_n##_CI(*c0,i)); \
+}
+
+/* ---------------------------------------------------------------------------
+
+    The element-wise arithmetic of the Cx types is kept in a macro of its
+    own, so that a Cx type can provide hand-vectorised versions of these
+    functions instead of the generic loops (see C4.h); '_Cx_IMPLEMENTATION'
+    instantiates both parts.
+
+------------------------------------------------------------------------aw- */
+
+#define _Cx_ARITHMETIC_IMPLEMENTATION(_f,_F,_fp,_dtype,_zero,_one,_maxvalue,_n,_fpref) \
+\
+INLINE_INSTRUCTION void _f##c##_n##_inv_c( \
+        _F##Crd##_n  * cr  \
+        ) \
+{ \
+    for( unsigned int i = 0; i < _n; i++ ) \
+    { \
+        if ( _F##C##_n##_CI(*cr,i) != _zero ) \
+            _F##C##_n##_CI(*cr,i) = _one / _F##C##_n##_CI(*cr,i); \
+        else \
+            _F##C##_n##_CI(*cr,i) = _maxvalue; \
+    } \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_cc_safediv_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_inv_c( \
         const _F##Crd##_n  * c0, \
-        const _F##Crd##_n  * c1, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
     { \
         if ( _F##C##_n##_CI(*c0,i) != _zero ) \
-            _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c1,i) / _F##C##_n##_CI(*c0,i); \
+            _F##C##_n##_CI(*cr,i) = _one / _F##C##_n##_CI(*c0,i); \
         else \
             _F##C##_n##_CI(*cr,i) = _maxvalue; \
     } \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_add_c( \
-        const _dtype         d0, \
-        const _F##Crd##_n  * c0, \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##_add_c( \
+        const _dtype     d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) + d0; \
+        _F##C##_n##_CI(*cr,i) += d0; \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_sub_c( \
-        const _dtype         d0, \
-        const _F##Crd##_n  * c0, \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##_sub_c( \
+        const _dtype     d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) - d0; \
+        _F##C##_n##_CI(*cr,i) -= d0; \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_mul_c( \
-        const _dtype         d0, \
-        const _F##Crd##_n  * c0, \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##_mul_c( \
+        const _dtype     d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) * d0; \
+        _F##C##_n##_CI(*cr,i) *= d0; \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_div_c( \
-        const _dtype         d0, \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##_div_c( \
+        const _dtype     d0, \
+              _F##Crd##_n  * cr  \
+        ) \
+{ \
+    for( unsigned int i = 0; i < _n; i++ ) \
+        _F##C##_n##_CI(*cr,i) /= d0; \
+} \
+\
+INLINE_INSTRUCTION void _f##c##_n##_c_add_c( \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) / d0; \
+        _F##C##_n##_CI(*cr,i) += _F##C##_n##_CI(*c0,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_dc_pow_c( \
-        const double         d0, \
+INLINE_INSTRUCTION void _f##c##_n##_c_sub_c( \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = m_dd_pow(_F##C##_n##_CI(*c0,i),d0); \
+        _F##C##_n##_CI(*cr,i) -= _F##C##_n##_CI(*c0,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_cd_pow_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_mul_c( \
         const _F##Crd##_n  * c0, \
-        const double         d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = m_dd_pow(d0, _F##C##_n##_CI(*c0,i)); \
+        _F##C##_n##_CI(*cr,i) *= _F##C##_n##_CI(*c0,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_cd_negpow_c( \
+INLINE_INSTRUCTION void _f##c##_n##_c_div_c( \
         const _F##Crd##_n  * c0, \
-        const double         d0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = m_dd_pow(d0, -_F##C##_n##_CI(*c0,i)); \
+        _F##C##_n##_CI(*cr,i) /= _F##C##_n##_CI(*c0,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_sqrt_c(  \
-        _F##Crd##_n  * cr \
+INLINE_INSTRUCTION void _f##c##_n##_c_safediv_c( \
+        const _F##Crd##_n  * c0, \
+              _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = sqrt( _F##C##_n##_CI(*cr,i) ); \
+    { \
+        if ( _F##C##_n##_CI(*c0,i) != _zero ) \
+            _F##C##_n##_CI(*cr,i) /= _F##C##_n##_CI(*c0,i); \
+        else \
+            _F##C##_n##_CI(*cr,i) = _maxvalue; \
+    } \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_sqrt_c( \
+INLINE_INSTRUCTION void _f##c##_n##_cc_add_c( \
         const _F##Crd##_n  * c0, \
+        const _F##Crd##_n  * c1, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = sqrt( _F##C##_n##_CI(*c0,i) ); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) + _F##C##_n##_CI(*c1,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_exp_c(  \
-        _F##Crd##_n  * cr \
+INLINE_INSTRUCTION void _f##c##_n##_cc_sub_c( \
+        const _F##Crd##_n  * c0, \
+        const _F##Crd##_n  * c1, \
+              _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = exp( _F##C##_n##_CI(*cr,i) ); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c1,i) - _F##C##_n##_CI(*c0,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_exp_c( \
+INLINE_INSTRUCTION void _f##c##_n##_cc_mul_c( \
         const _F##Crd##_n  * c0, \
+        const _F##Crd##_n  * c1, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = exp( _F##C##_n##_CI(*c0,i) ); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) * _F##C##_n##_CI(*c1,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_negexp_c(  \
-        _F##Crd##_n  * cr \
+INLINE_INSTRUCTION void _f##c##_n##_cc_div_c( \
+        const _F##Crd##_n  * c0, \
+        const _F##Crd##_n  * c1, \
+              _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = exp( - _F##C##_n##_CI(*cr,i) ); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c1,i) / _F##C##_n##_CI(*c0,i); \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_negexp_c( \
+INLINE_INSTRUCTION void _f##c##_n##_cc_safediv_c( \
         const _F##Crd##_n  * c0, \
+        const _F##Crd##_n  * c1, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = exp(- _F##C##_n##_CI(*c0,i)); \
+    { \
+        if ( _F##C##_n##_CI(*c0,i) != _zero ) \
+            _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c1,i) / _F##C##_n##_CI(*c0,i); \
+        else \
+            _F##C##_n##_CI(*cr,i) = _maxvalue; \
+    } \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_log_c(  \
-        _F##Crd##_n  * cr \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_add_c( \
+        const _dtype         d0, \
+        const _F##Crd##_n  * c0, \
+              _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = log( _F##C##_n##_CI(*cr,i) ); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) + d0; \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_log_c( \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_sub_c( \
+        const _dtype         d0, \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = log( _F##C##_n##_CI(*c0,i) ); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) - d0; \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_logneg_c(  \
-        _F##Crd##_n  * cr \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_mul_c( \
+        const _dtype         d0, \
+        const _F##Crd##_n  * c0, \
+              _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = - log( _F##C##_n##_CI(*cr,i) ); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) * d0; \
 } \
 \
-INLINE_INSTRUCTION void _f##c##_n##_c_logneg_c( \
+INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_div_c( \
+        const _dtype         d0, \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ) \
 { \
     for( unsigned int i = 0; i < _n; i++ ) \
-        _F##C##_n##_CI(*cr,i) = - log( _F##C##_n##_CI(*c0,i)); \
+        _F##C##_n##_CI(*cr,i) = _F##C##_n##_CI(*c0,i) / d0; \
 } \
 \
 INLINE_INSTRUCTION void _f##c##_n##_c##_fp##_sub_c( \
@@ -770,9 +781,13 @@ INLINE_INSTRUCTION void _f##c##_n##_##_fp##c_mul_##_fp##c_mul_##_fp##c_mul_add3_
             + d2 * _F##C##_n##_CI(*c2,i); \
 }
 
-#define Cx_IMPLEMENTATION(_n) \
+#define _Cx_IMPLEMENTATION(_f,_F,_fp,_dtype,_zero,_one,_maxvalue,_n,_fpref) \
+\
+_Cx_BASIC_IMPLEMENTATION(_f,_F,_fp,_dtype,_zero,_one,_maxvalue,_n,_fpref) \
+_Cx_ARITHMETIC_IMPLEMENTATION(_f,_F,_fp,_dtype,_zero,_one,_maxvalue,_n,_fpref)
+
+#define _Cx_FLOAT_AND_CONVERSION_IMPLEMENTATION(_n) \
 \
-_Cx_IMPLEMENTATION(,,d,double,0.0,1.0,MATH_HUGE_DOUBLE,_n,f) \
 _Cx_IMPLEMENTATION(f,F,f,float,0.0,1.0,MATH_HUGE_FLOAT,_n,f) \
 \
 INLINE_INSTRUCTION void c##_n##_c_to_fc( \
@@ -811,6 +826,19 @@ INLINE_INSTRUCTION Crd##_n c##_n##_c_of_fc( \
     return cr; \
 }
 
+#define Cx_IMPLEMENTATION(_n) \
+\
+_Cx_IMPLEMENTATION(,,d,double,0.0,1.0,MATH_HUGE_DOUBLE,_n,f) \
+_Cx_FLOAT_AND_CONVERSION_IMPLEMENTATION(_n)
+
+//   For a Cx type whose double precision element-wise arithmetic is
+//   provided by hand (currently only C4, see C4.h).
+
+#define Cx_IMPLEMENTATION_WITHOUT_DOUBLE_ARITHMETIC(_n) \
+\
+_Cx_BASIC_IMPLEMENTATION(,,d,double,0.0,1.0,MATH_HUGE_DOUBLE,_n,f) \
+_Cx_FLOAT_AND_CONVERSION_IMPLEMENTATION(_n)
+
 #define ICx_IMPLEMENTATION(_n) \
 \
 _Cx_IMPLEMENTATION(i,I,i,int,0,1,UINT_MAX,_n,)
@@ -47,6 +47,11 @@ _Cx_FUNCTION_DEFINITION(_f,_F,_fp,_ftype,N,__art_gv)
 
 #define _Cx_FUNCTION_DEFINITION(_f,_F,_fp,_ftype,_n,__art_gv) \
 \
+_Cx_BASIC_FUNCTION_DEFINITION(_f,_F,_fp,_ftype,_n,__art_gv) \
+_Cx_ARITHMETIC_FUNCTION_DEFINITION(_f,_F,_fp,_ftype,_n,__art_gv)
+
+#define _Cx_BASIC_FUNCTION_DEFINITION(_f,_F,_fp,_ftype,_n,__art_gv) \
+\
 void _f##c##_n##_##_fp##_init_c( \
         ART_Cx_CONTEXT_ARGUMENT \
         const _ftype         d0, \
@@ -187,35 +192,100 @@ void _f##c##_n##_c_fast_inv_c( \
               _F##Crd##_n  * cr  \
         ); \
 \
-void _f##c##_n##_inv_c( \
+void _f##c##_n##_norm_c( \
         ART_Cx_CONTEXT_ARGUMENT \
               _F##Crd##_n  * cr \
         ); \
 \
-void _f##c##_n##_c_inv_c( \
+void _f##c##_n##_c_norm_c( \
         ART_Cx_CONTEXT_ARGUMENT \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ); \
 \
-void _f##c##_n##_norm_c( \
+void _f##c##_n##_##_fp##_atomic_add_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const _ftype         d0, \
+              _F##Crd##_n  * cr  \
+        ); \
+\
+void _f##c##_n##_c_atomic_add_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const _F##Crd##_n  * c0, \
+              _F##Crd##_n  * cr  \
+        ); \
+\
+void _f##c##_n##_dc_pow_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const double         d0, \
+        const _F##Crd##_n  * c0, \
+              _F##Crd##_n  * cr  \
+        ); \
+\
+void _f##c##_n##_cd_pow_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const _F##Crd##_n  * c0, \
+        const double         d0, \
+              _F##Crd##_n  * cr  \
+        ); \
+\
+void _f##c##_n##_cd_negpow_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const _F##Crd##_n  * c0, \
+        const double         d0, \
+              _F##Crd##_n  * cr  \
+        ); \
+\
+void _f##c##_n##_sqrt_c(  \
         ART_Cx_CONTEXT_ARGUMENT \
               _F##Crd##_n  * cr \
         ); \
 \
-void _f##c##_n##_c_norm_c( \
+void _f##c##_n##_c_sqrt_c( \
         ART_Cx_CONTEXT_ARGUMENT \
         const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ); \
 \
-void _f##c##_n##_##_fp##_add_c( \
+void _f##c##_n##_exp_c(  \
         ART_Cx_CONTEXT_ARGUMENT \
-        const _ftype         d0, \
+              _F##Crd##_n  * cr \
+        ); \
+\
+void _f##c##_n##_c_exp_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const _F##Crd##_n  * c0, \
               _F##Crd##_n  * cr  \
         ); \
 \
-void _f##c##_n##_##_fp##_atomic_add_c( \
+void _f##c##_n##_negexp_c(  \
+        ART_Cx_CONTEXT_ARGUMENT \
+              _F##Crd##_n  * cr \
+        ); \
+\
+void _f##c##_n##_c_negexp_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const _F##Crd##_n  * c0, \
+              _F##Crd##_n  * cr  \
+        );
+
+//   The element-wise arithmetic, which a Cx type can also provide
+//   otherwise (see C4.h), cf. _Cx_ARITHMETIC_IMPLEMENTATION.
+
+#define _Cx_ARITHMETIC_FUNCTION_DEFINITION(_f,_F,_fp,_ftype,_n,__art_gv) \
+\
+void _f##c##_n##_inv_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+              _F##Crd##_n  * cr \
+        ); \
+\
+void _f##c##_n##_c_inv_c( \
+        ART_Cx_CONTEXT_ARGUMENT \
+        const _F##Crd##_n  * c0, \
+              _F##Crd##_n  * cr  \
+        ); \
+\
+void _f##c##_n##_##_fp##_add_c( \
         ART_Cx_CONTEXT_ARGUMENT \
         const _ftype         d0, \
               _F##Crd##_n  * cr  \
@@ -245,12 +315,6 @@ void _f##c##_n##_c_add_c( \
               _F##Crd##_n  * cr  \
         ); \
 \
-void _f##c##_n##_c_atomic_add_c( \
-        ART_Cx_CONTEXT_ARGUMENT \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
-        ); \
-\
 void _f##c##_n##_c_sub_c( \
         ART_Cx_CONTEXT_ARGUMENT \
         const _F##Crd##_n  * c0, \
@@ -338,61 +402,6 @@ void _f##c##_n##_##_fp##c_div_c( \
               _F##Crd##_n  * cr  \
         ); \
 \
-void _f##c##_n##_dc_pow_c( \
-        ART_Cx_CONTEXT_ARGUMENT \
-        const double         d0, \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
-        ); \
-\
-void _f##c##_n##_cd_pow_c( \
-        ART_Cx_CONTEXT_ARGUMENT \
-        const _F##Crd##_n  * c0, \
-        const double         d0, \
-              _F##Crd##_n  * cr  \
-        ); \
-\
-void _f##c##_n##_cd_negpow_c( \
-        ART_Cx_CONTEXT_ARGUMENT \
-        const _F##Crd##_n  * c0, \
-        const double         d0, \
-              _F##Crd##_n  * cr  \
-        ); \
-\
-void _f##c##_n##_sqrt_c(  \
-        ART_Cx_CONTEXT_ARGUMENT \
-              _F##Crd##_n  * cr \
-        ); \
-\
-void _f##c##_n##_c_sqrt_c( \
-        ART_Cx_CONTEXT_ARGUMENT \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
-        ); \
-\
-\
-void _f##c##_n##_exp_c(  \
-        ART_Cx_CONTEXT_ARGUMENT \
-              _F##Crd##_n  * cr \
-        ); \
-\
-void _f##c##_n##_c_exp_c( \
-        ART_Cx_CONTEXT_ARGUMENT \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
-        ); \
-\
-void _f##c##_n##_negexp_c(  \
-        ART_Cx_CONTEXT_ARGUMENT \
-              _F##Crd##_n  * cr \
-        ); \
-\
-void _f##c##_n##_c_negexp_c( \
-        ART_Cx_CONTEXT_ARGUMENT \
-        const _F##Crd##_n  * c0, \
-              _F##Crd##_n  * cr  \
-        ); \
-\
 void _f##c##_n##_##_fp##c_add_c( \
         ART_Cx_CONTEXT_ARGUMENT \
         const _ftype         d0, \
@@ -482,6 +491,20 @@ void _f##c##_n##_##_fp##c_mul_##_fp##c_mul_##_fp##c_mul_add3_c( \
 \
 _Cx_DEFINITION(,,d,double,_n) \
 _Cx_DEFINITION(f,F,f,float,_n) \
+_Cx_CONVERSION_DEFINITION(_n)
+
+//   For a Cx type whose double precision element-wise arithmetic is
+//   defined by hand (currently only C4, see C4.h).
+
+#define Cx_DEFINITION_WITHOUT_DOUBLE_ARITHMETIC(_n) \
+\
+typedef struct { double x[(_n)]; } Crd##_n; \
+\
+_Cx_BASIC_FUNCTION_DEFINITION(,,d,double,_n,) \
+_Cx_DEFINITION(f,F,f,float,_n) \
+_Cx_CONVERSION_DEFINITION(_n)
+
+#define _Cx_CONVERSION_DEFINITION(_n) \
 \
 void c##_n##_c_to_fc( \
         const Crd##_n   * crd, \
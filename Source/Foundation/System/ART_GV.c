@@ -31,7 +31,7 @@ void art_gv_initialise(
         ART_GV  * art_gv
         )
 {
-    //   currently, there are 67 struct pointers
+    //   currently, there are 69 struct pointers
     //   10 NULL per line, plus one zero in the beginning
     //   ( for the verbosity int )
 
@@ -44,7 +44,7 @@ void art_gv_initialise(
           NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
           NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
           NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-          NULL, NULL, NULL, NULL, NULL, NULL, NULL
+          NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
         });
 }
 
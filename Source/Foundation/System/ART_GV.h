@@ -213,6 +213,10 @@ typedef struct ART_GV
     struct ARM_RayCasting_GV            * ar2m_raycasting_gv;
     struct ARM_ScenegraphActions_GV     * ar2m_scenegraphactions_gv;
     struct ApplicationSupport_GV        * application_support_gv;
+
+    //   67..68
+    struct ArnRayCaster_GV              * arnraycaster_gv;
+    struct ArnTiledStochasticSampler_GV * arntiledstochasticsampler_gv;
 }
 ART_GV;
 